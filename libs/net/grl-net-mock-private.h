@@ -44,6 +44,11 @@ void get_content_mocked (GrlNetWc *self,
                          gchar **content,
                          gsize *length);
 
+G_GNUC_INTERNAL
+GInputStream *get_stream_mocked (GrlNetWc *self,
+                                 void *op,
+                                 GError **error);
+
 G_GNUC_INTERNAL
 void init_mock_requester (GrlNetWc *self);
 
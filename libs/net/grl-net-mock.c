@@ -156,6 +156,34 @@ get_content_mocked (GrlNetWc *self,
   g_clear_pointer (&full_path, g_free);
 }
 
+GInputStream *
+get_stream_mocked (GrlNetWc *self,
+                   void *op,
+                   GError **error)
+{
+  char *url = (char *) op;
+  char *data_file = NULL, *full_path = NULL;
+  GFile *file;
+  GFileInputStream *stream;
+
+  data_file = g_key_file_get_value (config, url, "data", NULL);
+  if (data_file[0] != '/') {
+    full_path = g_build_filename (base_path, data_file, NULL);
+  } else {
+    full_path = data_file;
+    data_file = NULL;
+  }
+
+  file = g_file_new_for_path (full_path);
+  stream = g_file_read (file, NULL, error);
+  g_object_unref (file);
+
+  g_clear_pointer (&data_file, g_free);
+  g_clear_pointer (&full_path, g_free);
+
+  return G_INPUT_STREAM (stream);
+}
+
 void init_mock_requester (GrlNetWc *self)
 {
   g_atomic_int_inc (&refcount);
@@ -49,6 +49,12 @@
 #include <libsoup/soup.h>
 #include <string.h>
 
+#ifdef G_OS_UNIX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
 #include <grilo.h>
 #include "grl-net-wc.h"
 #include "grl-net-mock-private.h"
@@ -60,15 +66,26 @@ GRL_LOG_DOMAIN_STATIC(wc_log_domain);
 
 enum {
   PROP_0,
+  PROP_SHARED_SESSION,
   PROP_LOG_LEVEL,
   PROP_THROTTLING,
+  PROP_THROTTLING_MS,
   PROP_CACHE,
   PROP_CACHE_SIZE,
-  PROP_USER_AGENT
+  PROP_CACHE_NAME,
+  PROP_STALE_WHILE_REVALIDATE,
+  PROP_USER_AGENT,
+  PROP_RATE_LIMIT,
+  PROP_RATE_BURST,
+  PROP_MAX_REQUESTS_PER_HOST
 };
 
 struct request_res {
+  GrlNetWc *self;
   SoupRequest *request;
+  gchar *host;
+  gboolean stream;
+  GInputStream *input;
   gchar *buffer;
   gsize length;
   gsize offset;
@@ -76,20 +93,58 @@ struct request_res {
 
 struct _GrlNetWcPrivate {
   SoupSession *session;
+  gboolean shared_session;
+  gchar *user_agent;
   SoupLoggerLogLevel log_level;
-  /* throttling in secs */
-  guint throttling;
-  /* last request time  */
-  GTimeVal last_request;
-  /* closure queue for delayed requests */
+  /* throttling in ms */
+  guint throttling_ms;
+  /* token bucket: requests per second, and how many can be sent at once */
+  gdouble rate;
+  guint burst;
+  gdouble tokens;
+  gint64 tokens_time;
+  /* running requests per host, and how many are allowed */
+  GHashTable *in_flight;
+  guint max_per_host;
+  /* closure queue for delayed requests, sorted by priority */
   GQueue *pending;
+  guint dispatch_id;
   /* cache size in Mb */
   guint cache_size;
+  /* name of the persistent cache, or NULL for a temporary one */
+  gchar *cache_name;
+  /* seconds a stale cached response can be used while it is refreshed */
+  guint stale_while_revalidate;
+  /* urls being refreshed in the background */
+  GHashTable *revalidating;
   gchar *previous_data;
 };
 
 static const char *capture_dir = NULL;
 
+/* Persistent caches, by name. The instances of a process using a name
+   share one SoupCache; the processes share its directory and index */
+struct named_cache {
+  SoupCache *cache;
+  /* holds the locks and the cache directory, which SoupCache empties */
+  gchar *dir;
+  guint users;
+  /* shared lock on users.lock while this process uses the cache */
+  gint users_fd;
+  /* identifies the index last loaded */
+  gchar *index_stamp;
+};
+
+G_LOCK_DEFINE_STATIC (named_caches);
+static GHashTable *named_caches = NULL;
+
+#define NAMED_CACHE_KEY "grl-net-wc-cache-name"
+
+/* Session shared by the instances created with GrlNetWc:shared-session */
+G_LOCK_DEFINE_STATIC (shared_session);
+static SoupSession *shared_session = NULL;
+static guint shared_session_users = 0;
+
 GQuark
 grl_net_wc_error_quark (void)
 {
@@ -118,6 +173,26 @@ grl_net_wc_class_init (GrlNetWcClass *klass)
   g_klass->set_property = grl_net_wc_set_property;
   g_klass->get_property = grl_net_wc_get_property;
 
+  /**
+   * GrlNetWc::shared-session:
+   *
+   * %TRUE if the HTTP session is shared with the other instances created with
+   * this property set, so connections to the same servers are reused. The
+   * log level, cache and cache size are then settings of the shared session,
+   * and changing them affects all those instances.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_SHARED_SESSION,
+                                   g_param_spec_boolean ("shared-session",
+                                                         "Shared session",
+                                                         "Share the HTTP session with other instances",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY |
+                                                         G_PARAM_STATIC_STRINGS));
+
   /**
    * GrlNetWc::loglevel:
    *
@@ -146,6 +221,21 @@ grl_net_wc_class_init (GrlNetWcClass *klass)
                                                       0, G_MAXUINT, 0,
                                                       G_PARAM_READWRITE |
                                                       G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::throttling-ms:
+   *
+   * Like #GrlNetWc:throttling, but in milliseconds.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_THROTTLING_MS,
+                                   g_param_spec_uint ("throttling-ms",
+                                                      "throttle timeout in ms",
+                                                      "Time to throttle connections, in milliseconds",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
   /**
    * GrlNetWc::cache:
    *
@@ -174,6 +264,39 @@ grl_net_wc_class_init (GrlNetWcClass *klass)
                                                       G_PARAM_READWRITE |
                                                       G_PARAM_CONSTRUCT |
                                                       G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::cache-name:
+   *
+   * Name of a persistent cache, or %NULL to use a temporary one. See
+   * grl_net_wc_set_cache_name().
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_CACHE_NAME,
+                                   g_param_spec_string ("cache-name",
+                                                        "Cache name",
+                                                        "Name of the persistent cache",
+                                                        NULL,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::stale-while-revalidate:
+   *
+   * Number of seconds a cached response can still be used after it expired,
+   * while it is refreshed in the background. See
+   * grl_net_wc_set_stale_while_revalidate().
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_STALE_WHILE_REVALIDATE,
+                                   g_param_spec_uint ("stale-while-revalidate",
+                                                      "Stale while revalidate",
+                                                      "Seconds an expired cached response can be used",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
   /**
    * GrlNetWc::user-agent:
    *
@@ -188,6 +311,55 @@ grl_net_wc_class_init (GrlNetWcClass *klass)
                                                         G_PARAM_READWRITE |
                                                         G_PARAM_CONSTRUCT |
                                                         G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::rate-limit:
+   *
+   * Maximum number of requests sent per second, or 0 for no limit. Requests
+   * above the limit are queued, and sent by priority as soon as the rate
+   * allows it.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_RATE_LIMIT,
+                                   g_param_spec_double ("rate-limit",
+                                                        "Rate limit",
+                                                        "Maximum number of requests per second",
+                                                        0, G_MAXDOUBLE, 0,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::rate-burst:
+   *
+   * Number of requests that can be sent at once, without waiting, when the
+   * rate limit was not reached for a while.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_RATE_BURST,
+                                   g_param_spec_uint ("rate-burst",
+                                                      "Rate burst",
+                                                      "Number of requests that can be sent at once",
+                                                      1, G_MAXUINT, 1,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlNetWc::max-requests-per-host:
+   *
+   * Maximum number of requests running at the same time against the same
+   * host, or 0 for no limit.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (g_klass,
+                                   PROP_MAX_REQUESTS_PER_HOST,
+                                   g_param_spec_uint ("max-requests-per-host",
+                                                      "Maximum requests per host",
+                                                      "Maximum number of running requests per host",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -195,7 +367,14 @@ free_op_res (void *op)
 {
   struct request_res *rr = op;
 
-  g_object_unref (rr->request);
+  /* Requests cancelled before being sent have no result */
+  if (!rr)
+    return;
+
+  g_clear_object (&rr->request);
+  g_clear_object (&rr->input);
+  g_free (rr->host);
+  g_free (rr->buffer);
   g_slice_free (struct request_res, rr);
 }
 
@@ -233,12 +412,226 @@ init_dump_directory (void)
   }
 }
 
+static gint
+named_cache_open_lock (const gchar *dir,
+                       const gchar *name)
+{
+#ifdef G_OS_UNIX
+  gchar *path;
+  gint fd;
+
+  path = g_build_filename (dir, name, NULL);
+  fd = g_open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0)
+    GRL_WARNING ("Could not open lock file \"%s\": %s",
+                 path, g_strerror (errno));
+  g_free (path);
+
+  return fd;
+#else
+  return -1;
+#endif
+}
+
 static void
-cache_down (GrlNetWc *self)
+named_cache_close_lock (gint fd)
+{
+#ifdef G_OS_UNIX
+  if (fd >= 0)
+    close (fd);
+#endif
+}
+
+/* Serializes the accesses of all the processes to the index; released by
+   closing the returned descriptor */
+static gint
+named_cache_lock_index (struct named_cache *nc)
+{
+  gint fd;
+
+  fd = named_cache_open_lock (nc->dir, "index.lock");
+#ifdef G_OS_UNIX
+  if (fd >= 0 && flock (fd, LOCK_EX) != 0)
+    GRL_WARNING ("Could not lock the index of cache \"%s\": %s",
+                 nc->dir, g_strerror (errno));
+#endif
+
+  return fd;
+}
+
+/* Whether no other process uses the cache. Called with the index locked,
+   which every process holds to take or drop users.lock, so it can not be
+   raced */
+static gboolean
+named_cache_is_alone (struct named_cache *nc)
+{
+#ifdef G_OS_UNIX
+  return nc->users_fd >= 0 && flock (nc->users_fd, LOCK_EX | LOCK_NB) == 0;
+#else
+  return TRUE;
+#endif
+}
+
+/* Identifies the current index file, which is replaced on each dump, or
+   NULL if there is none */
+static gchar *
+named_cache_index_stamp (struct named_cache *nc)
+{
+  GStatBuf st;
+  gchar *path;
+  gchar *stamp = NULL;
+
+  /* Index file name used by libsoup */
+  path = g_build_filename (nc->dir, "cache", "soup.cache2", NULL);
+  if (g_stat (path, &st) == 0)
+    stamp = g_strdup_printf ("%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+                             (guint64) st.st_ino,
+                             (gint64) st.st_mtime,
+                             (gint64) st.st_size);
+  g_free (path);
+
+  return stamp;
+}
+
+static struct named_cache *
+named_cache_new (const gchar *name)
+{
+  struct named_cache *nc;
+  gchar *dir, *cache_dir, *clean_path;
+  gint index_fd;
+
+  dir = g_build_filename (g_get_user_cache_dir (), "grilo", "net", name, NULL);
+  cache_dir = g_build_filename (dir, "cache", NULL);
+  if (g_mkdir_with_parents (cache_dir, 0700) != 0) {
+    GRL_WARNING ("Could not create cache directory \"%s\": %s",
+                 cache_dir, g_strerror (errno));
+    g_free (cache_dir);
+    g_free (dir);
+    return NULL;
+  }
+
+  nc = g_slice_new (struct named_cache);
+  nc->cache = soup_cache_new (cache_dir, SOUP_CACHE_SINGLE_USER);
+  nc->dir = dir;
+  g_free (cache_dir);
+  nc->users = 0;
+  nc->users_fd = named_cache_open_lock (dir, "users.lock");
+  g_object_set_data_full (G_OBJECT (nc->cache), NAMED_CACHE_KEY,
+                          g_strdup (name), g_free);
+
+  index_fd = named_cache_lock_index (nc);
+
+  /* The marker is left by the last process closing the cache, once the
+     index lists all of its files. Without it, a process died and its
+     files would never be removed, so start from scratch. Only possible
+     when no other process is using the directory */
+  clean_path = g_build_filename (dir, "clean", NULL);
+  if (!named_cache_is_alone (nc) || g_unlink (clean_path) == 0) {
+    soup_cache_load (nc->cache);
+  } else {
+    GRL_DEBUG ("discarding unclean cache %s", dir);
+    soup_cache_clear (nc->cache);
+  }
+  g_free (clean_path);
+  nc->index_stamp = named_cache_index_stamp (nc);
+
+#ifdef G_OS_UNIX
+  if (nc->users_fd >= 0)
+    flock (nc->users_fd, LOCK_SH);
+#endif
+
+  named_cache_close_lock (index_fd);
+
+  return nc;
+}
+
+/* Saves the index when the process is done with the cache. If other
+   processes saved it meanwhile, their entries are loaded first so they
+   are kept; theirs win for the responses both have */
+static void
+named_cache_close (struct named_cache *nc)
+{
+  gchar *clean_path, *stamp;
+  gint index_fd;
+
+  index_fd = named_cache_lock_index (nc);
+
+  /* Loading our own index again would bring back the entries replaced
+     since */
+  stamp = named_cache_index_stamp (nc);
+  if (g_strcmp0 (stamp, nc->index_stamp) != 0)
+    soup_cache_load (nc->cache);
+  g_free (stamp);
+
+  /* Not flushed: that would run the session of the instance being
+     disposed. Responses still being written are left out of the index */
+  soup_cache_dump (nc->cache);
+
+  if (named_cache_is_alone (nc)) {
+    clean_path = g_build_filename (nc->dir, "clean", NULL);
+    if (!g_file_set_contents (clean_path, "", 0, NULL))
+      GRL_WARNING ("Could not mark cache %s as clean", nc->dir);
+    g_free (clean_path);
+  }
+
+  named_cache_close_lock (nc->users_fd);
+  named_cache_close_lock (index_fd);
+}
+
+static SoupCache *
+named_cache_get (const gchar *name)
+{
+  struct named_cache *nc;
+
+  G_LOCK (named_caches);
+
+  if (!named_caches)
+    named_caches = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, NULL);
+
+  nc = g_hash_table_lookup (named_caches, name);
+  if (!nc) {
+    nc = named_cache_new (name);
+    if (!nc) {
+      G_UNLOCK (named_caches);
+      return NULL;
+    }
+    g_hash_table_insert (named_caches, g_strdup (name), nc);
+  }
+  nc->users++;
+
+  G_UNLOCK (named_caches);
+
+  return g_object_ref (nc->cache);
+}
+
+static void
+named_cache_release (SoupCache *cache)
+{
+  struct named_cache *nc;
+  const gchar *name;
+
+  G_LOCK (named_caches);
+
+  name = g_object_get_data (G_OBJECT (cache), NAMED_CACHE_KEY);
+  nc = g_hash_table_lookup (named_caches, name);
+  if (nc && --nc->users == 0) {
+    named_cache_close (nc);
+    g_hash_table_remove (named_caches, name);
+    g_object_unref (nc->cache);
+    g_free (nc->index_stamp);
+    g_free (nc->dir);
+    g_slice_free (struct named_cache, nc);
+  }
+
+  G_UNLOCK (named_caches);
+}
+
+static void
+session_cache_down (SoupSession *session)
 {
   GFile *cache_dir_file;
-  GrlNetWcPrivate *priv = self->priv;
-  SoupSessionFeature *cache = soup_session_get_feature (priv->session, SOUP_TYPE_CACHE);
+  SoupSessionFeature *cache = soup_session_get_feature (session, SOUP_TYPE_CACHE);
   gchar *cache_dir;
 
   GRL_DEBUG ("cache down");
@@ -247,6 +640,13 @@ cache_down (GrlNetWc *self)
     return;
   }
 
+  /* Persistent caches are saved instead of removed */
+  if (g_object_get_data (G_OBJECT (cache), NAMED_CACHE_KEY)) {
+    named_cache_release (SOUP_CACHE (cache));
+    soup_session_remove_feature (session, cache);
+    return;
+  }
+
   soup_cache_clear (SOUP_CACHE (cache));
 
   g_object_get (cache, "cache-dir", &cache_dir, NULL);
@@ -256,7 +656,13 @@ cache_down (GrlNetWc *self)
   g_file_delete (cache_dir_file, NULL, NULL);
   g_object_unref (G_OBJECT (cache_dir_file));
 
-  soup_session_remove_feature (priv->session, cache);
+  soup_session_remove_feature (session, cache);
+}
+
+static void
+cache_down (GrlNetWc *self)
+{
+  session_cache_down (self->priv->session);
 }
 
 static void
@@ -268,12 +674,18 @@ cache_up (GrlNetWc *self)
 
   GRL_DEBUG ("cache up");
 
-  dir = g_dir_make_tmp ("grilo-plugin-cache-XXXXXX", NULL);
-  if (!dir)
-    return;
+  /* Falls back to a temporary cache if the persistent one is not
+     available */
+  cache = priv->cache_name ? named_cache_get (priv->cache_name) : NULL;
+
+  if (!cache) {
+    dir = g_dir_make_tmp ("grilo-plugin-cache-XXXXXX", NULL);
+    if (!dir)
+      return;
 
-  cache = soup_cache_new (dir, SOUP_CACHE_SINGLE_USER);
-  g_free (dir);
+    cache = soup_cache_new (dir, SOUP_CACHE_SINGLE_USER);
+    g_free (dir);
+  }
 
   soup_session_add_feature (priv->session,
                             SOUP_SESSION_FEATURE (cache));
@@ -302,10 +714,49 @@ finalize_requester (GrlNetWc *self)
 {
   GrlNetWcPrivate *priv = self->priv;
 
-  cache_down (self);
+  /* The shared session keeps its cache while other instances use it */
+  if (!priv->shared_session)
+    cache_down (self);
   g_free (priv->previous_data);
 }
 
+/* Replaces the own session of @self by the shared one, keeping the cache
+   setting */
+static void
+use_shared_session (GrlNetWc *self)
+{
+  GrlNetWcPrivate *priv = self->priv;
+  gboolean use_cache;
+
+  use_cache = cache_is_available (self);
+  cache_down (self);
+  g_object_unref (priv->session);
+
+  G_LOCK (shared_session);
+  if (!shared_session)
+    shared_session = soup_session_async_new ();
+  shared_session_users++;
+  priv->session = g_object_ref (shared_session);
+  priv->shared_session = TRUE;
+  G_UNLOCK (shared_session);
+
+  set_thread_context (self);
+
+  if (use_cache && !cache_is_available (self))
+    cache_up (self);
+}
+
+static void
+release_shared_session (GrlNetWc *self)
+{
+  G_LOCK (shared_session);
+  if (--shared_session_users == 0) {
+    session_cache_down (shared_session);
+    g_clear_object (&shared_session);
+  }
+  G_UNLOCK (shared_session);
+}
+
 static void
 grl_net_wc_init (GrlNetWc *wc)
 {
@@ -315,6 +766,11 @@ grl_net_wc_init (GrlNetWc *wc)
 
   wc->priv->session = soup_session_async_new ();
   wc->priv->pending = g_queue_new ();
+  wc->priv->in_flight = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, NULL);
+  wc->priv->burst = 1;
+  wc->priv->revalidating = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, NULL);
 
   set_thread_context (wc);
   init_mock_requester (wc);
@@ -329,12 +785,20 @@ grl_net_wc_finalize (GObject *object)
   wc = GRL_NET_WC (object);
   grl_net_wc_flush_delayed_requests (wc);
 
-  cache_down (wc);
+  if (wc->priv->dispatch_id)
+    g_source_remove (wc->priv->dispatch_id);
+
   finalize_requester (wc);
   finalize_mock_requester (wc);
 
   g_queue_free (wc->priv->pending);
+  g_hash_table_unref (wc->priv->in_flight);
+  g_hash_table_unref (wc->priv->revalidating);
+  g_free (wc->priv->cache_name);
+  g_free (wc->priv->user_agent);
   g_object_unref (wc->priv->session);
+  if (wc->priv->shared_session)
+    release_shared_session (wc);
 
   G_OBJECT_CLASS (grl_net_wc_parent_class)->finalize (object);
 }
@@ -350,22 +814,48 @@ grl_net_wc_set_property (GObject *object,
   wc = GRL_NET_WC (object);
 
   switch (propid) {
+  case PROP_SHARED_SESSION:
+    if (g_value_get_boolean (value))
+      use_shared_session (wc);
+    break;
   case PROP_LOG_LEVEL:
     grl_net_wc_set_log_level (wc, g_value_get_uint (value));
     break;
   case PROP_THROTTLING:
     grl_net_wc_set_throttling (wc, g_value_get_uint (value));
     break;
+  case PROP_THROTTLING_MS:
+    grl_net_wc_set_throttling_ms (wc, g_value_get_uint (value));
+    break;
   case PROP_CACHE:
     grl_net_wc_set_cache (wc, g_value_get_boolean (value));
     break;
   case PROP_CACHE_SIZE:
     grl_net_wc_set_cache_size (wc, g_value_get_uint (value));
     break;
+  case PROP_CACHE_NAME:
+    grl_net_wc_set_cache_name (wc, g_value_get_string (value));
+    break;
+  case PROP_STALE_WHILE_REVALIDATE:
+    grl_net_wc_set_stale_while_revalidate (wc, g_value_get_uint (value));
+    break;
   case PROP_USER_AGENT:
-    g_object_set (G_OBJECT (wc->priv->session),
-                  "user-agent", g_value_get_string (value),
-                  NULL);
+    g_free (wc->priv->user_agent);
+    wc->priv->user_agent = g_value_dup_string (value);
+    /* With a shared session it is set in each request */
+    if (!wc->priv->shared_session)
+      g_object_set (G_OBJECT (wc->priv->session),
+                    "user-agent", wc->priv->user_agent,
+                    NULL);
+    break;
+  case PROP_RATE_LIMIT:
+    grl_net_wc_set_rate_limit (wc, g_value_get_double (value), wc->priv->burst);
+    break;
+  case PROP_RATE_BURST:
+    grl_net_wc_set_rate_limit (wc, wc->priv->rate, g_value_get_uint (value));
+    break;
+  case PROP_MAX_REQUESTS_PER_HOST:
+    grl_net_wc_set_max_requests_per_host (wc, g_value_get_uint (value));
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (wc, propid, pspec);
@@ -383,11 +873,17 @@ grl_net_wc_get_property (GObject *object,
   wc = GRL_NET_WC (object);
 
   switch (propid) {
+  case PROP_SHARED_SESSION:
+    g_value_set_boolean (value, wc->priv->shared_session);
+    break;
   case PROP_LOG_LEVEL:
     g_value_set_uint (value, wc->priv->log_level);
     break;
   case PROP_THROTTLING:
-    g_value_set_uint (value, wc->priv->throttling);
+    g_value_set_uint (value, wc->priv->throttling_ms / 1000);
+    break;
+  case PROP_THROTTLING_MS:
+    g_value_set_uint (value, wc->priv->throttling_ms);
     break;
   case PROP_CACHE:
     g_value_set_boolean(value, cache_is_available (wc));
@@ -395,8 +891,23 @@ grl_net_wc_get_property (GObject *object,
   case PROP_CACHE_SIZE:
     g_value_set_uint (value, wc->priv->cache_size);
     break;
+  case PROP_CACHE_NAME:
+    g_value_set_string (value, wc->priv->cache_name);
+    break;
+  case PROP_STALE_WHILE_REVALIDATE:
+    g_value_set_uint (value, wc->priv->stale_while_revalidate);
+    break;
   case PROP_USER_AGENT:
-    g_object_get_property (G_OBJECT (wc->priv->session), "user_agent", value);
+    g_value_set_string (value, wc->priv->user_agent);
+    break;
+  case PROP_RATE_LIMIT:
+    g_value_set_double (value, wc->priv->rate);
+    break;
+  case PROP_RATE_BURST:
+    g_value_set_uint (value, wc->priv->burst);
+    break;
+  case PROP_MAX_REQUESTS_PER_HOST:
+    g_value_set_uint (value, wc->priv->max_per_host);
     break;
   default:
     G_OBJECT_WARN_INVALID_PROPERTY_ID (wc, propid, pspec);
@@ -406,10 +917,12 @@ grl_net_wc_get_property (GObject *object,
 struct request_clos {
   GrlNetWc *self;
   char *url;
+  gchar *host;
+  gint priority;
+  gboolean stream;
   GAsyncResult *result;
   GCancellable *cancellable;
   GHashTable *headers;
-  guint source_id;
 };
 
 static void
@@ -418,11 +931,214 @@ request_clos_destroy (gpointer data)
   struct request_clos *c = (struct request_clos *) data;
 
   g_free (c->url);
+  g_free (c->host);
   g_clear_object (&c->cancellable);
   g_clear_pointer (&c->headers, g_hash_table_unref);
   g_free (c);
 }
 
+static gboolean dispatch_pending (gpointer user_data);
+
+static void
+schedule_dispatch (GrlNetWc *self)
+{
+  GrlNetWcPrivate *priv = self->priv;
+
+  /* Either already scheduled, or waiting for the rate limit */
+  if (priv->dispatch_id)
+    return;
+
+  priv->dispatch_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                       dispatch_pending, self, NULL);
+  g_source_set_name_by_id (priv->dispatch_id, "[grl-net] dispatch_pending");
+}
+
+/* Called when a request sent to @host completes, so the next ones to the same
+   host can be sent */
+static void
+request_done (GrlNetWc *self,
+              const gchar *host)
+{
+  GrlNetWcPrivate *priv = self->priv;
+  guint running;
+
+  running = GPOINTER_TO_UINT (g_hash_table_lookup (priv->in_flight, host));
+  if (running > 1)
+    g_hash_table_insert (priv->in_flight, g_strdup (host),
+                         GUINT_TO_POINTER (running - 1));
+  else
+    g_hash_table_remove (priv->in_flight, host);
+
+  if (!g_queue_is_empty (priv->pending))
+    schedule_dispatch (self);
+}
+
+/* A streamed request is done when its stream is gone */
+struct stream_done {
+  GrlNetWc *self;
+  gchar *host;
+};
+
+static void
+stream_done_cb (gpointer user_data,
+                GObject *where_the_object_was)
+{
+  struct stream_done *sd = user_data;
+
+  if (sd->self) {
+    g_object_remove_weak_pointer (G_OBJECT (sd->self), (gpointer *) &sd->self);
+    request_done (sd->self, sd->host);
+  }
+
+  g_free (sd->host);
+  g_slice_free (struct stream_done, sd);
+}
+
+static void
+watch_stream (GrlNetWc *self,
+              const gchar *host,
+              GInputStream *stream)
+{
+  struct stream_done *sd = g_slice_new (struct stream_done);
+
+  sd->self = self;
+  sd->host = g_strdup (host);
+  g_object_add_weak_pointer (G_OBJECT (self), (gpointer *) &sd->self);
+  g_object_weak_ref (G_OBJECT (stream), stream_done_cb, sd);
+}
+
+/* Whether the response is older than its lifetime */
+static gboolean
+response_is_stale (SoupMessageHeaders *headers)
+{
+  const char *value;
+  SoupDate *date;
+  GHashTable *params;
+  gchar *max_age;
+  gint64 date_time, age, lifetime = -1;
+
+  value = soup_message_headers_get_one (headers, "Date");
+  date = value ? soup_date_new_from_string (value) : NULL;
+  if (!date)
+    return FALSE;
+  date_time = soup_date_to_time_t (date);
+  soup_date_free (date);
+
+  value = soup_message_headers_get_list (headers, "Cache-Control");
+  if (value) {
+    params = soup_header_parse_param_list (value);
+    if (g_hash_table_lookup_extended (params, "max-age",
+                                      NULL, (gpointer *) &max_age) &&
+        max_age)
+      lifetime = g_ascii_strtoll (max_age, NULL, 10);
+    soup_header_free_param_list (params);
+  }
+
+  if (lifetime < 0) {
+    value = soup_message_headers_get_one (headers, "Expires");
+    date = value ? soup_date_new_from_string (value) : NULL;
+    if (date) {
+      lifetime = soup_date_to_time_t (date) - date_time;
+      soup_date_free (date);
+    }
+  }
+
+  /* Without an explicit lifetime it is up to the cache */
+  if (lifetime < 0)
+    return FALSE;
+
+  age = g_get_real_time () / G_USEC_PER_SEC - date_time;
+  value = soup_message_headers_get_one (headers, "Age");
+  if (value)
+    age = MAX (age, g_ascii_strtoll (value, NULL, 10));
+
+  return age > lifetime;
+}
+
+#define FROM_NETWORK_KEY "grl-net-wc-from-network"
+
+/* The request went to the server: the response is not the cached one */
+static void
+wrote_headers_cb (SoupMessage *msg,
+                  gpointer user_data)
+{
+  g_object_set_data (G_OBJECT (msg), FROM_NETWORK_KEY, GINT_TO_POINTER (TRUE));
+}
+
+static gboolean
+needs_revalidation (GrlNetWc *self,
+                    SoupMessage *msg)
+{
+  /* Responses just received can be stale as well, but asking again would
+     get the same one */
+  return self->priv->stale_while_revalidate > 0 &&
+    cache_is_available (self) &&
+    !g_object_get_data (G_OBJECT (msg), FROM_NETWORK_KEY) &&
+    response_is_stale (msg->response_headers);
+}
+
+static void
+revalidate_cb (GObject *source_object,
+               GAsyncResult *res,
+               gpointer user_data)
+{
+  GrlNetWc *self = GRL_NET_WC (source_object);
+  gchar *url = user_data;
+  GError *error = NULL;
+  GBytes *bytes;
+
+  bytes = grl_net_wc_request_bytes_finish (self, res, &error);
+  if (error) {
+    GRL_DEBUG ("Could not refresh %s: %s", url, error->message);
+    g_error_free (error);
+  }
+  g_clear_pointer (&bytes, g_bytes_unref);
+
+  g_hash_table_remove (self->priv->revalidating, url);
+  g_free (url);
+}
+
+static void get_url (GrlNetWc *self,
+                     const char *url,
+                     GHashTable *headers,
+                     gint priority,
+                     gboolean stream,
+                     GAsyncResult *result,
+                     GCancellable *cancellable);
+
+/* Refreshes the cached response in the background, so the next request
+   gets an up to date one */
+static void
+revalidate (GrlNetWc *self,
+            SoupRequest *request)
+{
+  GrlNetWcPrivate *priv = self->priv;
+  GSimpleAsyncResult *result;
+  GHashTable *headers;
+  gchar *url;
+
+  url = soup_uri_to_string (soup_request_get_uri (request), FALSE);
+  if (g_hash_table_contains (priv->revalidating, url)) {
+    g_free (url);
+    return;
+  }
+
+  GRL_DEBUG ("refreshing stale response for %s", url);
+  g_hash_table_add (priv->revalidating, g_strdup (url));
+
+  headers = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (headers, "Cache-Control", "max-age=0");
+
+  result = g_simple_async_result_new (G_OBJECT (self),
+                                      revalidate_cb,
+                                      url,
+                                      grl_net_wc_request_async);
+  get_url (self, url, headers, G_PRIORITY_LOW, FALSE,
+           G_ASYNC_RESULT (result), NULL);
+
+  g_hash_table_unref (headers);
+}
+
 static void
 parse_error (guint status,
              const gchar *reason,
@@ -585,6 +1301,8 @@ read_async_cb (GObject *source,
   g_input_stream_close (G_INPUT_STREAM (source), NULL, NULL);
   g_object_unref (source);
 
+  request_done (rr->self, rr->host);
+
   if (error) {
     if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
       g_simple_async_result_set_error (result, G_IO_ERROR,
@@ -612,8 +1330,10 @@ read_async_cb (GObject *source,
                      msg->reason_phrase,
                      msg->response_body->data,
                      G_SIMPLE_ASYNC_RESULT (user_data));
-        g_object_unref (msg);
+    } else if (msg && needs_revalidation (rr->self, msg)) {
+        revalidate (rr->self, rr->request);
     }
+    g_clear_object (&msg);
   }
 
   g_simple_async_result_complete (result);
@@ -629,9 +1349,12 @@ reply_cb (GObject *source,
   struct request_res *rr = g_simple_async_result_get_op_res_gpointer (result);
 
   GError *error = NULL;
+  goffset content_length;
   GInputStream *in = soup_request_send_finish (rr->request, res, &error);
 
   if (error) {
+    request_done (rr->self, rr->host);
+
     if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
       g_simple_async_result_set_from_error (result, error);
     } else {
@@ -646,8 +1369,35 @@ reply_cb (GObject *source,
     return;
   }
 
-  rr->length = soup_request_get_content_length (rr->request) + 1;
-  if (rr->length == 1)
+  if (rr->stream) {
+    SoupMessage *msg =
+      soup_request_http_get_message (SOUP_REQUEST_HTTP (rr->request));
+
+    if (msg && msg->status_code != SOUP_STATUS_OK) {
+      /* The body is not read, so the reason is all there is */
+      parse_error (msg->status_code, msg->reason_phrase, NULL, result);
+      g_object_unref (in);
+      request_done (rr->self, rr->host);
+    } else {
+      watch_stream (rr->self, rr->host, in);
+      rr->input = in;
+
+      if (msg && needs_revalidation (rr->self, msg))
+        revalidate (rr->self, rr->request);
+    }
+    g_clear_object (&msg);
+
+    g_simple_async_result_complete (result);
+    g_object_unref (result);
+    return;
+  }
+
+  /* Read straight into a buffer of the announced size, plus the nul byte,
+     so it does not need to grow */
+  content_length = soup_request_get_content_length (rr->request);
+  if (content_length > 0)
+    rr->length = content_length + 1;
+  else
     rr->length = 50 * 1024;
 
   rr->buffer = g_new (gchar, rr->length);
@@ -664,14 +1414,21 @@ reply_cb (GObject *source,
 static void
 get_url_now (GrlNetWc *self,
              const char *url,
+             const gchar *host,
+             gboolean stream,
              GHashTable *headers,
              GAsyncResult *result,
              GCancellable *cancellable)
 {
   GrlNetWcPrivate *priv = self->priv;
   SoupURI *uri;
+  gboolean max_stale;
   struct request_res *rr = g_slice_new0 (struct request_res);
 
+  rr->self = self;
+  rr->host = g_strdup (host);
+  rr->stream = stream;
+
   g_simple_async_result_set_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result),
                                              rr,
                                              NULL);
@@ -685,6 +1442,7 @@ get_url_now (GrlNetWc *self,
   }
 
   if (!rr->request) {
+    request_done (self, host);
     g_simple_async_result_set_error (G_SIMPLE_ASYNC_RESULT (result),
                                      G_IO_ERROR,
                                      G_IO_ERROR_INVALID_ARGUMENT,
@@ -695,7 +1453,9 @@ get_url_now (GrlNetWc *self,
     return;
   }
 
-  if (headers != NULL) {
+  max_stale = priv->stale_while_revalidate > 0 && cache_is_available (self);
+
+  if (headers != NULL || (priv->shared_session && priv->user_agent) || max_stale) {
     SoupMessage *message;
     GHashTableIter iter;
     const char *key, *value;
@@ -703,10 +1463,33 @@ get_url_now (GrlNetWc *self,
     message = soup_request_http_get_message (SOUP_REQUEST_HTTP (rr->request));
 
     if (message) {
-      g_hash_table_iter_init (&iter, headers);
-      while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *)&value)) {
-        soup_message_headers_append (message->request_headers, key, value);
+      /* The shared session has no user agent of its own */
+      if (priv->shared_session && priv->user_agent)
+        soup_message_headers_replace (message->request_headers,
+                                      "User-Agent", priv->user_agent);
+
+      if (headers != NULL) {
+        g_hash_table_iter_init (&iter, headers);
+        while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *)&value)) {
+          soup_message_headers_append (message->request_headers, key, value);
+        }
+      }
+
+      /* Let the cache answer with an expired response; it is refreshed
+         afterwards */
+      if (max_stale &&
+          !soup_message_headers_get_one (message->request_headers,
+                                         "Cache-Control")) {
+        gchar *cache_control = g_strdup_printf ("max-stale=%u",
+                                                priv->stale_while_revalidate);
+        soup_message_headers_append (message->request_headers,
+                                     "Cache-Control", cache_control);
+        g_free (cache_control);
       }
+
+      if (max_stale)
+        g_signal_connect (message, "wrote-headers",
+                          G_CALLBACK (wrote_headers_cb), NULL);
       g_object_unref (message);
     }
   }
@@ -714,69 +1497,172 @@ get_url_now (GrlNetWc *self,
   soup_request_send_async (rr->request, cancellable, reply_cb, result);
 }
 
+static void
+request_clos_cancel (struct request_clos *c)
+{
+  GSimpleAsyncResult *result = G_SIMPLE_ASYNC_RESULT (c->result);
+
+  g_simple_async_result_set_error (result, G_IO_ERROR,
+                                   G_IO_ERROR_CANCELLED,
+                                   _("Operation was cancelled"));
+  g_simple_async_result_complete_in_idle (result);
+  g_object_unref (result);
+  request_clos_destroy (c);
+}
+
+/* Refills the token bucket with the tokens earned since last time */
+static void
+refill_tokens (GrlNetWcPrivate *priv)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (priv->rate > 0) {
+    priv->tokens += (now - priv->tokens_time) * priv->rate / G_USEC_PER_SEC;
+    priv->tokens = MIN (priv->tokens, priv->burst);
+  }
+  priv->tokens_time = now;
+}
+
+/* Sends the pending requests, by priority, as long as the rate limit and the
+   per-host limit allow it */
 static gboolean
-get_url_cb (gpointer user_data)
+dispatch_pending (gpointer user_data)
 {
-  struct request_clos *c = (struct request_clos *) user_data;
+  GrlNetWc *self = GRL_NET_WC (user_data);
+  GrlNetWcPrivate *priv = self->priv;
+  struct request_clos *c;
+  GList *l, *next;
+  gint64 wait = 0;
+  guint running;
 
-  /* validation */
-  {
-    GrlNetWcPrivate *priv = c->self->priv;
-    struct request_clos *d = g_queue_pop_tail (priv->pending);
-    g_assert (c == d);
+  priv->dispatch_id = 0;
+  refill_tokens (priv);
+
+  for (l = priv->pending->head; l; l = next) {
+    next = l->next;
+    c = l->data;
+
+    if (c->cancellable && g_cancellable_is_cancelled (c->cancellable)) {
+      g_queue_delete_link (priv->pending, l);
+      request_clos_cancel (c);
+      continue;
+    }
+
+    if (is_mocked ()) {
+      g_queue_delete_link (priv->pending, l);
+      get_url_mocked (self, c->url, c->headers, c->result, c->cancellable);
+      request_clos_destroy (c);
+      continue;
+    }
+
+    /* Wait until one of the requests to this host finishes */
+    running = GPOINTER_TO_UINT (g_hash_table_lookup (priv->in_flight, c->host));
+    if (priv->max_per_host > 0 && running >= priv->max_per_host)
+      continue;
+
+    if (priv->rate > 0) {
+      if (priv->tokens < 1) {
+        wait = (1 - priv->tokens) * G_USEC_PER_SEC / priv->rate;
+        break;
+      }
+      priv->tokens -= 1;
+    }
+
+    g_queue_delete_link (priv->pending, l);
+    g_hash_table_insert (priv->in_flight, g_strdup (c->host),
+                         GUINT_TO_POINTER (running + 1));
+    get_url_now (self, c->url, c->host, c->stream, c->headers, c->result,
+                 c->cancellable);
+    request_clos_destroy (c);
   }
 
-  if (is_mocked ())
-    get_url_mocked (c->self, c->url, c->headers, c->result, c->cancellable);
-  else
-    get_url_now (c->self, c->url, c->headers, c->result, c->cancellable);
+  if (wait > 0) {
+    GRL_DEBUG ("delaying web request by %" G_GINT64_FORMAT " ms",
+               (wait + 999) / 1000);
+    priv->dispatch_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                            (wait + 999) / 1000,
+                                            dispatch_pending, self, NULL);
+    g_source_set_name_by_id (priv->dispatch_id, "[grl-net] dispatch_pending");
+  }
+
+  return G_SOURCE_REMOVE;
+}
 
-  return FALSE;
+static gchar *
+get_host_key (const char *url)
+{
+  SoupURI *uri;
+  gchar *key;
+
+  uri = soup_uri_new (url);
+  if (!uri)
+    return g_strdup ("");
+
+  key = g_strdup_printf ("%s:%u",
+                         soup_uri_get_host (uri) ? soup_uri_get_host (uri) : "",
+                         soup_uri_get_port (uri));
+  soup_uri_free (uri);
+
+  return key;
 }
 
 static void
 get_url (GrlNetWc *self,
          const char *url,
          GHashTable *headers,
+         gint priority,
+         gboolean stream,
          GAsyncResult *result,
          GCancellable *cancellable)
 {
-  guint id;
-  GTimeVal now;
   struct request_clos *c;
   GrlNetWcPrivate *priv = self->priv;
+  GList *l;
 
   /* closure */
   c = g_new (struct request_clos, 1);
   c->self = self;
   c->url = g_strdup (url);
+  c->host = get_host_key (url);
+  c->priority = priority;
+  c->stream = stream;
   c->headers = headers? g_hash_table_ref (headers): NULL;
   c->result = result;
   c->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
 
-  g_get_current_time (&now);
+  /* Keep the queue sorted by priority; requests with the same priority are
+     sent in the order they were done */
+  for (l = priv->pending->tail; l; l = l->prev) {
+    if (((struct request_clos *) l->data)->priority <= priority)
+      break;
+  }
+  if (l)
+    g_queue_insert_after (priv->pending, l, c);
+  else
+    g_queue_push_head (priv->pending, c);
 
-  /* If grl-net-wc is not mocked, we need to check if throttling is set
-   * otherwise the throttling delay check would always be true */
-  if (is_mocked ()
-      || priv->throttling == 0
-      || (now.tv_sec - priv->last_request.tv_sec) > priv->throttling) {
-    priv->last_request = now;
-    id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
-                          get_url_cb, c, request_clos_destroy);
-  } else {
-    priv->last_request.tv_sec += priv->throttling;
+  schedule_dispatch (self);
+}
+
+/* Hands the buffer over to the bytes, without copying it */
+static GBytes *
+get_bytes (GrlNetWc *self,
+           void *op)
+{
+  struct request_res *rr = op;
+  gchar *content = NULL;
+  gsize length = 0;
 
-    GRL_DEBUG ("delaying web request by %lu seconds",
-               priv->last_request.tv_sec - now.tv_sec);
-    id = g_timeout_add_seconds_full (G_PRIORITY_DEFAULT,
-                                     priv->last_request.tv_sec - now.tv_sec,
-                                     get_url_cb, c, request_clos_destroy);
+  if (is_mocked ()) {
+    get_content_mocked (self, op, &content, &length);
+    return g_bytes_new_take (content, length);
   }
-  g_source_set_name_by_id (id, "[grl-net] get_url_cb");
 
-  c->source_id = id;
-  g_queue_push_head (self->priv->pending, c);
+  dump_data (soup_request_get_uri (rr->request),
+             rr->buffer,
+             rr->offset);
+
+  return g_bytes_new_take (g_steal_pointer (&rr->buffer), rr->offset);
 }
 
 static void
@@ -796,7 +1682,7 @@ get_content (GrlNetWc *self,
     dump_data (soup_request_get_uri (rr->request),
                rr->buffer,
                rr->offset);
-    priv->previous_data = rr->buffer;
+    priv->previous_data = g_steal_pointer (&rr->buffer);
     if (length) {
       *length = rr->offset;
     }
@@ -938,7 +1824,132 @@ grl_net_wc_request_with_headers_hash_async (GrlNetWc *self,
                                       user_data,
                                       grl_net_wc_request_async);
 
-  get_url (self, uri, headers, G_ASYNC_RESULT (result), cancellable);
+  get_url (self, uri, headers, G_PRIORITY_DEFAULT, FALSE,
+           G_ASYNC_RESULT (result), cancellable);
+}
+
+/**
+ * grl_net_wc_request_with_priority_async:
+ * @self: a #GrlNetWc instance
+ * @uri: The URI of the resource to request
+ * @headers: (allow-none) (element-type utf8 utf8): a set of additional HTTP
+ * headers for this request or %NULL to ignore
+ * @io_priority: the priority of the request. Lower numbers are sent first
+ * @cancellable: (allow-none): a #GCancellable instance or %NULL to ignore
+ * @callback: The callback when the result is ready
+ * @user_data: User data set for the @callback
+ *
+ * Like grl_net_wc_request_with_headers_hash_async(), but when the request
+ * has to wait because of the rate limit or the per-host limit, it is sent
+ * before the waiting requests with a higher @io_priority value. Requests with
+ * the same priority are sent in the order they were done. Other requests use
+ * %G_PRIORITY_DEFAULT.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_net_wc_request_with_priority_async (GrlNetWc *self,
+                                        const char *uri,
+                                        GHashTable *headers,
+                                        gint io_priority,
+                                        GCancellable *cancellable,
+                                        GAsyncReadyCallback callback,
+                                        gpointer user_data)
+{
+  GSimpleAsyncResult *result;
+
+  g_return_if_fail (GRL_IS_NET_WC (self));
+
+  result = g_simple_async_result_new (G_OBJECT (self),
+                                      callback,
+                                      user_data,
+                                      grl_net_wc_request_async);
+
+  get_url (self, uri, headers, io_priority, FALSE,
+           G_ASYNC_RESULT (result), cancellable);
+}
+
+/**
+ * grl_net_wc_request_stream_async:
+ * @self: a #GrlNetWc instance
+ * @uri: The URI of the resource to request
+ * @headers: (allow-none) (element-type utf8 utf8): a set of additional HTTP
+ * headers for this request or %NULL to ignore
+ * @cancellable: (allow-none): a #GCancellable instance or %NULL to ignore
+ * @callback: The callback when the result is ready
+ * @user_data: User data set for the @callback
+ *
+ * Request the fetching of a web resource given the @uri, like
+ * grl_net_wc_request_with_headers_hash_async(). But instead of waiting for
+ * the whole contents, the @callback is called as soon as the response headers
+ * are received, and grl_net_wc_request_stream_finish() returns a stream to
+ * read the contents from while they are downloaded.
+ *
+ * The request counts for #GrlNetWc:max-requests-per-host until the stream is
+ * destroyed. Streamed contents are not captured.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_net_wc_request_stream_async (GrlNetWc *self,
+                                 const char *uri,
+                                 GHashTable *headers,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+  GSimpleAsyncResult *result;
+
+  g_return_if_fail (GRL_IS_NET_WC (self));
+
+  result = g_simple_async_result_new (G_OBJECT (self),
+                                      callback,
+                                      user_data,
+                                      grl_net_wc_request_stream_async);
+
+  get_url (self, uri, headers, G_PRIORITY_DEFAULT, TRUE,
+           G_ASYNC_RESULT (result), cancellable);
+}
+
+/**
+ * grl_net_wc_request_stream_finish:
+ * @self: a #GrlNetWc instance
+ * @result: The result of the request
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes a request started with grl_net_wc_request_stream_async().
+ *
+ * Returns: (transfer full): a stream with the contents of the resource, or
+ * %NULL if an error occurred
+ *
+ * Since: 0.3.13
+ */
+GInputStream *
+grl_net_wc_request_stream_finish (GrlNetWc *self,
+                                  GAsyncResult *result,
+                                  GError **error)
+{
+  GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (result);
+  GInputStream *stream = NULL;
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (res) ==
+                  grl_net_wc_request_stream_async);
+
+  void *op = g_simple_async_result_get_op_res_gpointer (res);
+
+  if (!g_simple_async_result_propagate_error (res, error)) {
+    if (is_mocked ())
+      stream = get_stream_mocked (self, op, error);
+    else
+      stream = g_steal_pointer (&((struct request_res *) op)->input);
+  }
+
+  if (is_mocked ())
+    free_mock_op_res (op);
+  else
+    free_op_res (op);
+
+  return stream;
 }
 
 
@@ -992,6 +2003,48 @@ end_func:
   return ret;
 }
 
+/**
+ * grl_net_wc_request_bytes_finish:
+ * @self: a #GrlNetWc instance
+ * @result: The result of the request
+ * @error: return location for a #GError, or %NULL
+ *
+ * Finishes an asynchronous load of the file's contents, like
+ * grl_net_wc_request_finish(). Unlike it, the contents are not invalidated by
+ * the next request: they belong to the returned #GBytes.
+ *
+ * The contents are not copied. For convenience, they are followed by a nul
+ * byte, not included in the size of the #GBytes.
+ *
+ * Returns: (transfer full): the contents of the resource, or %NULL if an error
+ * occurred
+ *
+ * Since: 0.3.13
+ */
+GBytes *
+grl_net_wc_request_bytes_finish (GrlNetWc *self,
+                                 GAsyncResult *result,
+                                 GError **error)
+{
+  GSimpleAsyncResult *res = G_SIMPLE_ASYNC_RESULT (result);
+  GBytes *bytes = NULL;
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (res) ==
+                  grl_net_wc_request_async);
+
+  void *op = g_simple_async_result_get_op_res_gpointer (res);
+
+  if (!g_simple_async_result_propagate_error (res, error))
+    bytes = get_bytes (self, op);
+
+  if (is_mocked ())
+    free_mock_op_res (op);
+  else
+    free_op_res (op);
+
+  return bytes;
+}
+
 /**
  * grl_net_wc_set_log_level:
  * @self: a #GrlNetWc instance
@@ -1028,6 +2081,8 @@ grl_net_wc_set_log_level (GrlNetWc *self,
  *
  * Setting this property, the #GrlNetWc will queue all the requests and
  * will dispatch them with a pause between them of this value.
+ *
+ * See grl_net_wc_set_throttling_ms() for a finer resolution.
  */
 void
 grl_net_wc_set_throttling (GrlNetWc *self,
@@ -1035,17 +2090,123 @@ grl_net_wc_set_throttling (GrlNetWc *self,
 {
   g_return_if_fail (GRL_IS_NET_WC (self));
 
-  if (throttling > 0) {
-    /* max conns per host = 1 */
-    g_object_set (self->priv->session,
-                  SOUP_SESSION_MAX_CONNS_PER_HOST, 1, NULL);
-  } else {
-    /* default value */
-    g_object_set (self->priv->session,
-                  SOUP_SESSION_MAX_CONNS_PER_HOST, 2, NULL);
+  grl_net_wc_set_throttling_ms (self, MIN (throttling, G_MAXUINT / 1000) * 1000);
+}
+
+/**
+ * grl_net_wc_set_throttling_ms:
+ * @self: a #GrlNetWc instance
+ * @throttling_ms: the number of milliseconds to wait between requests
+ *
+ * Queues all the requests and dispatches them evenly spaced by
+ * @throttling_ms milliseconds. The first request is sent right away.
+ *
+ * This is a shortcut for a rate limit of one request every @throttling_ms
+ * milliseconds; see grl_net_wc_set_rate_limit().
+ *
+ * Since: 0.3.13
+ */
+void
+grl_net_wc_set_throttling_ms (GrlNetWc *self,
+                              guint throttling_ms)
+{
+  g_return_if_fail (GRL_IS_NET_WC (self));
+
+  if (self->priv->throttling_ms == throttling_ms)
+    return;
+
+  /* The connections of a shared session are not ours to limit */
+  if (!self->priv->shared_session) {
+    if (throttling_ms > 0) {
+      /* max conns per host = 1 */
+      g_object_set (self->priv->session,
+                    SOUP_SESSION_MAX_CONNS_PER_HOST, 1, NULL);
+    } else {
+      /* default value */
+      g_object_set (self->priv->session,
+                    SOUP_SESSION_MAX_CONNS_PER_HOST, 2, NULL);
+    }
+  }
+
+  self->priv->throttling_ms = throttling_ms;
+  grl_net_wc_set_rate_limit (self,
+                             throttling_ms > 0 ? 1000.0 / throttling_ms : 0,
+                             1);
+
+  g_object_notify (G_OBJECT (self), "throttling");
+  g_object_notify (G_OBJECT (self), "throttling-ms");
+}
+
+/**
+ * grl_net_wc_set_rate_limit:
+ * @self: a #GrlNetWc instance
+ * @rate: maximum number of requests per second, or 0 for no limit
+ * @burst: number of requests that can be sent at once
+ *
+ * Limits the rate of requests with a token bucket: up to @burst requests can
+ * be sent at once, and then they are sent at @rate requests per second. The
+ * requests above the limit are queued, and sent by priority.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_net_wc_set_rate_limit (GrlNetWc *self,
+                           gdouble rate,
+                           guint burst)
+{
+  GrlNetWcPrivate *priv;
+
+  g_return_if_fail (GRL_IS_NET_WC (self));
+  g_return_if_fail (rate >= 0);
+  g_return_if_fail (burst > 0);
+
+  priv = self->priv;
+  if (priv->rate == rate && priv->burst == burst)
+    return;
+
+  priv->rate = rate;
+  priv->burst = burst;
+  priv->tokens = burst;
+  priv->tokens_time = g_get_monotonic_time ();
+
+  /* A pending wait was computed with the old rate */
+  if (priv->dispatch_id) {
+    g_source_remove (priv->dispatch_id);
+    priv->dispatch_id = 0;
   }
+  if (!g_queue_is_empty (priv->pending))
+    schedule_dispatch (self);
 
-  self->priv->throttling = throttling;
+  g_object_notify (G_OBJECT (self), "rate-limit");
+  g_object_notify (G_OBJECT (self), "rate-burst");
+}
+
+/**
+ * grl_net_wc_set_max_requests_per_host:
+ * @self: a #GrlNetWc instance
+ * @max_requests: maximum number of running requests per host, or 0 for no
+ * limit
+ *
+ * Limits how many requests can be running at the same time against the same
+ * host. The requests above the limit are queued, and sent by priority when
+ * the running ones finish.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_net_wc_set_max_requests_per_host (GrlNetWc *self,
+                                      guint max_requests)
+{
+  g_return_if_fail (GRL_IS_NET_WC (self));
+
+  if (self->priv->max_per_host == max_requests)
+    return;
+
+  self->priv->max_per_host = max_requests;
+  if (!g_queue_is_empty (self->priv->pending))
+    schedule_dispatch (self);
+
+  g_object_notify (G_OBJECT (self), "max-requests-per-host");
 }
 
 /**
@@ -1099,6 +2260,129 @@ grl_net_wc_set_cache_size (GrlNetWc *self,
   soup_cache_set_max_size (SOUP_CACHE (cache), size * 1024 * 1024);
 }
 
+/**
+ * grl_net_wc_set_cache_name:
+ * @self: a #GrlNetWc instance
+ * @name: (allow-none): name of the cache, or %NULL
+ *
+ * Makes the cache persistent: instead of a temporary cache removed with
+ * the #GrlNetWc, use the cache called @name in the user cache directory. It
+ * is kept across runs, so responses still fresh are not requested again.
+ * Its size is bounded by #GrlNetWc:cache-size, evicting the least recently
+ * used entries.
+ *
+ * The instances of a process using the same name share the cache. Other
+ * processes using it save their index when they are done with it, merging
+ * it with the entries saved meanwhile.
+ *
+ * Setting %NULL goes back to a temporary cache.
+ *
+ * Since: 0.3.13
+ **/
+void
+grl_net_wc_set_cache_name (GrlNetWc *self,
+                           const gchar *name)
+{
+  gboolean use_cache;
+
+  g_return_if_fail (GRL_IS_NET_WC (self));
+  g_return_if_fail (name == NULL ||
+                    (*name != '\0' &&
+                     strpbrk (name, "/\\") == NULL &&
+                     g_strcmp0 (name, ".") != 0 &&
+                     g_strcmp0 (name, "..") != 0));
+
+  if (g_strcmp0 (self->priv->cache_name, name) == 0)
+    return;
+
+  use_cache = cache_is_available (self);
+  if (use_cache)
+    cache_down (self);
+
+  g_free (self->priv->cache_name);
+  self->priv->cache_name = g_strdup (name);
+
+  if (use_cache)
+    cache_up (self);
+
+  g_object_notify (G_OBJECT (self), "cache-name");
+}
+
+/**
+ * grl_net_wc_set_stale_while_revalidate:
+ * @self: a #GrlNetWc instance
+ * @seconds: how long an expired response can still be used, or 0
+ *
+ * Allows the cache to answer with a response that expired less than
+ * @seconds ago, instead of waiting for the server. Such responses are then
+ * refreshed in the background, so the next request gets the new contents.
+ *
+ * Since: 0.3.13
+ **/
+void
+grl_net_wc_set_stale_while_revalidate (GrlNetWc *self,
+                                       guint seconds)
+{
+  g_return_if_fail (GRL_IS_NET_WC (self));
+
+  if (self->priv->stale_while_revalidate == seconds)
+    return;
+
+  self->priv->stale_while_revalidate = seconds;
+  g_object_notify (G_OBJECT (self), "stale-while-revalidate");
+}
+
+/**
+ * grl_net_wc_get_queue_depth:
+ * @self: a #GrlNetWc instance
+ *
+ * Gets the number of requests waiting to be sent because of the rate limit
+ * or the per-host limit.
+ *
+ * Returns: the number of queued requests
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_net_wc_get_queue_depth (GrlNetWc *self)
+{
+  g_return_val_if_fail (GRL_IS_NET_WC (self), 0);
+
+  return g_queue_get_length (self->priv->pending);
+}
+
+/**
+ * grl_net_wc_get_current_delay:
+ * @self: a #GrlNetWc instance
+ *
+ * Estimates how long a request done now would wait before being sent,
+ * behind the already queued ones, according to the rate limit. The
+ * per-host limit is not taken into account.
+ *
+ * Returns: the delay in milliseconds
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_net_wc_get_current_delay (GrlNetWc *self)
+{
+  GrlNetWcPrivate *priv;
+  gdouble missing;
+
+  g_return_val_if_fail (GRL_IS_NET_WC (self), 0);
+
+  priv = self->priv;
+  if (priv->rate <= 0)
+    return 0;
+
+  refill_tokens (priv);
+  missing = g_queue_get_length (priv->pending) + 1 - priv->tokens;
+  if (missing <= 0)
+    return 0;
+
+  return (guint) MIN (missing * 1000 / priv->rate + 0.5, G_MAXUINT);
+}
+
 /**
  * grl_net_wc_flush_delayed_requests:
  * @self: a #GrlNetWc instance
@@ -1116,9 +2400,6 @@ grl_net_wc_flush_delayed_requests (GrlNetWc *self)
   while ((c = g_queue_pop_head (priv->pending))) {
     if (c->cancellable)
       g_cancellable_cancel (c->cancellable);
-    /* This will call the destroy notify, request_clos_destroy()  */
-    g_source_remove (c->source_id);
+    request_clos_cancel (c);
   }
-
-  g_get_current_time (&priv->last_request);
 }
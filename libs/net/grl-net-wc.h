@@ -140,24 +140,67 @@ void grl_net_wc_request_with_headers_async (GrlNetWc *self,
                                             gpointer user_data,
                                             ...) G_GNUC_NULL_TERMINATED;
 
+void grl_net_wc_request_with_priority_async (GrlNetWc *self,
+                                             const char *uri,
+                                             GHashTable *headers,
+                                             gint io_priority,
+                                             GCancellable *cancellable,
+                                             GAsyncReadyCallback callback,
+                                             gpointer user_data);
+
+void grl_net_wc_request_stream_async (GrlNetWc *self,
+                                      const char *uri,
+                                      GHashTable *headers,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data);
+
+GInputStream *grl_net_wc_request_stream_finish (GrlNetWc *self,
+                                                GAsyncResult *result,
+                                                GError **error);
+
 gboolean grl_net_wc_request_finish (GrlNetWc *self,
 				    GAsyncResult *result,
 				    gchar **content,
 				    gsize *length,
 				    GError **error);
 
+GBytes *grl_net_wc_request_bytes_finish (GrlNetWc *self,
+                                         GAsyncResult *result,
+                                         GError **error);
+
 void grl_net_wc_set_log_level (GrlNetWc *self,
 			       guint log_level);
 
 void grl_net_wc_set_throttling (GrlNetWc *self,
 				guint throttling);
 
+void grl_net_wc_set_throttling_ms (GrlNetWc *self,
+                                   guint throttling_ms);
+
 void grl_net_wc_set_cache (GrlNetWc *self,
                            gboolean use_cache);
 
 void grl_net_wc_set_cache_size (GrlNetWc *self,
                                 guint cache_size);
 
+void grl_net_wc_set_cache_name (GrlNetWc *self,
+                                const gchar *name);
+
+void grl_net_wc_set_stale_while_revalidate (GrlNetWc *self,
+                                            guint seconds);
+
+void grl_net_wc_set_rate_limit (GrlNetWc *self,
+                                gdouble rate,
+                                guint burst);
+
+void grl_net_wc_set_max_requests_per_host (GrlNetWc *self,
+                                           guint max_requests);
+
+guint grl_net_wc_get_queue_depth (GrlNetWc *self);
+
+guint grl_net_wc_get_current_delay (GrlNetWc *self);
+
 void grl_net_wc_flush_delayed_requests (GrlNetWc *self);
 
 G_END_DECLS
@@ -112,6 +112,7 @@ grl_media_new_from_pls_entry (const gchar *uri,
 
 /* -------- Variables ------- */
 
+G_LOCK_DEFINE_STATIC (operations);
 static GHashTable *operations = NULL;
 
 /* -------- Functions ------- */
@@ -653,13 +654,15 @@ grl_pls_browse_report_results (GrlSourceBrowseSpec *bs)
              NULL);
   }
 
-  called_from_plugin = g_hash_table_lookup (operations,
-      GUINT_TO_POINTER (bs->operation_id)) == NULL;
+  G_LOCK (operations);
+  called_from_plugin = !g_hash_table_steal (operations,
+                                            GUINT_TO_POINTER (bs->operation_id));
+  G_UNLOCK (operations);
 
   if (!called_from_plugin) {
     operation_set_completed (bs->operation_id);
     operation_set_finished (bs->operation_id);
-    g_hash_table_remove (operations, GUINT_TO_POINTER (bs->operation_id));
+    grl_source_browse_spec_free (bs);
   }
 
   return FALSE;
@@ -757,7 +760,7 @@ multiple_result_async_cb (GrlSource *source,
     g_list_free (ds->data);
 
     ds->data = NULL;
-    ds->complete = TRUE;
+    grl_data_sync_complete (ds);
     return;
   }
 
@@ -767,7 +770,7 @@ multiple_result_async_cb (GrlSource *source,
 
   if (remaining == 0) {
     ds->data = g_list_reverse (ds->data);
-    ds->complete = TRUE;
+    grl_data_sync_complete (ds);
   }
 }
 
@@ -830,11 +833,13 @@ grl_pls_browse_by_spec (GrlSource *source,
   /* check if we have the entries cached or not */
   valid_entries = g_object_get_data (G_OBJECT (bs->container), GRL_DATA_PRIV_PLS_VALID_ENTRIES);
   if (valid_entries) {
-    guint id;
-
     GRL_DEBUG ("%s : using cached data bs=%p", __FUNCTION__, bs);
-    id = g_idle_add ((GSourceFunc) grl_pls_browse_report_results, bs);
-    g_source_set_name_by_id (id, "[grl-pls] grl_pls_browse_report_results");
+    grl_operation_idle_add (bs->operation_id,
+                            G_PRIORITY_DEFAULT_IDLE,
+                            (GSourceFunc) grl_pls_browse_report_results,
+                            bs,
+                            NULL,
+                            "[grl-pls] grl_pls_browse_report_results");
     return;
   }
 
@@ -934,7 +939,9 @@ grl_pls_browse (GrlSource *source,
   bs->user_data = userdata;
   bs->operation_id = grl_operation_generate_id ();
 
+  G_LOCK (operations);
   g_hash_table_insert (operations, GUINT_TO_POINTER (bs->operation_id), bs);
+  G_UNLOCK (operations);
 
   operation_set_ongoing (source, bs->operation_id, bs);
 
@@ -943,6 +950,29 @@ grl_pls_browse (GrlSource *source,
   return bs->operation_id;
 }
 
+struct BrowseSyncCall {
+  GrlSource *source;
+  GrlMedia *playlist;
+  const GList *keys;
+  GrlOperationOptions *options;
+  GrlPlsFilterFunc filter_func;
+  GrlDataSync *ds;
+};
+
+static gboolean
+browse_sync_start (gpointer user_data)
+{
+  struct BrowseSyncCall *call = (struct BrowseSyncCall *) user_data;
+
+  return grl_pls_browse (call->source,
+                         call->playlist,
+                         call->keys,
+                         call->options,
+                         call->filter_func,
+                         multiple_result_async_cb,
+                         call->ds) > 0;
+}
+
 /**
  * grl_pls_browse_sync:
  * @source: a source
@@ -985,28 +1015,32 @@ grl_pls_browse_sync (GrlSource *source,
                      GError **error)
 {
   GrlDataSync *ds;
+  struct BrowseSyncCall call;
   GList *result;
 
   grl_pls_init();
 
   GRL_DEBUG (__FUNCTION__);
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_pls_browse (source,
-                      playlist,
-                      keys,
-                      options,
-                      filter_func,
-                      multiple_result_async_cb,
-                      ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.playlist = playlist;
+  call.keys = keys;
+  call.options = options;
+  call.filter_func = filter_func;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     browse_sync_start,
+                     &call);
 
   if (ds->error)
     g_propagate_error (error, ds->error);
 
   result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
 
   return result;
 }
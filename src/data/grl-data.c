@@ -32,23 +32,63 @@
  * their values can be stored.  Usually, application and plugin developers would
  * interact with specific subclass of #GrlData, #GrlMedia, which provide
  * specific API to manipulate well known attributes of these media types.
+ *
+ * Some keys, like the source or the genre, tend to have the same values in
+ * many media. Values of the keys set with grl_data_set_interned_key() are
+ * kept in a pool shared by all the #GrlData, so each different string is only
+ * stored once. No key is interned by default.
  */
 
 #include "grl-data.h"
 #include "grl-log.h"
 #include "grl-registry-priv.h"
+#include "grl-related-keys-priv.h"
+
+#include <string.h>
 
 #define GRL_LOG_DOMAIN_DEFAULT data_log_domain
 GRL_LOG_DOMAIN(data_log_domain);
 
+/* Each value, or set of related values, is kept in a slot. Slots are sorted by
+   the sample key of their relation, so all the values of related keys are
+   contiguous and in the order they were added.
+
+   A slot holding the value of a single key stores it inline. A #GrlRelatedKeys
+   is only created when several related keys are set in the slot, or when it
+   is requested with grl_data_get_related_keys(). The inline value is then
+   moved into it, and the inline copy is left untouched, so the pointers that
+   were handed out by the getters stay valid.
+
+   Inline strings of interned keys belong to the string pool, and are set as
+   static strings in the value. */
+typedef struct {
+  GrlKeyID sample_key;
+  guint key : 31;
+  guint interned : 1;
+  GrlRelatedKeys *relkeys;
+  GValue value;
+} DataSlot;
+
+typedef struct {
+  guint ref_count;
+  gsize length;
+  gchar str[];
+} PoolString;
+
+G_LOCK_DEFINE_STATIC (pool);
+
+static GHashTable *pool = NULL;
+static GHashTable *interned_keys = NULL;
+static gint n_interned_keys = 0;
+static guint pool_references = 0;
+static gsize pool_saved = 0;
+
 struct _GrlDataPrivate {
-  GHashTable *data;
+  GPtrArray *slots;
 };
 
 static void grl_data_finalize (GObject *object);
-static void free_list_values (GrlKeyID key, GList *values, gpointer user_data);
-
-static void free_list_values (GrlKeyID key, GList *values, gpointer user_data);
+static void data_slot_free (DataSlot *slot);
 
 /* ================ GrlData GObject ================ */
 
@@ -66,10 +106,8 @@ static void
 grl_data_init (GrlData *self)
 {
   self->priv = grl_data_get_instance_private (self);
-  self->priv->data = g_hash_table_new_full (g_direct_hash,
-                                            g_direct_equal,
-                                            NULL,
-                                            NULL);
+  self->priv->slots =
+    g_ptr_array_new_with_free_func ((GDestroyNotify) data_slot_free);
 }
 
 static void
@@ -78,43 +116,486 @@ grl_data_finalize (GObject *object)
   GrlData *data = GRL_DATA (object);
 
   g_signal_handlers_destroy (object);
-  g_hash_table_foreach (data->priv->data,
-                        (GHFunc) free_list_values,
-                        NULL);
-  g_hash_table_unref (data->priv->data);
+  g_ptr_array_unref (data->priv->slots);
 
   G_OBJECT_CLASS (grl_data_parent_class)->finalize (object);
 }
 
 /* ================ Utitilies ================ */
 
-/* Free the list of values, which are of type #GrlRelatedKeys */
-static void
-free_list_values (GrlKeyID key, GList *values, gpointer user_data)
-{
-  g_list_free_full (values, g_object_unref);
-}
-
 /* Returns the sample key that represents the set of keys related with @key */
 static GrlKeyID
 get_sample_key (GrlKeyID key)
 {
-  GrlRegistry *registry;
-  const GList *related_keys;
+  const GrlKeyInfo *info;
 
-  registry = grl_registry_get_default ();
-  related_keys =
-    grl_registry_lookup_metadata_key_relation (registry, key);
+  info = grl_registry_lookup_metadata_key_info (grl_registry_get_default (),
+                                                key);
 
-  if (!related_keys) {
+  if (!info) {
     GRL_WARNING ("Related keys not found for key \"%s\"",
                  grl_metadata_key_get_name (key));
     return GRL_METADATA_KEY_INVALID;
   } else {
-    return GRLPOINTER_TO_KEYID (related_keys->data);
+    return info->sample_key;
+  }
+}
+
+static gboolean
+is_interned_key (GrlKeyID key)
+{
+  gboolean interned;
+
+  /* Avoid the lock in the common case of nothing being interned */
+  if (g_atomic_int_get (&n_interned_keys) == 0) {
+    return FALSE;
+  }
+
+  G_LOCK (pool);
+  interned = interned_keys &&
+    g_hash_table_contains (interned_keys, GRLKEYID_TO_POINTER (key));
+  G_UNLOCK (pool);
+
+  return interned;
+}
+
+/* Returns the shared copy of @str, adding a reference to it */
+static const gchar *
+string_pool_acquire (const gchar *str)
+{
+  PoolString *pstr;
+
+  G_LOCK (pool);
+
+  if (!pool) {
+    pool = g_hash_table_new (g_str_hash, g_str_equal);
+  }
+
+  pstr = g_hash_table_lookup (pool, str);
+  if (pstr) {
+    pstr->ref_count++;
+    pool_saved += pstr->length + 1;
+  } else {
+    gsize length = strlen (str);
+
+    pstr = g_malloc (sizeof (PoolString) + length + 1);
+    pstr->ref_count = 1;
+    pstr->length = length;
+    memcpy (pstr->str, str, length + 1);
+    g_hash_table_insert (pool, pstr->str, pstr);
+  }
+  pool_references++;
+
+  G_UNLOCK (pool);
+
+  return pstr->str;
+}
+
+static void
+string_pool_release (const gchar *str)
+{
+  PoolString *pstr;
+
+  G_LOCK (pool);
+
+  pstr = g_hash_table_lookup (pool, str);
+  g_assert (pstr && pstr->str == str);
+
+  pool_references--;
+  if (--pstr->ref_count == 0) {
+    g_hash_table_remove (pool, str);
+    g_free (pstr);
+  } else {
+    pool_saved -= pstr->length + 1;
+  }
+
+  G_UNLOCK (pool);
+}
+
+/* Makes @value, already initialized to hold a string, hold the shared copy of
+   @str */
+static void
+value_set_interned_string (GValue *value,
+                           const gchar *str)
+{
+  g_value_set_static_string (value, string_pool_acquire (str));
+}
+
+static void
+slot_clear_value (DataSlot *slot)
+{
+  if (slot->interned) {
+    string_pool_release (g_value_get_string (&slot->value));
+    slot->interned = FALSE;
+  }
+  g_value_unset (&slot->value);
+}
+
+/* Sets in the slot a copy of @value, which is already valid for @key */
+static void
+slot_set_value (DataSlot *slot,
+                GrlKeyID key,
+                const GValue *value)
+{
+  slot->key = key;
+  g_value_init (&slot->value, G_VALUE_TYPE (value));
+
+  if (G_VALUE_HOLDS_STRING (value) &&
+      g_value_get_string (value) &&
+      is_interned_key (key)) {
+    value_set_interned_string (&slot->value, g_value_get_string (value));
+    slot->interned = TRUE;
+  } else {
+    g_value_copy (value, &slot->value);
   }
 }
 
+static void
+data_slot_free (DataSlot *slot)
+{
+  if (slot->relkeys) {
+    g_object_unref (slot->relkeys);
+  } else {
+    slot_clear_value (slot);
+  }
+  g_slice_free (DataSlot, slot);
+}
+
+/* Looks for the slots of @sample_key. Returns how many there are, and in
+   @first the position of the first one, or where it should be inserted */
+static guint
+find_slots (GrlData *data,
+            GrlKeyID sample_key,
+            guint *first)
+{
+  GPtrArray *slots = data->priv->slots;
+  guint low = 0;
+  guint high = slots->len;
+  guint mid;
+
+  while (low < high) {
+    mid = (low + high) / 2;
+    if (((DataSlot *) g_ptr_array_index (slots, mid))->sample_key < sample_key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  *first = low;
+  while (high < slots->len &&
+         ((DataSlot *) g_ptr_array_index (slots, high))->sample_key == sample_key) {
+    high++;
+  }
+
+  return high - low;
+}
+
+/* Returns the slot at @index for @key and its related keys */
+static DataSlot *
+get_slot (GrlData *data,
+          GrlKeyID key,
+          guint index,
+          gboolean warn)
+{
+  GrlKeyID sample_key;
+  guint first;
+
+  sample_key = get_sample_key (key);
+  if (!sample_key) {
+    return NULL;
+  }
+
+  if (index >= find_slots (data, sample_key, &first)) {
+    if (warn) {
+      GRL_WARNING ("%s: index %u out of range", __FUNCTION__, index);
+    }
+    return NULL;
+  }
+
+  return g_ptr_array_index (data->priv->slots, first + index);
+}
+
+static void
+insert_slot (GrlData *data,
+             DataSlot *slot)
+{
+  guint first;
+  guint length;
+
+  length = find_slots (data, slot->sample_key, &first);
+  g_ptr_array_insert (data->priv->slots, first + length, slot);
+}
+
+static const GValue *
+slot_get_value (DataSlot *slot,
+                GrlKeyID key)
+{
+  if (slot->relkeys) {
+    return grl_related_keys_get (slot->relkeys, key);
+  }
+
+  return slot->key == key? &slot->value: NULL;
+}
+
+static gboolean
+slot_has_key (DataSlot *slot,
+              GrlKeyID key)
+{
+  if (slot->relkeys) {
+    return grl_related_keys_has_key (slot->relkeys, key);
+  }
+
+  return slot->key == key;
+}
+
+/* Moves an inline value into a #GrlRelatedKeys, so it can be handed out. The
+   value is not copied: the #GrlRelatedKeys takes over its contents, and keeps
+   the reference to an interned string until it is finalized */
+static GrlRelatedKeys *
+slot_get_related_keys (DataSlot *slot)
+{
+  GValue *value;
+
+  if (!slot->relkeys) {
+    slot->relkeys = grl_related_keys_new ();
+    if (slot->interned) {
+      g_object_set_qdata_full (G_OBJECT (slot->relkeys),
+                               g_quark_from_static_string ("grl-data-pooled"),
+                               (gpointer) g_value_get_string (&slot->value),
+                               (GDestroyNotify) string_pool_release);
+      slot->interned = FALSE;
+    }
+    value = g_new (GValue, 1);
+    *value = slot->value;
+    grl_related_keys_take_value (slot->relkeys, slot->key, value);
+    slot->key = GRL_METADATA_KEY_INVALID;
+  }
+
+  return slot->relkeys;
+}
+
+/* Drops the values of the slot, so new ones can be set in it */
+static void
+slot_reset (DataSlot *slot)
+{
+  if (slot->relkeys) {
+    g_clear_object (&slot->relkeys);
+    /* The inline value, if any, was moved into the #GrlRelatedKeys */
+    memset (&slot->value, 0, sizeof (GValue));
+  } else {
+    slot_clear_value (slot);
+  }
+  slot->key = GRL_METADATA_KEY_INVALID;
+}
+
+/* Takes @relkeys, which holds @keys. If it only holds one key and it is @owned,
+   that is, it was created internally and nobody else can use it, just its
+   value is kept. Otherwise the caller might still look at @relkeys, so it is
+   kept alive */
+static void
+slot_take_related_keys (DataSlot *slot,
+                        GrlRelatedKeys *relkeys,
+                        GList *keys,
+                        gboolean owned)
+{
+  GrlKeyID key = GRLPOINTER_TO_KEYID (keys->data);
+  const GValue *value;
+
+  if (keys->next || !owned) {
+    slot->relkeys = relkeys;
+    return;
+  }
+
+  value = grl_related_keys_get (relkeys, key);
+  slot_set_value (slot, key, value);
+  g_object_unref (relkeys);
+}
+
+/* Sets in @dest a copy of @value, converted to the type of @key and
+   validated. If @interned is not %NULL and @key is interned, the string is
+   taken from the pool */
+static gboolean
+init_value_for_key (GValue *dest,
+                    GrlKeyID key,
+                    const GValue *value,
+                    gboolean *interned)
+{
+  const GrlKeyInfo *info;
+  GType key_type, value_type;
+  const gchar *pooled = NULL;
+
+  info = grl_registry_lookup_metadata_key_info (grl_registry_get_default (),
+                                                key);
+  key_type = info? info->type: G_TYPE_INVALID;
+  value_type = G_VALUE_TYPE (value);
+
+  if (!g_value_type_transformable (value_type, key_type)) {
+    GRL_WARNING ("value has type %s, but expected %s",
+                 g_type_name (value_type),
+                 g_type_name (key_type));
+    return FALSE;
+  }
+
+  g_value_init (dest, key_type);
+
+  if (interned &&
+      key_type == G_TYPE_STRING &&
+      value_type == G_TYPE_STRING &&
+      g_value_get_string (value) &&
+      is_interned_key (key)) {
+    value_set_interned_string (dest, g_value_get_string (value));
+    pooled = g_value_get_string (dest);
+  } else if (value_type == key_type) {
+    g_value_copy (value, dest);
+  } else if (!g_value_transform (value, dest)) {
+    GRL_WARNING ("transforming value type %s to key's type %s failed",
+                 g_type_name (value_type),
+                 g_type_name (key_type));
+    g_value_unset (dest);
+    return FALSE;
+  }
+
+  if (info->needs_validation && g_param_value_validate (info->pspec, dest)) {
+    GRL_WARNING ("'%s' value invalid, adjusting",
+                 GRL_METADATA_KEY_GET_NAME (key));
+  }
+
+  if (pooled && g_value_get_string (dest) != pooled) {
+    /* Validation replaced the string */
+    string_pool_release (pooled);
+    pooled = NULL;
+  }
+
+  if (interned) {
+    *interned = pooled != NULL;
+  }
+
+  return TRUE;
+}
+
+/* Fast path for the typed setters. If @key holds values of exactly @type and
+   its first value is not grouped with related keys, returns the slot where it
+   is stored, cleared and initialized for @type. Otherwise returns %NULL, and
+   the generic path must be used */
+static DataSlot *
+get_typed_slot (GrlData *data,
+                GrlKeyID key,
+                GType type,
+                const GrlKeyInfo **info)
+{
+  DataSlot *slot;
+  guint first;
+
+  *info = grl_registry_lookup_metadata_key_info (grl_registry_get_default (),
+                                                 key);
+  if (!*info || (*info)->type != type) {
+    return NULL;
+  }
+
+  if (find_slots (data, (*info)->sample_key, &first) > 0) {
+    slot = g_ptr_array_index (data->priv->slots, first);
+    if (slot->relkeys || slot->key != key) {
+      return NULL;
+    }
+    slot_clear_value (slot);
+  } else {
+    slot = g_slice_new0 (DataSlot);
+    slot->sample_key = (*info)->sample_key;
+    slot->key = key;
+    g_ptr_array_insert (data->priv->slots, first, slot);
+  }
+
+  g_value_init (&slot->value, type);
+
+  return slot;
+}
+
+/* Validates the value just set in a slot returned by get_typed_slot() */
+static void
+validate_typed_slot (DataSlot *slot,
+                     const GrlKeyInfo *info)
+{
+  const gchar *pooled;
+
+  if (!info->needs_validation) {
+    return;
+  }
+
+  pooled = slot->interned? g_value_get_string (&slot->value): NULL;
+
+  if (g_param_value_validate (info->pspec, &slot->value)) {
+    GRL_WARNING ("'%s' value invalid, adjusting",
+                 g_param_spec_get_name (info->pspec));
+    if (pooled && g_value_get_string (&slot->value) != pooled) {
+      /* Validation replaced the string */
+      string_pool_release (pooled);
+      slot->interned = FALSE;
+    }
+  }
+}
+
+/* Appends a new value for @key, without creating a #GrlRelatedKeys */
+static void
+add_value (GrlData *data,
+           GrlKeyID key,
+           const GValue *value)
+{
+  DataSlot *slot;
+  GrlKeyID sample_key;
+  gboolean interned;
+
+  sample_key = get_sample_key (key);
+  if (!sample_key) {
+    return;
+  }
+
+  slot = g_slice_new0 (DataSlot);
+  if (!init_value_for_key (&slot->value, key, value, &interned)) {
+    g_slice_free (DataSlot, slot);
+    return;
+  }
+
+  slot->sample_key = sample_key;
+  slot->key = key;
+  slot->interned = interned;
+  insert_slot (data, slot);
+}
+
+/* Appends a new set of values, taking @relkeys. See slot_take_related_keys()
+   for @owned */
+static void
+add_related_keys (GrlData *data,
+                  GrlRelatedKeys *relkeys,
+                  gboolean owned)
+{
+  GList *keys;
+  GrlKeyID sample_key;
+  DataSlot *slot;
+
+  keys = grl_related_keys_get_keys (relkeys);
+  if (!keys) {
+    /* Ignore empty set of related keys */
+    GRL_WARNING ("Trying to add an empty GrlRelatedKeys to GrlData");
+    g_object_unref (relkeys);
+    return;
+  }
+
+  sample_key = get_sample_key (GRLPOINTER_TO_KEYID (keys->data));
+  if (!sample_key) {
+    g_list_free (keys);
+    g_object_unref (relkeys);
+    return;
+  }
+
+  slot = g_slice_new0 (DataSlot);
+  slot->sample_key = sample_key;
+  slot_take_related_keys (slot, relkeys, keys, owned);
+  g_list_free (keys);
+
+  insert_slot (data, slot);
+}
+
 /* ================ API ================ */
 
 /**
@@ -148,20 +629,17 @@ grl_data_new (void)
 const GValue *
 grl_data_get (GrlData *data, GrlKeyID key)
 {
-  GrlRelatedKeys *relkeys = NULL;
+  DataSlot *slot;
 
   g_return_val_if_fail (GRL_IS_DATA (data), NULL);
   g_return_val_if_fail (key, NULL);
 
-  if (grl_data_length (data, key) > 0) {
-    relkeys = grl_data_get_related_keys (data, key, 0);
-  }
-
-  if (!relkeys) {
+  slot = get_slot (data, key, 0, FALSE);
+  if (!slot) {
     return NULL;
   }
 
-  return grl_related_keys_get (relkeys, key);
+  return slot_get_value (slot, key);
 }
 
 /**
@@ -182,7 +660,9 @@ grl_data_get (GrlData *data, GrlKeyID key)
 void
 grl_data_set (GrlData *data, GrlKeyID key, const GValue *value)
 {
-  GrlRelatedKeys *relkeys = NULL;
+  DataSlot *slot;
+  GValue copy = G_VALUE_INIT;
+  gboolean interned;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
@@ -191,19 +671,19 @@ grl_data_set (GrlData *data, GrlKeyID key, const GValue *value)
     return;
   }
 
-  /* Get the right set of related keys */
-  if (grl_data_length (data, key) > 0) {
-    relkeys = grl_data_get_related_keys (data, key, 0);
-  }
-
-  if (!relkeys) {
-    /* No related keys; add them */
-    relkeys = grl_related_keys_new ();
-    grl_related_keys_set (relkeys, key, value);
-    grl_data_add_related_keys (data, relkeys);
+  slot = get_slot (data, key, 0, FALSE);
+  if (!slot) {
+    add_value (data, key, value);
+  } else if (!slot->relkeys && slot->key == key) {
+    /* Replace the inline value */
+    if (init_value_for_key (&copy, key, value, &interned)) {
+      slot_clear_value (slot);
+      slot->value = copy;
+      slot->interned = interned;
+    }
   } else {
-    /* Set the new value */
-    grl_related_keys_set (relkeys, key, value);
+    /* Set it along with the related keys */
+    grl_related_keys_set (slot_get_related_keys (slot), key, value);
   }
 }
 
@@ -224,16 +704,32 @@ grl_data_set_string (GrlData *data,
                      const gchar *strvalue)
 {
   GValue value = { 0 };
+  const GrlKeyInfo *info;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
-  if (strvalue) {
-    g_value_init (&value, G_TYPE_STRING);
-    g_value_set_string (&value, strvalue);
-    grl_data_set (data, key, &value);
-    g_value_unset (&value);
+  if (!strvalue) {
+    return;
   }
+
+  slot = get_typed_slot (data, key, G_TYPE_STRING, &info);
+  if (slot) {
+    if (is_interned_key (key)) {
+      value_set_interned_string (&slot->value, strvalue);
+      slot->interned = TRUE;
+    } else {
+      g_value_set_string (&slot->value, strvalue);
+    }
+    validate_typed_slot (slot, info);
+    return;
+  }
+
+  g_value_init (&value, G_TYPE_STRING);
+  g_value_set_static_string (&value, strvalue);
+  grl_data_set (data, key, &value);
+  g_value_unset (&value);
 }
 
 /**
@@ -282,10 +778,19 @@ void
 grl_data_set_int (GrlData *data, GrlKeyID key, gint intvalue)
 {
   GValue value = { 0 };
+  const GrlKeyInfo *info;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
+  slot = get_typed_slot (data, key, G_TYPE_INT, &info);
+  if (slot) {
+    g_value_set_int (&slot->value, intvalue);
+    validate_typed_slot (slot, info);
+    return;
+  }
+
   g_value_init (&value, G_TYPE_INT);
   g_value_set_int (&value, intvalue);
   grl_data_set (data, key, &value);
@@ -336,10 +841,19 @@ void
 grl_data_set_float (GrlData *data, GrlKeyID key, float floatvalue)
 {
   GValue value = { 0 };
+  const GrlKeyInfo *info;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
+  slot = get_typed_slot (data, key, G_TYPE_FLOAT, &info);
+  if (slot) {
+    g_value_set_float (&slot->value, floatvalue);
+    validate_typed_slot (slot, info);
+    return;
+  }
+
   g_value_init (&value, G_TYPE_FLOAT);
   g_value_set_float (&value, floatvalue);
   grl_data_set (data, key, &value);
@@ -390,10 +904,19 @@ void
 grl_data_set_boolean (GrlData *data, GrlKeyID key, gboolean boolvalue)
 {
   GValue value = { 0 };
+  const GrlKeyInfo *info;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
+  slot = get_typed_slot (data, key, G_TYPE_BOOLEAN, &info);
+  if (slot) {
+    g_value_set_boolean (&slot->value, boolvalue);
+    validate_typed_slot (slot, info);
+    return;
+  }
+
   g_value_init (&value, G_TYPE_BOOLEAN);
   g_value_set_boolean (&value, boolvalue);
   grl_data_set (data, key, &value);
@@ -572,10 +1095,19 @@ void
 grl_data_set_int64 (GrlData *data, GrlKeyID key, gint64 intvalue)
 {
   GValue value = { 0 };
+  const GrlKeyInfo *info;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
+  slot = get_typed_slot (data, key, G_TYPE_INT64, &info);
+  if (slot) {
+    g_value_set_int64 (&slot->value, intvalue);
+    validate_typed_slot (slot, info);
+    return;
+  }
+
   g_value_init (&value, G_TYPE_INT64);
   g_value_set_int64 (&value, intvalue);
   grl_data_set (data, key, &value);
@@ -802,9 +1334,10 @@ grl_data_remove (GrlData *data, GrlKeyID key)
 gboolean
 grl_data_has_key (GrlData *data, GrlKeyID key)
 {
-  GList *related_keys;
   GrlKeyID sample_key;
-  gboolean found = FALSE;
+  guint first;
+  guint length;
+  guint i;
 
   g_return_val_if_fail (GRL_IS_DATA (data), FALSE);
   g_return_val_if_fail (key, FALSE);
@@ -814,13 +1347,14 @@ grl_data_has_key (GrlData *data, GrlKeyID key)
     return FALSE;
   }
 
-  related_keys = g_hash_table_lookup (data->priv->data, GRLKEYID_TO_POINTER (sample_key));
-  while (related_keys && !found) {
-    found = grl_related_keys_has_key (related_keys->data, key);
-    related_keys = g_list_next (related_keys);
+  length = find_slots (data, sample_key, &first);
+  for (i = first; i < first + length; i++) {
+    if (slot_has_key (g_ptr_array_index (data->priv->slots, i), key)) {
+      return TRUE;
+    }
   }
 
-  return found;
+  return FALSE;
 }
 
 /**
@@ -839,19 +1373,24 @@ GList *
 grl_data_get_keys (GrlData *data)
 {
   GList *allkeys = NULL;
-  GList *keylist, *key;
   GrlRegistry *registry;
   const GList *relkeys;
+  GrlKeyID sample_key = GRL_METADATA_KEY_INVALID;
+  DataSlot *slot;
+  guint i;
 
   g_return_val_if_fail (GRL_IS_DATA (data), NULL);
 
-  keylist = g_hash_table_get_keys (data->priv->data);
   registry = grl_registry_get_default ();
 
-  for (key = keylist; key; key = g_list_next (key)) {
-    GrlKeyID key_id = GRLPOINTER_TO_KEYID (key->data);
+  for (i = 0; i < data->priv->slots->len; i++) {
+    slot = g_ptr_array_index (data->priv->slots, i);
+    if (slot->sample_key == sample_key) {
+      continue;
+    }
+    sample_key = slot->sample_key;
     relkeys =
-        grl_registry_lookup_metadata_key_relation (registry, key_id);
+        grl_registry_lookup_metadata_key_relation (registry, sample_key);
     while (relkeys) {
       if (grl_data_has_key (data, GRLPOINTER_TO_KEYID (relkeys->data))) {
         allkeys = g_list_prepend (allkeys, relkeys->data);
@@ -860,8 +1399,6 @@ grl_data_get_keys (GrlData *data)
     }
   }
 
-  g_list_free (keylist);
-
   return allkeys;
 }
 
@@ -882,35 +1419,10 @@ void
 grl_data_add_related_keys (GrlData *data,
                            GrlRelatedKeys *relkeys)
 {
-  GList *keys;
-  GList *list_relkeys;
-  GrlKeyID sample_key;
-
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (GRL_IS_RELATED_KEYS (relkeys));
 
-  keys = grl_related_keys_get_keys (relkeys);
-  if (!keys) {
-    /* Ignore empty set of related keys */
-    GRL_WARNING ("Trying to add an empty GrlRelatedKeys to GrlData");
-    g_object_unref (relkeys);
-    return;
-  }
-
-  sample_key = get_sample_key (GRLPOINTER_TO_KEYID (keys->data));
-  g_list_free (keys);
-
-  if (!sample_key) {
-    g_object_unref (relkeys);
-    return;
-  }
-
-  list_relkeys = g_hash_table_lookup (data->priv->data,
-                                      GRLKEYID_TO_POINTER (sample_key));
-  list_relkeys = g_list_append (list_relkeys, relkeys);
-  g_hash_table_insert (data->priv->data,
-                       GRLKEYID_TO_POINTER (sample_key),
-                       list_relkeys);
+  add_related_keys (data, relkeys, FALSE);
 }
 
 /**
@@ -928,15 +1440,16 @@ grl_data_add_string (GrlData *data,
                      GrlKeyID key,
                      const gchar *strvalue)
 {
-  GrlRelatedKeys *relkeys;
+  GValue value = G_VALUE_INIT;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
   if (strvalue) {
-    relkeys = grl_related_keys_new ();
-    grl_related_keys_set_string (relkeys, key, strvalue);
-    grl_data_add_related_keys (data, relkeys);
+    g_value_init (&value, G_TYPE_STRING);
+    g_value_set_static_string (&value, strvalue);
+    add_value (data, key, &value);
+    g_value_unset (&value);
   }
 }
 
@@ -955,14 +1468,14 @@ grl_data_add_int (GrlData *data,
                   GrlKeyID key,
                   gint intvalue)
 {
-  GrlRelatedKeys *relkeys;
+  GValue value = G_VALUE_INIT;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
-  relkeys = grl_related_keys_new ();
-  grl_related_keys_set_int (relkeys, key, intvalue);
-  grl_data_add_related_keys (data, relkeys);
+  g_value_init (&value, G_TYPE_INT);
+  g_value_set_int (&value, intvalue);
+  add_value (data, key, &value);
 }
 
 /**
@@ -980,14 +1493,14 @@ grl_data_add_float (GrlData *data,
                     GrlKeyID key,
                     gfloat floatvalue)
 {
-  GrlRelatedKeys *relkeys;
+  GValue value = G_VALUE_INIT;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
-  relkeys = grl_related_keys_new ();
-  grl_related_keys_set_float (relkeys, key, floatvalue);
-  grl_data_add_related_keys (data, relkeys);
+  g_value_init (&value, G_TYPE_FLOAT);
+  g_value_set_float (&value, floatvalue);
+  add_value (data, key, &value);
 }
 
 /**
@@ -1018,7 +1531,7 @@ grl_data_add_binary (GrlData *data,
 
   relkeys = grl_related_keys_new ();
   grl_related_keys_set_binary (relkeys, key, buf, size);
-  grl_data_add_related_keys (data, relkeys);
+  add_related_keys (data, relkeys, TRUE);
 }
 
 /**
@@ -1044,7 +1557,7 @@ grl_data_add_boxed (GrlData *data,
 
   relkeys = grl_related_keys_new ();
   grl_related_keys_set_boxed (relkeys, key, boxed);
-  grl_data_add_related_keys (data, relkeys);
+  add_related_keys (data, relkeys, TRUE);
 }
 
 /**
@@ -1062,14 +1575,14 @@ grl_data_add_int64 (GrlData *data,
                     GrlKeyID key,
                     gint64 intvalue)
 {
-  GrlRelatedKeys *relkeys;
+  GValue value = G_VALUE_INIT;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
-  relkeys = grl_related_keys_new ();
-  grl_related_keys_set_int64 (relkeys, key, intvalue);
-  grl_data_add_related_keys (data, relkeys);
+  g_value_init (&value, G_TYPE_INT64);
+  g_value_set_int64 (&value, intvalue);
+  add_value (data, key, &value);
 }
 
 /**
@@ -1097,6 +1610,7 @@ grl_data_length (GrlData *data,
                  GrlKeyID key)
 {
   GrlKeyID sample_key;
+  guint first;
 
   g_return_val_if_fail (GRL_IS_DATA (data), 0);
   g_return_val_if_fail (key, 0);
@@ -1106,8 +1620,7 @@ grl_data_length (GrlData *data,
     return 0;
   }
 
-  return g_list_length (g_hash_table_lookup (data->priv->data,
-                                             GRLKEYID_TO_POINTER (sample_key)));
+  return find_slots (data, sample_key, &first);
 }
 
 /**
@@ -1131,28 +1644,17 @@ grl_data_get_related_keys (GrlData *data,
                            GrlKeyID key,
                            guint index)
 {
-  GList *relkeys_list;
-  GrlKeyID sample_key;
-  GrlRelatedKeys *relkeys;
+  DataSlot *slot;
 
   g_return_val_if_fail (GRL_IS_DATA (data), NULL);
   g_return_val_if_fail (key, NULL);
 
-  sample_key = get_sample_key (key);
-  if (!sample_key) {
+  slot = get_slot (data, key, index, TRUE);
+  if (!slot) {
     return NULL;
   }
 
-  relkeys_list = g_hash_table_lookup (data->priv->data,
-                                      GRLKEYID_TO_POINTER (sample_key));
-  relkeys = g_list_nth_data (relkeys_list, index);
-
-  if (!relkeys) {
-    GRL_WARNING ("%s: index %u out of range", __FUNCTION__, index);
-    return NULL;
-  }
-
-  return relkeys;
+  return slot_get_related_keys (slot);
 }
 
 /**
@@ -1171,10 +1673,12 @@ GList *
 grl_data_get_single_values_for_key (GrlData *data,
                                     GrlKeyID key)
 {
-  GList *related_keys;
   GList *values = NULL;
   GrlKeyID sample_key;
   const GValue *v;
+  guint first;
+  guint length;
+  guint i;
 
   g_return_val_if_fail (GRL_IS_DATA (data), NULL);
   g_return_val_if_fail (key, NULL);
@@ -1184,14 +1688,12 @@ grl_data_get_single_values_for_key (GrlData *data,
     return NULL;
   }
 
-  related_keys = g_hash_table_lookup (data->priv->data,
-                                      GRLKEYID_TO_POINTER (sample_key));
-  while (related_keys) {
-    v = grl_related_keys_get (related_keys->data, key);
+  length = find_slots (data, sample_key, &first);
+  for (i = first; i < first + length; i++) {
+    v = slot_get_value (g_ptr_array_index (data->priv->slots, i), key);
     if (v) {
       values = g_list_prepend (values, (gpointer) v);
     }
-    related_keys = g_list_next (related_keys);
   }
 
   return g_list_reverse (values);
@@ -1258,31 +1760,17 @@ grl_data_remove_nth (GrlData *data,
                      GrlKeyID key,
                      guint index)
 {
-  GList *relkeys_element;
-  GList *relkeys_list;
-  GrlKeyID sample_key;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (key);
 
-  sample_key = get_sample_key (key);
-  if (!sample_key) {
+  slot = get_slot (data, key, index, TRUE);
+  if (!slot) {
     return;
   }
 
-  relkeys_list = g_hash_table_lookup (data->priv->data,
-                                      GRLKEYID_TO_POINTER (sample_key));
-  relkeys_element = g_list_nth (relkeys_list, index);
-  if (!relkeys_element) {
-    GRL_WARNING ("%s: index %u out of range", __FUNCTION__, index);
-    return;
-  }
-
-  g_object_unref (relkeys_element->data);
-  relkeys_list = g_list_delete_link (relkeys_list, relkeys_element);
-  g_hash_table_insert (data->priv->data,
-                       GRLKEYID_TO_POINTER (sample_key),
-                       relkeys_list);
+  g_ptr_array_remove (data->priv->slots, slot);
 }
 
 /**
@@ -1304,9 +1792,7 @@ grl_data_set_related_keys (GrlData *data,
                            guint index)
 {
   GList *keys;
-  GList *relkeys_element;
-  GList *relkeys_list;
-  GrlKeyID sample_key;
+  DataSlot *slot;
 
   g_return_if_fail (GRL_IS_DATA (data));
   g_return_if_fail (GRL_IS_RELATED_KEYS (relkeys));
@@ -1318,22 +1804,17 @@ grl_data_set_related_keys (GrlData *data,
     return;
   }
 
-  sample_key = get_sample_key (GRLPOINTER_TO_KEYID (keys->data));
-  g_list_free (keys);
-  if (!sample_key) {
-    return;
-  }
-
-  relkeys_list = g_hash_table_lookup (data->priv->data,
-                                      GRLKEYID_TO_POINTER (sample_key));
-  relkeys_element = g_list_nth (relkeys_list, index);
-  if (!relkeys_element) {
-    GRL_WARNING ("%s: index %u out of range", __FUNCTION__, index);
+  slot = get_slot (data, GRLPOINTER_TO_KEYID (keys->data), index, TRUE);
+  if (!slot) {
+    g_list_free (keys);
+    g_object_unref (relkeys);
     return;
   }
 
-  g_object_unref (relkeys_element->data);
-  relkeys_element->data = relkeys;
+  /* Keep the position: the slot is reused */
+  slot_reset (slot);
+  slot_take_related_keys (slot, relkeys, keys, FALSE);
+  g_list_free (keys);
 }
 
 /**
@@ -1349,31 +1830,124 @@ grl_data_set_related_keys (GrlData *data,
 GrlData *
 grl_data_dup (GrlData *data)
 {
-  GList *dup_relkeys_list;
-  GList *key;
-  GList *keys;
-  GList *relkeys_list;
   GrlData *dup_data;
+  DataSlot *slot;
+  DataSlot *dup_slot;
+  guint i;
 
   g_return_val_if_fail (GRL_IS_DATA (data), NULL);
 
   dup_data = grl_data_new ();
-  keys = g_hash_table_get_keys (data->priv->data);
-  for (key = keys; key; key = g_list_next (key)) {
-    dup_relkeys_list = NULL;
-    relkeys_list = g_hash_table_lookup (data->priv->data, key->data);
-    while (relkeys_list) {
-      dup_relkeys_list =
-        g_list_prepend (dup_relkeys_list,
-                        grl_related_keys_dup (relkeys_list->data));
-      relkeys_list = g_list_next (relkeys_list);
+  for (i = 0; i < data->priv->slots->len; i++) {
+    slot = g_ptr_array_index (data->priv->slots, i);
+    dup_slot = g_slice_new0 (DataSlot);
+    dup_slot->sample_key = slot->sample_key;
+    if (slot->relkeys) {
+      dup_slot->relkeys = grl_related_keys_dup (slot->relkeys);
+    } else if (slot->interned) {
+      dup_slot->key = slot->key;
+      dup_slot->interned = TRUE;
+      g_value_init (&dup_slot->value, G_TYPE_STRING);
+      value_set_interned_string (&dup_slot->value,
+                                 g_value_get_string (&slot->value));
+    } else {
+      dup_slot->key = slot->key;
+      g_value_init (&dup_slot->value, G_VALUE_TYPE (&slot->value));
+      g_value_copy (&slot->value, &dup_slot->value);
     }
-    g_hash_table_insert (dup_data->priv->data,
-                         key->data,
-                         g_list_reverse (relkeys_list));
+    /* Slots are already sorted */
+    g_ptr_array_add (dup_data->priv->slots, dup_slot);
   }
 
-  g_list_free (keys);
-
   return dup_data;
 }
+
+/**
+ * grl_data_set_interned_key:
+ * @key: (type GrlKeyID): a string-type key
+ * @interned: whether values of @key are interned
+ *
+ * Sets whether the values of @key are kept in a pool shared by all the
+ * #GrlData, so that media with the same value for @key share the same copy
+ * of the string. This is useful for keys whose values are repeated across
+ * many media, like the source, the genre or the album. No key is interned
+ * unless requested.
+ *
+ * Strings in the pool are freed when no #GrlData uses them. Changing it only
+ * affects the values set from now on.
+ *
+ * Since: 0.3.13
+ **/
+void
+grl_data_set_interned_key (GrlKeyID key,
+                           gboolean interned)
+{
+  g_return_if_fail (key != GRL_METADATA_KEY_INVALID);
+
+  if (interned && GRL_METADATA_KEY_GET_TYPE (key) != G_TYPE_STRING) {
+    GRL_WARNING ("%s: only string-type keys can be interned", __FUNCTION__);
+    return;
+  }
+
+  G_LOCK (pool);
+
+  if (!interned_keys) {
+    interned_keys = g_hash_table_new (g_direct_hash, g_direct_equal);
+  }
+
+  if (interned) {
+    if (g_hash_table_add (interned_keys, GRLKEYID_TO_POINTER (key))) {
+      g_atomic_int_inc (&n_interned_keys);
+    }
+  } else if (g_hash_table_remove (interned_keys, GRLKEYID_TO_POINTER (key))) {
+    g_atomic_int_add (&n_interned_keys, -1);
+  }
+
+  G_UNLOCK (pool);
+}
+
+/**
+ * grl_data_get_interned_key:
+ * @key: (type GrlKeyID): a key
+ *
+ * Returns whether the values of @key are kept in the shared pool.
+ *
+ * Returns: %TRUE if values of @key are interned
+ *
+ * Since: 0.3.13
+ **/
+gboolean
+grl_data_get_interned_key (GrlKeyID key)
+{
+  return is_interned_key (key);
+}
+
+/**
+ * grl_data_get_string_pool_stats:
+ * @strings: (out) (allow-none): number of different strings in the pool
+ * @references: (out) (allow-none): number of values using them
+ * @saved: (out) (allow-none): bytes saved by sharing the strings
+ *
+ * Gets statistics of the pool of interned strings.
+ *
+ * Since: 0.3.13
+ **/
+void
+grl_data_get_string_pool_stats (guint *strings,
+                                guint *references,
+                                gsize *saved)
+{
+  G_LOCK (pool);
+
+  if (strings) {
+    *strings = pool? g_hash_table_size (pool): 0;
+  }
+  if (references) {
+    *references = pool_references;
+  }
+  if (saved) {
+    *saved = pool_saved;
+  }
+
+  G_UNLOCK (pool);
+}
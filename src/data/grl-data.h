@@ -169,6 +169,14 @@ void grl_data_set_related_keys (GrlData *data, GrlRelatedKeys *relkeys, guint in
 
 GrlData *grl_data_dup (GrlData *data);
 
+void grl_data_set_interned_key (GrlKeyID key, gboolean interned);
+
+gboolean grl_data_get_interned_key (GrlKeyID key);
+
+void grl_data_get_string_pool_stats (guint *strings,
+                                     guint *references,
+                                     gsize *saved);
+
 G_END_DECLS
 
 #endif /* _GRL_DATA_H_ */
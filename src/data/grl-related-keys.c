@@ -39,9 +39,9 @@
  * can handle them in one shot.
  */
 
-#include "grl-related-keys.h"
+#include "grl-related-keys-priv.h"
 #include "grl-log.h"
-#include "grl-registry.h"
+#include "grl-registry-priv.h"
 
 struct _GrlRelatedKeysPrivate {
   GHashTable *data;
@@ -235,7 +235,7 @@ grl_related_keys_set (GrlRelatedKeys *relkeys,
                       const GValue *value)
 {
   GValue *copy = NULL;
-  GrlRegistry *registry;
+  const GrlKeyInfo *info;
   GType key_type, value_type;
 
   g_return_if_fail (GRL_IS_RELATED_KEYS (relkeys));
@@ -245,36 +245,59 @@ grl_related_keys_set (GrlRelatedKeys *relkeys,
     return;
   }
 
-  key_type = GRL_METADATA_KEY_GET_TYPE (key);
+  info = grl_registry_lookup_metadata_key_info (grl_registry_get_default (),
+                                                key);
+  key_type = info? info->type: G_TYPE_INVALID;
   value_type = G_VALUE_TYPE (value);
 
-  if (!g_value_type_transformable (value_type, key_type)) {
-    GRL_WARNING ("value has type %s, but expected %s",
-                 g_type_name (value_type),
-                 g_type_name (key_type));
-    return;
-  }
-
   /* Dup value */
-  copy = g_new0 (GValue, 1);
-  g_value_init (copy, key_type);
-  if (!g_value_transform (value, copy)) {
-    GRL_WARNING ("transforming value type %s to key's type %s failed",
-                 g_type_name (value_type),
-                 g_type_name (key_type));
-    g_free (copy);
-    return;
-  }
+  if (value_type == key_type) {
+    copy = g_new0 (GValue, 1);
+    g_value_init (copy, key_type);
+    g_value_copy (value, copy);
+  } else {
+    if (!g_value_type_transformable (value_type, key_type)) {
+      GRL_WARNING ("value has type %s, but expected %s",
+                   g_type_name (value_type),
+                   g_type_name (key_type));
+      return;
+    }
 
-  registry = grl_registry_get_default ();
+    copy = g_new0 (GValue, 1);
+    g_value_init (copy, key_type);
+    if (!g_value_transform (value, copy)) {
+      GRL_WARNING ("transforming value type %s to key's type %s failed",
+                   g_type_name (value_type),
+                   g_type_name (key_type));
+      g_free (copy);
+      return;
+    }
+  }
 
-  if (!grl_registry_metadata_key_validate (registry, key, copy)) {
+  if (info->needs_validation && g_param_value_validate (info->pspec, copy)) {
     GRL_WARNING ("'%s' value invalid, adjusting",
                  GRL_METADATA_KEY_GET_NAME (key));
   }
   g_hash_table_insert (relkeys->priv->data, GRLKEYID_TO_POINTER (key), copy);
 }
 
+/*
+ * grl_related_keys_take_value:
+ * @relkeys: set of related keys to modify
+ * @key: key to change or add
+ * @value: (transfer full): a newly allocated value, already valid for @key
+ *
+ * Sets @value for @key in @relkeys without copying it. @relkeys frees it with
+ * g_free() when the value is replaced or removed.
+ */
+void
+grl_related_keys_take_value (GrlRelatedKeys *relkeys,
+                             GrlKeyID key,
+                             GValue *value)
+{
+  g_hash_table_insert (relkeys->priv->data, GRLKEYID_TO_POINTER (key), value);
+}
+
 /**
  * grl_related_keys_set_string:
  * @relkeys: set of related keys to modify
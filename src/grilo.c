@@ -40,6 +40,7 @@
 #include "grl-metadata-key-priv.h"
 #include "grl-operation-priv.h"
 #include "grl-registry-priv.h"
+#include "grl-resolve-cache-priv.h"
 #include "grl-log-priv.h"
 #include "config.h"
 
@@ -191,6 +192,8 @@ grl_deinit (void)
 
   registry = grl_registry_get_default ();
   grl_registry_shutdown (registry);
+  grl_resolve_cache_set_file (NULL, NULL);
+  grl_resolve_cache_clear ();
   grl_initialized = FALSE;
 }
 
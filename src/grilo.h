@@ -41,6 +41,8 @@
 #include <grl-util.h>
 #include <grl-definitions.h>
 #include <grl-operation.h>
+#include <grl-resolve-cache.h>
+#include <grl-result-stream.h>
 
 #undef _GRILO_H_INSIDE_
 
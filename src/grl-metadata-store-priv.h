@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_METADATA_STORE_PRIV_H_
+#define _GRL_METADATA_STORE_PRIV_H_
+
+#include <glib.h>
+
+#include "grl-metadata-key.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GrlMetadataStore GrlMetadataStore;
+
+GrlMetadataStore *grl_metadata_store_open (const gchar *filename,
+                                           GError **error);
+
+void grl_metadata_store_close (GrlMetadataStore *store);
+
+gboolean grl_metadata_store_append (GrlMetadataStore *store,
+                                    const gchar *media_source,
+                                    const gchar *media_id,
+                                    GrlKeyID key,
+                                    const gchar *provider,
+                                    GList *values,
+                                    gint64 expires);
+
+GList *grl_metadata_store_lookup (GrlMetadataStore *store,
+                                  const gchar *media_source,
+                                  const gchar *media_id,
+                                  GrlKeyID key,
+                                  gchar **provider,
+                                  gint64 *expires);
+
+void grl_metadata_store_invalidate_source (GrlMetadataStore *store,
+                                           const gchar *source_id);
+
+void grl_metadata_store_clear (GrlMetadataStore *store);
+
+gboolean grl_metadata_store_flush (GrlMetadataStore *store,
+                                   GError **error);
+
+gboolean grl_metadata_store_compact (GrlMetadataStore *store,
+                                     GError **error);
+
+G_END_DECLS
+
+#endif /* _GRL_METADATA_STORE_PRIV_H_ */
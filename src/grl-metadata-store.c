@@ -0,0 +1,1187 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*
+ * Persistent storage for the resolve cache.
+ *
+ * The store is a single file made of a header followed by records that are
+ * only ever appended:
+ *
+ *   header:  "GRLMETA\0" | version (u32) | reserved (u32)
+ *   record:  magic (u32) | payload length (u32) | checksum (u32) | payload
+ *
+ * A payload is either an entry (the values of a key for a media, identified by
+ * its source and id) or the invalidation of all the entries related to a
+ * source. Integers are little endian, strings are prefixed with their length,
+ * and keys are saved by name as their identifiers change between processes.
+ *
+ * When opening the store, the records are scanned to build an index of the
+ * latest entry for each key. A record that is truncated or does not match its
+ * checksum, as left by a crash in the middle of an append, ends the scan and
+ * the file is truncated there. Values are decoded on demand from a read-only
+ * mapping of the file.
+ *
+ * Appended records are kept in memory until the store is flushed, so the
+ * resolve path never waits for the disk; the owner of the store is expected to
+ * flush it from an idle callback or a timeout.
+ *
+ * As entries are replaced, invalidated or expire, the file accumulates dead
+ * records. Compacting writes the live ones to a new file that atomically
+ * replaces the old one.
+ *
+ * The store is meant to be used by a single process: a lock file next to it
+ * prevents another one from opening it at the same time.
+ */
+
+#include "grl-metadata-store-priv.h"
+#include "grl-related-keys.h"
+#include "grl-registry.h"
+#include "grl-log.h"
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+#ifdef G_OS_UNIX
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#define GRL_LOG_DOMAIN_DEFAULT  resolve_cache_log_domain
+GRL_LOG_DOMAIN_EXTERN(resolve_cache_log_domain);
+
+#define STORE_MAGIC          "GRLMETA"
+#define STORE_VERSION        1
+#define STORE_HEADER_SIZE    16
+#define RECORD_MAGIC         0x4752524c
+#define RECORD_HEADER_SIZE   12
+
+/* Compact when dead records take more than the live ones and this size */
+#define COMPACT_MIN_DEAD     (1024 * 1024)
+
+enum {
+  RECORD_ENTRY = 1,
+  RECORD_INVALIDATE = 2
+};
+
+enum {
+  VALUE_STRING = 1,
+  VALUE_INT,
+  VALUE_INT64,
+  VALUE_FLOAT,
+  VALUE_BOOLEAN,
+  VALUE_DATE_TIME,
+  VALUE_BINARY
+};
+
+typedef struct {
+  gchar *media_source;
+  gchar *media_id;
+  gchar *key;
+} StoreKey;
+
+typedef struct {
+  StoreKey skey;
+  gchar *provider;
+  gint64 expires;
+  goffset offset;
+  guint32 length;
+} StoreRecord;
+
+struct _GrlMetadataStore {
+  GFile *file;
+  GFileIOStream *stream;
+  GMappedFile *map;
+  GHashTable *index;
+  GByteArray *pending;
+  goffset written;
+  goffset length;
+  goffset live;
+  gint lock_fd;
+};
+
+typedef struct {
+  const guint8 *data;
+  gsize length;
+  gsize pos;
+  gboolean error;
+} Reader;
+
+/* ================ Encoding ================ */
+
+static guint32
+checksum (const guint8 *data,
+          gsize length)
+{
+  /* Adler-32 */
+  guint32 a = 1;
+  guint32 b = 0;
+
+  while (length > 0) {
+    gsize block = MIN (length, 5552);
+
+    length -= block;
+    while (block--) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+
+  return (b << 16) | a;
+}
+
+static void
+put_u8 (GByteArray *buffer,
+        guint8 value)
+{
+  g_byte_array_append (buffer, &value, 1);
+}
+
+static void
+put_u32 (GByteArray *buffer,
+         guint32 value)
+{
+  value = GUINT32_TO_LE (value);
+  g_byte_array_append (buffer, (guint8 *) &value, sizeof (value));
+}
+
+static void
+put_i64 (GByteArray *buffer,
+         gint64 value)
+{
+  value = GINT64_TO_LE (value);
+  g_byte_array_append (buffer, (guint8 *) &value, sizeof (value));
+}
+
+static void
+put_data (GByteArray *buffer,
+          const guint8 *data,
+          gsize length)
+{
+  put_u32 (buffer, length);
+  g_byte_array_append (buffer, data, length);
+}
+
+static void
+put_str (GByteArray *buffer,
+         const gchar *str)
+{
+  put_data (buffer, (const guint8 *) str, str? strlen (str): 0);
+}
+
+static const guint8 *
+get_bytes (Reader *reader,
+           gsize length)
+{
+  const guint8 *bytes;
+
+  if (reader->error || reader->length - reader->pos < length) {
+    reader->error = TRUE;
+    return NULL;
+  }
+
+  bytes = reader->data + reader->pos;
+  reader->pos += length;
+
+  return bytes;
+}
+
+static guint8
+get_u8 (Reader *reader)
+{
+  const guint8 *bytes = get_bytes (reader, 1);
+
+  return bytes? *bytes: 0;
+}
+
+static guint32
+get_u32 (Reader *reader)
+{
+  const guint8 *bytes = get_bytes (reader, sizeof (guint32));
+  guint32 value;
+
+  if (!bytes) {
+    return 0;
+  }
+
+  memcpy (&value, bytes, sizeof (value));
+  return GUINT32_FROM_LE (value);
+}
+
+static gint64
+get_i64 (Reader *reader)
+{
+  const guint8 *bytes = get_bytes (reader, sizeof (gint64));
+  gint64 value;
+
+  if (!bytes) {
+    return 0;
+  }
+
+  memcpy (&value, bytes, sizeof (value));
+  return GINT64_FROM_LE (value);
+}
+
+static const guint8 *
+get_data (Reader *reader,
+          gsize *length)
+{
+  *length = get_u32 (reader);
+  return get_bytes (reader, *length);
+}
+
+static gchar *
+get_str (Reader *reader)
+{
+  const guint8 *data;
+  gsize length;
+
+  data = get_data (reader, &length);
+  return data? g_strndup ((const gchar *) data, length): NULL;
+}
+
+static gboolean
+put_value (GByteArray *buffer,
+           const GValue *value)
+{
+  GType type = G_VALUE_TYPE (value);
+
+  if (type == G_TYPE_STRING) {
+    put_u8 (buffer, VALUE_STRING);
+    put_str (buffer, g_value_get_string (value));
+  } else if (type == G_TYPE_INT) {
+    put_u8 (buffer, VALUE_INT);
+    put_u32 (buffer, (guint32) g_value_get_int (value));
+  } else if (type == G_TYPE_INT64) {
+    put_u8 (buffer, VALUE_INT64);
+    put_i64 (buffer, g_value_get_int64 (value));
+  } else if (type == G_TYPE_FLOAT) {
+    gfloat f = g_value_get_float (value);
+    guint32 bits;
+
+    memcpy (&bits, &f, sizeof (bits));
+    put_u8 (buffer, VALUE_FLOAT);
+    put_u32 (buffer, bits);
+  } else if (type == G_TYPE_BOOLEAN) {
+    put_u8 (buffer, VALUE_BOOLEAN);
+    put_u8 (buffer, g_value_get_boolean (value));
+  } else if (type == G_TYPE_DATE_TIME && g_value_get_boxed (value)) {
+    GDateTime *date = g_value_get_boxed (value);
+
+    put_u8 (buffer, VALUE_DATE_TIME);
+    put_i64 (buffer, g_date_time_to_unix (date));
+    put_u32 (buffer, g_date_time_get_microsecond (date));
+    put_i64 (buffer, g_date_time_get_utc_offset (date));
+  } else if (type == G_TYPE_BYTE_ARRAY && g_value_get_boxed (value)) {
+    GByteArray *array = g_value_get_boxed (value);
+
+    put_u8 (buffer, VALUE_BINARY);
+    put_data (buffer, array->data, array->len);
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static gboolean
+get_value (Reader *reader,
+           GValue *value)
+{
+  switch (get_u8 (reader)) {
+  case VALUE_STRING:
+    g_value_init (value, G_TYPE_STRING);
+    g_value_take_string (value, get_str (reader));
+    break;
+  case VALUE_INT:
+    g_value_init (value, G_TYPE_INT);
+    g_value_set_int (value, (gint32) get_u32 (reader));
+    break;
+  case VALUE_INT64:
+    g_value_init (value, G_TYPE_INT64);
+    g_value_set_int64 (value, get_i64 (reader));
+    break;
+  case VALUE_FLOAT: {
+    guint32 bits = get_u32 (reader);
+    gfloat f;
+
+    memcpy (&f, &bits, sizeof (f));
+    g_value_init (value, G_TYPE_FLOAT);
+    g_value_set_float (value, f);
+    break;
+  }
+  case VALUE_BOOLEAN:
+    g_value_init (value, G_TYPE_BOOLEAN);
+    g_value_set_boolean (value, get_u8 (reader));
+    break;
+  case VALUE_DATE_TIME: {
+    gint64 unix_time = get_i64 (reader);
+    guint32 usec = get_u32 (reader);
+    gint64 offset = get_i64 (reader) / G_USEC_PER_SEC;
+    GDateTime *utc;
+    GDateTime *date;
+    GTimeZone *tz;
+    gchar *tz_id;
+
+    if (reader->error) {
+      return FALSE;
+    }
+
+    tz_id = g_strdup_printf ("%c%02d:%02d",
+                             offset < 0? '-': '+',
+                             (gint) (ABS (offset) / 3600),
+                             (gint) (ABS (offset) % 3600 / 60));
+    tz = g_time_zone_new (tz_id);
+    utc = g_date_time_new_from_unix_utc (unix_time);
+    date = g_date_time_add (utc, usec);
+    g_value_init (value, G_TYPE_DATE_TIME);
+    g_value_take_boxed (value, g_date_time_to_timezone (date, tz));
+    g_date_time_unref (date);
+    g_date_time_unref (utc);
+    g_time_zone_unref (tz);
+    g_free (tz_id);
+    break;
+  }
+  case VALUE_BINARY: {
+    const guint8 *data;
+    gsize length;
+    GByteArray *array;
+
+    data = get_data (reader, &length);
+    if (!data) {
+      return FALSE;
+    }
+    array = g_byte_array_sized_new (length);
+    g_byte_array_append (array, data, length);
+    g_value_init (value, G_TYPE_BYTE_ARRAY);
+    g_value_take_boxed (value, array);
+    break;
+  }
+  default:
+    reader->error = TRUE;
+    break;
+  }
+
+  if (reader->error) {
+    if (G_IS_VALUE (value)) {
+      g_value_unset (value);
+    }
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* ================ Index ================ */
+
+static guint
+store_key_hash (gconstpointer key)
+{
+  const StoreKey *skey = key;
+
+  return (g_str_hash (skey->media_source) * 31 +
+          g_str_hash (skey->media_id)) * 31 + g_str_hash (skey->key);
+}
+
+static gboolean
+store_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const StoreKey *ka = a;
+  const StoreKey *kb = b;
+
+  return g_str_equal (ka->key, kb->key) &&
+    g_str_equal (ka->media_id, kb->media_id) &&
+    g_str_equal (ka->media_source, kb->media_source);
+}
+
+static void
+store_record_free (StoreRecord *record)
+{
+  g_free (record->skey.media_source);
+  g_free (record->skey.media_id);
+  g_free (record->skey.key);
+  g_free (record->provider);
+  g_slice_free (StoreRecord, record);
+}
+
+static void
+index_insert (GrlMetadataStore *store,
+              StoreRecord *record)
+{
+  StoreRecord *old;
+
+  old = g_hash_table_lookup (store->index, &record->skey);
+  if (old) {
+    store->live -= old->length;
+    g_hash_table_remove (store->index, &old->skey);
+  }
+
+  g_hash_table_insert (store->index, &record->skey, record);
+  store->live += record->length;
+}
+
+static guint
+index_invalidate_source (GrlMetadataStore *store,
+                         const gchar *source_id)
+{
+  GHashTableIter iter;
+  StoreRecord *record;
+  guint removed = 0;
+
+  g_hash_table_iter_init (&iter, store->index);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &record)) {
+    if (g_str_equal (record->skey.media_source, source_id) ||
+        g_strcmp0 (record->provider, source_id) == 0) {
+      store->live -= record->length;
+      g_hash_table_iter_remove (&iter);
+      removed++;
+    }
+  }
+
+  return removed;
+}
+
+/* Parses the part of an entry that goes into the index; the reader is left at
+   the beginning of the values */
+static StoreRecord *
+parse_entry (Reader *reader)
+{
+  StoreRecord *record;
+
+  record = g_slice_new0 (StoreRecord);
+  record->expires = get_i64 (reader);
+  record->skey.media_source = get_str (reader);
+  record->skey.media_id = get_str (reader);
+  record->skey.key = get_str (reader);
+  record->provider = get_str (reader);
+
+  if (reader->error) {
+    store_record_free (record);
+    return NULL;
+  }
+
+  if (*record->provider == '\0') {
+    g_clear_pointer (&record->provider, g_free);
+  }
+
+  return record;
+}
+
+/* Scans the records in @data, filling the index. Returns the length of the
+   valid part */
+static gsize
+store_scan (GrlMetadataStore *store,
+            const guint8 *data,
+            gsize length)
+{
+  gsize pos = STORE_HEADER_SIZE;
+
+  while (length - pos >= RECORD_HEADER_SIZE) {
+    Reader reader = { data + pos, RECORD_HEADER_SIZE, 0, FALSE };
+    guint32 magic = get_u32 (&reader);
+    guint32 payload_length = get_u32 (&reader);
+    guint32 payload_checksum = get_u32 (&reader);
+    const guint8 *payload = data + pos + RECORD_HEADER_SIZE;
+
+    if (magic != RECORD_MAGIC ||
+        length - pos - RECORD_HEADER_SIZE < payload_length ||
+        checksum (payload, payload_length) != payload_checksum) {
+      break;
+    }
+
+    reader.data = payload;
+    reader.length = payload_length;
+    reader.pos = 0;
+
+    switch (get_u8 (&reader)) {
+    case RECORD_ENTRY: {
+      StoreRecord *record = parse_entry (&reader);
+      if (record) {
+        record->offset = pos;
+        record->length = RECORD_HEADER_SIZE + payload_length;
+        index_insert (store, record);
+      }
+      break;
+    }
+    case RECORD_INVALIDATE: {
+      gchar *source_id = get_str (&reader);
+      if (source_id) {
+        index_invalidate_source (store, source_id);
+        g_free (source_id);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    pos += RECORD_HEADER_SIZE + payload_length;
+  }
+
+  return pos;
+}
+
+/* ================ File handling ================ */
+
+static GBytes *
+store_header_new (void)
+{
+  GByteArray *header = g_byte_array_sized_new (STORE_HEADER_SIZE);
+
+  g_byte_array_append (header, (const guint8 *) STORE_MAGIC,
+                       sizeof (STORE_MAGIC));
+  put_u32 (header, STORE_VERSION);
+  put_u32 (header, 0);
+
+  return g_byte_array_free_to_bytes (header);
+}
+
+static gboolean
+store_reopen_stream (GrlMetadataStore *store,
+                     GError **error)
+{
+  g_clear_object (&store->stream);
+  g_clear_pointer (&store->map, g_mapped_file_unref);
+
+  store->stream = g_file_open_readwrite (store->file, NULL, error);
+  if (!store->stream) {
+    return FALSE;
+  }
+
+  return g_seekable_seek (G_SEEKABLE (store->stream), store->written,
+                          G_SEEK_SET, NULL, error);
+}
+
+/* Makes sure the mapping covers @length bytes */
+static const guint8 *
+store_map (GrlMetadataStore *store,
+           goffset length)
+{
+  gchar *path;
+
+  if (!store->map || g_mapped_file_get_length (store->map) < length) {
+    g_clear_pointer (&store->map, g_mapped_file_unref);
+    path = g_file_get_path (store->file);
+    store->map = g_mapped_file_new (path, FALSE, NULL);
+    g_free (path);
+  }
+
+  if (!store->map || g_mapped_file_get_length (store->map) < length) {
+    return NULL;
+  }
+
+  return (const guint8 *) g_mapped_file_get_contents (store->map);
+}
+
+/* Returns the bytes of @record, either from the file or from the records that
+   were not flushed yet */
+static const guint8 *
+store_record_data (GrlMetadataStore *store,
+                   StoreRecord *record)
+{
+  const guint8 *data;
+
+  if (record->offset >= store->written) {
+    return store->pending->data + (record->offset - store->written);
+  }
+
+  data = store_map (store, record->offset + record->length);
+  return data? data + record->offset: NULL;
+}
+
+static gboolean
+store_append_record (GrlMetadataStore *store,
+                     GByteArray *payload,
+                     StoreRecord *record)
+{
+  guint length = RECORD_HEADER_SIZE + payload->len;
+
+  if (!store->stream) {
+    if (record) {
+      store_record_free (record);
+    }
+    return FALSE;
+  }
+
+  put_u32 (store->pending, RECORD_MAGIC);
+  put_u32 (store->pending, payload->len);
+  put_u32 (store->pending, checksum (payload->data, payload->len));
+  g_byte_array_append (store->pending, payload->data, payload->len);
+
+  if (record) {
+    record->offset = store->length;
+    record->length = length;
+    index_insert (store, record);
+  }
+  store->length += length;
+
+  return TRUE;
+}
+
+static void
+store_maybe_compact (GrlMetadataStore *store)
+{
+  goffset dead = store->length - STORE_HEADER_SIZE - store->live;
+  GError *error = NULL;
+
+  if (dead > store->live && dead > COMPACT_MIN_DEAD) {
+    if (!grl_metadata_store_compact (store, &error)) {
+      GRL_WARNING ("Unable to compact metadata store: %s", error->message);
+      g_error_free (error);
+    }
+  }
+}
+
+static gboolean
+store_lock (GrlMetadataStore *store,
+            const gchar *filename,
+            GError **error)
+{
+#ifdef G_OS_UNIX
+  gchar *lock_path;
+  gint saved_errno;
+
+  lock_path = g_strconcat (filename, ".lock", NULL);
+  store->lock_fd = g_open (lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  saved_errno = errno;
+  g_free (lock_path);
+
+  if (store->lock_fd < 0) {
+    g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                 "Unable to create lock file for metadata store '%s': %s",
+                 filename, g_strerror (saved_errno));
+    return FALSE;
+  }
+
+  if (flock (store->lock_fd, LOCK_EX | LOCK_NB) < 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_BUSY,
+                 "Metadata store '%s' is in use by another process",
+                 filename);
+    return FALSE;
+  }
+#endif
+
+  return TRUE;
+}
+
+/*
+ * grl_metadata_store_open:
+ * @filename: path of the store
+ * @error: a #GError, or @NULL
+ *
+ * Opens the store in @filename, creating it if it does not exist. Stores from
+ * a different version are discarded. Fails if another process has it open.
+ *
+ * Returns: the store, or %NULL on error
+ */
+GrlMetadataStore *
+grl_metadata_store_open (const gchar *filename,
+                         GError **error)
+{
+  GrlMetadataStore *store;
+  GMappedFile *map;
+  GBytes *header;
+  const guint8 *data = NULL;
+  gsize length = 0;
+  gsize valid;
+  GError *map_error = NULL;
+
+  store = g_slice_new0 (GrlMetadataStore);
+  store->file = g_file_new_for_path (filename);
+  store->index = g_hash_table_new_full (store_key_hash, store_key_equal,
+                                        NULL,
+                                        (GDestroyNotify) store_record_free);
+  store->pending = g_byte_array_new ();
+  store->lock_fd = -1;
+
+  if (!store_lock (store, filename, error)) {
+    grl_metadata_store_close (store);
+    return NULL;
+  }
+
+  map = g_mapped_file_new (filename, FALSE, &map_error);
+  if (map) {
+    data = (const guint8 *) g_mapped_file_get_contents (map);
+    length = g_mapped_file_get_length (map);
+  } else if (!g_error_matches (map_error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+    g_propagate_error (error, map_error);
+    grl_metadata_store_close (store);
+    return NULL;
+  } else {
+    g_clear_error (&map_error);
+  }
+
+  header = store_header_new ();
+  if (length < STORE_HEADER_SIZE ||
+      memcmp (data, g_bytes_get_data (header, NULL), STORE_HEADER_SIZE) != 0) {
+    if (length > 0) {
+      GRL_WARNING ("Discarding metadata store '%s': unknown format or version",
+                   filename);
+    }
+    g_clear_pointer (&map, g_mapped_file_unref);
+    if (!g_file_replace_contents (store->file,
+                                  g_bytes_get_data (header, NULL),
+                                  STORE_HEADER_SIZE,
+                                  NULL, FALSE, G_FILE_CREATE_NONE,
+                                  NULL, NULL, error)) {
+      g_bytes_unref (header);
+      grl_metadata_store_close (store);
+      return NULL;
+    }
+    valid = STORE_HEADER_SIZE;
+    length = STORE_HEADER_SIZE;
+  } else {
+    valid = store_scan (store, data, length);
+  }
+  g_bytes_unref (header);
+  g_clear_pointer (&map, g_mapped_file_unref);
+
+  store->written = valid;
+  store->length = valid;
+  if (!store_reopen_stream (store, error)) {
+    grl_metadata_store_close (store);
+    return NULL;
+  }
+
+  if (valid < length) {
+    GRL_WARNING ("Discarding %" G_GSIZE_FORMAT " bytes of incomplete records "
+                 "in metadata store '%s'", length - valid, filename);
+    if (!g_seekable_truncate (G_SEEKABLE (store->stream), valid, NULL, error)) {
+      grl_metadata_store_close (store);
+      return NULL;
+    }
+  }
+
+  GRL_DEBUG ("opened metadata store '%s' with %u entries",
+             filename, g_hash_table_size (store->index));
+
+  store_maybe_compact (store);
+
+  return store;
+}
+
+/*
+ * grl_metadata_store_close:
+ * @store: a store
+ *
+ * Flushes, closes and frees @store.
+ */
+void
+grl_metadata_store_close (GrlMetadataStore *store)
+{
+  GError *error = NULL;
+
+  if (!grl_metadata_store_flush (store, &error)) {
+    GRL_WARNING ("Unable to flush metadata store: %s", error->message);
+    g_error_free (error);
+  }
+
+  g_clear_pointer (&store->map, g_mapped_file_unref);
+  g_clear_object (&store->stream);
+  g_object_unref (store->file);
+  g_hash_table_unref (store->index);
+  g_byte_array_unref (store->pending);
+#ifdef G_OS_UNIX
+  if (store->lock_fd >= 0) {
+    close (store->lock_fd);
+  }
+#endif
+  g_slice_free (GrlMetadataStore, store);
+}
+
+/*
+ * grl_metadata_store_append:
+ * @store: a store
+ * @media_source: source of the media
+ * @media_id: identifier of the media
+ * @key: the key
+ * @provider: (allow-none): source that resolved @key
+ * @values: (element-type GrlRelatedKeys): the values of @key
+ * @expires: real time when the values expire, or 0
+ *
+ * Saves the values of @key for a media, replacing the previous ones. They are
+ * written to the file by the next grl_metadata_store_flush().
+ *
+ * Returns: %TRUE if they were saved
+ */
+gboolean
+grl_metadata_store_append (GrlMetadataStore *store,
+                           const gchar *media_source,
+                           const gchar *media_id,
+                           GrlKeyID key,
+                           const gchar *provider,
+                           GList *values,
+                           gint64 expires)
+{
+  GByteArray *payload;
+  StoreRecord *record;
+  GList *v;
+  GList *keys;
+  GList *k;
+  gboolean ret;
+
+  payload = g_byte_array_new ();
+  put_u8 (payload, RECORD_ENTRY);
+  put_i64 (payload, expires);
+  put_str (payload, media_source);
+  put_str (payload, media_id);
+  put_str (payload, GRL_METADATA_KEY_GET_NAME (key));
+  put_str (payload, provider);
+
+  put_u32 (payload, g_list_length (values));
+  for (v = values; v; v = g_list_next (v)) {
+    GByteArray *relkeys_buffer = g_byte_array_new ();
+    guint n_values = 0;
+
+    keys = grl_related_keys_get_keys (v->data);
+    for (k = keys; k; k = g_list_next (k)) {
+      GrlKeyID related_key = GRLPOINTER_TO_KEYID (k->data);
+      guint before = relkeys_buffer->len;
+
+      put_str (relkeys_buffer, GRL_METADATA_KEY_GET_NAME (related_key));
+      if (put_value (relkeys_buffer,
+                     grl_related_keys_get (v->data, related_key))) {
+        n_values++;
+      } else {
+        g_byte_array_set_size (relkeys_buffer, before);
+      }
+    }
+    g_list_free (keys);
+
+    put_u32 (payload, n_values);
+    g_byte_array_append (payload, relkeys_buffer->data, relkeys_buffer->len);
+    g_byte_array_unref (relkeys_buffer);
+  }
+
+  record = g_slice_new0 (StoreRecord);
+  record->skey.media_source = g_strdup (media_source);
+  record->skey.media_id = g_strdup (media_id);
+  record->skey.key = g_strdup (GRL_METADATA_KEY_GET_NAME (key));
+  record->provider = g_strdup (provider);
+  record->expires = expires;
+
+  ret = store_append_record (store, payload, record);
+  g_byte_array_unref (payload);
+
+  return ret;
+}
+
+/*
+ * grl_metadata_store_lookup:
+ * @store: a store
+ * @media_source: source of the media
+ * @media_id: identifier of the media
+ * @key: the key
+ * @provider: (out) (allow-none): source that resolved @key
+ * @expires: (out) (allow-none): real time when the values expire, or 0
+ *
+ * Reads the saved values of @key for a media. Values of keys that are not
+ * registered are skipped.
+ *
+ * Returns: (element-type GrlRelatedKeys) (transfer full): the values, or %NULL
+ */
+GList *
+grl_metadata_store_lookup (GrlMetadataStore *store,
+                           const gchar *media_source,
+                           const gchar *media_id,
+                           GrlKeyID key,
+                           gchar **provider,
+                           gint64 *expires)
+{
+  StoreKey skey;
+  StoreRecord *record;
+  StoreRecord *parsed;
+  GrlRegistry *registry;
+  const guint8 *data;
+  Reader reader;
+  GList *values = NULL;
+  guint n_relkeys;
+  guint i;
+
+  skey.media_source = (gchar *) media_source;
+  skey.media_id = (gchar *) media_id;
+  skey.key = (gchar *) GRL_METADATA_KEY_GET_NAME (key);
+  if (!skey.key) {
+    return NULL;
+  }
+
+  record = g_hash_table_lookup (store->index, &skey);
+  if (!record) {
+    return NULL;
+  }
+
+  data = store_record_data (store, record);
+  if (!data) {
+    return NULL;
+  }
+
+  reader.data = data + RECORD_HEADER_SIZE;
+  reader.length = record->length - RECORD_HEADER_SIZE;
+  reader.pos = 0;
+  reader.error = FALSE;
+
+  /* Skip the part already in the index */
+  get_u8 (&reader);
+  parsed = parse_entry (&reader);
+  if (!parsed) {
+    return NULL;
+  }
+  store_record_free (parsed);
+
+  registry = grl_registry_get_default ();
+  n_relkeys = get_u32 (&reader);
+  for (i = 0; i < n_relkeys && !reader.error; i++) {
+    GrlRelatedKeys *relkeys = grl_related_keys_new ();
+    guint n_values = get_u32 (&reader);
+    guint j;
+
+    for (j = 0; j < n_values && !reader.error; j++) {
+      GValue value = G_VALUE_INIT;
+      gchar *name = get_str (&reader);
+      GrlKeyID related_key = name?
+        grl_registry_lookup_metadata_key (registry, name):
+        GRL_METADATA_KEY_INVALID;
+
+      if (get_value (&reader, &value)) {
+        if (related_key != GRL_METADATA_KEY_INVALID) {
+          grl_related_keys_set (relkeys, related_key, &value);
+        }
+        g_value_unset (&value);
+      }
+      g_free (name);
+    }
+
+    if (grl_related_keys_has_key (relkeys, key)) {
+      values = g_list_prepend (values, relkeys);
+    } else {
+      g_object_unref (relkeys);
+    }
+  }
+
+  if (reader.error) {
+    GRL_WARNING ("Corrupted entry in metadata store");
+    g_list_free_full (values, g_object_unref);
+    return NULL;
+  }
+
+  if (provider) {
+    *provider = g_strdup (record->provider);
+  }
+  if (expires) {
+    *expires = record->expires;
+  }
+
+  return g_list_reverse (values);
+}
+
+/*
+ * grl_metadata_store_invalidate_source:
+ * @store: a store
+ * @source_id: identifier of a source
+ *
+ * Drops the entries of the media belonging to @source_id, and the ones that
+ * were resolved by it.
+ */
+void
+grl_metadata_store_invalidate_source (GrlMetadataStore *store,
+                                      const gchar *source_id)
+{
+  GByteArray *payload;
+
+  if (index_invalidate_source (store, source_id) == 0) {
+    return;
+  }
+
+  /* Record it, so entries are not restored when opening the store again */
+  payload = g_byte_array_new ();
+  put_u8 (payload, RECORD_INVALIDATE);
+  put_str (payload, source_id);
+  store_append_record (store, payload, NULL);
+  g_byte_array_unref (payload);
+}
+
+/*
+ * grl_metadata_store_flush:
+ * @store: a store
+ * @error: a #GError, or @NULL
+ *
+ * Writes the records appended since the last flush to the file, in one go,
+ * and compacts it if dead records take most of it. On error, those records
+ * are dropped.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+grl_metadata_store_flush (GrlMetadataStore *store,
+                          GError **error)
+{
+  GOutputStream *output;
+  GHashTableIter iter;
+  StoreRecord *record;
+  gboolean ret;
+
+  if (store->pending->len == 0) {
+    return TRUE;
+  }
+
+  output = g_io_stream_get_output_stream (G_IO_STREAM (store->stream));
+  ret = g_output_stream_write_all (output,
+                                   store->pending->data, store->pending->len,
+                                   NULL, NULL, error) &&
+    g_output_stream_flush (output, NULL, error);
+
+  if (ret) {
+    store->written = store->length;
+  } else {
+    /* Do not leave half a record behind */
+    g_seekable_truncate (G_SEEKABLE (store->stream), store->written,
+                         NULL, NULL);
+    g_seekable_seek (G_SEEKABLE (store->stream), store->written,
+                     G_SEEK_SET, NULL, NULL);
+    g_hash_table_iter_init (&iter, store->index);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &record)) {
+      if (record->offset >= store->written) {
+        store->live -= record->length;
+        g_hash_table_iter_remove (&iter);
+      }
+    }
+    store->length = store->written;
+  }
+
+  g_byte_array_set_size (store->pending, 0);
+
+  if (ret) {
+    store_maybe_compact (store);
+  }
+
+  return ret;
+}
+
+/*
+ * grl_metadata_store_clear:
+ * @store: a store
+ *
+ * Drops all the entries from @store.
+ */
+void
+grl_metadata_store_clear (GrlMetadataStore *store)
+{
+  GError *error = NULL;
+
+  g_hash_table_remove_all (store->index);
+  store->live = 0;
+
+  if (!grl_metadata_store_compact (store, &error)) {
+    GRL_WARNING ("Unable to clear metadata store: %s", error->message);
+    g_error_free (error);
+  }
+}
+
+/*
+ * grl_metadata_store_compact:
+ * @store: a store
+ * @error: a #GError, or @NULL
+ *
+ * Rewrites @store keeping only the live entries, which also flushes it.
+ * Expired entries are dropped. The new file replaces the old one atomically,
+ * so a crash while compacting leaves the old one untouched.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+grl_metadata_store_compact (GrlMetadataStore *store,
+                            GError **error)
+{
+  GByteArray *buffer;
+  GBytes *header;
+  GHashTableIter iter;
+  StoreRecord *record;
+  GArray *offsets;
+  gint64 now;
+  gboolean ret;
+  guint i;
+
+  header = store_header_new ();
+  buffer = g_byte_array_sized_new (STORE_HEADER_SIZE + store->live);
+  g_byte_array_append (buffer, g_bytes_get_data (header, NULL),
+                       STORE_HEADER_SIZE);
+  g_bytes_unref (header);
+
+  now = g_get_real_time ();
+  offsets = g_array_sized_new (FALSE, FALSE, sizeof (goffset),
+                               g_hash_table_size (store->index));
+  g_hash_table_iter_init (&iter, store->index);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &record)) {
+    goffset offset = buffer->len;
+    const guint8 *data;
+
+    if (record->expires > 0 && record->expires <= now) {
+      continue;
+    }
+
+    data = store_record_data (store, record);
+    if (!data) {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   "Unable to map metadata store");
+      g_array_unref (offsets);
+      g_byte_array_unref (buffer);
+      return FALSE;
+    }
+
+    g_array_append_val (offsets, offset);
+    g_byte_array_append (buffer, data, record->length);
+  }
+
+  ret = g_file_replace_contents (store->file,
+                                 (const gchar *) buffer->data, buffer->len,
+                                 NULL, FALSE, G_FILE_CREATE_NONE,
+                                 NULL, NULL, error);
+
+  if (ret) {
+    GRL_DEBUG ("compacted metadata store from %" G_GOFFSET_FORMAT
+               " to %u bytes", store->length, buffer->len);
+
+    i = 0;
+    store->live = 0;
+    g_hash_table_iter_init (&iter, store->index);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &record)) {
+      if (record->expires > 0 && record->expires <= now) {
+        g_hash_table_iter_remove (&iter);
+        continue;
+      }
+      record->offset = g_array_index (offsets, goffset, i++);
+      store->live += record->length;
+    }
+    g_byte_array_set_size (store->pending, 0);
+    store->written = buffer->len;
+    store->length = buffer->len;
+    ret = store_reopen_stream (store, error);
+  }
+
+  g_array_unref (offsets);
+  g_byte_array_unref (buffer);
+
+  return ret;
+}
@@ -22,7 +22,7 @@
 
 /**
  * SECTION:grl-multiple
- * @short_description: Search in multiple loaded sources
+ * @short_description: Search, browse and query in multiple loaded sources
  * @see_also: #GrlPlugin, #GrlSource
  *
  * These helper functions are due to ease the search in multiple sources.
@@ -31,6 +31,10 @@
  *
  * Also you can set %NULL that sources list, so the function will use all
  * the available sources with the search capability.
+ *
+ * Browsing equivalent containers and running the same query in several
+ * sources work the same way, with grl_multiple_browse() and
+ * grl_multiple_query().
  */
 
 #include "grl-multiple.h"
@@ -51,32 +55,66 @@
 #define GRL_LOG_DOMAIN_DEFAULT  multiple_log_domain
 GRL_LOG_DOMAIN(multiple_log_domain);
 
+/* State of a search, browse or query spanning several sources. The operation
+   holds a reference, and so does every request running in a source, as it
+   calls back even after the operation was cancelled */
 struct MultipleSearchData {
+  gint ref_count;
+  GrlSupportedOps operation_type;
   GHashTable *table;
   guint remaining;
-  GList *search_ids;
   GList *sources;
   GList *keys;
   guint search_id;
   gboolean cancelled;
+  gboolean cancel_confirmed;
+  gboolean finished;
   guint pending;
-  guint sources_done;
-  guint sources_count;
+  guint running;
   GList *sources_more;
   gchar *text;
   GrlOperationOptions *options;
+  gint64 started;
+  guint source_timeout;
+  gboolean continuous_refill;
+  GrlMergeOrder merge_order;
+  GrlKeyID merge_key;
+  GrlKeyID dedup_key;
+  struct DedupFilter *dedup;
   GrlSourceResultCb user_callback;
   gpointer user_data;
 };
 
 struct ResultCount {
+  struct MultipleSearchData *msd;
+  GrlSource *source;
+  GrlMedia *container;
+  gboolean timed_out;
   guint count;
   guint remaining;
   guint received;
   guint skip;
+  guint operation_id;
+  guint total;
+  gint64 first_result;
+  gint rank;
+  GQueue queued;
+};
+
+/* A result waiting for its turn to be relayed */
+struct QueuedResult {
+  GrlMedia *media;
+  guint position;
+};
+
+/* Bloom filter remembering the identity of the relayed results */
+struct DedupFilter {
+  guint32 *bits;
+  guint n_bits;
 };
 
 struct CallbackData {
+  GrlSupportedOps operation_type;
   GrlSourceResultCb user_callback;
   gpointer user_data;
 };
@@ -100,14 +138,97 @@ static void multiple_search_cb (GrlSource *source,
 
 static void multiple_search_cancel_cb (struct MultipleSearchData *msd);
 
+static void multiple_source_done (struct MultipleSearchData *msd,
+                                  struct ResultCount *rc);
+
 /* ================ Utitilies ================ */
 
+#define DEDUP_BITS_PER_ITEM       10
+#define DEDUP_HASHES              7
+#define DEDUP_DEFAULT_CAPACITY    4096
+
+static struct DedupFilter *
+dedup_filter_new (guint capacity)
+{
+  struct DedupFilter *filter = g_slice_new (struct DedupFilter);
+
+  /* About 1% of false positives when holding @capacity items */
+  filter->n_bits = MAX (capacity, 64) * DEDUP_BITS_PER_ITEM;
+  filter->bits = g_new0 (guint32, (filter->n_bits + 31) / 32);
+
+  return filter;
+}
+
+static void
+dedup_filter_free (struct DedupFilter *filter)
+{
+  g_free (filter->bits);
+  g_slice_free (struct DedupFilter, filter);
+}
+
+/* Adds @value to @filter, returning %TRUE if it was (probably) there */
+static gboolean
+dedup_filter_check_and_add (struct DedupFilter *filter,
+                            const gchar *value)
+{
+  guint32 h1, h2;
+  const gchar *p;
+  gboolean seen = TRUE;
+  guint i;
+
+  /* Double hashing: djb2 from GLib and FNV-1a */
+  h1 = g_str_hash (value);
+  h2 = 2166136261u;
+  for (p = value; *p; p++) {
+    h2 = (h2 ^ (guchar) *p) * 16777619u;
+  }
+  h2 |= 1;
+
+  for (i = 0; i < DEDUP_HASHES; i++) {
+    guint bit = (h1 + i * h2) % filter->n_bits;
+    guint32 mask = 1u << (bit % 32);
+
+    if (!(filter->bits[bit / 32] & mask)) {
+      filter->bits[bit / 32] |= mask;
+      seen = FALSE;
+    }
+  }
+
+  return seen;
+}
+
 static void
-free_multiple_search_data (struct MultipleSearchData *msd)
+queued_result_free (struct QueuedResult *qr)
 {
+  g_clear_object (&qr->media);
+  g_slice_free (struct QueuedResult, qr);
+}
+
+static void
+free_result_count (struct ResultCount *rc)
+{
+  g_clear_object (&rc->container);
+  g_queue_foreach (&rc->queued, (GFunc) queued_result_free, NULL);
+  g_queue_clear (&rc->queued);
+  g_free (rc);
+}
+
+static struct MultipleSearchData *
+multiple_search_data_ref (struct MultipleSearchData *msd)
+{
+  msd->ref_count++;
+  return msd;
+}
+
+static void
+multiple_search_data_unref (struct MultipleSearchData *msd)
+{
+  if (--msd->ref_count > 0)
+    return;
+
   GRL_DEBUG ("free_multiple_search_data");
   g_hash_table_unref (msd->table);
-  g_list_free (msd->search_ids);
+  g_clear_pointer (&msd->dedup, dedup_filter_free);
   g_list_free (msd->sources);
   g_list_free (msd->sources_more);
   g_list_free (msd->keys);
@@ -121,17 +242,37 @@ confirm_cancel_idle (gpointer user_data)
 {
   struct MultipleSearchData *msd = (struct MultipleSearchData *) user_data;
   msd->user_callback (NULL, msd->search_id, NULL, 0, msd->user_data, NULL);
+  msd->cancel_confirmed = TRUE;
+
+  /* Otherwise the last source to finish removes it */
+  if (msd->running == 0) {
+    grl_operation_remove (msd->search_id);
+  }
+
   return FALSE;
 }
 
 static gboolean
-handle_no_searchable_sources_idle (gpointer user_data)
+handle_no_sources_idle (gpointer user_data)
 {
   GError *error;
   struct CallbackData *callback_data = (struct CallbackData *) user_data;
 
-  error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_SEARCH_FAILED,
-                       _("No searchable sources available"));
+  switch (callback_data->operation_type) {
+  case GRL_OP_BROWSE:
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_BROWSE_FAILED,
+                         _("No browsable sources available"));
+    break;
+  case GRL_OP_QUERY:
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_QUERY_FAILED,
+                         _("No queryable sources available"));
+    break;
+  default:
+    error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_SEARCH_FAILED,
+                         _("No searchable sources available"));
+    break;
+  }
+
   callback_data->user_callback (NULL, 0, NULL, 0, callback_data->user_data, error);
 
   g_error_free (error);
@@ -141,22 +282,185 @@ handle_no_searchable_sources_idle (gpointer user_data)
 }
 
 static void
-handle_no_searchable_sources (GrlSourceResultCb callback, gpointer user_data)
+handle_no_sources (GrlSupportedOps operation_type,
+                   GrlSourceResultCb callback,
+                   gpointer user_data)
 {
   struct CallbackData *callback_data = g_new0 (struct CallbackData, 1);
-  guint id;
+  callback_data->operation_type = operation_type;
   callback_data->user_callback = callback;
   callback_data->user_data = user_data;
-  id = g_idle_add (handle_no_searchable_sources_idle, callback_data);
-  g_source_set_name_by_id (id, "[grilo] handle_no_searchable_sources_idle");
+  grl_operation_idle_add (0,
+                          G_PRIORITY_DEFAULT_IDLE,
+                          handle_no_sources_idle,
+                          callback_data,
+                          NULL,
+                          "[grilo] handle_no_sources_idle");
+}
+
+/* Asks @source for @count more results, starting where the previous
+   request to that source stopped */
+static void
+start_source_operation (struct MultipleSearchData *msd,
+                        GrlSource *source,
+                        struct ResultCount *rc,
+                        gint count)
+{
+  GrlOperationOptions *source_options = NULL;
+  GrlCaps *source_caps;
+  guint deadline;
+
+  rc->skip += rc->received;
+  rc->count = count;
+  rc->received = 0;
+  rc->remaining = 0;
+
+  source_caps = grl_source_get_caps (source, msd->operation_type);
+  grl_operation_options_obey_caps (msd->options, source_caps,
+                                   &source_options, NULL);
+  grl_operation_options_set_skip (source_options, rc->skip);
+  grl_operation_options_set_count (source_options, rc->count);
+
+  /* The source timeout is the deadline of each request, so a source that
+     does not finish in time completes with what it sent so far */
+  deadline = grl_operation_options_get_deadline (source_options);
+  if (msd->source_timeout > 0 &&
+      (deadline == 0 || msd->source_timeout < deadline)) {
+    grl_operation_options_set_deadline (source_options, msd->source_timeout);
+  }
+
+  msd->running++;
+  switch (msd->operation_type) {
+  case GRL_OP_BROWSE:
+    rc->operation_id = grl_source_browse (source,
+                                          rc->container,
+                                          msd->keys,
+                                          source_options,
+                                          multiple_search_cb,
+                                          msd);
+    break;
+  case GRL_OP_QUERY:
+    rc->operation_id = grl_source_query (source,
+                                         msd->text,
+                                         msd->keys,
+                                         source_options,
+                                         multiple_search_cb,
+                                         msd);
+    break;
+  default:
+    rc->operation_id = grl_source_search (source,
+                                          msd->text,
+                                          msd->keys,
+                                          source_options,
+                                          multiple_search_cb,
+                                          msd);
+    break;
+  }
+
+  if (rc->operation_id == 0) {
+    GRL_WARNING ("Could not start operation in %s",
+                 grl_source_get_name (source));
+    msd->running--;
+    /* Its share goes to the other sources */
+    if (count != GRL_COUNT_INFINITY)
+      msd->pending += count;
+  } else {
+    GRL_DEBUG ("Operation %s:%u: Requesting %u items from offset %u",
+               grl_source_get_name (source),
+               rc->operation_id, rc->count, rc->skip);
+
+    /* Released when the source sends its last result */
+    multiple_search_data_ref (msd);
+  }
+
+  g_object_unref (source_options);
+}
+
+/* Hands the results that could not be provided by some sources over to the
+   sources that are known to have more, as soon as they become idle */
+static void
+refill_multiple_search (struct MultipleSearchData *msd)
+{
+  GList *sources_more, *iter;
+  guint n, individual_count, first_count;
+
+  if (msd->cancelled || msd->finished ||
+      msd->pending == 0 || !msd->sources_more) {
+    return;
+  }
+
+  sources_more = msd->sources_more;
+  msd->sources_more = NULL;
+
+  n = g_list_length (sources_more);
+  individual_count = msd->pending / n;
+  first_count = individual_count + msd->pending % n;
+  msd->pending = 0;
+
+  GRL_DEBUG ("Requesting %u more items from %u sources",
+             first_count + individual_count * (n - 1), n);
+
+  for (iter = sources_more; iter; iter = g_list_next (iter)) {
+    GrlSource *source = GRL_SOURCE (iter->data);
+    struct ResultCount *rc;
+    guint c;
+
+    c = (iter == sources_more) ? first_count : individual_count;
+    rc = g_hash_table_lookup (msd->table, source);
+
+    if (c != 0) {
+      start_source_operation (msd, source, rc, c);
+    } else {
+      msd->sources_more = g_list_append (msd->sources_more, source);
+    }
+  }
+
+  g_list_free (sources_more);
+}
+
+/* Finishes an operation that none of its sources could start */
+static gboolean
+start_failed_idle (gpointer user_data)
+{
+  struct MultipleSearchData *msd = (struct MultipleSearchData *) user_data;
+  GrlCoreError code;
+  GError *error;
+
+  /* Cancelling it already told the user */
+  if (msd->cancelled) {
+    return G_SOURCE_REMOVE;
+  }
+
+  switch (msd->operation_type) {
+  case GRL_OP_BROWSE:
+    code = GRL_CORE_ERROR_BROWSE_FAILED;
+    break;
+  case GRL_OP_QUERY:
+    code = GRL_CORE_ERROR_QUERY_FAILED;
+    break;
+  default:
+    code = GRL_CORE_ERROR_SEARCH_FAILED;
+    break;
+  }
+
+  error = g_error_new (GRL_CORE_ERROR, code,
+                       _("Operation could not be started"));
+  msd->finished = TRUE;
+  msd->user_callback (NULL, msd->search_id, NULL, 0, msd->user_data, error);
+  g_error_free (error);
+
+  grl_operation_remove (msd->search_id);
+
+  return G_SOURCE_REMOVE;
 }
 
 static struct MultipleSearchData *
 start_multiple_search_operation (guint search_id,
+				 GrlSupportedOps operation_type,
 				 const GList *sources,
+				 const GList *containers,
 				 const gchar *text,
 				 const GList *keys,
-				 const GList *skip_counts,
 				 gint count,
 				 GrlOperationOptions *options,
 				 GrlSourceResultCb user_callback,
@@ -165,23 +469,40 @@ start_multiple_search_operation (guint search_id,
   GRL_DEBUG ("start_multiple_search_operation");
 
   struct MultipleSearchData *msd;
-  GList *iter_sources, *iter_skips;
+  GList *iter_sources, *iter_containers;
   guint n;
   gint first_count, individual_count;
 
   /* Prepare data required to execute the operation */
   msd = g_new0 (struct MultipleSearchData, 1);
+  msd->ref_count = 1;
+  msd->operation_type = operation_type;
   msd->table = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-				      NULL, g_free);
-  msd->remaining =
-      (count == GRL_COUNT_INFINITY) ? GRL_COUNT_INFINITY : (count - 1);
+				      NULL, (GDestroyNotify) free_result_count);
+  msd->remaining = (guint) count;
   msd->search_id = search_id;
   msd->text = g_strdup (text);
   msd->keys = g_list_copy ((GList *) keys);
   msd->options = g_object_ref (options);
+  msd->started = g_get_monotonic_time ();
+  msd->source_timeout = grl_operation_options_get_source_timeout (options);
+  msd->continuous_refill =
+    grl_operation_options_get_continuous_refill (options);
+  msd->merge_order = grl_operation_options_get_merge_order (options,
+                                                            &msd->merge_key);
+  msd->dedup_key = grl_operation_options_get_dedup_key (options);
+  if (msd->dedup_key != GRL_METADATA_KEY_INVALID) {
+    msd->dedup = dedup_filter_new (count == GRL_COUNT_INFINITY ?
+                                   DEDUP_DEFAULT_CAPACITY : (guint) count);
+  }
   msd->user_callback = user_callback;
   msd->user_data = user_data;
 
+  grl_operation_set_private_data (msd->search_id,
+                                  msd,
+                                  (GrlOperationCancelCb) multiple_search_cancel_cb,
+                                  (GDestroyNotify) multiple_search_data_unref);
+
   /* Compute the # of items to request by each source */
   n = g_list_length ((GList *) sources);
   if (count == GRL_COUNT_INFINITY) {
@@ -192,15 +513,15 @@ start_multiple_search_operation (guint search_id,
     first_count = individual_count + count % n;
   }
 
-  /* Issue search operations on each source */
-  iter_sources = (GList *) sources;
-  iter_skips = (GList *) skip_counts;
+  /* Issue operations on each source */
   n = 0;
-  while (iter_sources) {
+  iter_containers = (GList *) containers;
+  for (iter_sources = (GList *) sources;
+       iter_sources;
+       iter_sources = g_list_next (iter_sources)) {
     GrlSource *source;
-    guint c, id;
     struct ResultCount *rc;
-    guint skip;
+    guint c;
 
     source = GRL_SOURCE (iter_sources->data);
 
@@ -208,100 +529,201 @@ start_multiple_search_operation (guint search_id,
     c = (n == 0) ? first_count : individual_count;
     n++;
 
-    /* Only interested in sources with c != 0 */
-    if (c != 0) {
-      GrlOperationOptions *source_options = NULL;
-      GrlCaps *source_caps;
-
-      /* We use ResultCount to keep track of results emitted by this source */
-      rc = g_new0 (struct ResultCount, 1);
-      rc->count = c;
-      g_hash_table_insert (msd->table, source, rc);
-
-      /* Check if we have to apply a "skip" parameter to this source
-	 (useful when we are chaining queries to complete the result count) */
-      if (iter_skips) {
-	skip = GPOINTER_TO_INT (iter_skips->data);
-      } else {
-	skip = 0;
-      }
-
-      source_caps = grl_source_get_caps (source, GRL_OP_SEARCH);
-      grl_operation_options_obey_caps (options, source_caps, &source_options, NULL);
-      grl_operation_options_set_skip (source_options, skip);
-      grl_operation_options_set_count (source_options, rc->count);
-
-      /* Execute the search on this source */
-      id = grl_source_search (source,
-				    msd->text,
-				    msd->keys,
-				    source_options,
-				    multiple_search_cb,
-				    msd);
-
-      GRL_DEBUG ("Operation %s:%u: Searching %u items from offset %u",
-                 grl_source_get_name (GRL_SOURCE (source)),
-                 id, rc->count, skip);
-
-      g_object_unref (source_options);
-
-      /* Keep track of this operation and this source */
-      msd->search_ids = g_list_prepend (msd->search_ids, GINT_TO_POINTER (id));
-      msd->sources = g_list_prepend (msd->sources, source);
-      msd->sources_count++;
+    /* We use ResultCount to keep track of results emitted by this source */
+    rc = g_new0 (struct ResultCount, 1);
+    rc->msd = msd;
+    rc->source = source;
+    rc->rank = grl_source_get_rank (source);
+    if (iter_containers) {
+      if (iter_containers->data)
+        rc->container = g_object_ref (iter_containers->data);
+      iter_containers = g_list_next (iter_containers);
     }
+    g_queue_init (&rc->queued);
+    g_hash_table_insert (msd->table, source, rc);
+    msd->sources = g_list_append (msd->sources, source);
 
-    /* Move to the next source */
-    iter_sources = g_list_next (iter_sources);
-    iter_skips = g_list_next (iter_skips);
+    if (c != 0) {
+      start_source_operation (msd, source, rc, c);
+    } else if (msd->continuous_refill) {
+      /* Nothing to ask yet, but it can make up for other sources later */
+      msd->sources_more = g_list_append (msd->sources_more, source);
+    }
   }
 
-  /* This frees the previous msd structure (if this operation is chained) */
-  grl_operation_set_private_data (msd->search_id,
-                                  msd,
-                                  (GrlOperationCancelCb) multiple_search_cancel_cb,
-                                  (GDestroyNotify) free_multiple_search_data);
+  /* No source will ever answer */
+  if (msd->running == 0) {
+    grl_operation_idle_add (msd->search_id,
+                            G_PRIORITY_DEFAULT_IDLE,
+                            start_failed_idle,
+                            multiple_search_data_ref (msd),
+                            (GDestroyNotify) multiple_search_data_unref,
+                            "[grilo] start_failed_idle");
+  }
 
   return msd;
 }
 
-static struct MultipleSearchData *
-chain_multiple_search_operation (struct MultipleSearchData *old_msd)
+/* Compares the values of @key in @a and @b; media lacking it go last */
+static gint
+compare_key_values (GrlMedia *a,
+                    GrlMedia *b,
+                    GrlKeyID key)
 {
-  GList *skip_list = NULL;
-  GList *source_iter;
-  struct ResultCount *rc;
-  GrlSource *source;
-  struct MultipleSearchData *msd;
+  const GValue *va, *vb;
+  GType type;
+
+  va = grl_data_get (GRL_DATA (a), key);
+  vb = grl_data_get (GRL_DATA (b), key);
+
+  if (!va || !vb)
+    return (va == NULL) - (vb == NULL);
+
+  type = G_VALUE_TYPE (va);
+  if (type != G_VALUE_TYPE (vb))
+    return 0;
+
+  if (type == G_TYPE_STRING) {
+    return g_utf8_collate (g_value_get_string (va) ? g_value_get_string (va) : "",
+                           g_value_get_string (vb) ? g_value_get_string (vb) : "");
+  } else if (type == G_TYPE_INT) {
+    return (g_value_get_int (va) > g_value_get_int (vb)) -
+      (g_value_get_int (va) < g_value_get_int (vb));
+  } else if (type == G_TYPE_INT64) {
+    return (g_value_get_int64 (va) > g_value_get_int64 (vb)) -
+      (g_value_get_int64 (va) < g_value_get_int64 (vb));
+  } else if (type == G_TYPE_FLOAT) {
+    return (g_value_get_float (va) > g_value_get_float (vb)) -
+      (g_value_get_float (va) < g_value_get_float (vb));
+  } else if (type == G_TYPE_DOUBLE) {
+    return (g_value_get_double (va) > g_value_get_double (vb)) -
+      (g_value_get_double (va) < g_value_get_double (vb));
+  } else if (type == G_TYPE_BOOLEAN) {
+    return g_value_get_boolean (va) - g_value_get_boolean (vb);
+  } else if (type == G_TYPE_DATE_TIME) {
+    return g_date_time_compare (g_value_get_boxed (va),
+                                g_value_get_boxed (vb));
+  }
 
-  /* Compute skip parameter for each of the sources that can still
-     provide more results */
-  source_iter = old_msd->sources_more;
-  while (source_iter) {
-    source = GRL_SOURCE (source_iter->data);
-    rc = (struct ResultCount *)
-      g_hash_table_lookup (old_msd->table, (gpointer) source);
-    skip_list = g_list_prepend (skip_list,
-				GINT_TO_POINTER (rc->count + rc->skip));
-    source_iter = g_list_next (source_iter);
-  }
-
-  /* Reverse the sources list so that they match the skip list */
-  old_msd->sources_more = g_list_reverse (old_msd->sources_more);
-
-  /* Continue the search process with the same search_id */
-  msd = start_multiple_search_operation (old_msd->search_id,
-					 old_msd->sources_more,
-					 old_msd->text,
-					 old_msd->keys,
-					 skip_list,
-					 old_msd->pending,
-					 old_msd->options,
-					 old_msd->user_callback,
-					 old_msd->user_data);
-  g_list_free (skip_list);
+  return 0;
+}
 
-  return msd;
+/* Returns a negative value if @a must be relayed before @b */
+static gint
+compare_queued_results (struct MultipleSearchData *msd,
+                        struct QueuedResult *a,
+                        struct ResultCount *rc_a,
+                        struct QueuedResult *b,
+                        struct ResultCount *rc_b)
+{
+  gint result = 0;
+
+  if (msd->merge_order == GRL_MERGE_ASCENDING ||
+      msd->merge_order == GRL_MERGE_DESCENDING) {
+    gboolean has_a = grl_data_has_key (GRL_DATA (a->media), msd->merge_key);
+    gboolean has_b = grl_data_has_key (GRL_DATA (b->media), msd->merge_key);
+
+    result = compare_key_values (a->media, b->media, msd->merge_key);
+    if (msd->merge_order == GRL_MERGE_DESCENDING && has_a && has_b)
+      result = -result;
+  }
+
+  /* Then by position in their source, then by source rank */
+  if (result == 0)
+    result = (a->position > b->position) - (a->position < b->position);
+  if (result == 0)
+    result = (rc_a->rank < rc_b->rank) - (rc_a->rank > rc_b->rank);
+
+  return result;
+}
+
+/* Returns %TRUE if @media is the same as a result already relayed */
+static gboolean
+is_duplicated_result (struct MultipleSearchData *msd,
+                      GrlMedia *media)
+{
+  const GValue *value;
+  gchar *identity;
+  gboolean duplicated;
+
+  if (!msd->dedup)
+    return FALSE;
+
+  value = grl_data_get (GRL_DATA (media), msd->dedup_key);
+  if (!value)
+    return FALSE;
+
+  if (G_VALUE_HOLDS_STRING (value)) {
+    if (!g_value_get_string (value))
+      return FALSE;
+    return dedup_filter_check_and_add (msd->dedup, g_value_get_string (value));
+  }
+
+  identity = g_strdup_value_contents (value);
+  duplicated = dedup_filter_check_and_add (msd->dedup, identity);
+  g_free (identity);
+
+  return duplicated;
+}
+
+/* Relays every queued result whose turn has come. With a merge order, the
+   next result can only be chosen once all the running sources have one to
+   compare with. */
+static void
+flush_multiple_search (struct MultipleSearchData *msd)
+{
+  while (!msd->finished && !msd->cancelled) {
+    struct QueuedResult *next = NULL;
+    struct ResultCount *next_rc = NULL;
+    GrlSource *next_source = NULL;
+    GList *iter;
+
+    for (iter = msd->sources; iter; iter = g_list_next (iter)) {
+      struct ResultCount *rc = g_hash_table_lookup (msd->table, iter->data);
+      struct QueuedResult *qr = g_queue_peek_head (&rc->queued);
+
+      if (!qr) {
+        if (msd->merge_order != GRL_MERGE_ARRIVAL && rc->operation_id != 0) {
+          /* Wait until this source says something */
+          return;
+        }
+        continue;
+      }
+
+      if (!next ||
+          compare_queued_results (msd, qr, rc, next, next_rc) < 0) {
+        next = qr;
+        next_rc = rc;
+        next_source = iter->data;
+      }
+    }
+
+    if (!next)
+      return;
+
+    g_queue_pop_head (&next_rc->queued);
+
+    if (is_duplicated_result (msd, next->media)) {
+      GRL_DEBUG ("Dropping duplicated result from %s",
+                 grl_source_get_name (next_source));
+      /* Ask somebody else for a replacement */
+      if (msd->remaining != GRL_COUNT_INFINITY)
+        msd->pending++;
+    } else {
+      if (msd->remaining != GRL_COUNT_INFINITY) {
+        msd->remaining--;
+      }
+      msd->finished = (msd->remaining == 0);
+      msd->user_callback (next_source,
+                          msd->search_id,
+                          g_steal_pointer (&next->media),
+                          msd->remaining,
+                          msd->user_data,
+                          NULL);
+    }
+
+    queued_result_free (next);
+  }
 }
 
 static void
@@ -323,7 +745,7 @@ multiple_result_async_cb (GrlSource *source,
     g_list_free_full (ds->data, g_object_unref);
 
     ds->data = NULL;
-    ds->complete = TRUE;
+    grl_data_sync_complete (ds);
     return;
   }
 
@@ -333,10 +755,78 @@ multiple_result_async_cb (GrlSource *source,
 
   if (remaining == 0) {
     ds->data = g_list_reverse (ds->data);
-    ds->complete = TRUE;
+    grl_data_sync_complete (ds);
   }
 }
 
+/* Called once @rc will not provide more results for its last request */
+static void
+multiple_source_done (struct MultipleSearchData *msd,
+                      struct ResultCount *rc)
+{
+  GrlSource *source = rc->source;
+  gint64 now;
+
+  msd->running--;
+  rc->operation_id = 0;
+
+  /* Its results no longer need to wait for it */
+  flush_multiple_search (msd);
+
+  now = g_get_monotonic_time ();
+  GRL_DEBUG ("%s: %u results, first after %.1f ms, done after %.1f ms",
+             grl_source_get_name (source),
+             rc->total,
+             rc->total > 0 ? (rc->first_result - msd->started) / 1000.0 : 0.0,
+             (now - msd->started) / 1000.0);
+
+  if (rc->count != GRL_COUNT_INFINITY &&
+      (rc->received < rc->count || rc->timed_out)) {
+    /* This source failed to provide as many results as we requested,
+       reassign the missing ones to the sources that still have more */
+    msd->pending += rc->count - rc->received;
+  } else if (rc->count != GRL_COUNT_INFINITY) {
+    /* This source provided all requested results, if others did not
+       we can use this to request more */
+    msd->sources_more = g_list_append (msd->sources_more, source);
+    GRL_DEBUG ("Source %s provided all requested results",
+               grl_source_get_name (GRL_SOURCE (source)));
+  }
+
+  /* --- Manage pending results --- */
+
+  /* By default, a new round starts once every source of the previous one
+     has finished */
+  if (msd->continuous_refill || msd->running == 0) {
+    refill_multiple_search (msd);
+  }
+
+  if (msd->running > 0) {
+    /* Other sources are still working */
+    return;
+  }
+
+  if (!msd->cancelled && !msd->finished) {
+    /* We don't have sources capable of providing more results,
+       finish operation now */
+    msd->finished = TRUE;
+    msd->user_callback (source,
+                        msd->search_id,
+                        NULL,
+                        0,
+                        msd->user_data,
+                        NULL);
+  }
+
+  /* A cancelled operation is removed once the user was told */
+  if (msd->cancelled && !msd->cancel_confirmed) {
+    return;
+  }
+
+  GRL_DEBUG ("Multiple operation finished (%u)", msd->search_id);
+  grl_operation_remove (msd->search_id);
+}
+
 static void
 multiple_search_cb (GrlSource *source,
 		    guint search_id,
@@ -348,119 +838,58 @@ multiple_search_cb (GrlSource *source,
   GRL_DEBUG (__FUNCTION__);
 
   struct MultipleSearchData *msd;
-  gboolean emit;
-  gboolean operation_done = FALSE;
   struct ResultCount *rc;
 
   msd = (struct MultipleSearchData *) user_data;
+  rc = (struct ResultCount *)
+    g_hash_table_lookup (msd->table, (gpointer) source);
 
   GRL_DEBUG ("multiple:remaining == %u, source:remaining = %u (%s)",
              msd->remaining, remaining,
              grl_source_get_name (GRL_SOURCE (source)));
 
-  /* Check if operation is done, that is, if all the sources involved
-     in the multiple operation have emitted remaining=0 */
-  if (remaining == 0) {
-    msd->sources_done++;
-    if (msd->sources_done == msd->sources_count) {
-      operation_done = TRUE;
-      GRL_DEBUG ("multiple operation chunk done");
-    }
+  if (error) {
+    GRL_DEBUG ("Operation in %s failed: %s",
+               grl_source_get_name (source), error->message);
   }
 
-  /* --- Cancellation management --- */
-
-  if (msd->cancelled) {
-    GRL_DEBUG ("operation is cancelled or already finished, skipping result!");
-    g_clear_object (&media);
-    if (operation_done) {
-      /* This was the last result and the operation is cancelled
-	 so we don't have anything else to do*/
-      goto operation_done;
-    }
-    /* The operation is cancelled but the sources involved
-       in the operation still have to complete the cancellation,
-       that is, they still have not send remaining=0 */
-    return;
+  /* Its deadline expired, so it is not asked for more */
+  if (g_error_matches (error, GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_OPERATION_TIMED_OUT)) {
+    rc->timed_out = TRUE;
   }
 
-  /* --- Update remaining count --- */
-
-  rc = (struct ResultCount *)
-    g_hash_table_lookup (msd->table, (gpointer) source);
+  /* --- Result emission --- */
 
   if (media) {
+    if (rc->total == 0) {
+      rc->first_result = g_get_monotonic_time ();
+    }
     rc->received++;
-  }
-
-  rc->remaining = remaining;
+    rc->total++;
 
-  if (rc->remaining == 0 && rc->received != rc->count) {
-    /* This source failed to provide as many results as we requested,
-       we will have to check if other sources can provide the missing
-       results */
-    if (rc->count != GRL_COUNT_INFINITY)
-      msd->pending += rc->count - rc->received;
-  } else if (remaining == 0) {
-    /* This source provided all requested results, if others did not
-       we can use this to request more */
-    msd->sources_more = g_list_prepend (msd->sources_more, source);
-    GRL_DEBUG ("Source %s provided all requested results",
-               grl_source_get_name (GRL_SOURCE (source)));
-  }
-
-  /* --- Manage NULL results --- */
-
-  if (remaining == 0 && media == NULL && msd->remaining > 0) {
-    /* A source emitted a NULL result to finish its search operation
-       we don't want to relay this to the client (unless this is the
-       last one in the multiple search) */
-    GRL_DEBUG ("Skipping NULL result");
-    emit = FALSE;
-  } else {
-    emit = TRUE;
-  }
-
-  /* --- Result emission --- */
+    if (msd->cancelled || msd->finished) {
+      GRL_DEBUG ("operation is cancelled or already finished, skipping result!");
+      g_object_unref (media);
+    } else {
+      struct QueuedResult *qr = g_slice_new (struct QueuedResult);
 
-  if (emit) {
-    msd->user_callback (source,
-  		        msd->search_id,
- 		        media,
-		        msd->remaining--,
-		        msd->user_data,
-		        NULL);
+      qr->media = media;
+      qr->position = rc->total;
+      g_queue_push_tail (&rc->queued, qr);
+    }
   }
 
-  /* --- Manage pending results --- */
+  rc->remaining = remaining;
 
-  if (operation_done && msd->pending > 0 && msd->sources_more) {
-    /* We did not get all the requested results and have sources
-       that can still provide more */
-    GRL_DEBUG ("Requesting next chunk");
-    chain_multiple_search_operation (msd);
-    return;
-  } else if (operation_done && msd->pending > 0) {
-    /* We don't have sources capable of providing more results,
-       finish operation now */
-    msd->user_callback (source,
-			msd->search_id,
-			NULL,
-			0,
-			msd->user_data,
-			NULL);
-    goto operation_done;
-  } else if (operation_done) {
-    /* We provided all the results */
-    goto operation_done;
-  } else {
-    /* We are still receiving results */
+  if (remaining > 0) {
+    /* We are still receiving results from this source */
+    flush_multiple_search (msd);
     return;
   }
 
- operation_done:
-  GRL_DEBUG ("Multiple operation finished (%u)", msd->search_id);
-  grl_operation_remove (msd->search_id);
+  multiple_source_done (msd, rc);
+  multiple_search_data_unref (msd);
 }
 
 static void
@@ -520,6 +949,52 @@ media_from_uri_cb (GrlSource *source,
   }
 }
 
+static guint
+multiple_operation_start (GrlSupportedOps operation_type,
+                          const GList *sources,
+                          const GList *containers,
+                          const gchar *text,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GrlSourceResultCb callback,
+                          gpointer user_data)
+{
+  GrlRegistry *registry;
+  GList *sources_list = NULL;
+  struct MultipleSearchData *msd;
+
+  /* If no sources have been provided then get the list of all
+     capable sources from the registry */
+  if (!sources) {
+    registry = grl_registry_get_default ();
+    sources_list =
+      grl_registry_get_sources_by_operations (registry,
+                                              operation_type,
+                                              TRUE);
+    if (sources_list == NULL) {
+      /* No capable sources? Raise error and bail out */
+      handle_no_sources (operation_type, callback, user_data);
+      return 0;
+    }
+    sources = sources_list;
+  }
+
+  /* Start multiple operation */
+  msd = start_multiple_search_operation (grl_operation_generate_id (),
+                                         operation_type,
+                                         sources,
+                                         containers,
+                                         text,
+                                         keys,
+                                         grl_operation_options_get_count (options),
+                                         options,
+                                         callback,
+                                         user_data);
+  g_list_free (sources_list);
+
+  return msd->search_id;
+}
+
 /* ================ API ================ */
 
 /**
@@ -539,6 +1014,13 @@ media_from_uri_cb (GrlSource *source,
  * If @text is @NULL then NULL-text searchs will be used for each searchable
  * plugin (see #grl_source_search for more details).
  *
+ * The requested count is split among the sources, and results are relayed as
+ * soon as any source provides them. When a source runs out of results before
+ * providing its share, the missing results are requested to the sources that
+ * delivered all they were asked for, once every source has finished. See
+ * grl_operation_options_set_continuous_refill() to request them without
+ * waiting for the slower sources.
+ *
  * This method is asynchronous.
  *
  * Returns: the operation identifier
@@ -553,78 +1035,193 @@ grl_multiple_search (const GList *sources,
 		     GrlSourceResultCb callback,
 		     gpointer user_data)
 {
-  GrlRegistry *registry;
-  GList *sources_list;
-  struct MultipleSearchData *msd;
-  gboolean allocated_sources_list = FALSE;
-  guint operation_id;
-
   GRL_DEBUG ("grl_multiple_search");
 
   g_return_val_if_fail (callback != NULL, 0);
   g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
 
-  /* If no sources have been provided then get the list of all
-     searchable sources from the registry */
-  if (!sources) {
-    registry = grl_registry_get_default ();
-    sources_list =
-      grl_registry_get_sources_by_operations (registry,
-                                              GRL_OP_SEARCH,
-                                              TRUE);
-    if (sources_list == NULL) {
-      /* No searchable sources? Raise error and bail out */
-      g_list_free (sources_list);
-      handle_no_searchable_sources (callback, user_data);
-      return 0;
-    } else {
-      sources = sources_list;
-      allocated_sources_list = TRUE;
-    }
-  }
+  return multiple_operation_start (GRL_OP_SEARCH, sources, NULL, text,
+                                   keys, options, callback, user_data);
+}
 
-  /* Start multiple search operation */
-  operation_id = grl_operation_generate_id ();
-  msd = start_multiple_search_operation (operation_id,
-					 sources,
-					 text,
-					 keys,
-					 NULL,
-					 grl_operation_options_get_count (options),
-					 options,
-					 callback,
-					 user_data);
-  if  (allocated_sources_list) {
-    g_list_free ((GList *) sources);
-  }
+/**
+ * grl_multiple_browse:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to browse (%NULL for the root of all
+ * browsable sources)
+ * @containers: (element-type GrlMedia) (allow-none): the containers to browse,
+ * in the same order as @sources; %NULL elements, or a %NULL list, stand for
+ * the root of the corresponding source
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass to the user callback
+ *
+ * Browse equivalent containers in several sources at once, as if they were a
+ * single one.
+ *
+ * Results are distributed, merged and refilled as in grl_multiple_search().
+ * See also grl_operation_options_set_source_timeout() to stop waiting for
+ * unresponsive sources.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_multiple_browse (const GList *sources,
+                     const GList *containers,
+                     const GList *keys,
+                     GrlOperationOptions *options,
+                     GrlSourceResultCb callback,
+                     gpointer user_data)
+{
+  GRL_DEBUG ("grl_multiple_browse");
 
-  return msd->search_id;
+  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (sources != NULL || containers == NULL, 0);
+
+  return multiple_operation_start (GRL_OP_BROWSE, sources, containers, NULL,
+                                   keys, options, callback, user_data);
+}
+
+/**
+ * grl_multiple_query:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to query (%NULL for all sources with query
+ * capability)
+ * @query: the query to run in each source
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass to the user callback
+ *
+ * Run @query in all the sources specified in @sources. As queries are
+ * source-specific, the sources are expected to understand the same query
+ * language.
+ *
+ * Results are distributed, merged and refilled as in grl_multiple_search().
+ * See also grl_operation_options_set_source_timeout() to stop waiting for
+ * unresponsive sources.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_multiple_query (const GList *sources,
+                    const gchar *query,
+                    const GList *keys,
+                    GrlOperationOptions *options,
+                    GrlSourceResultCb callback,
+                    gpointer user_data)
+{
+  GRL_DEBUG ("grl_multiple_query");
+
+  g_return_val_if_fail (query != NULL, 0);
+  g_return_val_if_fail (callback != NULL, 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+
+  return multiple_operation_start (GRL_OP_QUERY, sources, NULL, query,
+                                   keys, options, callback, user_data);
 }
 
 static void
 multiple_search_cancel_cb (struct MultipleSearchData *msd)
 {
-  GList *sources, *ids;
-  guint id;
+  GHashTableIter iter;
+  GrlSource *source;
+  struct ResultCount *rc;
+
+  msd->cancelled = TRUE;
 
   /* Go through all the sources involved in that operation and issue
-     cancel() operations for each one */
-  sources = msd->sources;
-  ids = msd->search_ids;
-  while (sources) {
+     cancel() operations for each one still running */
+  g_hash_table_iter_init (&iter, msd->table);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &source, (gpointer *) &rc)) {
+    if (rc->operation_id == 0)
+      continue;
+
     GRL_DEBUG ("cancelling operation %s:%u",
-               grl_source_get_name (GRL_SOURCE (sources->data)),
-               GPOINTER_TO_UINT (ids->data));
-    grl_operation_cancel (GPOINTER_TO_INT (ids->data));
-    sources = g_list_next (sources);
-    ids = g_list_next (ids);
+               grl_source_get_name (source), rc->operation_id);
+    grl_operation_cancel (rc->operation_id);
   }
 
-  msd->cancelled = TRUE;
+  /* The user already got the last result */
+  if (msd->finished) {
+    msd->cancel_confirmed = TRUE;
+    return;
+  }
 
   /* Send operation finished message now to client (remaining == 0) */
-  id = g_idle_add (confirm_cancel_idle, msd);
-  g_source_set_name_by_id (id, "[grilo] confirm_cancel_idle");
+  grl_operation_idle_add (msd->search_id,
+                          G_PRIORITY_DEFAULT_IDLE,
+                          confirm_cancel_idle,
+                          multiple_search_data_ref (msd),
+                          (GDestroyNotify) multiple_search_data_unref,
+                          "[grilo] confirm_cancel_idle");
+}
+
+struct MultipleSyncCall {
+  GrlSupportedOps operation_type;
+  const GList *sources;
+  const GList *containers;
+  const gchar *text;
+  const GList *keys;
+  GrlOperationOptions *options;
+  GrlDataSync *ds;
+};
+
+static gboolean
+multiple_sync_start (gpointer user_data)
+{
+  struct MultipleSyncCall *call = (struct MultipleSyncCall *) user_data;
+
+  return multiple_operation_start (call->operation_type,
+                                   call->sources,
+                                   call->containers,
+                                   call->text,
+                                   call->keys,
+                                   call->options,
+                                   multiple_result_async_cb,
+                                   call->ds) > 0;
+}
+
+static GList *
+multiple_sync_run (struct MultipleSyncCall *call,
+                   GError **error)
+{
+  GrlDataSync *ds;
+  GList *result;
+
+  ds = grl_data_sync_new ();
+
+  call->ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (call->options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     multiple_sync_start,
+                     call);
+
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
+
+  result = (GList *) ds->data;
+  grl_data_sync_free (ds);
+
+  return result;
 }
 
 /**
@@ -642,6 +1239,10 @@ multiple_search_cancel_cb (struct MultipleSearchData *msd)
  *
  * This method is synchronous.
  *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
  * Returns: (element-type GrlMedia) (transfer full): a list with #GrlMedia elements
  *
  * Since: 0.2.0
@@ -653,31 +1254,105 @@ grl_multiple_search_sync (const GList *sources,
                           GrlOperationOptions *options,
                           GError **error)
 {
-  GrlDataSync *ds;
-  GList *result;
+  struct MultipleSyncCall call = { 0, };
 
-  ds = g_slice_new0 (GrlDataSync);
+  call.operation_type = GRL_OP_SEARCH;
+  call.sources = sources;
+  call.text = text;
+  call.keys = keys;
+  call.options = options;
 
-  if (grl_multiple_search (sources,
-                           text,
-                           keys,
-                           options,
-                           multiple_result_async_cb,
-                           ds))
-    grl_wait_for_async_operation_complete (ds);
+  return multiple_sync_run (&call, error);
+}
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
-  }
+/**
+ * grl_multiple_browse_sync:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to browse (%NULL for the root of all
+ * browsable sources)
+ * @containers: (element-type GrlMedia) (allow-none): the containers to browse,
+ * in the same order as @sources; %NULL elements, or a %NULL list, stand for
+ * the root of the corresponding source
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
+ *
+ * Browse equivalent containers in several sources at once.
+ *
+ * This method is synchronous.
+ *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a list with #GrlMedia elements
+ *
+ * Since: 0.3.13
+ */
+GList *
+grl_multiple_browse_sync (const GList *sources,
+                          const GList *containers,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GError **error)
+{
+  struct MultipleSyncCall call = { 0, };
 
-  result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+  g_return_val_if_fail (sources != NULL || containers == NULL, NULL);
 
-  return result;
+  call.operation_type = GRL_OP_BROWSE;
+  call.sources = sources;
+  call.containers = containers;
+  call.keys = keys;
+  call.options = options;
+
+  return multiple_sync_run (&call, error);
+}
+
+/**
+ * grl_multiple_query_sync:
+ * @sources: (element-type GrlSource) (allow-none):
+ * a #GList of #GrlSource<!-- -->s to query (%NULL for all sources with query
+ * capability)
+ * @query: the query to run in each source
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID to retrieve
+ * @options: options wanted for that operation
+ * @error: a #GError, or @NULL
+ *
+ * Run @query in all the sources specified in @sources.
+ *
+ * This method is synchronous.
+ *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a list with #GrlMedia elements
+ *
+ * Since: 0.3.13
+ */
+GList *
+grl_multiple_query_sync (const GList *sources,
+                         const gchar *query,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GError **error)
+{
+  struct MultipleSyncCall call = { 0, };
+
+  g_return_val_if_fail (query != NULL, NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+
+  call.operation_type = GRL_OP_QUERY;
+  call.sources = sources;
+  call.text = query;
+  call.keys = keys;
+  call.options = options;
+
+  return multiple_sync_run (&call, error);
 }
 
 /**
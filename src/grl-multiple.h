@@ -47,6 +47,32 @@ GList *grl_multiple_search_sync (const GList *sources,
                                  GrlOperationOptions *options,
                                  GError **error);
 
+guint grl_multiple_browse (const GList *sources,
+                           const GList *containers,
+                           const GList *keys,
+                           GrlOperationOptions *options,
+                           GrlSourceResultCb callback,
+                           gpointer user_data);
+
+GList *grl_multiple_browse_sync (const GList *sources,
+                                 const GList *containers,
+                                 const GList *keys,
+                                 GrlOperationOptions *options,
+                                 GError **error);
+
+guint grl_multiple_query (const GList *sources,
+                          const gchar *query,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GrlSourceResultCb callback,
+                          gpointer user_data);
+
+GList *grl_multiple_query_sync (const GList *sources,
+                                const gchar *query,
+                                const GList *keys,
+                                GrlOperationOptions *options,
+                                GError **error);
+
 void grl_multiple_get_media_from_uri (const gchar *uri,
 				      const GList *keys,
 				      GrlOperationOptions *options,
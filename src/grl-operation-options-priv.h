@@ -37,6 +37,14 @@
 #define GRL_OPERATION_OPTION_TYPE_FILTER "type-filter"
 #define GRL_OPERATION_OPTION_KEY_EQUAL_FILTER "key-equal-filter"
 #define GRL_OPERATION_OPTION_KEY_RANGE_FILTER "key-range-filter"
+#define GRL_OPERATION_OPTION_BATCH_SIZE "batch-size"
+#define GRL_OPERATION_OPTION_BATCH_LATENCY "batch-latency"
+#define GRL_OPERATION_OPTION_MERGE_ORDER "merge-order"
+#define GRL_OPERATION_OPTION_MERGE_KEY "merge-key"
+#define GRL_OPERATION_OPTION_DEDUP_KEY "dedup-key"
+#define GRL_OPERATION_OPTION_CONTINUOUS_REFILL "continuous-refill"
+#define GRL_OPERATION_OPTION_SOURCE_TIMEOUT "source-timeout"
+#define GRL_OPERATION_OPTION_DEADLINE "deadline"
 
 gboolean grl_operation_options_key_is_set (GrlOperationOptions *options,
                                            const gchar *key);
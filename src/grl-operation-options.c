@@ -50,6 +50,12 @@ G_DEFINE_TYPE_WITH_PRIVATE (GrlOperationOptions, grl_operation_options, G_TYPE_O
 #define COUNT_DEFAULT GRL_COUNT_INFINITY;
 #define RESOLUTION_FLAGS_DEFAULT GRL_RESOLVE_NORMAL;
 #define TYPE_FILTER_DEFAULT GRL_TYPE_FILTER_ALL;
+#define BATCH_SIZE_DEFAULT 0;
+#define BATCH_LATENCY_DEFAULT 0;
+#define MERGE_ORDER_DEFAULT GRL_MERGE_ARRIVAL;
+#define CONTINUOUS_REFILL_DEFAULT FALSE;
+#define SOURCE_TIMEOUT_DEFAULT 0;
+#define DEADLINE_DEFAULT 0;
 
 static void
 grl_operation_options_dispose (GrlOperationOptions *self)
@@ -208,6 +214,9 @@ grl_operation_options_obey_caps (GrlOperationOptions *options,
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_SKIP);
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_COUNT);
     copy_option (options, *supported_options, GRL_OPERATION_OPTION_RESOLUTION_FLAGS);
+    copy_option (options, *supported_options, GRL_OPERATION_OPTION_BATCH_SIZE);
+    copy_option (options, *supported_options, GRL_OPERATION_OPTION_BATCH_LATENCY);
+    copy_option (options, *supported_options, GRL_OPERATION_OPTION_DEADLINE);
   }
 
   if (unsupported_options)
@@ -280,6 +289,14 @@ grl_operation_options_copy (GrlOperationOptions *options)
   copy_option (options, copy, GRL_OPERATION_OPTION_COUNT);
   copy_option (options, copy, GRL_OPERATION_OPTION_RESOLUTION_FLAGS);
   copy_option (options, copy, GRL_OPERATION_OPTION_TYPE_FILTER);
+  copy_option (options, copy, GRL_OPERATION_OPTION_BATCH_SIZE);
+  copy_option (options, copy, GRL_OPERATION_OPTION_BATCH_LATENCY);
+  copy_option (options, copy, GRL_OPERATION_OPTION_MERGE_ORDER);
+  copy_option (options, copy, GRL_OPERATION_OPTION_MERGE_KEY);
+  copy_option (options, copy, GRL_OPERATION_OPTION_DEDUP_KEY);
+  copy_option (options, copy, GRL_OPERATION_OPTION_CONTINUOUS_REFILL);
+  copy_option (options, copy, GRL_OPERATION_OPTION_SOURCE_TIMEOUT);
+  copy_option (options, copy, GRL_OPERATION_OPTION_DEADLINE);
 
   g_hash_table_foreach (options->priv->key_filter,
                         (GHFunc) key_filter_dup,
@@ -465,6 +482,382 @@ grl_operation_options_get_resolution_flags (GrlOperationOptions *options)
   return RESOLUTION_FLAGS_DEFAULT;
 }
 
+/**
+ * grl_operation_options_set_batch_size:
+ * @options: a #GrlOperationOptions instance
+ * @batch_size: maximum number of elements to deliver at once, or 0 for no
+ * limit
+ *
+ * Set the maximum number of elements handed to the user in a single batch by
+ * grl_source_browse_batched(), grl_source_search_batched() and
+ * grl_source_query_batched().
+ *
+ * It also allows operations relaying their results through the idle loop to
+ * send up to @batch_size ready elements in each main loop iteration.
+ *
+ * Returns: %TRUE if @batch_size could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_batch_size (GrlOperationOptions *options,
+                                      guint batch_size)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, batch_size);
+  set_value (options, GRL_OPERATION_OPTION_BATCH_SIZE, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_batch_size:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the maximum number of elements in a batch, or 0 if there is no
+ * limit.
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_operation_options_get_batch_size (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data, GRL_OPERATION_OPTION_BATCH_SIZE);
+
+  if (value)
+    return g_value_get_uint (value);
+
+  return BATCH_SIZE_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_batch_latency:
+ * @options: a #GrlOperationOptions instance
+ * @latency: maximum time in milliseconds an element waits for its batch to
+ * be delivered, or 0 to wait until the batch is full
+ *
+ * Set the maximum time a batch is held before being handed to the user by
+ * grl_source_browse_batched(), grl_source_search_batched() and
+ * grl_source_query_batched(), counting from the reception of its first
+ * element.
+ *
+ * Returns: %TRUE if @latency could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_batch_latency (GrlOperationOptions *options,
+                                         guint latency)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, latency);
+  set_value (options, GRL_OPERATION_OPTION_BATCH_LATENCY, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_batch_latency:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the maximum batch latency in milliseconds, or 0 if there is none.
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_operation_options_get_batch_latency (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data, GRL_OPERATION_OPTION_BATCH_LATENCY);
+
+  if (value)
+    return g_value_get_uint (value);
+
+  return BATCH_LATENCY_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_merge_order:
+ * @options: a #GrlOperationOptions instance
+ * @order: how to order results coming from several sources
+ * @key: the key to sort by with %GRL_MERGE_ASCENDING and
+ * %GRL_MERGE_DESCENDING, ignored otherwise
+ *
+ * Set how grl_multiple_search() merges the results of the different sources.
+ *
+ * Each source is expected to return its results already sorted in @order.
+ * Results are still relayed incrementally: one is held only until every source
+ * still running has provided a result to compare it with. Media lacking @key
+ * go after the ones having it.
+ *
+ * Returns: %TRUE if @order could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_merge_order (GrlOperationOptions *options,
+                                       GrlMergeOrder order,
+                                       GrlKeyID key)
+{
+  GValue value = { 0, };
+
+  if ((order == GRL_MERGE_ASCENDING || order == GRL_MERGE_DESCENDING) &&
+      key == GRL_METADATA_KEY_INVALID) {
+    return FALSE;
+  }
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, order);
+  set_value (options, GRL_OPERATION_OPTION_MERGE_ORDER, &value);
+  g_value_set_uint (&value, key);
+  set_value (options, GRL_OPERATION_OPTION_MERGE_KEY, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_merge_order:
+ * @options: a #GrlOperationOptions instance
+ * @key: (out) (allow-none): the key results are sorted by
+ *
+ * Returns: how results coming from several sources are ordered.
+ *
+ * Since: 0.3.13
+ */
+GrlMergeOrder
+grl_operation_options_get_merge_order (GrlOperationOptions *options,
+                                       GrlKeyID *key)
+{
+  const GValue *value;
+
+  if (key) {
+    value = g_hash_table_lookup (options->priv->data,
+                                 GRL_OPERATION_OPTION_MERGE_KEY);
+    *key = value? g_value_get_uint (value): GRL_METADATA_KEY_INVALID;
+  }
+
+  value = g_hash_table_lookup (options->priv->data,
+                               GRL_OPERATION_OPTION_MERGE_ORDER);
+  if (value)
+    return g_value_get_uint (value);
+
+  return MERGE_ORDER_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_dedup_key:
+ * @options: a #GrlOperationOptions instance
+ * @key: the key identifying a media, such as %GRL_METADATA_KEY_URL, or
+ * %GRL_METADATA_KEY_INVALID to keep duplicates
+ *
+ * Make grl_multiple_search() drop results whose @key has the same value as a
+ * result already relayed, for instance the same media found in several
+ * sources.
+ *
+ * Seen values are remembered in a fixed-size Bloom filter sized after the
+ * requested count, so memory use stays bounded but a small fraction of
+ * distinct results may be taken for duplicates.
+ *
+ * Returns: %TRUE if @key could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_dedup_key (GrlOperationOptions *options,
+                                     GrlKeyID key)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, key);
+  set_value (options, GRL_OPERATION_OPTION_DEDUP_KEY, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_dedup_key:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the key used to drop duplicated results, or
+ * %GRL_METADATA_KEY_INVALID if they are kept.
+ *
+ * Since: 0.3.13
+ */
+GrlKeyID
+grl_operation_options_get_dedup_key (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data, GRL_OPERATION_OPTION_DEDUP_KEY);
+
+  if (value)
+    return g_value_get_uint (value);
+
+  return GRL_METADATA_KEY_INVALID;
+}
+
+/**
+ * grl_operation_options_set_continuous_refill:
+ * @options: a #GrlOperationOptions instance
+ * @continuous: whether missing results are asked for as soon as possible
+ *
+ * When a source of grl_multiple_search(), grl_multiple_browse() or
+ * grl_multiple_query() provides less results than its share, the missing
+ * ones are asked to the sources that provided all theirs. By default this
+ * happens in rounds, once every source of the previous round has finished. If
+ * @continuous is %TRUE, they are asked for as soon as a source finishes, so
+ * slow sources do not delay the others.
+ *
+ * Returns: %TRUE if @continuous could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_continuous_refill (GrlOperationOptions *options,
+                                             gboolean continuous)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&value, continuous);
+  set_value (options, GRL_OPERATION_OPTION_CONTINUOUS_REFILL, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_continuous_refill:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: whether missing results are asked for as soon as a source
+ * finishes, instead of in rounds.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_get_continuous_refill (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data,
+                           GRL_OPERATION_OPTION_CONTINUOUS_REFILL);
+
+  if (value)
+    return g_value_get_boolean (value);
+
+  return CONTINUOUS_REFILL_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_source_timeout:
+ * @options: a #GrlOperationOptions instance
+ * @timeout: time in milliseconds, or 0 to wait forever
+ *
+ * Set how long grl_multiple_search(), grl_multiple_browse() and
+ * grl_multiple_query() wait for each source to complete a request. Sources
+ * taking longer are cancelled and their share of results is asked to the
+ * other sources, so an unresponsive source does not stall the operation.
+ *
+ * Returns: %TRUE if @timeout could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_source_timeout (GrlOperationOptions *options,
+                                          guint timeout)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, timeout);
+  set_value (options, GRL_OPERATION_OPTION_SOURCE_TIMEOUT, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_source_timeout:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the time in milliseconds given to each source, or 0 if there is no
+ * limit.
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_operation_options_get_source_timeout (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data, GRL_OPERATION_OPTION_SOURCE_TIMEOUT);
+
+  if (value)
+    return g_value_get_uint (value);
+
+  return SOURCE_TIMEOUT_DEFAULT;
+}
+
+/**
+ * grl_operation_options_set_deadline:
+ * @options: a #GrlOperationOptions instance
+ * @deadline: time in milliseconds, or 0 to wait forever
+ *
+ * Set how long a source is given to complete an operation. When the time is
+ * over, the source is cancelled and the operation completes with the results
+ * received so far, plus a %GRL_CORE_ERROR_OPERATION_TIMED_OUT error.
+ *
+ * With %GRL_RESOLVE_FULL, each of the sources asked for additional keys is
+ * given the same time; a source that does not make it is skipped, and the
+ * next one able to resolve its keys is asked instead.
+ *
+ * Returns: %TRUE if @deadline could be set, %FALSE otherwise.
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_operation_options_set_deadline (GrlOperationOptions *options,
+                                    guint deadline)
+{
+  GValue value = { 0, };
+
+  g_value_init (&value, G_TYPE_UINT);
+  g_value_set_uint (&value, deadline);
+  set_value (options, GRL_OPERATION_OPTION_DEADLINE, &value);
+  g_value_unset (&value);
+
+  return TRUE;
+}
+
+/**
+ * grl_operation_options_get_deadline:
+ * @options: a #GrlOperationOptions instance
+ *
+ * Returns: the time in milliseconds given to a source to complete the
+ * operation, or 0 if there is no limit.
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_operation_options_get_deadline (GrlOperationOptions *options)
+{
+  const GValue *value =
+      g_hash_table_lookup (options->priv->data, GRL_OPERATION_OPTION_DEADLINE);
+
+  if (value)
+    return g_value_get_uint (value);
+
+  return DEADLINE_DEFAULT;
+}
+
 /**
  * grl_operation_options_set_type_filter:
  * @options: a #GrlOperationOptions instance
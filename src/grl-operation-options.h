@@ -71,6 +71,12 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrlOperationOptions, g_object_unref)
  * @GRL_RESOLVE_FULL: Try other plugins if necessary.
  * @GRL_RESOLVE_IDLE_RELAY: Use idle loop to relay results.
  * @GRL_RESOLVE_FAST_ONLY: Only resolve fast metadata keys.
+ * @GRL_RESOLVE_PRIVATE_CONTEXT: Run synchronous operations in a private main
+ * context, that is the only one iterated while waiting for them. Only use it
+ * with sources that complete through the context of the operation, like
+ * grl_operation_idle_add() does: a source relying on the global default
+ * context, through g_idle_add(), g_timeout_add() or a #SoupSession attached
+ * to it, is never dispatched, and the call blocks forever. Since: 0.3.13
  *
  * Resolution flags
  */
@@ -78,7 +84,8 @@ typedef enum {
   GRL_RESOLVE_NORMAL     = 0,        /* Normal mode */
   GRL_RESOLVE_FULL       = (1 << 0), /* Try other plugins if necessary */
   GRL_RESOLVE_IDLE_RELAY = (1 << 1), /* Use idle loop to relay results */
-  GRL_RESOLVE_FAST_ONLY  = (1 << 2)  /* Only resolve fast metadata keys */
+  GRL_RESOLVE_FAST_ONLY  = (1 << 2), /* Only resolve fast metadata keys */
+  GRL_RESOLVE_PRIVATE_CONTEXT = (1 << 3) /* Run sync operations in a private context */
 } GrlResolutionFlags;
 
 /**
@@ -93,6 +100,27 @@ typedef enum {
   GRL_WRITE_FULL       = (1 << 0)  /* Try other plugins if necessary */
 } GrlWriteFlags;
 
+/**
+ * GrlMergeOrder:
+ * @GRL_MERGE_ARRIVAL: Results are relayed as soon as they arrive.
+ * @GRL_MERGE_RANK: Results are interleaved by their position in each source,
+ * results from sources with a higher rank going first.
+ * @GRL_MERGE_ASCENDING: Results are sorted by increasing value of the merge
+ * key.
+ * @GRL_MERGE_DESCENDING: Results are sorted by decreasing value of the merge
+ * key.
+ *
+ * How results coming from several sources are ordered.
+ *
+ * Since: 0.3.13
+ */
+typedef enum {
+  GRL_MERGE_ARRIVAL,
+  GRL_MERGE_RANK,
+  GRL_MERGE_ASCENDING,
+  GRL_MERGE_DESCENDING
+} GrlMergeOrder;
+
 #define GRL_COUNT_INFINITY (-1)
 
 GType grl_operation_options_get_type (void);
@@ -117,6 +145,36 @@ gboolean grl_operation_options_set_resolution_flags (GrlOperationOptions *option
 GrlResolutionFlags
     grl_operation_options_get_resolution_flags (GrlOperationOptions *options);
 
+gboolean grl_operation_options_set_batch_size (GrlOperationOptions *options,
+                                               guint batch_size);
+guint grl_operation_options_get_batch_size (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_batch_latency (GrlOperationOptions *options,
+                                                  guint latency);
+guint grl_operation_options_get_batch_latency (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_merge_order (GrlOperationOptions *options,
+                                                GrlMergeOrder order,
+                                                GrlKeyID key);
+GrlMergeOrder grl_operation_options_get_merge_order (GrlOperationOptions *options,
+                                                     GrlKeyID *key);
+
+gboolean grl_operation_options_set_dedup_key (GrlOperationOptions *options,
+                                              GrlKeyID key);
+GrlKeyID grl_operation_options_get_dedup_key (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_continuous_refill (GrlOperationOptions *options,
+                                                      gboolean continuous);
+gboolean grl_operation_options_get_continuous_refill (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_source_timeout (GrlOperationOptions *options,
+                                                   guint timeout);
+guint grl_operation_options_get_source_timeout (GrlOperationOptions *options);
+
+gboolean grl_operation_options_set_deadline (GrlOperationOptions *options,
+                                             guint deadline);
+guint grl_operation_options_get_deadline (GrlOperationOptions *options);
+
 gboolean grl_operation_options_set_type_filter (GrlOperationOptions *options,
                                                 GrlTypeFilter filter);
 
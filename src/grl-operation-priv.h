@@ -40,4 +40,19 @@ gpointer grl_operation_get_private_data (guint operation_id);
 
 void grl_operation_remove (guint operation_id);
 
+GMainContext *grl_operation_get_context (guint operation_id);
+
+GSource *grl_operation_idle_add (guint          operation_id,
+                                 gint           priority,
+                                 GSourceFunc    function,
+                                 gpointer       data,
+                                 GDestroyNotify notify,
+                                 const gchar   *name);
+
+GSource *grl_operation_timeout_add (guint       operation_id,
+                                    guint       interval,
+                                    GSourceFunc function,
+                                    gpointer    data,
+                                    const gchar *name);
+
 #endif /* _GRL_OPERATION_PRIV_H_ */
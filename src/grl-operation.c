@@ -24,6 +24,10 @@
 #include "grl-operation-priv.h"
 #include "grl-log.h"
 
+/* Operations are spread across several tables, each one with its own lock, so
+   threads working on different operations do not contend */
+#define N_SHARDS 16
+
 typedef struct
 {
   GrlOperationCancelCb cancel_cb;
@@ -31,10 +35,23 @@ typedef struct
   gpointer             private_data;
   gpointer             user_data;
   GDestroyNotify       user_data_destroy_func;
+  GMainContext        *context;
 } OperationData;
 
-static guint       operations_id;
-static GHashTable *operations;
+typedef struct
+{
+  GMutex      lock;
+  GHashTable *operations;
+} OperationShard;
+
+static gint           operations_id = 1;
+static OperationShard shards[N_SHARDS];
+
+static inline OperationShard *
+get_shard (guint operation_id)
+{
+  return &shards[operation_id % N_SHARDS];
+}
 
 static void
 operation_data_free (OperationData *data)
@@ -48,31 +65,71 @@ operation_data_free (OperationData *data)
     data->destroy_cb (data->private_data);
   }
 
+  g_main_context_unref (data->context);
   g_slice_free (OperationData, data);
 }
 
+/* Must be called with the lock of the shard held */
+static OperationData *
+shard_lookup (OperationShard *shard,
+              guint operation_id)
+{
+  return g_hash_table_lookup (shard->operations,
+                              GUINT_TO_POINTER (operation_id));
+}
+
 void
 grl_operation_init (void)
 {
   static gboolean initialized = FALSE;
+  guint i;
 
   if (G_LIKELY (initialized))
     return;
 
   initialized = TRUE;
-  operations = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                      NULL,
-                                      (GDestroyNotify) operation_data_free);
-  operations_id = 1;
+  for (i = 0; i < N_SHARDS; i++) {
+    g_mutex_init (&shards[i].lock);
+    shards[i].operations = g_hash_table_new (g_direct_hash, g_direct_equal);
+  }
 }
 
+/*
+ * grl_operation_generate_id:
+ *
+ * Registers a new operation, owned by the thread-default main context of the
+ * caller. Results and cancellation of the operation are dispatched in that
+ * context.
+ *
+ * Returns: the identifier of the operation
+ */
 guint
 grl_operation_generate_id (void)
 {
-  guint operation_id = operations_id++;
   OperationData *data = g_slice_new0 (OperationData);
-
-  g_hash_table_insert (operations, GUINT_TO_POINTER (operation_id), data);
+  OperationShard *shard;
+  guint operation_id;
+
+  data->context = g_main_context_ref_thread_default ();
+
+  while (TRUE) {
+    operation_id = (guint) g_atomic_int_add (&operations_id, 1);
+    /* 0 is not a valid identifier, and after wrapping around the identifier
+       could still be in use by a long running operation */
+    if (operation_id == 0) {
+      continue;
+    }
+
+    shard = get_shard (operation_id);
+    g_mutex_lock (&shard->lock);
+    if (!shard_lookup (shard, operation_id)) {
+      g_hash_table_insert (shard->operations,
+                           GUINT_TO_POINTER (operation_id), data);
+      g_mutex_unlock (&shard->lock);
+      break;
+    }
+    g_mutex_unlock (&shard->lock);
+  }
 
   return operation_id;
 }
@@ -83,35 +140,196 @@ grl_operation_set_private_data (guint                operation_id,
                                 GrlOperationCancelCb cancel_cb,
                                 GDestroyNotify       destroy_cb)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    data->cancel_cb    = cancel_cb;
+    data->destroy_cb   = destroy_cb;
+    data->private_data = private_data;
+  }
+  g_mutex_unlock (&shard->lock);
 
   g_return_if_fail (data != NULL);
-
-  data->cancel_cb    = cancel_cb;
-  data->destroy_cb   = destroy_cb;
-  data->private_data = private_data;
 }
 
 /**
  * grl_operation_get_private_data: (skip)
  * @operation_id: operation identifier
+ *
+ * Gets the private data of the operation. Only the lookup is protected: the
+ * data itself is not, so it must only be used from the main context owning
+ * the operation, where it is also removed.
+ *
+ * Returns: (transfer none): the private data
  */
 gpointer
 grl_operation_get_private_data (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  gpointer private_data = NULL;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    private_data = data->private_data;
+  }
+  g_mutex_unlock (&shard->lock);
 
   g_return_val_if_fail (data != NULL, NULL);
 
-  return data->private_data;
+  return private_data;
 }
 
 void
 grl_operation_remove (guint operation_id)
 {
-  g_hash_table_remove (operations, GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    g_hash_table_remove (shard->operations, GUINT_TO_POINTER (operation_id));
+  }
+  g_mutex_unlock (&shard->lock);
+
+  /* Destroy functions can use the table, so they run without the lock */
+  if (data) {
+    operation_data_free (data);
+  }
+}
+
+/*
+ * grl_operation_get_context:
+ * @operation_id: operation identifier, or 0
+ *
+ * Gets the main context owning the operation, where its results must be
+ * delivered. If the operation does not exist, the thread-default main context
+ * of the caller is returned.
+ *
+ * Returns: (transfer full): a #GMainContext
+ */
+GMainContext *
+grl_operation_get_context (guint operation_id)
+{
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  GMainContext *context = NULL;
+
+  if (operation_id > 0) {
+    g_mutex_lock (&shard->lock);
+    data = shard_lookup (shard, operation_id);
+    if (data) {
+      context = g_main_context_ref (data->context);
+    }
+    g_mutex_unlock (&shard->lock);
+  }
+
+  return context? context: g_main_context_ref_thread_default ();
+}
+
+static GSource *
+operation_attach_source (guint operation_id,
+                         GSource *source,
+                         const gchar *name)
+{
+  GMainContext *context = grl_operation_get_context (operation_id);
+
+  g_source_set_name (source, name);
+  g_source_attach (source, context);
+  g_source_unref (source);
+  g_main_context_unref (context);
+
+  return source;
+}
+
+/*
+ * grl_operation_idle_add:
+ * @operation_id: operation identifier, or 0
+ * @priority: priority of the idle source
+ * @function: function to call
+ * @data: data to pass to @function
+ * @notify: (allow-none): function to call when the idle is removed
+ * @name: name of the source, for debugging
+ *
+ * Like g_idle_add_full(), but dispatches @function in the main context owning
+ * the operation instead of the global default one.
+ *
+ * Returns: (transfer none): the source, that is valid until it is destroyed
+ * or @function returns %G_SOURCE_REMOVE
+ */
+GSource *
+grl_operation_idle_add (guint operation_id,
+                        gint priority,
+                        GSourceFunc function,
+                        gpointer data,
+                        GDestroyNotify notify,
+                        const gchar *name)
+{
+  GSource *source = g_idle_source_new ();
+
+  g_source_set_priority (source, priority);
+  g_source_set_callback (source, function, data, notify);
+
+  return operation_attach_source (operation_id, source, name);
+}
+
+/*
+ * grl_operation_timeout_add:
+ * @operation_id: operation identifier, or 0
+ * @interval: time between calls to @function, in milliseconds
+ * @function: function to call
+ * @data: data to pass to @function
+ * @name: name of the source, for debugging
+ *
+ * Like g_timeout_add(), but dispatches @function in the main context owning
+ * the operation instead of the global default one.
+ *
+ * Returns: (transfer none): the source, that is valid until it is destroyed
+ * or @function returns %G_SOURCE_REMOVE
+ */
+GSource *
+grl_operation_timeout_add (guint operation_id,
+                           guint interval,
+                           GSourceFunc function,
+                           gpointer data,
+                           const gchar *name)
+{
+  GSource *source = g_timeout_source_new (interval);
+
+  g_source_set_callback (source, function, data, NULL);
+
+  return operation_attach_source (operation_id, source, name);
+}
+
+static gboolean
+operation_cancel_in_context (gpointer user_data)
+{
+  guint operation_id = GPOINTER_TO_UINT (user_data);
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  GrlOperationCancelCb cancel_cb = NULL;
+  gpointer private_data = NULL;
+
+  /* The operation could have finished while the cancellation was waiting to
+     be dispatched */
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    cancel_cb = data->cancel_cb;
+    private_data = data->private_data;
+  }
+  g_mutex_unlock (&shard->lock);
+
+  if (cancel_cb) {
+    cancel_cb (private_data);
+  }
+
+  return G_SOURCE_REMOVE;
 }
 
 /*** PUBLIC API ***/
@@ -121,23 +339,38 @@ grl_operation_remove (guint operation_id)
  * @operation_id: the identifier of a running operation
  *
  * Cancel an operation.
+ *
+ * It can be called from any thread. The cancellation is done in the main
+ * context where the operation was started. If the calling thread cannot use
+ * that context, this function returns before the operation is cancelled, and
+ * results can still be received until the context is iterated; so do not free
+ * the data passed to the callbacks right after calling it, but when the last
+ * callback is received.
  */
 void
 grl_operation_cancel (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  GMainContext *context = NULL;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    context = g_main_context_ref (data->context);
+  }
+  g_mutex_unlock (&shard->lock);
 
-  if (!data) {
+  if (!context) {
     GRL_WARNING ("Invalid operation %u", operation_id);
     return;
   }
 
-  g_return_if_fail (data != NULL);
-
-  if (data->cancel_cb) {
-    data->cancel_cb (data->private_data);
-  }
+  /* Runs right away if the context can be used from this thread */
+  g_main_context_invoke_full (context, G_PRIORITY_HIGH,
+                              operation_cancel_in_context,
+                              GUINT_TO_POINTER (operation_id), NULL);
+  g_main_context_unref (context);
 }
 
 /**
@@ -151,15 +384,23 @@ grl_operation_cancel (guint operation_id)
 gpointer
 grl_operation_get_data (guint operation_id)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  gpointer user_data = NULL;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    user_data = data->user_data;
+  }
+  g_mutex_unlock (&shard->lock);
 
   if (!data) {
     GRL_WARNING ("Invalid operation %u", operation_id);
     return NULL;
   }
 
-  return data->user_data;
+  return user_data;
 }
 
 /**
@@ -190,17 +431,24 @@ grl_operation_set_data (guint operation_id, gpointer user_data)
 void
 grl_operation_set_data_full (guint operation_id, gpointer user_data, GDestroyNotify destroy_func)
 {
-  OperationData *data = g_hash_table_lookup (operations,
-                                             GUINT_TO_POINTER (operation_id));
+  OperationShard *shard = get_shard (operation_id);
+  OperationData *data;
+  gpointer old_data = NULL;
+  GDestroyNotify old_destroy_func = NULL;
+
+  g_mutex_lock (&shard->lock);
+  data = shard_lookup (shard, operation_id);
+  if (data) {
+    old_data = data->user_data;
+    old_destroy_func = data->user_data_destroy_func;
+    data->user_data = user_data;
+    data->user_data_destroy_func = destroy_func;
+  }
+  g_mutex_unlock (&shard->lock);
 
   if (!data) {
     GRL_WARNING ("Invalid operation %u", operation_id);
-  } else {
-    if (data->user_data_destroy_func && data->user_data)
-      data->user_data_destroy_func (data->user_data);
-
-    data->user_data = user_data;
-    data->user_data_destroy_func = destroy_func;
+  } else if (old_destroy_func && old_data) {
+    old_destroy_func (old_data);
   }
 }
-
@@ -25,6 +25,13 @@
 
 #include <grl-registry.h>
 
+typedef struct {
+  GType type;
+  GrlKeyID sample_key;
+  GParamSpec *pspec;
+  gboolean needs_validation;
+} GrlKeyInfo;
+
 void
 grl_registry_restrict_plugins (GrlRegistry *registry,
                                gchar **plugins);
@@ -41,4 +48,9 @@ GrlKeyID grl_registry_register_metadata_key_for_type (GrlRegistry *registry,
                                                       const gchar *key_name,
                                                       GType type);
 
+const GrlKeyInfo *grl_registry_lookup_metadata_key_info (GrlRegistry *registry,
+                                                         GrlKeyID key);
+
+guint grl_registry_get_sources_generation (GrlRegistry *registry);
+
 #endif /* _GRL_REGISTRY_PRIV_H_ */
@@ -45,6 +45,7 @@
 
 #include "grl-registry-priv.h"
 #include "grl-plugin-priv.h"
+#include "grl-resolve-cache-priv.h"
 #include "grl-log.h"
 #include "grl-error.h"
 
@@ -56,6 +57,11 @@
 #define GRL_LOG_DOMAIN_DEFAULT  registry_log_domain
 GRL_LOG_DOMAIN(registry_log_domain);
 
+/* Protects the tables of metadata keys. Keys can be registered from the main
+   thread while media are built in worker threads, so lookups take it for
+   reading */
+static GRWLock keys_lock;
+
 #define XML_ROOT_ELEMENT_NAME "plugin"
 
 #define GRL_PLUGIN_INFO_SUFFIX "xml"
@@ -88,6 +94,7 @@ struct _GrlRegistryPrivate {
   GSList *allowed_plugins;
   gboolean all_plugins_preloaded;
   struct KeyIDHandler key_id_handler;
+  GPtrArray *key_infos;
   GNetworkMonitor *netmon;
 };
 
@@ -126,6 +133,9 @@ enum {
 };
 static gint registry_signals[SIG_LAST];
 
+/* Bumped each time the set of visible sources or their ranks change */
+static guint sources_generation = 1;
+
 G_DEFINE_TYPE_WITH_PRIVATE (GrlRegistry, grl_registry, G_TYPE_OBJECT);
 
 static void
@@ -189,6 +199,20 @@ grl_registry_class_init (GrlRegistryClass *klass)
                  G_TYPE_NONE, 1, G_TYPE_STRING);
 }
 
+static void
+sources_changed (void)
+{
+  g_atomic_int_inc (&sources_generation);
+}
+
+static void
+source_rank_changed_cb (GObject    *source,
+                        GParamSpec *pspec,
+                        gpointer    user_data)
+{
+  sources_changed ();
+}
+
 static void
 get_connectivity (GrlRegistry          *registry,
                   GNetworkConnectivity *connectivity,
@@ -246,6 +270,7 @@ network_changed_cb (GObject     *gobject,
         GRL_DEBUG ("Network isn't available for '%s', hiding",
                    grl_source_get_id (current_source));
         SET_INVISIBLE_SOURCE(current_source, TRUE);
+        sources_changed ();
         g_signal_emit (registry, registry_signals[SIG_SOURCE_REMOVED], 0, current_source);
       }
     }
@@ -289,12 +314,14 @@ network_changed_cb (GObject     *gobject,
 
     for (l = to_add; l != NULL; l = l->next) {
       SET_INVISIBLE_SOURCE(l->data, FALSE);
+      sources_changed ();
       g_signal_emit (registry, registry_signals[SIG_SOURCE_ADDED], 0, l->data);
     }
     g_list_free (to_add);
 
     for (l = to_remove; l != NULL; l = l->next) {
         SET_INVISIBLE_SOURCE(l->data, TRUE);
+        sources_changed ();
         g_signal_emit (registry, registry_signals[SIG_SOURCE_REMOVED], 0, l->data);
     }
     g_list_free (to_remove);
@@ -326,6 +353,7 @@ grl_registry_init (GrlRegistry *registry)
                     G_CALLBACK (network_changed_cb), registry);
 
   key_id_handler_init (&registry->priv->key_id_handler);
+  registry->priv->key_infos = g_ptr_array_new_with_free_func (g_free);
 
   grl_registry_setup_ranks (registry);
 }
@@ -528,6 +556,56 @@ activate_plugin (GrlRegistry *registry,
   return TRUE;
 }
 
+/* Whether g_param_value_validate() can change a value of the right type */
+static gboolean
+param_spec_needs_validation (GParamSpec *pspec)
+{
+  if (G_IS_PARAM_SPEC_STRING (pspec)) {
+    GParamSpecString *spec = G_PARAM_SPEC_STRING (pspec);
+    return spec->cset_first || spec->cset_nth ||
+      spec->null_fold_if_empty || spec->ensure_non_null;
+  }
+
+  if (G_IS_PARAM_SPEC_INT (pspec)) {
+    GParamSpecInt *spec = G_PARAM_SPEC_INT (pspec);
+    return spec->minimum > G_MININT || spec->maximum < G_MAXINT;
+  }
+
+  if (G_IS_PARAM_SPEC_INT64 (pspec)) {
+    GParamSpecInt64 *spec = G_PARAM_SPEC_INT64 (pspec);
+    return spec->minimum > G_MININT64 || spec->maximum < G_MAXINT64;
+  }
+
+  /* Floating point specs always need it: even with the default range,
+     validation clamps infinite values */
+  return TRUE;
+}
+
+/* Precomputes what setters need to know about @key. Each key has its own
+   allocation, so the pointers handed out stay valid when the array grows */
+static void
+key_info_set (GrlRegistry *registry,
+              GrlKeyID key,
+              GParamSpec *param_spec,
+              GrlKeyID sample_key)
+{
+  GrlKeyInfo *info;
+
+  if (key >= registry->priv->key_infos->len) {
+    g_ptr_array_set_size (registry->priv->key_infos, key + 1);
+  }
+
+  info = g_ptr_array_index (registry->priv->key_infos, key);
+  if (!info) {
+    info = g_new0 (GrlKeyInfo, 1);
+    g_ptr_array_index (registry->priv->key_infos, key) = info;
+  }
+  info->type = G_PARAM_SPEC_VALUE_TYPE (param_spec);
+  info->sample_key = sample_key;
+  info->pspec = param_spec;
+  info->needs_validation = param_spec_needs_validation (param_spec);
+}
+
 static GrlKeyID
 grl_registry_register_metadata_key_full (GrlRegistry *registry,
                                          GParamSpec *param_spec,
@@ -544,6 +622,9 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
   GrlKeyID registered_key;
 
   key_name = g_param_spec_get_name (param_spec);
+
+  g_rw_lock_writer_lock (&keys_lock);
+
   registered_key = key_id_handler_get_key (&registry->priv->key_id_handler, key_name);
   if (registered_key != GRL_METADATA_KEY_INVALID) {
     GParamSpec *key_spec = g_hash_table_lookup (registry->priv->system_keys,
@@ -552,6 +633,7 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
       /* Key registered */
       GRL_DEBUG ("metadata key '%s' already registered with same spec", key_name);
       g_param_spec_unref (param_spec);
+      g_rw_lock_writer_unlock (&keys_lock);
       return registered_key;
     } else {
       GRL_WARNING ("metadata key '%s' already exists", key_name);
@@ -560,6 +642,7 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
                    GRL_CORE_ERROR_REGISTER_METADATA_KEY_FAILED,
                    _("Metadata key “%s” already registered in different format"),
                    key_name);
+      g_rw_lock_writer_unlock (&keys_lock);
       return GRL_METADATA_KEY_INVALID;
     }
   }
@@ -574,6 +657,7 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
                  _("Metadata key “%s” cannot be registered"),
                  key_name);
 
+    g_rw_lock_writer_unlock (&keys_lock);
     return GRL_METADATA_KEY_INVALID;
   }
 
@@ -587,6 +671,7 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
                          GRLKEYID_TO_POINTER (registered_key),
                          g_list_prepend (NULL,
                                          GRLKEYID_TO_POINTER (registered_key)));
+    key_info_set (registry, registered_key, param_spec, registered_key);
   } else {
     /* Add the new key to the partners */
     bound_partners = g_hash_table_lookup (registry->priv->related_keys, GRLKEYID_TO_POINTER (bind_key));
@@ -598,8 +683,13 @@ grl_registry_register_metadata_key_full (GrlRegistry *registry,
                            partner->data,
                            bound_partners);
     }
+    /* Keys are appended, so the sample key of the relation does not change */
+    key_info_set (registry, registered_key, param_spec,
+                  GRLPOINTER_TO_KEYID (bound_partners->data));
   }
 
+  g_rw_lock_writer_unlock (&keys_lock);
+
   return registered_key;
 }
 
@@ -931,14 +1021,20 @@ grl_registry_shutdown (GrlRegistry *registry)
   if (registry->priv->sources) {
     g_hash_table_iter_init (&iter, registry->priv->sources);
     while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &source)) {
+      g_signal_handlers_disconnect_by_func (source,
+                                            source_rank_changed_cb,
+                                            NULL);
       g_object_unref (source);
     }
     g_clear_pointer (&registry->priv->sources, g_hash_table_unref);
+    sources_changed ();
   }
 
   g_clear_pointer (&registry->priv->ranks, g_hash_table_unref);
   g_clear_pointer (&registry->priv->configs, g_hash_table_unref);
 
+  g_rw_lock_writer_lock (&keys_lock);
+
   /* We need to free this table with care. Several keys can be pointing to the
      same value, so we need to ensure that we only free the value once */
   if (registry->priv->related_keys) {
@@ -960,8 +1056,11 @@ grl_registry_shutdown (GrlRegistry *registry)
   g_slist_free_full (registry->priv->allowed_plugins, (GDestroyNotify) g_free);
 
   key_id_handler_free (&registry->priv->key_id_handler);
+  g_clear_pointer (&registry->priv->key_infos, g_ptr_array_unref);
   g_clear_pointer (&registry->priv->system_keys, g_hash_table_unref);
 
+  g_rw_lock_writer_unlock (&keys_lock);
+
   g_object_unref (registry);
 }
 
@@ -1038,6 +1137,10 @@ grl_registry_register_source (GrlRegistry *registry,
   /* Update whether it should be invisible */
   update_source_visibility (registry, source);
 
+  g_signal_connect (source, "notify::rank",
+                    G_CALLBACK (source_rank_changed_cb), NULL);
+  sources_changed ();
+
   if (!SOURCE_IS_INVISIBLE(source))
     g_signal_emit (registry, registry_signals[SIG_SOURCE_ADDED], 0, source);
 
@@ -1072,6 +1175,11 @@ grl_registry_unregister_source (GrlRegistry *registry,
 
   if (g_hash_table_remove (registry->priv->sources, id)) {
     GRL_DEBUG ("source '%s' is no longer available", id);
+    grl_resolve_cache_invalidate_source (id, FALSE);
+    g_signal_handlers_disconnect_by_func (source,
+                                          source_rank_changed_cb,
+                                          NULL);
+    sources_changed ();
     g_signal_emit (registry, registry_signals[SIG_SOURCE_REMOVED], 0, source);
     g_object_unref (source);
   } else {
@@ -1592,6 +1700,22 @@ grl_registry_get_sources_by_operations (GrlRegistry *registry,
   return source_list;
 }
 
+/*
+ * grl_registry_get_sources_generation:
+ * @registry: the registry instance
+ *
+ * Returns a counter that changes every time a source is added, removed,
+ * hidden, shown or gets a new rank. Callers caching information derived from
+ * the list of sources can compare it to know when to drop it.
+ */
+guint
+grl_registry_get_sources_generation (GrlRegistry *registry)
+{
+  g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
+
+  return (guint) g_atomic_int_get (&sources_generation);
+}
+
 /**
  * grl_registry_lookup_plugin:
  * @registry: the registry instance
@@ -1801,10 +1925,16 @@ GrlKeyID
 grl_registry_lookup_metadata_key (GrlRegistry *registry,
                                   const gchar *key_name)
 {
+  GrlKeyID key;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
   g_return_val_if_fail (key_name, 0);
 
-  return key_id_handler_get_key (&registry->priv->key_id_handler, key_name);
+  g_rw_lock_reader_lock (&keys_lock);
+  key = key_id_handler_get_key (&registry->priv->key_id_handler, key_name);
+  g_rw_lock_reader_unlock (&keys_lock);
+
+  return key;
 }
 
 /**
@@ -1822,9 +1952,15 @@ const gchar *
 grl_registry_lookup_metadata_key_name (GrlRegistry *registry,
                                        GrlKeyID key)
 {
+  const gchar *key_name;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
-  return key_id_handler_get_name (&registry->priv->key_id_handler, key);
+  g_rw_lock_reader_lock (&keys_lock);
+  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
+  g_rw_lock_reader_unlock (&keys_lock);
+
+  return key_name;
 }
 
 /**
@@ -1847,11 +1983,11 @@ grl_registry_lookup_metadata_key_desc (GrlRegistry *registry,
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
+  g_rw_lock_reader_lock (&keys_lock);
   key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return NULL;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = key_name?
+    g_hash_table_lookup (registry->priv->system_keys, key_name): NULL;
+  g_rw_lock_reader_unlock (&keys_lock);
 
   if (key_pspec) {
     return g_param_spec_get_blurb (key_pspec);
@@ -1875,22 +2011,41 @@ GType
 grl_registry_lookup_metadata_key_type (GrlRegistry *registry,
                                        GrlKeyID key)
 {
-  const gchar *key_name;
-  GParamSpec *key_pspec;
+  const GrlKeyInfo *info;
 
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), 0);
 
-  key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return G_TYPE_INVALID;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  info = grl_registry_lookup_metadata_key_info (registry, key);
 
-  if (key_pspec) {
-    return G_PARAM_SPEC_VALUE_TYPE (key_pspec);
-  } else {
-    return G_TYPE_INVALID;
+  return info? info->type: G_TYPE_INVALID;
+}
+
+/*
+ * grl_registry_lookup_metadata_key_info:
+ * @registry: the registry instance
+ * @key: a metadata key
+ *
+ * Returns what was precomputed about @key when it was registered, so setting
+ * values does not need to look up its specification.
+ *
+ * Returns: the information of @key, or %NULL if it is not registered. It is
+ * valid until the registry is shut down.
+ */
+const GrlKeyInfo *
+grl_registry_lookup_metadata_key_info (GrlRegistry *registry,
+                                       GrlKeyID key)
+{
+  GPtrArray *key_infos;
+  const GrlKeyInfo *info = NULL;
+
+  g_rw_lock_reader_lock (&keys_lock);
+  key_infos = registry->priv->key_infos;
+  if (key_infos && key < key_infos->len) {
+    info = g_ptr_array_index (key_infos, key);
   }
+  g_rw_lock_reader_unlock (&keys_lock);
+
+  return info && info->pspec? info: NULL;
 }
 
 /**
@@ -1918,11 +2073,11 @@ grl_registry_metadata_key_validate (GrlRegistry *registry,
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), FALSE);
   g_return_val_if_fail (G_IS_VALUE (value), FALSE);
 
+  g_rw_lock_reader_lock (&keys_lock);
   key_name = key_id_handler_get_name (&registry->priv->key_id_handler, key);
-  if (!key_name) {
-    return FALSE;
-  }
-  key_pspec = g_hash_table_lookup (registry->priv->system_keys, key_name);
+  key_pspec = key_name?
+    g_hash_table_lookup (registry->priv->system_keys, key_name): NULL;
+  g_rw_lock_reader_unlock (&keys_lock);
 
   if (key_pspec) {
     return !g_param_value_validate (key_pspec, value);
@@ -1949,9 +2104,16 @@ const GList *
 grl_registry_lookup_metadata_key_relation (GrlRegistry *registry,
                                            GrlKeyID key)
 {
+  const GList *related_keys;
+
   g_return_val_if_fail (GRL_IS_REGISTRY (registry), NULL);
 
-  return g_hash_table_lookup (registry->priv->related_keys, GRLKEYID_TO_POINTER (key));
+  g_rw_lock_reader_lock (&keys_lock);
+  related_keys = g_hash_table_lookup (registry->priv->related_keys,
+                                      GRLKEYID_TO_POINTER (key));
+  g_rw_lock_reader_unlock (&keys_lock);
+
+  return related_keys;
 }
 
 /**
@@ -1969,7 +2131,13 @@ grl_registry_lookup_metadata_key_relation (GrlRegistry *registry,
 GList *
 grl_registry_get_metadata_keys (GrlRegistry *registry)
 {
-  return key_id_handler_get_all_keys (&registry->priv->key_id_handler);
+  GList *keys;
+
+  g_rw_lock_reader_lock (&keys_lock);
+  keys = key_id_handler_get_all_keys (&registry->priv->key_id_handler);
+  g_rw_lock_reader_unlock (&keys_lock);
+
+  return keys;
 }
 
 /**
@@ -0,0 +1,767 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/**
+ * SECTION:grl-resolve-cache
+ * @short_description: Cache of resolved metadata shared by all operations
+ * @see_also: #GrlSource
+ *
+ * User interfaces tend to resolve the same keys of the same media over and
+ * over, for instance each time a list is redrawn. The resolve cache keeps the
+ * values obtained by grl_source_resolve(), including the ones resolved while
+ * browsing, searching or querying with %GRL_RESOLVE_FULL, and uses them to
+ * fill the next requests of the same keys for the same media without asking
+ * the sources again.
+ *
+ * Entries are identified by the source and the identifier of the media, and
+ * the key. They can expire after a time that can be set for each key, and are
+ * dropped when the source of the media, or the one that resolved the key,
+ * emits #GrlSource::content-changed.
+ *
+ * The cache is disabled by default. It is enabled by setting a maximum size
+ * with grl_resolve_cache_set_max_size(). When the cache is full, least
+ * recently used entries are discarded.
+ *
+ * Entries can also be saved in a file with grl_resolve_cache_set_file(), so
+ * they are available the next time the application runs. Entries in the file
+ * are read on demand when they are not in memory, and are not accounted in the
+ * maximum size. The file should not be used by several processes at the same
+ * time.
+ */
+
+#include "grl-resolve-cache.h"
+#include "grl-resolve-cache-priv.h"
+#include "grl-metadata-store-priv.h"
+#include "grl-related-keys.h"
+#include "grl-log.h"
+
+#include <string.h>
+
+#define GRL_LOG_DOMAIN_DEFAULT  resolve_cache_log_domain
+GRL_LOG_DOMAIN(resolve_cache_log_domain);
+
+/* Rough size of the structures, used to account the memory of the entries */
+#define ENTRY_OVERHEAD        128
+#define RELATED_KEYS_OVERHEAD 96
+
+/* Seconds to wait before writing stored entries to the file */
+#define FLUSH_DELAY           2
+
+typedef struct {
+  gchar *media_source;
+  gchar *media_id;
+  GrlKeyID key;
+} CacheKey;
+
+typedef struct {
+  CacheKey ckey;
+  gchar *provider;
+  GList *values;
+  gint64 expires;
+  gsize size;
+  GList *link;
+} CacheEntry;
+
+G_LOCK_DEFINE_STATIC (cache);
+
+static GHashTable *entries = NULL;
+static GQueue lru = G_QUEUE_INIT;
+static GHashTable *ttls = NULL;
+static guint default_ttl = 0;
+static gsize cache_max_size = 0;
+static gsize cache_size = 0;
+static guint64 cache_hits = 0;
+static guint64 cache_misses = 0;
+static GrlMetadataStore *store = NULL;
+static GSource *flush_source = NULL;
+
+static guint
+cache_key_hash (gconstpointer key)
+{
+  const CacheKey *ckey = key;
+
+  return (g_str_hash (ckey->media_source) * 31 +
+          g_str_hash (ckey->media_id)) * 31 + ckey->key;
+}
+
+static gboolean
+cache_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const CacheKey *ka = a;
+  const CacheKey *kb = b;
+
+  return ka->key == kb->key &&
+    g_str_equal (ka->media_id, kb->media_id) &&
+    g_str_equal (ka->media_source, kb->media_source);
+}
+
+static gsize
+value_size (const GValue *value)
+{
+  if (G_VALUE_HOLDS_STRING (value) && g_value_get_string (value)) {
+    return sizeof (GValue) + strlen (g_value_get_string (value)) + 1;
+  }
+
+  if (G_VALUE_HOLDS (value, G_TYPE_BYTE_ARRAY) && g_value_get_boxed (value)) {
+    return sizeof (GValue) + ((GByteArray *) g_value_get_boxed (value))->len;
+  }
+
+  return sizeof (GValue);
+}
+
+static gsize
+related_keys_size (GrlRelatedKeys *relkeys)
+{
+  GList *keys;
+  GList *k;
+  gsize relkeys_size = RELATED_KEYS_OVERHEAD;
+
+  keys = grl_related_keys_get_keys (relkeys);
+  for (k = keys; k; k = g_list_next (k)) {
+    relkeys_size += value_size (grl_related_keys_get (relkeys,
+                                                      GRLPOINTER_TO_KEYID (k->data)));
+  }
+  g_list_free (keys);
+
+  return relkeys_size;
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->ckey.media_source);
+  g_free (entry->ckey.media_id);
+  g_free (entry->provider);
+  g_list_free_full (entry->values, g_object_unref);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Must be called with the lock held */
+static void
+cache_remove_entry (CacheEntry *entry)
+{
+  g_queue_delete_link (&lru, entry->link);
+  cache_size -= entry->size;
+  /* The table owns the entry */
+  g_hash_table_remove (entries, &entry->ckey);
+}
+
+/* Must be called with the lock held */
+static void
+cache_evict (gsize limit)
+{
+  CacheEntry *entry;
+
+  while (cache_size > limit && (entry = g_queue_peek_tail (&lru))) {
+    GRL_DEBUG ("evicting key '%s' of '%s' from '%s'",
+               GRL_METADATA_KEY_GET_NAME (entry->ckey.key),
+               entry->ckey.media_id,
+               entry->ckey.media_source);
+    cache_remove_entry (entry);
+  }
+}
+
+/* Must be called with the lock held */
+static void
+cache_insert_entry (CacheEntry *entry)
+{
+  if (!entries) {
+    entries = g_hash_table_new_full (cache_key_hash, cache_key_equal,
+                                     NULL, (GDestroyNotify) cache_entry_free);
+  } else {
+    CacheEntry *old = g_hash_table_lookup (entries, &entry->ckey);
+    if (old) {
+      cache_remove_entry (old);
+    }
+  }
+
+  if (entry->size > cache_max_size) {
+    /* Would not fit even in an empty cache */
+    cache_entry_free (entry);
+    return;
+  }
+
+  cache_evict (cache_max_size - entry->size);
+
+  g_hash_table_insert (entries, &entry->ckey, entry);
+  g_queue_push_head (&lru, entry);
+  entry->link = lru.head;
+  cache_size += entry->size;
+}
+
+static CacheEntry *
+cache_entry_new (const gchar *media_source,
+                 const gchar *media_id,
+                 GrlKeyID key,
+                 const gchar *provider)
+{
+  CacheEntry *entry;
+
+  entry = g_slice_new0 (CacheEntry);
+  entry->ckey.media_source = g_strdup (media_source);
+  entry->ckey.media_id = g_strdup (media_id);
+  entry->ckey.key = key;
+  entry->provider = g_strdup (provider);
+  entry->size = ENTRY_OVERHEAD + strlen (media_source) + strlen (media_id) +
+    (provider? strlen (provider): 0);
+
+  return entry;
+}
+
+/* Must be called with the lock held. Looks up the entry in the store, adding
+   it to memory if possible */
+static GList *
+cache_lookup_store (const CacheKey *ckey)
+{
+  GList *values;
+  GList *v;
+  gchar *provider = NULL;
+  gint64 expires = 0;
+  gint64 now;
+  CacheEntry *entry;
+
+  values = grl_metadata_store_lookup (store,
+                                      ckey->media_source,
+                                      ckey->media_id,
+                                      ckey->key,
+                                      &provider,
+                                      &expires);
+  if (!values) {
+    return NULL;
+  }
+
+  now = g_get_real_time ();
+  if (expires > 0 && expires <= now) {
+    g_list_free_full (values, g_object_unref);
+    g_free (provider);
+    return NULL;
+  }
+
+  if (cache_max_size > 0) {
+    entry = cache_entry_new (ckey->media_source, ckey->media_id, ckey->key,
+                             provider);
+    /* Expiration in the store is in real time */
+    if (expires > 0) {
+      entry->expires = g_get_monotonic_time () + (expires - now);
+    }
+    for (v = values; v; v = g_list_next (v)) {
+      entry->values = g_list_prepend (entry->values,
+                                      grl_related_keys_dup (v->data));
+      entry->size += related_keys_size (v->data);
+    }
+    entry->values = g_list_reverse (entry->values);
+    cache_insert_entry (entry);
+  }
+
+  g_free (provider);
+
+  return values;
+}
+
+static gboolean
+cache_flush_cb (gpointer user_data)
+{
+  GError *error = NULL;
+
+  G_LOCK (cache);
+
+  if (store && !grl_metadata_store_flush (store, &error)) {
+    GRL_WARNING ("Unable to write resolve cache file: %s", error->message);
+    g_error_free (error);
+  }
+  g_clear_pointer (&flush_source, g_source_unref);
+
+  G_UNLOCK (cache);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Must be called with the lock held. Entries are written to the file in
+   batches from the main context, so storing them never blocks on the disk */
+static void
+cache_schedule_flush (void)
+{
+  if (flush_source) {
+    return;
+  }
+
+  flush_source = g_timeout_source_new_seconds (FLUSH_DELAY);
+  g_source_set_callback (flush_source, cache_flush_cb, NULL, NULL);
+  g_source_attach (flush_source, NULL);
+}
+
+/* Must be called with the lock held */
+static void
+cache_cancel_flush (void)
+{
+  if (flush_source) {
+    g_source_destroy (flush_source);
+    g_clear_pointer (&flush_source, g_source_unref);
+  }
+}
+
+/* Must be called with the lock held */
+static guint
+cache_get_ttl (GrlKeyID key)
+{
+  gpointer ttl;
+
+  if (ttls &&
+      g_hash_table_lookup_extended (ttls, GRLKEYID_TO_POINTER (key), NULL, &ttl)) {
+    return GPOINTER_TO_UINT (ttl);
+  }
+
+  return default_ttl;
+}
+
+/*
+ * grl_resolve_cache_is_enabled:
+ *
+ * Returns: %TRUE if a maximum size or a file was set for the cache
+ */
+gboolean
+grl_resolve_cache_is_enabled (void)
+{
+  return cache_max_size > 0 || store != NULL;
+}
+
+/*
+ * grl_resolve_cache_fill:
+ * @media: a media
+ * @keys: (element-type GrlKeyID): keys wanted for @media
+ *
+ * Sets in @media the values of @keys that are in the cache and @media does not
+ * have yet.
+ */
+void
+grl_resolve_cache_fill (GrlMedia *media,
+                        const GList *keys)
+{
+  CacheKey ckey;
+  CacheEntry *entry;
+  const GList *k;
+  GList *values;
+  GList *v;
+  gint64 now;
+
+  if (!grl_resolve_cache_is_enabled ()) {
+    return;
+  }
+
+  ckey.media_source = (gchar *) grl_media_get_source (media);
+  ckey.media_id = (gchar *) grl_media_get_id (media);
+  if (!ckey.media_source || !ckey.media_id) {
+    return;
+  }
+
+  now = g_get_monotonic_time ();
+
+  G_LOCK (cache);
+
+  if (!entries && !store) {
+    G_UNLOCK (cache);
+    return;
+  }
+
+  for (k = keys; k; k = g_list_next (k)) {
+    ckey.key = GRLPOINTER_TO_KEYID (k->data);
+    if (grl_data_has_key (GRL_DATA (media), ckey.key)) {
+      continue;
+    }
+
+    entry = entries? g_hash_table_lookup (entries, &ckey): NULL;
+    if (entry && entry->expires > 0 && entry->expires <= now) {
+      cache_remove_entry (entry);
+      entry = NULL;
+    }
+
+    if (entry) {
+      cache_hits++;
+      for (v = entry->values; v; v = g_list_next (v)) {
+        grl_data_add_related_keys (GRL_DATA (media),
+                                   grl_related_keys_dup (v->data));
+      }
+
+      /* Mark as most recently used */
+      g_queue_unlink (&lru, entry->link);
+      g_queue_push_head_link (&lru, entry->link);
+      continue;
+    }
+
+    values = store? cache_lookup_store (&ckey): NULL;
+    if (!values) {
+      cache_misses++;
+      continue;
+    }
+
+    cache_hits++;
+    for (v = values; v; v = g_list_next (v)) {
+      grl_data_add_related_keys (GRL_DATA (media), v->data);
+    }
+    g_list_free (values);
+  }
+
+  G_UNLOCK (cache);
+}
+
+/*
+ * grl_resolve_cache_store:
+ * @media: a media
+ * @key: a key that has just been resolved for @media
+ * @provider: identifier of the source that resolved it
+ *
+ * Saves the values of @key in @media.
+ */
+void
+grl_resolve_cache_store (GrlMedia *media,
+                         GrlKeyID key,
+                         const gchar *provider)
+{
+  CacheEntry *entry;
+  const gchar *media_source;
+  const gchar *media_id;
+  guint length;
+  guint i;
+  guint ttl;
+
+  if (!grl_resolve_cache_is_enabled ()) {
+    return;
+  }
+
+  media_source = grl_media_get_source (media);
+  media_id = grl_media_get_id (media);
+  length = grl_data_length (GRL_DATA (media), key);
+  if (!media_source || !media_id || length == 0) {
+    return;
+  }
+
+  entry = cache_entry_new (media_source, media_id, key, provider);
+
+  for (i = 0; i < length; i++) {
+    GrlRelatedKeys *relkeys = grl_data_get_related_keys (GRL_DATA (media),
+                                                         key, i);
+    entry->values = g_list_prepend (entry->values,
+                                    grl_related_keys_dup (relkeys));
+    entry->size += related_keys_size (relkeys);
+  }
+  entry->values = g_list_reverse (entry->values);
+
+  G_LOCK (cache);
+
+  ttl = cache_get_ttl (key);
+  if (ttl > 0) {
+    entry->expires = g_get_monotonic_time () + (gint64) ttl * G_USEC_PER_SEC;
+  }
+
+  if (store) {
+    grl_metadata_store_append (store, media_source, media_id, key, provider,
+                               entry->values,
+                               ttl > 0?
+                               g_get_real_time () + (gint64) ttl * G_USEC_PER_SEC:
+                               0);
+    cache_schedule_flush ();
+  }
+
+  if (cache_max_size > 0) {
+    cache_insert_entry (entry);
+  } else {
+    cache_entry_free (entry);
+  }
+
+  G_UNLOCK (cache);
+}
+
+/*
+ * grl_resolve_cache_invalidate_source:
+ * @source_id: identifier of a source
+ * @persistent: whether to drop the entries from the file too
+ *
+ * Drops the entries of the media belonging to the source, and the ones that
+ * were resolved by it. Entries in the file are only dropped if @persistent is
+ * %TRUE, as they are still valid if the source is just being unloaded.
+ */
+void
+grl_resolve_cache_invalidate_source (const gchar *source_id,
+                                     gboolean persistent)
+{
+  GList *l;
+  GList *next;
+  guint dropped = 0;
+
+  G_LOCK (cache);
+
+  if (store && persistent) {
+    grl_metadata_store_invalidate_source (store, source_id);
+    cache_schedule_flush ();
+  }
+
+  if (!entries) {
+    G_UNLOCK (cache);
+    return;
+  }
+
+  for (l = lru.head; l; l = next) {
+    CacheEntry *entry = l->data;
+
+    next = l->next;
+    if (g_strcmp0 (entry->ckey.media_source, source_id) == 0 ||
+        g_strcmp0 (entry->provider, source_id) == 0) {
+      cache_remove_entry (entry);
+      dropped++;
+    }
+  }
+
+  G_UNLOCK (cache);
+
+  if (dropped > 0) {
+    GRL_DEBUG ("dropped %u entries related to '%s'", dropped, source_id);
+  }
+}
+
+/*** PUBLIC API ***/
+
+/**
+ * grl_resolve_cache_set_max_size:
+ * @max_size: maximum memory, in bytes, used by the cache, or 0 to disable it
+ *
+ * Sets how much memory the resolve cache can use. Setting a size different
+ * from 0 enables the cache.
+ *
+ * The size of the entries is estimated from the size of the values they store,
+ * so the actual memory used can be slightly different.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_resolve_cache_set_max_size (gsize max_size)
+{
+  G_LOCK (cache);
+
+  cache_max_size = max_size;
+  if (entries) {
+    cache_evict (cache_max_size);
+  }
+
+  G_UNLOCK (cache);
+}
+
+/**
+ * grl_resolve_cache_get_max_size:
+ *
+ * Gets how much memory the resolve cache can use.
+ *
+ * Returns: the maximum size in bytes, or 0 if the cache is disabled
+ *
+ * Since: 0.3.13
+ */
+gsize
+grl_resolve_cache_get_max_size (void)
+{
+  return cache_max_size;
+}
+
+/**
+ * grl_resolve_cache_set_ttl:
+ * @key: a key, or %GRL_METADATA_KEY_INVALID to set the default value
+ * @ttl: time, in seconds, the values of @key are valid, or 0 if they do not
+ * expire
+ *
+ * Sets how long values of @key are kept in the cache. By default values do not
+ * expire, and are only dropped when the cache is full or the source they come
+ * from changes.
+ *
+ * It only applies to values stored from now on.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_resolve_cache_set_ttl (GrlKeyID key,
+                           guint ttl)
+{
+  G_LOCK (cache);
+
+  if (key == GRL_METADATA_KEY_INVALID) {
+    default_ttl = ttl;
+  } else {
+    if (!ttls) {
+      ttls = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+    g_hash_table_insert (ttls, GRLKEYID_TO_POINTER (key), GUINT_TO_POINTER (ttl));
+  }
+
+  G_UNLOCK (cache);
+}
+
+/**
+ * grl_resolve_cache_get_ttl:
+ * @key: a key, or %GRL_METADATA_KEY_INVALID to get the default value
+ *
+ * Gets how long values of @key are kept in the cache.
+ *
+ * Returns: time in seconds, or 0 if values do not expire
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_resolve_cache_get_ttl (GrlKeyID key)
+{
+  guint ttl;
+
+  G_LOCK (cache);
+  ttl = key == GRL_METADATA_KEY_INVALID? default_ttl: cache_get_ttl (key);
+  G_UNLOCK (cache);
+
+  return ttl;
+}
+
+/**
+ * grl_resolve_cache_get_stats:
+ * @hits: (out) (allow-none): number of keys found in the cache
+ * @misses: (out) (allow-none): number of keys not found in the cache
+ * @size: (out) (allow-none): estimated memory used by the cache, in bytes
+ *
+ * Gets statistics of the resolve cache since it was last cleared.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_resolve_cache_get_stats (guint64 *hits,
+                             guint64 *misses,
+                             gsize *size)
+{
+  G_LOCK (cache);
+
+  if (hits) {
+    *hits = cache_hits;
+  }
+  if (misses) {
+    *misses = cache_misses;
+  }
+  if (size) {
+    *size = cache_size;
+  }
+
+  G_UNLOCK (cache);
+}
+
+/**
+ * grl_resolve_cache_clear:
+ *
+ * Drops all the entries from the resolve cache, including the ones saved in
+ * its file, and resets its statistics.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_resolve_cache_clear (void)
+{
+  G_LOCK (cache);
+
+  if (store) {
+    grl_metadata_store_clear (store);
+  }
+
+  g_queue_clear (&lru);
+  g_clear_pointer (&entries, g_hash_table_unref);
+  cache_size = 0;
+  cache_hits = 0;
+  cache_misses = 0;
+
+  G_UNLOCK (cache);
+}
+
+/**
+ * grl_resolve_cache_set_file:
+ * @filename: (type filename) (allow-none): path of the file, or %NULL
+ * @error: a #GError, or %NULL
+ *
+ * Sets the file where the resolve cache saves its entries, so they persist
+ * across runs. It is created if it does not exist. Setting a file enables the
+ * cache, even if no maximum size was set; in that case, entries are only kept
+ * in the file.
+ *
+ * Entries are appended to the file in batches, a couple of seconds after they
+ * are stored, from the default main context; the pending ones are also written
+ * when the file is closed. The file is checked when opened, so entries that
+ * were being written when the application crashed are discarded. Passing %NULL
+ * closes the current file.
+ *
+ * The file can only be used by one process at a time: opening a file that
+ * another process is using fails with %G_IO_ERROR_BUSY.
+ *
+ * Returns: %TRUE if the file could be opened
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_resolve_cache_set_file (const gchar *filename,
+                            GError **error)
+{
+  gboolean ret = TRUE;
+
+  G_LOCK (cache);
+
+  /* Close the current file first, as it might be the same one */
+  cache_cancel_flush ();
+  if (store) {
+    grl_metadata_store_close (store);
+    store = NULL;
+  }
+
+  if (filename) {
+    store = grl_metadata_store_open (filename, error);
+    ret = store != NULL;
+  }
+
+  G_UNLOCK (cache);
+
+  return ret;
+}
+
+/**
+ * grl_resolve_cache_compact:
+ * @error: a #GError, or %NULL
+ *
+ * Rewrites the file of the resolve cache without the entries that were
+ * replaced or dropped. The file is also compacted when it is opened and
+ * whenever those entries take most of it, so this is only needed to reclaim
+ * space at a specific moment.
+ *
+ * The new file atomically replaces the old one, so it is never left in an
+ * inconsistent state.
+ *
+ * Returns: %TRUE on success, or if no file was set
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_resolve_cache_compact (GError **error)
+{
+  gboolean ret = TRUE;
+
+  G_LOCK (cache);
+  if (store) {
+    ret = grl_metadata_store_compact (store, error);
+  }
+  G_UNLOCK (cache);
+
+  return ret;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#if !defined (_GRILO_H_INSIDE_) && !defined (GRILO_COMPILATION)
+#error "Only <grilo.h> can be included directly."
+#endif
+
+#ifndef _GRL_RESOLVE_CACHE_H_
+#define _GRL_RESOLVE_CACHE_H_
+
+#include <glib.h>
+
+#include "grl-metadata-key.h"
+
+G_BEGIN_DECLS
+
+void grl_resolve_cache_set_max_size (gsize max_size);
+
+gsize grl_resolve_cache_get_max_size (void);
+
+void grl_resolve_cache_set_ttl (GrlKeyID key, guint ttl);
+
+guint grl_resolve_cache_get_ttl (GrlKeyID key);
+
+void grl_resolve_cache_get_stats (guint64 *hits,
+                                  guint64 *misses,
+                                  gsize *size);
+
+void grl_resolve_cache_clear (void);
+
+gboolean grl_resolve_cache_set_file (const gchar *filename, GError **error);
+
+gboolean grl_resolve_cache_compact (GError **error);
+
+G_END_DECLS
+
+#endif /* _GRL_RESOLVE_CACHE_H_ */
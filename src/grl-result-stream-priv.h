@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#ifndef _GRL_RESULT_STREAM_PRIV_H_
+#define _GRL_RESULT_STREAM_PRIV_H_
+
+#include "grl-result-stream.h"
+#include "grl-source.h"
+
+G_BEGIN_DECLS
+
+GrlResultStream *grl_result_stream_new (GrlSource *source,
+                                        GrlSupportedOps operation_type,
+                                        GrlMedia *container,
+                                        const gchar *text,
+                                        const GList *keys,
+                                        GrlOperationOptions *options,
+                                        guint chunk_size);
+
+G_END_DECLS
+
+#endif /* _GRL_RESULT_STREAM_PRIV_H_ */
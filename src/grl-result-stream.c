@@ -0,0 +1,631 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/**
+ * SECTION:grl-result-stream
+ * @short_description: Pull results of an operation as they are needed
+ * @see_also: grl_source_browse_stream(), grl_source_search_stream(),
+ * grl_source_query_stream()
+ *
+ * A #GrlResultStream delivers the results of a browse, search or query when
+ * they are asked for with grl_result_stream_next_async() or
+ * grl_result_stream_next_batch_async(), instead of pushing all of them to a
+ * callback.
+ *
+ * The source is not asked for all the results at once. They are requested in
+ * chunks, using the skip and count options, and a new chunk is only requested
+ * when the consumer has taken most of the previous one. So a slow consumer
+ * keeps at most about two chunks of results in memory, no matter how many the
+ * operation returns.
+ *
+ * Results are delivered in the main context that was the thread-default one
+ * when the stream was created.
+ */
+
+#include "grl-result-stream.h"
+#include "grl-result-stream-priv.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "grl-operation.h"
+#include "grl-error.h"
+#include "grl-log.h"
+
+#include <glib/gi18n-lib.h>
+
+#define GRL_LOG_DOMAIN_DEFAULT  source_log_domain
+GRL_LOG_DOMAIN_EXTERN(source_log_domain);
+
+/* Used when the source has no auto-split threshold */
+#define CHUNK_SIZE_DEFAULT 50
+
+struct _GrlResultStreamPrivate {
+  GrlSource *source;
+  GrlSupportedOps operation_type;
+  GrlMedia *container;
+  gchar *text;
+  GList *keys;
+  GrlOperationOptions *options;
+  guint chunk_size;
+  guint next_skip;
+  gint unrequested;
+  guint operation_id;
+  guint chunk_received;
+  GQueue buffer;
+  GError *error;
+  gboolean exhausted;
+  gboolean closed;
+  GTask *pending;
+  guint pending_max;
+  GSource *cancel_source;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (GrlResultStream, grl_result_stream, G_TYPE_OBJECT);
+
+static void
+buffer_clear (GrlResultStream *stream)
+{
+  g_queue_foreach (&stream->priv->buffer, (GFunc) g_object_unref, NULL);
+  g_queue_clear (&stream->priv->buffer);
+}
+
+static void
+grl_result_stream_dispose (GObject *object)
+{
+  grl_result_stream_close (GRL_RESULT_STREAM (object));
+
+  G_OBJECT_CLASS (grl_result_stream_parent_class)->dispose (object);
+}
+
+static void
+grl_result_stream_finalize (GObject *object)
+{
+  GrlResultStream *stream = GRL_RESULT_STREAM (object);
+
+  buffer_clear (stream);
+  g_clear_object (&stream->priv->source);
+  g_clear_object (&stream->priv->container);
+  g_clear_object (&stream->priv->options);
+  g_list_free (stream->priv->keys);
+  g_free (stream->priv->text);
+  g_clear_error (&stream->priv->error);
+
+  G_OBJECT_CLASS (grl_result_stream_parent_class)->finalize (object);
+}
+
+static void
+grl_result_stream_init (GrlResultStream *stream)
+{
+  stream->priv = grl_result_stream_get_instance_private (stream);
+
+  g_queue_init (&stream->priv->buffer);
+}
+
+static void
+grl_result_stream_class_init (GrlResultStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = grl_result_stream_dispose;
+  object_class->finalize = grl_result_stream_finalize;
+}
+
+static void chunk_result_cb (GrlSource *source,
+                             guint operation_id,
+                             GrlMedia *media,
+                             guint remaining,
+                             gpointer user_data,
+                             const GError *error);
+
+static void
+request_chunk (GrlResultStream *stream)
+{
+  GrlResultStreamPrivate *priv = stream->priv;
+  GrlOperationOptions *options;
+  guint count;
+  guint operation_id = 0;
+  GrlCoreError error_code = GRL_CORE_ERROR_BROWSE_FAILED;
+
+  if (priv->operation_id != 0 || priv->exhausted || priv->closed) {
+    return;
+  }
+
+  count = priv->chunk_size;
+  if (priv->unrequested != GRL_COUNT_INFINITY) {
+    count = MIN (count, (guint) priv->unrequested);
+  }
+  if (count == 0) {
+    priv->exhausted = TRUE;
+    return;
+  }
+
+  options = grl_operation_options_copy (priv->options);
+  grl_operation_options_set_skip (options, priv->next_skip);
+  grl_operation_options_set_count (options, count);
+  GRL_DEBUG ("result-stream: requesting chunk (skip=%u, count=%u)",
+             priv->next_skip, count);
+
+  priv->chunk_received = 0;
+
+  /* The operation keeps the stream alive until it finishes */
+  g_object_ref (stream);
+
+  switch (priv->operation_type) {
+  case GRL_OP_BROWSE:
+    operation_id = grl_source_browse (priv->source, priv->container,
+                                      priv->keys, options,
+                                      chunk_result_cb, stream);
+    break;
+  case GRL_OP_SEARCH:
+    error_code = GRL_CORE_ERROR_SEARCH_FAILED;
+    operation_id = grl_source_search (priv->source, priv->text,
+                                      priv->keys, options,
+                                      chunk_result_cb, stream);
+    break;
+  case GRL_OP_QUERY:
+    error_code = GRL_CORE_ERROR_QUERY_FAILED;
+    operation_id = grl_source_query (priv->source, priv->text,
+                                     priv->keys, options,
+                                     chunk_result_cb, stream);
+    break;
+  default:
+    g_assert_not_reached ();
+    break;
+  }
+
+  g_object_unref (options);
+
+  if (operation_id == 0) {
+    priv->error = g_error_new (GRL_CORE_ERROR,
+                               error_code,
+                               _("Operation could not be started"));
+    priv->exhausted = TRUE;
+    g_object_unref (stream);
+    return;
+  }
+
+  priv->operation_id = operation_id;
+}
+
+/* Asks for more results once the consumer has taken most of the buffered
+   ones */
+static void
+fill_buffer (GrlResultStream *stream)
+{
+  if (g_queue_get_length (&stream->priv->buffer) < stream->priv->chunk_size) {
+    request_chunk (stream);
+  }
+}
+
+/* Detaches the pending request from the stream, so it can be returned: its
+   callback can run right away and ask for the next results */
+static GTask *
+take_pending (GrlResultStream *stream)
+{
+  GrlResultStreamPrivate *priv = stream->priv;
+
+  if (priv->cancel_source) {
+    g_source_destroy (priv->cancel_source);
+    g_clear_pointer (&priv->cancel_source, g_source_unref);
+  }
+
+  return g_steal_pointer (&priv->pending);
+}
+
+/* Completes the pending request if there are enough results for it, or if no
+   more will come */
+static void
+serve_pending (GrlResultStream *stream)
+{
+  GrlResultStreamPrivate *priv = stream->priv;
+  guint available = g_queue_get_length (&priv->buffer);
+  gboolean done = priv->exhausted && priv->operation_id == 0;
+  GTask *task;
+
+  if (!priv->pending) {
+    fill_buffer (stream);
+    return;
+  }
+
+  if (priv->pending_max == 0) {
+    if (available > 0) {
+      GrlMedia *media = g_queue_pop_head (&priv->buffer);
+
+      task = take_pending (stream);
+      fill_buffer (stream);
+      g_task_return_pointer (task, media, g_object_unref);
+    } else if (done && priv->error) {
+      task = take_pending (stream);
+      g_task_return_error (task, g_steal_pointer (&priv->error));
+    } else if (done) {
+      task = take_pending (stream);
+      g_task_return_pointer (task, NULL, NULL);
+    } else {
+      fill_buffer (stream);
+      return;
+    }
+  } else {
+    GPtrArray *medias;
+    guint i;
+
+    /* Do not wait for a full batch if the source is not sending anything */
+    if (available < priv->pending_max &&
+        (available == 0 || priv->operation_id != 0) &&
+        !done) {
+      fill_buffer (stream);
+      return;
+    }
+
+    task = take_pending (stream);
+    if (available == 0 && priv->error) {
+      g_task_return_error (task, g_steal_pointer (&priv->error));
+    } else {
+      available = MIN (available, priv->pending_max);
+      medias = g_ptr_array_new_full (available, g_object_unref);
+      for (i = 0; i < available; i++) {
+        g_ptr_array_add (medias, g_queue_pop_head (&priv->buffer));
+      }
+      fill_buffer (stream);
+      g_task_return_pointer (task, medias,
+                             (GDestroyNotify) g_ptr_array_unref);
+    }
+  }
+
+  g_object_unref (task);
+}
+
+static void
+chunk_result_cb (GrlSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 guint remaining,
+                 gpointer user_data,
+                 const GError *error)
+{
+  GrlResultStream *stream = GRL_RESULT_STREAM (user_data);
+  GrlResultStreamPrivate *priv = stream->priv;
+
+  if (media) {
+    priv->chunk_received++;
+    if (priv->closed) {
+      g_object_unref (media);
+    } else {
+      g_queue_push_tail (&priv->buffer, media);
+    }
+  }
+
+  /* The operation can go on after an error; keep the first one until it
+     ends */
+  if (error && !priv->error && !priv->closed) {
+    priv->error = g_error_copy (error);
+  }
+
+  if (remaining > 0) {
+    serve_pending (stream);
+    return;
+  }
+
+  priv->operation_id = 0;
+
+  if (priv->closed) {
+    g_object_unref (stream);
+    return;
+  }
+
+  /* Sources can send less than asked for, so continue from what was actually
+     received; an empty chunk means there is nothing else */
+  priv->next_skip += priv->chunk_received;
+  if (priv->unrequested != GRL_COUNT_INFINITY) {
+    priv->unrequested -= MIN (priv->chunk_received, (guint) priv->unrequested);
+  }
+
+  if (priv->error) {
+    priv->exhausted = TRUE;
+  } else if (priv->chunk_received == 0 || priv->unrequested == 0) {
+    priv->exhausted = TRUE;
+  }
+
+  serve_pending (stream);
+  g_object_unref (stream);
+}
+
+static gboolean
+pending_cancelled_cb (GCancellable *cancellable,
+                      gpointer user_data)
+{
+  GrlResultStream *stream = GRL_RESULT_STREAM (user_data);
+  GTask *task;
+
+  task = take_pending (stream);
+  g_task_return_error_if_cancelled (task);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+next_async (GrlResultStream *stream,
+            guint max_items,
+            GCancellable *cancellable,
+            GAsyncReadyCallback callback,
+            gpointer user_data,
+            gpointer source_tag)
+{
+  GrlResultStreamPrivate *priv = stream->priv;
+  GTask *task;
+
+  task = g_task_new (stream, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+
+  if (priv->closed) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CLOSED,
+                             _("Stream is already closed"));
+    g_object_unref (task);
+    return;
+  }
+
+  if (priv->pending) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_PENDING,
+                             _("Stream has outstanding operation"));
+    g_object_unref (task);
+    return;
+  }
+
+  if (g_task_return_error_if_cancelled (task)) {
+    g_object_unref (task);
+    return;
+  }
+
+  priv->pending = task;
+  priv->pending_max = max_items;
+
+  if (cancellable) {
+    priv->cancel_source = g_cancellable_source_new (cancellable);
+    g_source_set_callback (priv->cancel_source,
+                           (GSourceFunc) pending_cancelled_cb, stream, NULL);
+    g_source_set_name (priv->cancel_source,
+                       "[grilo] pending_cancelled_cb");
+    g_source_attach (priv->cancel_source, g_task_get_context (task));
+  }
+
+  serve_pending (stream);
+}
+
+/*
+ * grl_result_stream_new:
+ * @source: the source running the operation
+ * @operation_type: %GRL_OP_BROWSE, %GRL_OP_SEARCH or %GRL_OP_QUERY
+ * @container: (allow-none): container to browse
+ * @text: (allow-none): text to search, or query to run
+ * @keys: keys to request
+ * @options: options of the operation; skip and count apply to the whole
+ * stream
+ * @chunk_size: number of results to request at once, or 0 for the default
+ *
+ * Returns: (transfer full): a new stream, that starts requesting results
+ * right away
+ */
+GrlResultStream *
+grl_result_stream_new (GrlSource *source,
+                       GrlSupportedOps operation_type,
+                       GrlMedia *container,
+                       const gchar *text,
+                       const GList *keys,
+                       GrlOperationOptions *options,
+                       guint chunk_size)
+{
+  GrlResultStream *stream;
+  GrlResultStreamPrivate *priv;
+
+  stream = g_object_new (GRL_TYPE_RESULT_STREAM, NULL);
+  priv = stream->priv;
+
+  priv->source = g_object_ref (source);
+  priv->operation_type = operation_type;
+  priv->container = container? g_object_ref (container): NULL;
+  priv->text = g_strdup (text);
+  priv->keys = g_list_copy ((GList *) keys);
+  priv->options = grl_operation_options_copy (options);
+  priv->chunk_size = chunk_size > 0? chunk_size: CHUNK_SIZE_DEFAULT;
+  priv->next_skip = grl_operation_options_get_skip (options);
+  priv->unrequested = grl_operation_options_get_count (options);
+
+  request_chunk (stream);
+
+  return stream;
+}
+
+/**
+ * grl_result_stream_next_async:
+ * @stream: a result stream
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when a result
+ * is available
+ * @user_data: user data passed to @callback
+ *
+ * Requests the next result of the operation. Only one request can be pending
+ * at a time.
+ *
+ * Cancelling @cancellable cancels this request only, not the operation.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_result_stream_next_async (GrlResultStream *stream,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data)
+{
+  g_return_if_fail (GRL_IS_RESULT_STREAM (stream));
+
+  next_async (stream, 0, cancellable, callback, user_data,
+              grl_result_stream_next_async);
+}
+
+/**
+ * grl_result_stream_next_finish:
+ * @stream: a result stream
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_result_stream_next_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes a request started with grl_result_stream_next_async().
+ *
+ * If the operation fails, the results received before the error are still
+ * delivered, and then the error is reported once.
+ *
+ * Returns: (transfer full): the next #GrlMedia, or %NULL if there are no more
+ * results or on error
+ *
+ * Since: 0.3.13
+ */
+GrlMedia *
+grl_result_stream_next_finish (GrlResultStream *stream,
+                               GAsyncResult *result,
+                               GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, stream), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_result_stream_next_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_result_stream_next_batch_async:
+ * @stream: a result stream
+ * @max_items: maximum number of results to get
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when results
+ * are available
+ * @user_data: user data passed to @callback
+ *
+ * Requests up to @max_items of the following results of the operation. Less
+ * results are returned if the source does not send them fast enough, but at
+ * least one unless there are no more. Only one request can be pending at a
+ * time.
+ *
+ * Cancelling @cancellable cancels this request only, not the operation.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_result_stream_next_batch_async (GrlResultStream *stream,
+                                    guint max_items,
+                                    GCancellable *cancellable,
+                                    GAsyncReadyCallback callback,
+                                    gpointer user_data)
+{
+  g_return_if_fail (GRL_IS_RESULT_STREAM (stream));
+  g_return_if_fail (max_items > 0);
+
+  next_async (stream, max_items, cancellable, callback, user_data,
+              grl_result_stream_next_batch_async);
+}
+
+/**
+ * grl_result_stream_next_batch_finish:
+ * @stream: a result stream
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_result_stream_next_batch_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes a request started with grl_result_stream_next_batch_async().
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * following results, empty if there are no more, or %NULL on error. Use
+ * g_ptr_array_unref() after use.
+ *
+ * Since: 0.3.13
+ */
+GPtrArray *
+grl_result_stream_next_batch_finish (GrlResultStream *stream,
+                                     GAsyncResult *result,
+                                     GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, stream), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_result_stream_next_batch_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_result_stream_get_n_buffered:
+ * @stream: a result stream
+ *
+ * Gets how many results were received from the source and not requested yet.
+ *
+ * Returns: number of buffered results
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_result_stream_get_n_buffered (GrlResultStream *stream)
+{
+  g_return_val_if_fail (GRL_IS_RESULT_STREAM (stream), 0);
+
+  return g_queue_get_length (&stream->priv->buffer);
+}
+
+/**
+ * grl_result_stream_close:
+ * @stream: a result stream
+ *
+ * Cancels the operation and drops the results not requested yet. A pending
+ * request fails with %G_IO_ERROR_CLOSED, as will the following ones.
+ *
+ * It is called when the stream is disposed, but as the source keeps a
+ * reference while it is sending results, call it to stop the operation as
+ * soon as possible.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_result_stream_close (GrlResultStream *stream)
+{
+  GrlResultStreamPrivate *priv;
+
+  g_return_if_fail (GRL_IS_RESULT_STREAM (stream));
+
+  priv = stream->priv;
+  if (priv->closed) {
+    return;
+  }
+
+  priv->closed = TRUE;
+  buffer_clear (stream);
+
+  if (priv->operation_id != 0) {
+    grl_operation_cancel (priv->operation_id);
+  }
+
+  if (priv->pending) {
+    GTask *task = take_pending (stream);
+
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CLOSED,
+                             _("Stream is already closed"));
+    g_object_unref (task);
+  }
+}
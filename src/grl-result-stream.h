@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#if !defined (_GRILO_H_INSIDE_) && !defined (GRILO_COMPILATION)
+#error "Only <grilo.h> can be included directly."
+#endif
+
+#ifndef _GRL_RESULT_STREAM_H_
+#define _GRL_RESULT_STREAM_H_
+
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <grl-definitions.h>
+#include <grl-media.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GrlResultStreamPrivate GrlResultStreamPrivate;
+
+typedef struct {
+  GObject parent;
+
+  /*< private >*/
+  GrlResultStreamPrivate *priv;
+
+  gpointer _grl_reserved[GRL_PADDING_SMALL];
+} GrlResultStream;
+
+/**
+ * GrlResultStreamClass:
+ * @parent: the parent class structure
+ *
+ * Grilo Result Stream class.
+ */
+typedef struct {
+  GObjectClass parent;
+
+  /*< private >*/
+  gpointer _grl_reserved[GRL_PADDING];
+} GrlResultStreamClass;
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GrlResultStream, g_object_unref)
+
+#define GRL_TYPE_RESULT_STREAM (grl_result_stream_get_type ())
+#define GRL_RESULT_STREAM(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), GRL_TYPE_RESULT_STREAM, GrlResultStream))
+#define GRL_RESULT_STREAM_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass), GRL_TYPE_RESULT_STREAM, GrlResultStreamClass))
+#define GRL_IS_RESULT_STREAM(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GRL_TYPE_RESULT_STREAM))
+#define GRL_IS_RESULT_STREAM_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GRL_TYPE_RESULT_STREAM))
+#define GRL_RESULT_STREAM_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GRL_TYPE_RESULT_STREAM, GrlResultStreamClass))
+
+GType grl_result_stream_get_type (void);
+
+void grl_result_stream_next_async (GrlResultStream *stream,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data);
+
+GrlMedia *grl_result_stream_next_finish (GrlResultStream *stream,
+                                         GAsyncResult *result,
+                                         GError **error);
+
+void grl_result_stream_next_batch_async (GrlResultStream *stream,
+                                         guint max_items,
+                                         GCancellable *cancellable,
+                                         GAsyncReadyCallback callback,
+                                         gpointer user_data);
+
+GPtrArray *grl_result_stream_next_batch_finish (GrlResultStream *stream,
+                                                GAsyncResult *result,
+                                                GError **error);
+
+guint grl_result_stream_get_n_buffered (GrlResultStream *stream);
+
+void grl_result_stream_close (GrlResultStream *stream);
+
+G_END_DECLS
+
+#endif /* _GRL_RESULT_STREAM_H_ */
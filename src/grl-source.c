@@ -43,7 +43,10 @@
 #include "grl-marshal.h"
 #include "grl-type-builtins.h"
 #include "grl-sync-priv.h"
+#include "grl-resolve-cache-priv.h"
+#include "grl-result-stream-priv.h"
 #include "grl-registry.h"
+#include "grl-registry-priv.h"
 #include "grl-error.h"
 #include "grl-log.h"
 #include "data/grl-media.h"
@@ -63,6 +66,13 @@ enum {
   PROP_PLUGIN,
   PROP_RANK,
   PROP_AUTO_SPLIT_THRESHOLD,
+  PROP_AUTO_SPLIT_WINDOW,
+  PROP_AUTO_SPLIT_TARGET_LATENCY,
+  PROP_AUTO_SPLIT_TUNER_STATE,
+  PROP_THREAD_SAFE,
+  PROP_MAX_CONCURRENCY,
+  PROP_RESOLVE_BATCH_SIZE,
+  PROP_RESOLVE_BATCH_LATENCY,
   PROP_SUPPORTED_MEDIA,
   PROP_SOURCE_TAGS
 };
@@ -85,12 +95,30 @@ struct _GrlSourcePrivate {
   gint rank;
   GrlSupportedMedia supported_media;
   guint auto_split_threshold;
+  guint auto_split_window;
+  guint auto_split_target_latency;
+  guint auto_split_tuned;
+  guint auto_split_samples;
+  gdouble auto_split_latency;
+  gdouble auto_split_throughput;
+  gboolean thread_safe;
+  guint max_concurrency;
+  guint workers_running;
+  GQueue workers_pending;
+  guint resolve_batch_size;
+  guint resolve_batch_latency;
+  GList *resolve_batches;
+  GHashTable *resolve_plans;
+  guint resolve_plans_generation;
   GrlPlugin *plugin;
   GIcon *icon;
   GPtrArray *tags;
 };
 
+struct BrowseRelayCb;
+
 typedef struct {
+  struct BrowseRelayCb *brc;
   GrlMedia *media;
   gboolean is_ready;
   gint remaining;
@@ -103,6 +131,12 @@ typedef struct {
   gboolean being_queried;
 } MapNode;
 
+typedef struct {
+  GrlSource *source;
+  GList *required_keys;
+  gboolean dynamic;
+} PlanNode;
+
 struct AutoSplitCtl {
   gboolean chunk_first;
   guint chunk_requested;
@@ -111,14 +145,46 @@ struct AutoSplitCtl {
   guint count;
   guint total_remaining;
   guint chunk_remaining;
+  guint window;
+  guint next_skip;
+  guint unrequested;
+  GQueue *chunks;
+  GSource *promote_source;
+  gint64 chunk_started;
+  gint64 chunk_first_result;
+};
+
+struct AutoSplitChunk {
+  struct BrowseRelayCb *brc;
+  GrlSupportedOps operation_type;
+  guint operation_id;
+  guint count;
+  gboolean live;
+  gboolean done;
+  gint64 started;
+  gint64 first_result;
+  guint received;
+  GQueue *results;
+  union {
+    GrlSourceBrowseSpec *browse;
+    GrlSourceSearchSpec *search;
+    GrlSourceQuerySpec *query;
+  } spec;
 };
 
+typedef struct {
+  GrlMedia *media;
+  guint remaining;
+  GError *error;
+} AutoSplitResult;
+
 struct OperationState {
   GrlSource *source;
   guint operation_id;
   gboolean cancelled;
   gboolean completed;
   gboolean started;
+  struct AutoSplitCtl *auto_split;
 };
 
 struct ResolveRelayCb {
@@ -157,6 +223,20 @@ struct BrowseRelayCb {
   GQueue *queue;
   gboolean dispatcher_running;
   struct AutoSplitCtl *auto_split;
+  GSource *deadline_source;
+  gboolean timed_out;
+};
+
+struct BatchRelayCb {
+  GrlSource *source;
+  guint operation_id;
+  GPtrArray *medias;
+  guint batch_size;
+  guint batch_latency;
+  GSource *flush_source;
+  guint remaining;
+  GrlSourceResultBatchCb user_callback;
+  gpointer user_data;
 };
 
 struct RemoveRelayCb {
@@ -206,6 +286,9 @@ struct ResolveFullResolutionDoneCb {
 struct MediaDecorateData {
   GrlSource *source;
   guint operation_id;
+  GList *keys;
+  GrlOperationOptions *options;
+  GList *timed_out;
   GHashTable *pending_callbacks;
   MediaDecorateCb callback;
   gboolean cancelled;
@@ -232,6 +315,13 @@ static gboolean search_idle (gpointer user_data);
 
 static gboolean query_idle (gpointer user_data);
 
+static void browse_result_relay_cb (GrlSource *source,
+                                    guint operation_id,
+                                    GrlMedia *media,
+                                    guint remaining,
+                                    gpointer user_data,
+                                    const GError *error);
+
 static void run_store_metadata (GrlSource *source,
                                 GrlMedia *media,
                                 GList *keys,
@@ -241,6 +331,8 @@ static void run_store_metadata (GrlSource *source,
 
 static void map_list_nodes_free (GList *nodes);
 
+static void plan_nodes_free (GList *nodes);
+
 static void resolve_result_relay_cb (GrlSource *source,
                                      guint operation_id,
                                      GrlMedia *media,
@@ -253,6 +345,16 @@ static gboolean resolve_all_done (gpointer user_data);
 
 static void source_cancel_cb (struct OperationState *op_state);
 
+static void auto_split_cancel_chunks (struct AutoSplitCtl *as_ctl);
+
+static void auto_split_detach_chunks (struct BrowseRelayCb *brc);
+
+static void auto_split_tuner_reset (GrlSource *source);
+
+static GVariant *auto_split_tuner_get_state (GrlSource *source);
+
+static void worker_cancel (GrlSource *source, guint operation_id);
+
 /* ================ GrlSource GObject ================ */
 
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (GrlSource,
@@ -386,6 +488,132 @@ grl_source_class_init (GrlSourceClass *source_class)
                                                       0, G_MAXUINT, 0,
                                                       G_PARAM_READWRITE |
                                                       G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-window:
+   *
+   * Number of auto-split chunks that are requested to the source at the same
+   * time. Results are still delivered in order.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_WINDOW,
+                                   g_param_spec_uint ("auto-split-window",
+                                                      "Auto-split window",
+                                                      "Number of auto-split chunks requested in parallel",
+                                                      1, G_MAXUINT, 1,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-target-latency:
+   *
+   * Maximum time, in milliseconds, the source should take to send the first
+   * element of an auto-split chunk. If not 0, the size of the chunks is tuned
+   * at runtime, up to #GrlSource:auto-split-threshold.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_TARGET_LATENCY,
+                                   g_param_spec_uint ("auto-split-target-latency",
+                                                      "Auto-split target latency",
+                                                      "Target time to first result of auto-split chunks",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:auto-split-tuner-state:
+   *
+   * A dictionary with the state of the auto-split chunk size tuner:
+   * "chunk-size" (u), "target-latency" (u, in milliseconds),
+   * "first-result-latency" (d, in milliseconds), "throughput" (d, in elements
+   * per second) and "samples" (u). Latency and throughput are averages over the
+   * last chunks.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_AUTO_SPLIT_TUNER_STATE,
+                                   g_param_spec_variant ("auto-split-tuner-state",
+                                                         "Auto-split tuner state",
+                                                         "State of the auto-split chunk size tuner",
+                                                         G_VARIANT_TYPE_VARDICT,
+                                                         NULL,
+                                                         G_PARAM_READABLE |
+                                                         G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:thread-safe:
+   *
+   * Whether the browse, search, query, resolve and media_from_uri functions of
+   * the source can be run in other threads. If %TRUE, they are run on a thread
+   * pool shared by all the sources, instead of in the main context of the
+   * caller.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_THREAD_SAFE,
+                                   g_param_spec_boolean ("thread-safe",
+                                                         "Thread safe",
+                                                         "Whether operations can run in other threads",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT |
+                                                         G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:max-concurrency:
+   *
+   * Maximum number of operations of a thread-safe source that run at the same
+   * time in the thread pool, or 0 for no limit.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_MAX_CONCURRENCY,
+                                   g_param_spec_uint ("max-concurrency",
+                                                      "Maximum concurrency",
+                                                      "Maximum number of operations running in parallel",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:resolve-batch-size:
+   *
+   * Maximum number of resolutions passed at once to the resolve_batch()
+   * function of the source. It is only used by sources implementing it that
+   * are not thread-safe.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_RESOLVE_BATCH_SIZE,
+                                   g_param_spec_uint ("resolve-batch-size",
+                                                      "Resolve batch size",
+                                                      "Maximum number of media resolved at once",
+                                                      1, G_MAXUINT, 50,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT |
+                                                      G_PARAM_STATIC_STRINGS));
+  /**
+   * GrlSource:resolve-batch-latency:
+   *
+   * Time, in milliseconds, that resolutions wait for others to be passed
+   * together to the resolve_batch() function of the source. It is only used by
+   * sources implementing it.
+   *
+   * Since: 0.3.13
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_RESOLVE_BATCH_LATENCY,
+                                   g_param_spec_uint ("resolve-batch-latency",
+                                                      "Resolve batch latency",
+                                                      "Time to wait for more media to resolve at once",
+                                                      0, G_MAXUINT, 10,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT |
+                                                      G_PARAM_STATIC_STRINGS));
   /**
    * GrlSource:supported-media:
    *
@@ -516,11 +744,28 @@ grl_source_class_init (GrlSourceClass *source_class)
                  G_TYPE_BOOLEAN);
 }
 
+static void
+content_changed_cb (GrlSource *source,
+                    GPtrArray *changed_medias,
+                    GrlSourceChangeType change_type,
+                    gboolean location_unknown,
+                    gpointer user_data)
+{
+  /* Cached metadata coming from this source may be stale now */
+  grl_resolve_cache_invalidate_source (grl_source_get_id (source), TRUE);
+}
+
 static void
 grl_source_init (GrlSource *source)
 {
   source->priv = grl_source_get_instance_private (source);
   source->priv->tags = g_ptr_array_new_with_free_func (g_free);
+  source->priv->resolve_plans =
+    g_hash_table_new_full (g_str_hash, g_str_equal,
+                           g_free, (GDestroyNotify) plan_nodes_free);
+
+  g_signal_connect (source, "content-changed",
+                    G_CALLBACK (content_changed_cb), NULL);
 }
 
 static void
@@ -540,6 +785,7 @@ grl_source_finalize (GObject *object)
 
   g_clear_object (&source->priv->icon);
   g_clear_pointer (&source->priv->tags, g_ptr_array_unref);
+  g_clear_pointer (&source->priv->resolve_plans, g_hash_table_unref);
   g_free (source->priv->id);
   g_free (source->priv->name);
   g_free (source->priv->desc);
@@ -599,7 +845,25 @@ grl_source_set_property (GObject *object,
     source->priv->rank = g_value_get_int (value);
     break;
   case PROP_AUTO_SPLIT_THRESHOLD:
-    source->priv->auto_split_threshold = g_value_get_uint (value);
+    grl_source_set_auto_split_threshold (source, g_value_get_uint (value));
+    break;
+  case PROP_AUTO_SPLIT_WINDOW:
+    source->priv->auto_split_window = g_value_get_uint (value);
+    break;
+  case PROP_AUTO_SPLIT_TARGET_LATENCY:
+    grl_source_set_auto_split_target_latency (source, g_value_get_uint (value));
+    break;
+  case PROP_THREAD_SAFE:
+    source->priv->thread_safe = g_value_get_boolean (value);
+    break;
+  case PROP_MAX_CONCURRENCY:
+    grl_source_set_max_concurrency (source, g_value_get_uint (value));
+    break;
+  case PROP_RESOLVE_BATCH_SIZE:
+    grl_source_set_resolve_batch_size (source, g_value_get_uint (value));
+    break;
+  case PROP_RESOLVE_BATCH_LATENCY:
+    grl_source_set_resolve_batch_latency (source, g_value_get_uint (value));
     break;
   case PROP_SUPPORTED_MEDIA:
     source->priv->supported_media = g_value_get_flags (value);
@@ -645,6 +909,27 @@ grl_source_get_property (GObject *object,
   case PROP_AUTO_SPLIT_THRESHOLD:
     g_value_set_uint (value, source->priv->auto_split_threshold);
     break;
+  case PROP_AUTO_SPLIT_WINDOW:
+    g_value_set_uint (value, source->priv->auto_split_window);
+    break;
+  case PROP_AUTO_SPLIT_TARGET_LATENCY:
+    g_value_set_uint (value, source->priv->auto_split_target_latency);
+    break;
+  case PROP_AUTO_SPLIT_TUNER_STATE:
+    g_value_take_variant (value, auto_split_tuner_get_state (source));
+    break;
+  case PROP_THREAD_SAFE:
+    g_value_set_boolean (value, source->priv->thread_safe);
+    break;
+  case PROP_MAX_CONCURRENCY:
+    g_value_set_uint (value, source->priv->max_concurrency);
+    break;
+  case PROP_RESOLVE_BATCH_SIZE:
+    g_value_set_uint (value, source->priv->resolve_batch_size);
+    break;
+  case PROP_RESOLVE_BATCH_LATENCY:
+    g_value_set_uint (value, source->priv->resolve_batch_latency);
+    break;
   case PROP_SUPPORTED_MEDIA:
     g_value_set_flags (value, source->priv->supported_media);
     break;
@@ -1083,6 +1368,17 @@ source_cancel_cb (struct OperationState *op_state)
     GRL_SOURCE_GET_CLASS (source)->cancel (source,
                                            op_state->operation_id);
   }
+
+  /* Operations running in a worker are finished by the core once the source
+     function returns, even if the source never sends the last result */
+  if (source->priv->thread_safe) {
+    worker_cancel (source, op_state->operation_id);
+  }
+
+  /* Prefetched auto-split chunks run as operations on their own */
+  if (op_state->auto_split) {
+    auto_split_cancel_chunks (op_state->auto_split);
+  }
 }
 
 static void
@@ -1189,10 +1485,18 @@ resolve_relay_free (struct ResolveRelayCb *rrc)
 static void
 browse_relay_free (struct BrowseRelayCb *brc)
 {
+  auto_split_detach_chunks (brc);
+  if (brc->deadline_source) {
+    g_source_destroy (brc->deadline_source);
+  }
   g_object_unref (brc->source);
   g_object_unref (brc->options);
   g_list_free (brc->keys);
   if (brc->auto_split) {
+    if (brc->auto_split->promote_source) {
+      g_source_destroy (brc->auto_split->promote_source);
+    }
+    g_clear_pointer (&brc->auto_split->chunks, g_queue_free);
     g_slice_free (struct AutoSplitCtl, brc->auto_split);
   }
   g_clear_pointer (&brc->queue, g_queue_free);
@@ -1200,6 +1504,37 @@ browse_relay_free (struct BrowseRelayCb *brc)
   g_slice_free (struct BrowseRelayCb, brc);
 }
 
+static struct BatchRelayCb *
+batch_relay_new (GrlSource *source,
+                 GrlOperationOptions *options,
+                 GrlSourceResultBatchCb callback,
+                 gpointer user_data)
+{
+  struct BatchRelayCb *bth;
+
+  bth = g_slice_new0 (struct BatchRelayCb);
+  bth->source = g_object_ref (source);
+  bth->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  bth->batch_size = grl_operation_options_get_batch_size (options);
+  bth->batch_latency = grl_operation_options_get_batch_latency (options);
+  bth->user_callback = callback;
+  bth->user_data = user_data;
+
+  return bth;
+}
+
+static void
+batch_relay_free (struct BatchRelayCb *bth)
+{
+  if (bth->flush_source) {
+    g_source_destroy (bth->flush_source);
+  }
+  g_object_unref (bth->source);
+  g_ptr_array_unref (bth->medias);
+
+  g_slice_free (struct BatchRelayCb, bth);
+}
+
 static void
 remove_relay_free (struct RemoveRelayCb *rrc)
 {
@@ -1273,6 +1608,262 @@ source_supports (GrlSource *source,
   return TRUE;
 }
 
+/*
+ * Returns %TRUE if @key is a slow key for @source
+ */
+static gboolean
+is_slow_key (GrlSource *source, GrlKeyID key)
+{
+  return (g_list_find ((GList *) grl_source_slow_keys (source),
+                       GRLKEYID_TO_POINTER (key)) != NULL);
+}
+
+/*
+ * Resolution plans.
+ *
+ * Working out which sources can resolve a key walks the ranked list of
+ * sources and asks each of them for its supported and slow keys. For sources
+ * relying on the default may_resolve() the answer only depends on the key, the
+ * source the media comes from and the set of registered sources, so it is
+ * computed once per main source and kept until the registry changes.
+ *
+ * Sources providing their own may_resolve() can look at anything in the media;
+ * they keep their place in the plan but are marked as dynamic and asked again
+ * every time.
+ */
+
+G_LOCK_DEFINE_STATIC (resolve_plans);
+static GList *resolve_plans_sources = NULL;
+static guint resolve_plans_sources_generation = 0;
+
+static PlanNode *
+plan_node_new (GrlSource *source, GList *required_keys, gboolean dynamic)
+{
+  PlanNode *node = g_slice_new (PlanNode);
+
+  node->source = source;
+  node->required_keys = required_keys;
+  node->dynamic = dynamic;
+
+  return node;
+}
+
+static void
+plan_node_free (PlanNode *node)
+{
+  g_list_free (node->required_keys);
+  g_slice_free (PlanNode, node);
+}
+
+/* Frees nodes stored in a plan; they do not own their source */
+static void
+plan_nodes_free (GList *nodes)
+{
+  g_list_free_full (nodes, (GDestroyNotify) plan_node_free);
+}
+
+/* Frees nodes returned by resolve_plan_get() */
+static void
+plan_nodes_free_full (GList *nodes)
+{
+  GList *iter;
+
+  for (iter = nodes; iter; iter = g_list_next (iter))
+    g_object_unref (((PlanNode *) iter->data)->source);
+
+  plan_nodes_free (nodes);
+}
+
+static GList *
+plan_nodes_copy (GList *nodes)
+{
+  GList *copy = NULL;
+  GList *iter;
+
+  for (iter = nodes; iter; iter = g_list_next (iter)) {
+    PlanNode *node = (PlanNode *) iter->data;
+
+    copy = g_list_prepend (copy,
+                           plan_node_new (g_object_ref (node->source),
+                                          g_list_copy (node->required_keys),
+                                          node->dynamic));
+  }
+
+  return g_list_reverse (copy);
+}
+
+/*
+ * Returns whether the source in @node can resolve @key in @media directly. If
+ * it cannot, @required_keys is set to the keys it would need.
+ */
+static gboolean
+plan_node_may_resolve (PlanNode *node,
+                       GrlMedia *media,
+                       GrlKeyID key,
+                       GList **required_keys)
+{
+  if (node->dynamic) {
+    return grl_source_may_resolve (node->source, media, key, required_keys);
+  }
+
+  *required_keys = g_list_copy (node->required_keys);
+
+  return node->required_keys == NULL;
+}
+
+/*
+ * Returns the ranked list of sources supporting resolve(). The list must be
+ * freed with g_list_free().
+ */
+static GList *
+resolve_plans_get_sources (void)
+{
+  GrlRegistry *registry;
+  GList *sources;
+  guint generation;
+
+  registry = grl_registry_get_default ();
+  generation = grl_registry_get_sources_generation (registry);
+
+  G_LOCK (resolve_plans);
+  if (resolve_plans_sources_generation == generation) {
+    sources = g_list_copy (resolve_plans_sources);
+    G_UNLOCK (resolve_plans);
+    return sources;
+  }
+  G_UNLOCK (resolve_plans);
+
+  sources = grl_registry_get_sources_by_operations (registry,
+                                                    GRL_OP_RESOLVE,
+                                                    TRUE);
+
+  G_LOCK (resolve_plans);
+  g_list_free (resolve_plans_sources);
+  resolve_plans_sources = g_list_copy (sources);
+  resolve_plans_sources_generation = generation;
+  G_UNLOCK (resolve_plans);
+
+  return sources;
+}
+
+/*
+ * Returns the sources to consider when resolving from @source: only @source
+ * itself, or if @full is %TRUE all the resolvers, with @source on top.
+ */
+static GList *
+resolve_plan_get_sources (GrlSource *source, gboolean full)
+{
+  GList *sources = NULL;
+  gboolean can_resolve;
+
+  can_resolve = grl_source_supported_operations (source) & GRL_OP_RESOLVE;
+
+  if (full) {
+    sources = resolve_plans_get_sources ();
+    /* Put current source on top, if it supports resolve() */
+    if (can_resolve) {
+      sources = g_list_remove (sources, source);
+      sources = g_list_prepend (sources, source);
+    }
+  } else if (can_resolve) {
+    sources = g_list_prepend (NULL, source);
+  }
+
+  return sources;
+}
+
+static GList *
+resolve_plan_compute (GList *sources,
+                      GrlMedia *media,
+                      GrlKeyID key,
+                      gboolean filter_slow_keys)
+{
+  GList *plan = NULL;
+  GList *iter;
+
+  for (iter = sources; iter; iter = g_list_next (iter)) {
+    GrlSource *_source = (GrlSource *) iter->data;
+    GList *required_keys = NULL;
+
+    if (filter_slow_keys && is_slow_key (_source, key)) {
+      continue;
+    }
+
+    if (GRL_SOURCE_GET_CLASS (_source)->may_resolve) {
+      plan = g_list_prepend (plan, plan_node_new (_source, NULL, TRUE));
+    } else if (grl_source_may_resolve (_source, media, key, &required_keys) ||
+               required_keys) {
+      plan = g_list_prepend (plan,
+                             plan_node_new (_source, required_keys, FALSE));
+    }
+  }
+
+  return g_list_reverse (plan);
+}
+
+/*
+ * Returns, in order, the sources that may resolve @key in @media when
+ * resolving from @source. The plan is built the first time and reused until
+ * the set of registered sources or their ranks change.
+ *
+ * Free the result with plan_nodes_free_full().
+ */
+static GList *
+resolve_plan_get (GrlSource *source,
+                  GrlMedia *media,
+                  GrlKeyID key,
+                  gboolean full,
+                  gboolean filter_slow_keys)
+{
+  GList *plan, *sources, *result;
+  const gchar *media_source;
+  gchar *plan_key;
+  guint generation;
+
+  media_source = media? grl_media_get_source (media): NULL;
+  plan_key = g_strdup_printf ("%u:%d:%d:%d:%s",
+                              key, full, filter_slow_keys,
+                              media_source != NULL,
+                              media_source? media_source: "");
+  generation =
+    grl_registry_get_sources_generation (grl_registry_get_default ());
+
+  G_LOCK (resolve_plans);
+  if (source->priv->resolve_plans_generation != generation) {
+    g_hash_table_remove_all (source->priv->resolve_plans);
+    source->priv->resolve_plans_generation = generation;
+  }
+
+  if (g_hash_table_lookup_extended (source->priv->resolve_plans, plan_key,
+                                    NULL, (gpointer *) &plan)) {
+    result = plan_nodes_copy (plan);
+    G_UNLOCK (resolve_plans);
+    g_free (plan_key);
+    return result;
+  }
+  G_UNLOCK (resolve_plans);
+
+  GRL_DEBUG ("Building resolution plan for %s in %s",
+             GRL_METADATA_KEY_GET_NAME (key),
+             grl_source_get_id (source));
+
+  sources = resolve_plan_get_sources (source, full);
+  plan = resolve_plan_compute (sources, media, key, filter_slow_keys);
+  g_list_free (sources);
+  result = plan_nodes_copy (plan);
+
+  G_LOCK (resolve_plans);
+  if (source->priv->resolve_plans_generation == generation) {
+    g_hash_table_insert (source->priv->resolve_plans, plan_key, plan);
+  } else {
+    g_free (plan_key);
+    plan_nodes_free (plan);
+  }
+  G_UNLOCK (resolve_plans);
+
+  return result;
+}
+
 /*
  * Find the source that should be queried to add @key to @media.
  * If @additional_keys is provided, the result may include sources that need
@@ -1286,50 +1877,60 @@ source_supports (GrlSource *source,
  * considered. Sources that need other additional keys will not be put in the
  * returned list.
  *
- * @source will never be considered as additional source.
- *
- * @source and @additional_keys may not be @NULL if
- * @main_source_is_only_resolver is @TRUE.
+ * @source will never be considered as additional source, and may not be
+ * @NULL. @additional_keys may not be @NULL if @main_source_is_only_resolver is
+ * @TRUE. Sources in @skip are not considered either.
  *
  * Assumes @key is not already in @media.
  */
 static GrlSource *
 get_additional_source_for_key (GrlSource *source,
-                               GList *sources,
                                GrlMedia *media,
                                GrlKeyID key,
                                GList **additional_keys,
-                               gboolean main_source_is_only_resolver)
+                               gboolean main_source_is_only_resolver,
+                               GList *skip)
 {
-  GList *iter;
+  GList *plan, *iter;
+  GrlSource *result = NULL;
 
-  g_return_val_if_fail (source || !main_source_is_only_resolver, NULL);
+  g_return_val_if_fail (source, NULL);
   g_return_val_if_fail (additional_keys || !main_source_is_only_resolver, NULL);
 
-  for (iter = sources; iter; iter = g_list_next (iter)) {
+  plan = resolve_plan_get (source, media, key, TRUE, FALSE);
+
+  for (iter = plan; iter; iter = g_list_next (iter)) {
     GList *_additional_keys = NULL;
-    GrlSource *_source = (GrlSource *) iter->data;
+    PlanNode *node = (PlanNode *) iter->data;
 
-    if (_source == source) {
+    if (node->source == source || g_list_find (skip, node->source)) {
       continue;
     }
 
-    if (grl_source_may_resolve (_source, media, key, &_additional_keys)) {
-      return _source;
+    if (plan_node_may_resolve (node, media, key, &_additional_keys)) {
+      result = node->source;
+      break;
     }
 
     if (additional_keys && _additional_keys) {
       if (main_source_is_only_resolver &&
-          !source_supports (source, _additional_keys))
+          !source_supports (source, _additional_keys)) {
+        g_list_free (_additional_keys);
         continue;
+      }
 
       *additional_keys = _additional_keys;
-      return _source;
+      result = node->source;
+      break;
     }
+
+    g_list_free (_additional_keys);
   }
 
-  return NULL;
-}
+  plan_nodes_free_full (plan);
+
+  return result;
+}
 
 /*
  * Does the same thing as g_list_concat(), except that elements from
@@ -1380,35 +1981,31 @@ list_union (GList *original_set, GList *additional_set, GDestroyNotify free_func
  * considered. Sources that need other additional keys will not be put in the
  * returned list.
  *
- * Ignore elements of @keys that are already in @media.
+ * Ignore elements of @keys that are already in @media, and sources in @skip.
  */
 static GList *
 get_additional_sources (GrlSource *source,
                         GrlMedia *media,
                         GList *keys,
                         GList **additional_keys,
-                        gboolean main_source_is_only_resolver)
+                        gboolean main_source_is_only_resolver,
+                        GList *skip)
 {
-  GList *missing_keys, *iter, *result = NULL, *sources;
-  GrlRegistry *registry;
+  GList *missing_keys, *iter, *result = NULL;
 
   missing_keys = missing_in_data (GRL_DATA (media), keys);
   if (!missing_keys)
     return NULL;
 
-  registry = grl_registry_get_default ();
-  sources = grl_registry_get_sources_by_operations (registry,
-                                                    GRL_OP_RESOLVE,
-                                                    TRUE);
-
   for (iter = missing_keys; iter; iter = g_list_next (iter)) {
     GrlKeyID key = GRLPOINTER_TO_KEYID (iter->data);
     GrlSource *_source;
     GList *needed_keys = NULL;
 
-    _source = get_additional_source_for_key (source, sources, media, key,
+    _source = get_additional_source_for_key (source, media, key,
                                              additional_keys?&needed_keys:NULL,
-                                             main_source_is_only_resolver);
+                                             main_source_is_only_resolver,
+                                             skip);
     if (_source) {
       result = g_list_append (result, _source);
 
@@ -1463,7 +2060,7 @@ expand_operation_keys (GrlSource *source,
 
   sources =
     get_additional_sources (source, media, unsupported_keys,
-                            &additional_keys, TRUE);
+                            &additional_keys, TRUE, NULL);
   g_list_free (sources);
 
   /* Merge back the supported and unsupported list, and add also the additional keys */
@@ -1473,16 +2070,6 @@ expand_operation_keys (GrlSource *source,
   return keys;
 }
 
-/*
- * Returns %TRUE if @key is a slow key for @source
- */
-static gboolean
-is_slow_key (GrlSource *source, GrlKeyID key)
-{
-  return (g_list_find ((GList *) grl_source_slow_keys (source),
-                       GRLKEYID_TO_POINTER (key)) != NULL);
-}
-
 /*
  * Create a node for the map keys
  */
@@ -1528,14 +2115,19 @@ map_keys_new (void)
 }
 
 /*
- * Maps each key in @keys to the list of sources (from @sources) that can
- * resolve that key. For each of those (key, source) pair, a list of keys
- * dependencies is added
+ * Maps each key in @keys to the list of sources that can resolve that key when
+ * resolving from @source (see resolve_plan_get_sources()). For each of those
+ * (key, source) pair, a list of keys dependencies is added
  */
 static void
-map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *media, gboolean filter_slow_keys)
-{
-  GList *each_source;
+map_keys_to_sources (GHashTable *map,
+                     GList *keys,
+                     GrlSource *source,
+                     GrlMedia *media,
+                     gboolean full,
+                     gboolean filter_slow_keys)
+{
+  GList *plan, *each_node;
   GList *resolvable_sources;
   GList *each_key;
   GList *required_keys;
@@ -1549,31 +2141,34 @@ map_keys_to_sources (GHashTable *map, GList *keys, GList *sources, GrlMedia *med
       continue;
     }
     resolvable_sources = NULL;
-    for (each_source = sources;
-         each_source;
-         each_source = g_list_next (each_source)) {
-      if (filter_slow_keys &&
-          is_slow_key (each_source->data, GRLPOINTER_TO_KEYID (each_key->data))) {
-        continue;
-      }
+    plan = resolve_plan_get (source, media,
+                             GRLPOINTER_TO_KEYID (each_key->data),
+                             full, filter_slow_keys);
+    for (each_node = plan;
+         each_node;
+         each_node = g_list_next (each_node)) {
+      PlanNode *node = (PlanNode *) each_node->data;
+
       required_keys = NULL;
-      if (grl_source_may_resolve (each_source->data,
-                                  media,
-                                  GRLPOINTER_TO_KEYID (each_key->data),
-                                  &required_keys)) {
-        resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (each_source->data, NULL));
+      if (plan_node_may_resolve (node,
+                                 media,
+                                 GRLPOINTER_TO_KEYID (each_key->data),
+                                 &required_keys)) {
+        resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (node->source, NULL));
       } else if (required_keys) {
-        resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (each_source->data, required_keys));
+        resolvable_sources = g_list_prepend (resolvable_sources, map_node_new (node->source, required_keys));
         keys_to_map_later = g_list_concat (keys_to_map_later, required_keys);
       }
     }
+    plan_nodes_free_full (plan);
 
     resolvable_sources = g_list_reverse (resolvable_sources);
     g_hash_table_insert (map, each_key->data, resolvable_sources);
   }
 
   if (keys_to_map_later) {
-    map_keys_to_sources (map, keys_to_map_later, sources, media, filter_slow_keys);
+    map_keys_to_sources (map, keys_to_map_later, source, media,
+                         full, filter_slow_keys);
     g_list_free (keys_to_map_later);
   }
 }
@@ -1791,6 +2386,49 @@ send_decorated_media (GrlMedia *media,
   resolve_relay_free (mrc);
 }
 
+static void media_decorate_cb (GrlSource *source,
+                               guint operation_id,
+                               GrlMedia *media,
+                               gpointer user_data,
+                               const GError *error);
+
+/* Asks the missing keys to the sources able to resolve them, except the ones
+   already asked or that did not answer in time */
+static void
+media_decorate_run (struct MediaDecorateData *mdd,
+                    GrlMedia *media)
+{
+  GList *s, *sources;
+  guint operation_id;
+  GrlOperationOptions *supported_options;
+
+  sources = get_additional_sources (mdd->source, media,
+                                    mdd->keys, NULL, FALSE, mdd->timed_out);
+
+  for (s = sources; s; s = g_list_next (s)) {
+    if (g_hash_table_contains (mdd->pending_callbacks, s->data)) {
+      continue;
+    }
+    if (grl_source_supported_operations (s->data) & GRL_OP_RESOLVE) {
+      grl_operation_options_obey_caps (mdd->options,
+                                       grl_source_get_caps (s->data, GRL_OP_RESOLVE),
+                                       &supported_options,
+                                       NULL);
+      operation_id = grl_source_resolve (s->data, media, mdd->keys,
+                                         supported_options,
+                                         media_decorate_cb, mdd);
+      g_object_unref (supported_options);
+      if (operation_id > 0) {
+        g_hash_table_insert (mdd->pending_callbacks,
+                             s->data,
+                             GUINT_TO_POINTER (operation_id));
+      }
+    }
+  }
+
+  g_list_free (sources);
+}
+
 static void
 media_decorate_cb (GrlSource *source,
                    guint operation_id,
@@ -1813,6 +2451,14 @@ media_decorate_cb (GrlSource *source,
     g_hash_table_foreach (mdd->pending_callbacks, cancel_resolve, NULL);
   }
 
+  /* Skip a source that did not answer in time, and try the next one */
+  if (!mdd->cancelled &&
+      g_error_matches (error, GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_OPERATION_TIMED_OUT)) {
+    mdd->timed_out = g_list_prepend (mdd->timed_out, g_object_ref (source));
+    media_decorate_run (mdd, media);
+  }
+
   /* If all operations are complete, send the element */
   if (g_hash_table_size (mdd->pending_callbacks) == 0) {
     if (mdd->cancelled) {
@@ -1823,6 +2469,9 @@ media_decorate_cb (GrlSource *source,
     mdd->callback (media, mdd->user_data, _error);
     g_clear_error (&_error);
     g_object_unref (mdd->source);
+    g_object_unref (mdd->options);
+    g_list_free (mdd->keys);
+    g_list_free_full (mdd->timed_out, g_object_unref);
     g_hash_table_unref (mdd->pending_callbacks);
     g_slice_free (struct MediaDecorateData, mdd);
   }
@@ -1838,12 +2487,17 @@ media_decorate (GrlSource *main_source,
                 gpointer user_data)
 {
   struct MediaDecorateData *mdd;
-  GList *s, *sources;
-  guint operation_id;
   GrlOperationOptions *decorate_options;
-  GrlOperationOptions *supported_options;
   GrlResolutionFlags flags;
 
+  /* Only ask the sources for what is not in the cache */
+  if (grl_resolve_cache_is_enabled ()) {
+    grl_resolve_cache_fill (media, keys);
+    keys = filter_known_keys (media, keys);
+  } else {
+    keys = g_list_copy (keys);
+  }
+
   flags = grl_operation_options_get_resolution_flags (options);
   if (flags & GRL_RESOLVE_FULL) {
     decorate_options = grl_operation_options_copy (options);
@@ -1853,41 +2507,23 @@ media_decorate (GrlSource *main_source,
     decorate_options = g_object_ref (options);
   }
 
-  sources = get_additional_sources (main_source, media,
-                                    keys, NULL, FALSE);
-
   mdd = g_slice_new (struct MediaDecorateData);
   mdd->source = g_object_ref (main_source);
   mdd->operation_id = main_operation_id;
+  mdd->keys = keys;
+  mdd->options = decorate_options;
+  mdd->timed_out = NULL;
   mdd->callback = callback;
   mdd->user_data = user_data;
   mdd->pending_callbacks = g_hash_table_new (g_direct_hash, g_direct_equal);
   mdd->cancelled = FALSE;
 
-  for (s = sources; s; s = g_list_next (s)) {
-    if (grl_source_supported_operations (s->data) & GRL_OP_RESOLVE) {
-      grl_operation_options_obey_caps (decorate_options,
-                                       grl_source_get_caps (s->data, GRL_OP_RESOLVE),
-                                       &supported_options,
-                                       NULL);
-      operation_id = grl_source_resolve (s->data, media, keys, supported_options,
-                                         media_decorate_cb, mdd);
-      g_object_unref (supported_options);
-      if (operation_id > 0) {
-        g_hash_table_insert (mdd->pending_callbacks,
-                             s->data,
-                             GUINT_TO_POINTER (operation_id));
-      }
-    }
-  }
+  media_decorate_run (mdd, media);
 
   /* Check if nobody can solve the keys */
   if (g_hash_table_size (mdd->pending_callbacks) == 0) {
     media_decorate_cb (NULL, 0, media, mdd, NULL);
   }
-
-  g_object_unref (decorate_options);
-  g_list_free (sources);
 }
 
 static void
@@ -1977,6 +2613,8 @@ resolve_result_relay_cb (GrlSource *source,
     each_key = rrc->keys;
     while (each_key) {
       if (grl_data_has_key (GRL_DATA (media), GRLPOINTER_TO_KEYID (each_key->data))) {
+        grl_resolve_cache_store (media, GRLPOINTER_TO_KEYID (each_key->data),
+                                 grl_source_get_id (source));
         map_update_known_key (rrc->map, GRLPOINTER_TO_KEYID (each_key->data), media);
         delete_key = each_key;
         each_key = g_list_next (each_key);
@@ -2023,21 +2661,21 @@ resolve_result_relay_cb (GrlSource *source,
 
     rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
     if (rrc->specs_to_invoke) {
-      guint id;
-      id = g_idle_add_full (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
-                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                            resolve_idle,
-                            rrc,
-                            NULL);
-      g_source_set_name_by_id (id, "[grilo] resolve_idle");
+      grl_operation_idle_add (rrc->operation_id,
+                              grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
+                              G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                              resolve_idle,
+                              rrc,
+                              NULL,
+                              "[grilo] resolve_idle");
     } else {
-      guint id;
-      id = g_idle_add_full (grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
-                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                            resolve_all_done,
-                            rrc,
-                            NULL);
-      g_source_set_name_by_id (id, "[grilo] resolve_all_done");
+      grl_operation_idle_add (rrc->operation_id,
+                              grl_operation_options_get_resolution_flags (rrc->options) & GRL_RESOLVE_IDLE_RELAY?
+                              G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                              resolve_all_done,
+                              rrc,
+                              NULL,
+                              "[grilo] resolve_all_done");
     }
   }
 }
@@ -2048,10 +2686,13 @@ queue_process (gpointer user_data)
   QueueElement *qelement;
   GError *error;
   gint remaining;
+  guint batch_size;
+  guint sent;
   struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
 
-  /* Check if operation is cancelled */
-  if (operation_is_cancelled (brc->operation_id)) {
+  /* Check if operation is cancelled. Operations that timed out are cancelled
+     too, but the results in the queue are still sent to the user */
+  if (operation_is_cancelled (brc->operation_id) && !brc->timed_out) {
     /* This is how this works: if operation is cancelled, no one will add more
        elements to queue. If one with remaining=0 is found, means that the
        browse/search/query operation finished before operation is cancelled. So we
@@ -2082,23 +2723,37 @@ queue_process (gpointer user_data)
     return FALSE;
   }
 
-  /* Send the last element */
-  qelement = (QueueElement *) g_queue_pop_head (brc->queue);
-  remaining = qelement->remaining;
-  brc->user_callback (brc->source, brc->operation_id, qelement->media,
-                      remaining, brc->user_data, qelement->error);
-  g_clear_error (&qelement->error);
-  g_free (qelement);
+  /* Send up to batch-size ready elements in this iteration */
+  batch_size = MAX (1, grl_operation_options_get_batch_size (brc->options));
+  for (sent = 0; sent < batch_size; sent++) {
+    qelement = (QueueElement *) g_queue_pop_head (brc->queue);
+    remaining = qelement->remaining;
+    brc->user_callback (brc->source, brc->operation_id, qelement->media,
+                        remaining, brc->user_data, qelement->error);
+    g_clear_error (&qelement->error);
+    g_free (qelement);
 
-  if (remaining == 0) {
-    operation_set_finished (brc->operation_id);
-    browse_relay_free (brc);
-    return FALSE;
-  }
+    if (remaining == 0) {
+      /* If the deadline expired, the source may still be using it */
+      if (operation_is_completed (brc->operation_id)) {
+        operation_set_finished (brc->operation_id);
+        browse_relay_free (brc);
+      } else {
+        brc->dispatcher_running = FALSE;
+      }
+      return FALSE;
+    }
+
+    /* Check if should keep running */
+    qelement = (QueueElement *) g_queue_peek_head (brc->queue);
+    brc->dispatcher_running = qelement && qelement->is_ready;
 
-  /* Check if should keep running */
-  qelement = (QueueElement *) g_queue_peek_head (brc->queue);
-  brc->dispatcher_running = qelement && qelement->is_ready;
+    /* Let the next iteration deal with the cancellation */
+    if (!brc->dispatcher_running ||
+        operation_is_cancelled (brc->operation_id)) {
+      break;
+    }
+  }
 
   return brc->dispatcher_running;
 }
@@ -2111,40 +2766,30 @@ queue_start_process (struct BrowseRelayCb *brc)
   if (!brc->dispatcher_running) {
     qelement = g_queue_peek_head (brc->queue);
     if (qelement && qelement->is_ready) {
-      guint id = g_idle_add (queue_process,  brc);
-      g_source_set_name_by_id (id, "[grilo] queue_process");
+      grl_operation_idle_add (brc->operation_id,
+                              G_PRIORITY_DEFAULT_IDLE,
+                              queue_process,
+                              brc,
+                              NULL,
+                              "[grilo] queue_process");
       brc->dispatcher_running = TRUE;
     }
   }
 }
 
-static gint
-compare_queue_element (QueueElement *qelement,
-                       GrlMedia *media)
-{
-  return qelement->media != media;	//return 0 when equal
-}
-
 static void
 media_ready_cb (GrlMedia *media,
                 gpointer user_data,
                 const GError *error)
 {
-  GList *element;
-  QueueElement *qelement;
-  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  QueueElement *qelement = (QueueElement *) user_data;
 
-  /* Mark element as ready */
-  element = g_queue_find_custom (brc->queue, media,
-                                 (GCompareFunc) compare_queue_element);
-  if (!element) {
-    GRL_WARNING ("Media not found in the queue!");
-    return;
-  }
-
-  qelement = (QueueElement *) element->data;
+  /* Mark element as ready. The element is handed to media_decorate() as
+     user_data, so there is no need to look it up in the queue; it can not be
+     freed before being ready, as the queue is only consumed from the head
+     while elements are ready */
   qelement->is_ready = TRUE;
-  queue_start_process (brc);
+  queue_start_process (qelement->brc);
 }
 
 static void
@@ -2162,6 +2807,7 @@ queue_add_media (struct BrowseRelayCb *brc,
 
   /* Add element */
   qelement = g_new (QueueElement, 1);
+  qelement->brc = brc;
   qelement->media = media;
   qelement->remaining = remaining;
   /* Media is ready if we do not need to ask other sources to complete it */
@@ -2181,27 +2827,212 @@ queue_add_media (struct BrowseRelayCb *brc,
 
   if (!qelement->is_ready) {
     media_decorate (brc->source, brc->operation_id, media, unknown_keys,
-                    brc->options, media_ready_cb, brc);
+                    brc->options, media_ready_cb, qelement);
   }
 
   queue_start_process (brc);
 }
 
+static gboolean
+browse_deadline_cb (gpointer user_data)
+{
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  struct OperationState *op_state;
+  QueueElement *qelement;
+  GError *error;
+
+  brc->deadline_source = NULL;
+
+  /* Nothing to do if the source already finished */
+  op_state = grl_operation_get_private_data (brc->operation_id);
+  if (!op_state || op_state->cancelled || op_state->completed) {
+    return G_SOURCE_REMOVE;
+  }
+
+  GRL_INFO ("operation %u in '%s' did not complete in %u ms, cancelling it",
+            brc->operation_id,
+            grl_source_get_id (brc->source),
+            grl_operation_options_get_deadline (brc->options));
+
+  brc->timed_out = TRUE;
+  error = g_error_new (GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_OPERATION_TIMED_OUT,
+                       _("Operation timed out"));
+
+  if (brc->queue && !g_queue_is_empty (brc->queue)) {
+    /* Results being completed are sent before the error */
+    qelement = g_new (QueueElement, 1);
+    qelement->brc = brc;
+    qelement->media = NULL;
+    qelement->remaining = 0;
+    qelement->is_ready = TRUE;
+    qelement->error = error;
+    g_queue_push_tail (brc->queue, qelement);
+    queue_start_process (brc);
+  } else {
+    brc->user_callback (brc->source, brc->operation_id, NULL, 0,
+                        brc->user_data, error);
+    g_error_free (error);
+  }
+
+  /* Results the source sends from now on are dropped; the relay data is
+     freed when it sends the last one */
+  source_cancel_cb (op_state);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+browse_relay_set_deadline (struct BrowseRelayCb *brc)
+{
+  guint deadline;
+
+  deadline = grl_operation_options_get_deadline (brc->options);
+  if (deadline > 0) {
+    brc->deadline_source = grl_operation_timeout_add (brc->operation_id,
+                                                      deadline,
+                                                      browse_deadline_cb,
+                                                      brc,
+                                                      "[grilo] browse_deadline_cb");
+  }
+}
+
+/* Weight of the last chunk in the tuner averages */
+#define AUTO_SPLIT_TUNER_WEIGHT 0.25
+/* Smallest chunk the tuner will request */
+#define AUTO_SPLIT_TUNER_MIN_CHUNK 10
+
+static void
+auto_split_tuner_reset (GrlSource *source)
+{
+  source->priv->auto_split_tuned = source->priv->auto_split_threshold;
+  source->priv->auto_split_samples = 0;
+  source->priv->auto_split_latency = 0;
+  source->priv->auto_split_throughput = 0;
+}
+
+static GVariant *
+auto_split_tuner_get_state (GrlSource *source)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "chunk-size",
+                         g_variant_new_uint32 (source->priv->auto_split_tuned));
+  g_variant_builder_add (&builder, "{sv}", "target-latency",
+                         g_variant_new_uint32 (source->priv->auto_split_target_latency));
+  g_variant_builder_add (&builder, "{sv}", "first-result-latency",
+                         g_variant_new_double (source->priv->auto_split_latency));
+  g_variant_builder_add (&builder, "{sv}", "throughput",
+                         g_variant_new_double (source->priv->auto_split_throughput));
+  g_variant_builder_add (&builder, "{sv}", "samples",
+                         g_variant_new_uint32 (source->priv->auto_split_samples));
+
+  return g_variant_builder_end (&builder);
+}
+
+/*
+ * auto_split_tuner_get_chunk_size:
+ *
+ * Returns how many elements should be requested in the next auto-split chunk.
+ */
+static guint
+auto_split_tuner_get_chunk_size (GrlSource *source)
+{
+  if (source->priv->auto_split_target_latency > 0 &&
+      source->priv->auto_split_tuned > 0) {
+    return source->priv->auto_split_tuned;
+  }
+
+  return source->priv->auto_split_threshold;
+}
+
+/*
+ * auto_split_tuner_update:
+ *
+ * Feeds the tuner with the timing of a finished chunk. Chunks are halved when
+ * the time to first result goes over the target latency, and grown by a half,
+ * up to the auto-split threshold, while it stays under half the target and
+ * bigger chunks don't make the throughput worse.
+ */
+static void
+auto_split_tuner_update (GrlSource *source,
+                         gint64 first_result,
+                         gint64 duration,
+                         guint received,
+                         guint requested)
+{
+  GrlSourcePrivate *priv = source->priv;
+  gdouble latency;
+  gdouble throughput;
+  gdouble last_throughput;
+  guint chunk;
+
+  if (priv->auto_split_target_latency == 0 || received == 0) {
+    return;
+  }
+
+  latency = (gdouble) first_result / 1000;
+  throughput = duration > 0? (gdouble) received * G_USEC_PER_SEC / duration: 0;
+  last_throughput = priv->auto_split_throughput;
+
+  if (priv->auto_split_samples == 0) {
+    priv->auto_split_latency = latency;
+    priv->auto_split_throughput = throughput;
+  } else {
+    priv->auto_split_latency += AUTO_SPLIT_TUNER_WEIGHT *
+      (latency - priv->auto_split_latency);
+    priv->auto_split_throughput += AUTO_SPLIT_TUNER_WEIGHT *
+      (throughput - priv->auto_split_throughput);
+  }
+  priv->auto_split_samples++;
+
+  chunk = priv->auto_split_tuned;
+  if (priv->auto_split_latency > priv->auto_split_target_latency) {
+    chunk = MAX (chunk / 2, MIN (AUTO_SPLIT_TUNER_MIN_CHUNK,
+                                 priv->auto_split_threshold));
+  } else if (priv->auto_split_latency < priv->auto_split_target_latency / 2.0 &&
+             received == requested &&
+             throughput >= 0.9 * last_throughput) {
+    chunk = MIN (chunk + MAX (chunk / 2, 1), priv->auto_split_threshold);
+  }
+
+  if (chunk != priv->auto_split_tuned) {
+    GRL_DEBUG ("auto-split: tuning chunk size of '%s' from %u to %u "
+               "(first result after %.1f ms, %.1f elements/s)",
+               grl_source_get_id (source), priv->auto_split_tuned, chunk,
+               priv->auto_split_latency, priv->auto_split_throughput);
+    priv->auto_split_tuned = chunk;
+  }
+
+  g_object_notify (G_OBJECT (source), "auto-split-tuner-state");
+}
+
 static struct AutoSplitCtl *
 auto_split_setup (GrlSource *source,
                   GrlOperationOptions *options)
 {
   struct AutoSplitCtl *as_ctl = NULL;
   gint count = grl_operation_options_get_count (options);
+  guint chunk_size = auto_split_tuner_get_chunk_size (source);
 
-  if (source->priv->auto_split_threshold > 0 &&
-      count > source->priv->auto_split_threshold) {
+  if (chunk_size > 0 && count > chunk_size) {
     GRL_DEBUG ("auto-split: enabled");
 
-    as_ctl = g_slice_new (struct AutoSplitCtl);
-    as_ctl->threshold = source->priv->auto_split_threshold;
+    as_ctl = g_slice_new0 (struct AutoSplitCtl);
+    as_ctl->threshold = chunk_size;
+    as_ctl->chunk_requested = chunk_size;
+    as_ctl->chunk_started = g_get_monotonic_time ();
     as_ctl->total_remaining = count;
     as_ctl->chunk_remaining = as_ctl->threshold;
+    as_ctl->window = source->priv->auto_split_window;
+    as_ctl->next_skip = grl_operation_options_get_skip (options) +
+                        as_ctl->threshold;
+    as_ctl->unrequested = count - as_ctl->threshold;
+    if (as_ctl->window > 1) {
+      GRL_DEBUG ("auto-split: pipelining up to %u chunks", as_ctl->window);
+      as_ctl->chunks = g_queue_new ();
+    }
     count = as_ctl->chunk_remaining;
     grl_operation_options_set_count (options, count);
     GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
@@ -2213,98 +3044,103 @@ auto_split_setup (GrlSource *source,
 }
 
 static void
-auto_split_run_next_chunk (struct BrowseRelayCb *brc)
+auto_split_result_free (AutoSplitResult *result)
 {
-  guint id;
-  brc->auto_split->chunk_remaining = MIN (brc->auto_split->threshold,
-                                          brc->auto_split->total_remaining);
+  g_clear_object (&result->media);
+  g_clear_error (&result->error);
+  g_slice_free (AutoSplitResult, result);
+}
 
-  switch (brc->operation_type) {
+static void
+auto_split_chunk_free (struct AutoSplitChunk *chunk)
+{
+  switch (chunk->operation_type) {
   case GRL_OP_BROWSE:
-    grl_operation_options_set_skip (brc->spec.browse->options,
-                                    grl_operation_options_get_skip (brc->spec.browse->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.browse->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.browse->options),
-               grl_operation_options_get_count (brc->spec.browse->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          browse_idle,
-                          brc->spec.browse,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] browse_idle");
+    g_object_unref (chunk->spec.browse->source);
+    g_object_unref (chunk->spec.browse->container);
+    g_object_unref (chunk->spec.browse->options);
+    g_list_free (chunk->spec.browse->keys);
+    g_free (chunk->spec.browse);
     break;
   case GRL_OP_SEARCH:
-    grl_operation_options_set_skip (brc->spec.search->options,
-                                    grl_operation_options_get_skip (brc->spec.search->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.search->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.search->options),
-               grl_operation_options_get_count (brc->spec.search->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          search_idle,
-                          brc->spec.search,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] search_idle");
+    g_object_unref (chunk->spec.search->source);
+    g_object_unref (chunk->spec.search->options);
+    g_list_free (chunk->spec.search->keys);
+    g_free (chunk->spec.search->text);
+    g_free (chunk->spec.search);
     break;
   case GRL_OP_QUERY:
-    grl_operation_options_set_skip (brc->spec.query->options,
-                                    grl_operation_options_get_skip (brc->spec.query->options) +
-                                    brc->auto_split->threshold);
-    grl_operation_options_set_count (brc->spec.query->options,
-                                     brc->auto_split->chunk_remaining);
-    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
-               grl_operation_options_get_skip (brc->spec.query->options),
-               grl_operation_options_get_count (brc->spec.query->options));
-    id = g_idle_add_full (grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          query_idle,
-                          brc->spec.query,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] query_idle");
+    g_object_unref (chunk->spec.query->source);
+    g_object_unref (chunk->spec.query->options);
+    g_list_free (chunk->spec.query->keys);
+    g_free (chunk->spec.query->query);
+    g_free (chunk->spec.query);
     break;
   default:
     g_assert_not_reached ();
     break;
   }
+
+  g_queue_free_full (chunk->results, (GDestroyNotify) auto_split_result_free);
+  g_slice_free (struct AutoSplitChunk, chunk);
 }
 
 static void
-warn_if_no_id (GrlMedia *media,
-               GrlSource *source)
+auto_split_cancel_chunks (struct AutoSplitCtl *as_ctl)
 {
-  const char *id;
+  GList *l;
 
-  if (media == NULL || !grl_media_is_container (media))
+  if (!as_ctl->chunks) {
     return;
+  }
 
-  id = grl_media_get_id (media);
-  if (id == NULL || *id == '\0')
-    GRL_WARNING ("Media container is not browsable, has no ID: %s (source: %s)",
-                 grl_media_get_title (media),
-                 grl_source_get_id (source));
+  for (l = as_ctl->chunks->head; l; l = l->next) {
+    struct AutoSplitChunk *chunk = (struct AutoSplitChunk *) l->data;
+    if (!chunk->done) {
+      source_cancel_cb (grl_operation_get_private_data (chunk->operation_id));
+    }
+  }
 }
 
+/* Called when the operation has delivered its last result: chunks that are
+   still running are cancelled and will be freed when they finish, results
+   already fetched by the others are dropped */
 static void
-browse_result_relay_cb (GrlSource *source,
-                        guint operation_id,
-                        GrlMedia *media,
-                        guint remaining,
-                        gpointer user_data,
-                        const GError *error)
+auto_split_detach_chunks (struct BrowseRelayCb *brc)
 {
-  GError *_error;
-  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  struct AutoSplitChunk *chunk;
+
+  if (!brc->auto_split || !brc->auto_split->chunks) {
+    return;
+  }
+
+  auto_split_cancel_chunks (brc->auto_split);
+
+  while ((chunk = g_queue_pop_head (brc->auto_split->chunks))) {
+    if (chunk->done) {
+      operation_set_finished (chunk->operation_id);
+      auto_split_chunk_free (chunk);
+    } else {
+      chunk->brc = NULL;
+    }
+  }
+}
+
+static void
+auto_split_chunk_relay_cb (GrlSource *source,
+                           guint operation_id,
+                           GrlMedia *media,
+                           guint remaining,
+                           gpointer user_data,
+                           const GError *error)
+{
+  struct AutoSplitChunk *chunk = (struct AutoSplitChunk *) user_data;
+  struct BrowseRelayCb *brc = chunk->brc;
+  AutoSplitResult *result;
 
   GRL_DEBUG (__FUNCTION__);
 
-  /* Ignore elements after operation has completed */
-  if (operation_is_completed (operation_id)) {
+  if (chunk->done) {
     GRL_WARNING ("Source '%s' emitted 'remaining=0' more than once "
                  "for operation %d",
                  grl_source_get_id (source), operation_id);
@@ -2312,28 +3148,396 @@ browse_result_relay_cb (GrlSource *source,
     return;
   }
 
-  /* Check if cancelled */
-  if (operation_is_cancelled (operation_id)) {
-    GRL_DEBUG ("Operation is cancelled, skipping result until getting the last one");
+  /* Operation already finished: just wait for the chunk to end */
+  if (!brc) {
     g_clear_object (&media);
-    /* Wait for the last element */
-    if (remaining > 0) {
-      return;
-    } else {
-      _error = g_error_new (GRL_CORE_ERROR,
-                            GRL_CORE_ERROR_OPERATION_CANCELLED,
-                            _("Operation was cancelled"));
-      brc->user_callback (source, operation_id, NULL, 0,
-                          brc->user_data, _error);
-      g_error_free (_error);
-      goto free_resources;
+    if (remaining == 0) {
+      operation_set_finished (chunk->operation_id);
+      auto_split_chunk_free (chunk);
     }
+    return;
   }
 
-  /* Auto-split management */
-  if (brc->auto_split) {
-    brc->auto_split->chunk_remaining--;
+  /* Measure the chunk as the source sends it, not as it gets delivered */
+  if (!chunk->first_result) {
+    chunk->first_result = g_get_monotonic_time ();
+  }
+  if (media) {
+    chunk->received++;
+  }
+  if (remaining == 0) {
+    auto_split_tuner_update (source,
+                             chunk->first_result - chunk->started,
+                             g_get_monotonic_time () - chunk->started,
+                             chunk->received,
+                             chunk->count);
+  }
+
+  /* Chunk is the one being delivered */
+  if (chunk->live) {
+    if (remaining == 0) {
+      g_queue_remove (brc->auto_split->chunks, chunk);
+      operation_set_finished (chunk->operation_id);
+      auto_split_chunk_free (chunk);
+    }
+    browse_result_relay_cb (source, brc->operation_id, media, remaining,
+                            brc, error);
+    return;
+  }
+
+  /* Keep the results until the previous chunks are delivered */
+  result = g_slice_new (AutoSplitResult);
+  result->media = media;
+  result->remaining = remaining;
+  result->error = error? g_error_copy (error): NULL;
+  g_queue_push_tail (chunk->results, result);
+
+  if (remaining == 0) {
+    chunk->done = TRUE;
+  }
+}
+
+static void
+auto_split_request_chunk (struct BrowseRelayCb *brc)
+{
+  struct AutoSplitCtl *as_ctl = brc->auto_split;
+  struct AutoSplitChunk *chunk;
+  GrlOperationOptions *options;
+
+  chunk = g_slice_new0 (struct AutoSplitChunk);
+  chunk->brc = brc;
+  chunk->operation_type = brc->operation_type;
+  chunk->operation_id = grl_operation_generate_id ();
+  as_ctl->threshold = auto_split_tuner_get_chunk_size (brc->source);
+  chunk->count = MIN (as_ctl->threshold, as_ctl->unrequested);
+  chunk->started = g_get_monotonic_time ();
+  chunk->results = g_queue_new ();
+
+  options = grl_operation_options_copy (brc->options);
+  grl_operation_options_set_skip (options, as_ctl->next_skip);
+  grl_operation_options_set_count (options, chunk->count);
+  GRL_DEBUG ("auto-split: prefetching chunk (skip=%u, count=%u)",
+             as_ctl->next_skip, chunk->count);
+
+  as_ctl->next_skip += chunk->count;
+  as_ctl->unrequested -= chunk->count;
+
+  operation_set_ongoing (brc->source, chunk->operation_id);
+
+  switch (brc->operation_type) {
+  case GRL_OP_BROWSE:
+    chunk->spec.browse = g_new (GrlSourceBrowseSpec, 1);
+    chunk->spec.browse->source = g_object_ref (brc->source);
+    chunk->spec.browse->operation_id = chunk->operation_id;
+    chunk->spec.browse->container = g_object_ref (brc->spec.browse->container);
+    chunk->spec.browse->keys = g_list_copy (brc->keys);
+    chunk->spec.browse->options = options;
+    chunk->spec.browse->callback = auto_split_chunk_relay_cb;
+    chunk->spec.browse->user_data = chunk;
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            browse_idle,
+                            chunk->spec.browse,
+                            NULL,
+                            "[grilo] browse_idle");
+    break;
+  case GRL_OP_SEARCH:
+    chunk->spec.search = g_new (GrlSourceSearchSpec, 1);
+    chunk->spec.search->source = g_object_ref (brc->source);
+    chunk->spec.search->operation_id = chunk->operation_id;
+    chunk->spec.search->text = g_strdup (brc->spec.search->text);
+    chunk->spec.search->keys = g_list_copy (brc->keys);
+    chunk->spec.search->options = options;
+    chunk->spec.search->callback = auto_split_chunk_relay_cb;
+    chunk->spec.search->user_data = chunk;
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            search_idle,
+                            chunk->spec.search,
+                            NULL,
+                            "[grilo] search_idle");
+    break;
+  case GRL_OP_QUERY:
+    chunk->spec.query = g_new (GrlSourceQuerySpec, 1);
+    chunk->spec.query->source = g_object_ref (brc->source);
+    chunk->spec.query->operation_id = chunk->operation_id;
+    chunk->spec.query->query = g_strdup (brc->spec.query->query);
+    chunk->spec.query->keys = g_list_copy (brc->keys);
+    chunk->spec.query->options = options;
+    chunk->spec.query->callback = auto_split_chunk_relay_cb;
+    chunk->spec.query->user_data = chunk;
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            query_idle,
+                            chunk->spec.query,
+                            NULL,
+                            "[grilo] query_idle");
+    break;
+  default:
+    g_assert_not_reached ();
+    break;
+  }
+
+  g_queue_push_tail (as_ctl->chunks, chunk);
+}
+
+/* Keeps up to window - 1 chunks in flight besides the one being delivered */
+static void
+auto_split_fill_window (struct BrowseRelayCb *brc)
+{
+  struct AutoSplitCtl *as_ctl = brc->auto_split;
+
+  if (!as_ctl || !as_ctl->chunks) {
+    return;
+  }
+
+  while (as_ctl->unrequested > 0 &&
+         g_queue_get_length (as_ctl->chunks) < as_ctl->window - 1) {
+    auto_split_request_chunk (brc);
+  }
+}
+
+/*
+ * auto_split_start:
+ *
+ * Starts prefetching the chunks that follow the first one, if pipelined
+ * auto-split was set up for this operation.
+ */
+static void
+auto_split_start (struct BrowseRelayCb *brc)
+{
+  struct OperationState *op_state;
+
+  if (!brc->auto_split || !brc->auto_split->chunks) {
+    return;
+  }
+
+  op_state = grl_operation_get_private_data (brc->operation_id);
+  op_state->auto_split = brc->auto_split;
+
+  auto_split_fill_window (brc);
+}
+
+static gboolean
+auto_split_promote_idle (gpointer user_data)
+{
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+  struct AutoSplitChunk *chunk;
+  AutoSplitResult *result;
+  GrlSource *source;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  brc->auto_split->promote_source = NULL;
+  /* From now on chunks are measured in auto_split_chunk_relay_cb() */
+  brc->auto_split->chunk_started = 0;
+
+  /* Make sure there is a following chunk, and that the window is full again
+     before handing out any result, as doing so can free the relay */
+  if (g_queue_is_empty (brc->auto_split->chunks)) {
+    auto_split_request_chunk (brc);
+  }
+  chunk = g_queue_peek_head (brc->auto_split->chunks);
+  chunk->live = TRUE;
+  brc->auto_split->chunk_remaining = chunk->count;
+  auto_split_fill_window (brc);
+
+  source = g_object_ref (brc->source);
+
+  /* Flush what was already fetched; once the last result has been flushed,
+     both the chunk and the relay could be gone */
+  while ((result = g_queue_pop_head (chunk->results))) {
+    gboolean last = (result->remaining == 0);
+
+    if (last) {
+      g_queue_remove (brc->auto_split->chunks, chunk);
+      operation_set_finished (chunk->operation_id);
+    }
+
+    browse_result_relay_cb (source, brc->operation_id,
+                            g_steal_pointer (&result->media),
+                            result->remaining, brc, result->error);
+
+    if (last) {
+      auto_split_result_free (result);
+      auto_split_chunk_free (chunk);
+      break;
+    }
+
+    auto_split_result_free (result);
+  }
+
+  g_object_unref (source);
+
+  return FALSE;
+}
+
+static void
+auto_split_run_next_chunk (struct BrowseRelayCb *brc)
+{
+  /* Pipelined mode: the next chunk is already in flight */
+  if (brc->auto_split->chunks) {
+    brc->auto_split->promote_source =
+      grl_operation_idle_add (brc->operation_id,
+                              grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                              G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                              auto_split_promote_idle,
+                              brc,
+                              NULL,
+                              "[grilo] auto_split_promote_idle");
+    return;
+  }
+
+  brc->auto_split->threshold = auto_split_tuner_get_chunk_size (brc->source);
+  brc->auto_split->chunk_remaining = MIN (brc->auto_split->threshold,
+                                          brc->auto_split->total_remaining);
+
+  switch (brc->operation_type) {
+  case GRL_OP_BROWSE:
+    grl_operation_options_set_skip (brc->spec.browse->options,
+                                    grl_operation_options_get_skip (brc->spec.browse->options) +
+                                    brc->auto_split->chunk_requested);
+    grl_operation_options_set_count (brc->spec.browse->options,
+                                     brc->auto_split->chunk_remaining);
+    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
+               grl_operation_options_get_skip (brc->spec.browse->options),
+               grl_operation_options_get_count (brc->spec.browse->options));
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            browse_idle,
+                            brc->spec.browse,
+                            NULL,
+                            "[grilo] browse_idle");
+    break;
+  case GRL_OP_SEARCH:
+    grl_operation_options_set_skip (brc->spec.search->options,
+                                    grl_operation_options_get_skip (brc->spec.search->options) +
+                                    brc->auto_split->chunk_requested);
+    grl_operation_options_set_count (brc->spec.search->options,
+                                     brc->auto_split->chunk_remaining);
+    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
+               grl_operation_options_get_skip (brc->spec.search->options),
+               grl_operation_options_get_count (brc->spec.search->options));
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            search_idle,
+                            brc->spec.search,
+                            NULL,
+                            "[grilo] search_idle");
+    break;
+  case GRL_OP_QUERY:
+    grl_operation_options_set_skip (brc->spec.query->options,
+                                    grl_operation_options_get_skip (brc->spec.query->options) +
+                                    brc->auto_split->chunk_requested);
+    grl_operation_options_set_count (brc->spec.query->options,
+                                     brc->auto_split->chunk_remaining);
+    GRL_DEBUG ("auto-split: requesting chunk (skip=%u, count=%u)",
+               grl_operation_options_get_skip (brc->spec.query->options),
+               grl_operation_options_get_count (brc->spec.query->options));
+    grl_operation_idle_add (brc->operation_id,
+                            grl_operation_options_get_resolution_flags (brc->options) & GRL_RESOLVE_IDLE_RELAY?
+                            G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            query_idle,
+                            brc->spec.query,
+                            NULL,
+                            "[grilo] query_idle");
+    break;
+  default:
+    g_assert_not_reached ();
+    break;
+  }
+
+  brc->auto_split->chunk_requested = brc->auto_split->chunk_remaining;
+  brc->auto_split->chunk_consumed = 0;
+  brc->auto_split->chunk_started = g_get_monotonic_time ();
+  brc->auto_split->chunk_first_result = 0;
+}
+
+static void
+warn_if_no_id (GrlMedia *media,
+               GrlSource *source)
+{
+  const char *id;
+
+  if (media == NULL || !grl_media_is_container (media))
+    return;
+
+  id = grl_media_get_id (media);
+  if (id == NULL || *id == '\0')
+    GRL_WARNING ("Media container is not browsable, has no ID: %s (source: %s)",
+                 grl_media_get_title (media),
+                 grl_source_get_id (source));
+}
+
+static void
+browse_result_relay_cb (GrlSource *source,
+                        guint operation_id,
+                        GrlMedia *media,
+                        guint remaining,
+                        gpointer user_data,
+                        const GError *error)
+{
+  GError *_error;
+  struct BrowseRelayCb *brc = (struct BrowseRelayCb *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  /* Ignore elements after operation has completed */
+  if (operation_is_completed (operation_id)) {
+    GRL_WARNING ("Source '%s' emitted 'remaining=0' more than once "
+                 "for operation %d",
+                 grl_source_get_id (source), operation_id);
+    g_clear_object (&media);
+    return;
+  }
+
+  /* Check if cancelled */
+  if (operation_is_cancelled (operation_id)) {
+    GRL_DEBUG ("Operation is cancelled, skipping result until getting the last one");
+    g_clear_object (&media);
+    /* Wait for the last element */
+    if (remaining > 0) {
+      return;
+    } else {
+      /* When the deadline expired, the user was already told */
+      if (!brc->timed_out) {
+        _error = g_error_new (GRL_CORE_ERROR,
+                              GRL_CORE_ERROR_OPERATION_CANCELLED,
+                              _("Operation was cancelled"));
+        brc->user_callback (source, operation_id, NULL, 0,
+                            brc->user_data, _error);
+        g_error_free (_error);
+      }
+      goto free_resources;
+    }
+  }
+
+  /* Auto-split management */
+  if (brc->auto_split) {
+    brc->auto_split->chunk_remaining--;
     brc->auto_split->total_remaining--;
+    if (brc->auto_split->chunk_started) {
+      if (!brc->auto_split->chunk_first_result) {
+        brc->auto_split->chunk_first_result = g_get_monotonic_time ();
+      }
+      if (media) {
+        brc->auto_split->chunk_consumed++;
+      }
+      if (remaining == 0) {
+        auto_split_tuner_update (source,
+                                 brc->auto_split->chunk_first_result -
+                                 brc->auto_split->chunk_started,
+                                 g_get_monotonic_time () -
+                                 brc->auto_split->chunk_started,
+                                 brc->auto_split->chunk_consumed,
+                                 brc->auto_split->chunk_requested);
+      }
+    }
     /* On last element, check if more elements should be asked: if source
        satisfied all requested elements, but we need to get more */
     if (remaining == 0) {
@@ -2347,45 +3551,657 @@ browse_result_relay_cb (GrlSource *source,
     }
   }
 
-  /* Set the source */
-  if (media && !grl_media_get_source (media)) {
-    grl_media_set_source (media, grl_source_get_id (source));
+  /* Set the source */
+  if (media && !grl_media_get_source (media)) {
+    grl_media_set_source (media, grl_source_get_id (source));
+  }
+
+  /* If we need further processing of media, put it in a queue */
+  if (grl_operation_options_get_resolution_flags (brc->options) &
+      (GRL_RESOLVE_FULL | GRL_RESOLVE_IDLE_RELAY)) {
+    queue_add_media (brc, media, remaining, error);
+  } else {
+    warn_if_no_id (media, source);
+    brc->user_callback (source, operation_id, media, remaining,
+                        brc->user_data, error);
+  }
+
+  if (remaining == 0) {
+  free_resources:
+    auto_split_detach_chunks (brc);
+    browse_relay_spec_free (brc);
+    if (!brc->queue || g_queue_is_empty (brc->queue)) {
+      operation_set_finished (operation_id);
+      browse_relay_free (brc);
+    } else {
+      /* There are elements pending to be processed; let's wait to free it in
+         the queue */
+      operation_set_completed (operation_id);
+    }
+  }
+}
+
+static void
+remove_result_relay_cb (GrlSource *source,
+                        GrlMedia *media,
+                        gpointer user_data,
+                        const GError *error)
+{
+  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
+
+  rrc->user_callback (source, media, rrc->user_data, error);
+  remove_relay_free (rrc);
+}
+
+static void
+batch_flush (struct BatchRelayCb *bth,
+             guint operation_id,
+             const GError *error)
+{
+  GPtrArray *medias;
+
+  if (bth->flush_source) {
+    g_source_destroy (bth->flush_source);
+    bth->flush_source = NULL;
+  }
+
+  if (bth->medias->len == 0 && !error && bth->remaining > 0) {
+    return;
+  }
+
+  /* Hand the current batch to the user and start a new one */
+  medias = bth->medias;
+  bth->medias = g_ptr_array_new_with_free_func (g_object_unref);
+
+  bth->user_callback (bth->source, operation_id, medias, bth->remaining,
+                      bth->user_data, error);
+}
+
+static gboolean
+batch_flush_timeout (gpointer user_data)
+{
+  struct BatchRelayCb *bth = (struct BatchRelayCb *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  bth->flush_source = NULL;
+  if (bth->medias->len > 0) {
+    batch_flush (bth, bth->operation_id, NULL);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+batch_result_relay_cb (GrlSource *source,
+                       guint operation_id,
+                       GrlMedia *media,
+                       guint remaining,
+                       gpointer user_data,
+                       const GError *error)
+{
+  struct BatchRelayCb *bth = (struct BatchRelayCb *) user_data;
+
+  bth->operation_id = operation_id;
+  bth->remaining = remaining;
+
+  if (media) {
+    g_ptr_array_add (bth->medias, media);
+  }
+
+  if (error || remaining == 0) {
+    batch_flush (bth, operation_id, error);
+  } else if (bth->batch_size > 0 && bth->medias->len >= bth->batch_size) {
+    batch_flush (bth, operation_id, NULL);
+  } else if (bth->batch_latency > 0 && bth->medias->len == 1 && !bth->flush_source) {
+    /* First element of a new batch: deliver it after the latency at most */
+    bth->flush_source = grl_operation_timeout_add (operation_id,
+                                                   bth->batch_latency,
+                                                   batch_flush_timeout,
+                                                   bth,
+                                                   "[grilo] batch_flush_timeout");
+  }
+
+  if (remaining == 0) {
+    batch_relay_free (bth);
+  }
+}
+
+/* Thread-safe sources run their operations in a thread pool shared by all the
+   sources. Results are sent back to the main context owning the operation, in
+   the same order the source emitted them.
+
+   Jobs are looked up by operation id, so results the source sends once the
+   job is finished are dropped instead of reaching freed memory. A cancelled
+   job is finished by the core as soon as the source function returns, so it
+   does not wait forever for a source that never sends the last result */
+
+typedef struct {
+  gint ref_count;
+  GrlSource *source;
+  GrlSupportedOps operation;
+  guint operation_id;
+  gpointer spec;
+  gpointer callback;
+  gpointer user_data;
+  /* Protected by the workers lock */
+  gboolean started;
+  gboolean returned;
+  gboolean cancelled;
+  gboolean finished;
+} WorkerJob;
+
+typedef struct {
+  WorkerJob *job;
+  GrlMedia *media;
+  guint remaining;
+  GError *error;
+} WorkerResult;
+
+G_LOCK_DEFINE_STATIC (workers);
+static GThreadPool *worker_pool = NULL;
+/* Unfinished jobs by operation id */
+static GHashTable *worker_jobs = NULL;
+
+static WorkerJob *
+worker_job_ref (WorkerJob *job)
+{
+  g_atomic_int_inc (&job->ref_count);
+  return job;
+}
+
+static void
+worker_job_unref (WorkerJob *job)
+{
+  if (g_atomic_int_dec_and_test (&job->ref_count)) {
+    g_object_unref (job->source);
+    g_slice_free (WorkerJob, job);
+  }
+}
+
+static gboolean
+worker_result_dispatch (gpointer user_data)
+{
+  WorkerResult *result = (WorkerResult *) user_data;
+  WorkerJob *job = result->job;
+
+  switch (job->operation) {
+  case GRL_OP_BROWSE:
+  case GRL_OP_SEARCH:
+  case GRL_OP_QUERY:
+    /* Ownership of the media goes to the callback */
+    ((GrlSourceResultCb) job->callback) (job->source, job->operation_id,
+                                         result->media, result->remaining,
+                                         job->user_data, result->error);
+    break;
+  case GRL_OP_RESOLVE:
+  case GRL_OP_MEDIA_FROM_URI:
+    ((GrlSourceResolveCb) job->callback) (job->source, job->operation_id,
+                                          result->media, job->user_data,
+                                          result->error);
+    g_clear_object (&result->media);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  worker_job_unref (job);
+  g_clear_error (&result->error);
+  g_slice_free (WorkerResult, result);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Must be called with the workers lock held */
+static void
+worker_result_push_locked (WorkerJob *job,
+                           GrlMedia *media,
+                           guint remaining,
+                           const GError *error)
+{
+  WorkerResult *result;
+
+  result = g_slice_new0 (WorkerResult);
+  result->job = worker_job_ref (job);
+  result->media = media;
+  result->remaining = remaining;
+  result->error = error? g_error_copy (error): NULL;
+
+  /* Results of an operation are dispatched in the same order they are
+     pushed, as all of them have the same priority */
+  grl_operation_idle_add (job->operation_id,
+                          G_PRIORITY_DEFAULT,
+                          worker_result_dispatch,
+                          result,
+                          NULL,
+                          "[grilo] worker_result_dispatch");
+
+  if (remaining == 0) {
+    /* The queued result keeps the job alive until it is dispatched */
+    job->finished = TRUE;
+    g_hash_table_remove (worker_jobs, GUINT_TO_POINTER (job->operation_id));
+  }
+}
+
+static void
+worker_result_push (guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    const GError *error)
+{
+  WorkerJob *job;
+
+  G_LOCK (workers);
+  job = g_hash_table_lookup (worker_jobs, GUINT_TO_POINTER (operation_id));
+  if (job) {
+    worker_result_push_locked (job, media, remaining, error);
+  }
+  G_UNLOCK (workers);
+
+  if (!job) {
+    GRL_DEBUG ("Dropping result of finished operation %u", operation_id);
+    g_clear_object (&media);
+  }
+}
+
+static void
+worker_result_cb (GrlSource *source,
+                  guint operation_id,
+                  GrlMedia *media,
+                  guint remaining,
+                  gpointer user_data,
+                  const GError *error)
+{
+  worker_result_push (GPOINTER_TO_UINT (user_data), media, remaining, error);
+}
+
+static void
+worker_resolve_cb (GrlSource *source,
+                   guint operation_id,
+                   GrlMedia *media,
+                   gpointer user_data,
+                   const GError *error)
+{
+  worker_result_push (GPOINTER_TO_UINT (user_data),
+                      media? g_object_ref (media): NULL, 0, error);
+}
+
+static void
+worker_run (gpointer data,
+            gpointer user_data)
+{
+  WorkerJob *job = (WorkerJob *) data;
+  GrlSource *source = g_object_ref (job->source);
+  WorkerJob *next;
+
+  switch (job->operation) {
+  case GRL_OP_BROWSE:
+    GRL_SOURCE_GET_CLASS (source)->browse (source, job->spec);
+    break;
+  case GRL_OP_SEARCH:
+    GRL_SOURCE_GET_CLASS (source)->search (source, job->spec);
+    break;
+  case GRL_OP_QUERY:
+    GRL_SOURCE_GET_CLASS (source)->query (source, job->spec);
+    break;
+  case GRL_OP_RESOLVE:
+    GRL_SOURCE_GET_CLASS (source)->resolve (source, job->spec);
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    GRL_SOURCE_GET_CLASS (source)->media_from_uri (source, job->spec);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  G_LOCK (workers);
+  job->returned = TRUE;
+  /* The source is not using the spec any more, so a cancelled operation can
+     be finished without waiting for its last result */
+  if (job->cancelled && !job->finished) {
+    worker_result_push_locked (job, NULL, 0, NULL);
+  }
+
+  /* Let the next operation of the source take the slot */
+  next = g_queue_pop_head (&source->priv->workers_pending);
+  if (next) {
+    next->started = TRUE;
+  } else {
+    source->priv->workers_running--;
+  }
+  G_UNLOCK (workers);
+
+  if (next) {
+    g_thread_pool_push (worker_pool, next, NULL);
+  }
+
+  worker_job_unref (job);
+  g_object_unref (source);
+}
+
+static void
+worker_cancel (GrlSource *source,
+               guint operation_id)
+{
+  WorkerJob *job;
+  gboolean dequeued = FALSE;
+
+  G_LOCK (workers);
+  job = worker_jobs?
+    g_hash_table_lookup (worker_jobs, GUINT_TO_POINTER (operation_id)): NULL;
+  if (job) {
+    job->cancelled = TRUE;
+    if (!job->started) {
+      /* It never reached the source: drop it from the queue */
+      g_queue_remove (&source->priv->workers_pending, job);
+      dequeued = TRUE;
+      worker_result_push_locked (job, NULL, 0, NULL);
+    } else if (job->returned) {
+      worker_result_push_locked (job, NULL, 0, NULL);
+    }
+  }
+  G_UNLOCK (workers);
+
+  /* Release the reference worker_run() would have released */
+  if (dequeued) {
+    worker_job_unref (job);
+  }
+}
+
+static void
+worker_push (GrlSource *source,
+             GrlSupportedOps operation,
+             guint operation_id,
+             gpointer spec)
+{
+  WorkerJob *job;
+  gboolean run;
+
+  job = g_slice_new0 (WorkerJob);
+  /* One reference for the table of jobs and one for worker_run() */
+  job->ref_count = 2;
+  job->source = g_object_ref (source);
+  job->operation = operation;
+  job->operation_id = operation_id;
+  job->spec = spec;
+
+  /* Results go through the worker, that relays them to the owning context */
+  switch (operation) {
+  case GRL_OP_BROWSE:
+    job->callback = ((GrlSourceBrowseSpec *) spec)->callback;
+    job->user_data = ((GrlSourceBrowseSpec *) spec)->user_data;
+    ((GrlSourceBrowseSpec *) spec)->callback = worker_result_cb;
+    ((GrlSourceBrowseSpec *) spec)->user_data = GUINT_TO_POINTER (operation_id);
+    break;
+  case GRL_OP_SEARCH:
+    job->callback = ((GrlSourceSearchSpec *) spec)->callback;
+    job->user_data = ((GrlSourceSearchSpec *) spec)->user_data;
+    ((GrlSourceSearchSpec *) spec)->callback = worker_result_cb;
+    ((GrlSourceSearchSpec *) spec)->user_data = GUINT_TO_POINTER (operation_id);
+    break;
+  case GRL_OP_QUERY:
+    job->callback = ((GrlSourceQuerySpec *) spec)->callback;
+    job->user_data = ((GrlSourceQuerySpec *) spec)->user_data;
+    ((GrlSourceQuerySpec *) spec)->callback = worker_result_cb;
+    ((GrlSourceQuerySpec *) spec)->user_data = GUINT_TO_POINTER (operation_id);
+    break;
+  case GRL_OP_RESOLVE:
+    job->callback = ((GrlSourceResolveSpec *) spec)->callback;
+    job->user_data = ((GrlSourceResolveSpec *) spec)->user_data;
+    ((GrlSourceResolveSpec *) spec)->callback = worker_resolve_cb;
+    ((GrlSourceResolveSpec *) spec)->user_data = GUINT_TO_POINTER (operation_id);
+    break;
+  case GRL_OP_MEDIA_FROM_URI:
+    job->callback = ((GrlSourceMediaFromUriSpec *) spec)->callback;
+    job->user_data = ((GrlSourceMediaFromUriSpec *) spec)->user_data;
+    ((GrlSourceMediaFromUriSpec *) spec)->callback = worker_resolve_cb;
+    ((GrlSourceMediaFromUriSpec *) spec)->user_data = GUINT_TO_POINTER (operation_id);
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+
+  G_LOCK (workers);
+  if (!worker_pool) {
+    worker_pool = g_thread_pool_new (worker_run, NULL,
+                                     MAX (g_get_num_processors (), 2),
+                                     FALSE, NULL);
+    worker_jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                         NULL,
+                                         (GDestroyNotify) worker_job_unref);
+  }
+  g_hash_table_insert (worker_jobs, GUINT_TO_POINTER (operation_id), job);
+  run = source->priv->max_concurrency == 0 ||
+    source->priv->workers_running < source->priv->max_concurrency;
+  if (run) {
+    source->priv->workers_running++;
+    job->started = TRUE;
+  } else {
+    g_queue_push_tail (&source->priv->workers_pending, job);
+  }
+  G_UNLOCK (workers);
+
+  GRL_DEBUG ("%s operation %u in a worker", run? "running": "queueing",
+             operation_id);
+
+  if (run) {
+    g_thread_pool_push (worker_pool, job, NULL);
+  }
+}
+
+/* Resolutions waiting to be passed together to resolve_batch(). There is one
+   batch for each main context, as the source must be called from the context
+   of the operations */
+typedef struct {
+  GrlSource *source;
+  GMainContext *context;
+  GPtrArray *specs;
+  GSource *timeout_source;
+} ResolveBatch;
+
+G_LOCK_DEFINE_STATIC (resolve_batches);
+
+static void
+resolve_batch_run (ResolveBatch *batch)
+{
+  GrlSourceResolveSpec *rs;
+  GPtrArray *specs;
+  guint i;
+
+  specs = g_ptr_array_sized_new (batch->specs->len);
+  for (i = 0; i < batch->specs->len; i++) {
+    rs = g_ptr_array_index (batch->specs, i);
+    if (operation_is_cancelled (rs->operation_id)) {
+      /* Never got to the source, so complete it here */
+      rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data,
+                    NULL);
+    } else {
+      g_ptr_array_add (specs, rs);
+    }
+  }
+
+  if (specs->len > 0) {
+    GRL_DEBUG ("resolving %u media at once in '%s'",
+               specs->len, grl_source_get_id (batch->source));
+    GRL_SOURCE_GET_CLASS (batch->source)->resolve_batch (batch->source, specs);
   }
 
-  /* If we need further processing of media, put it in a queue */
-  if (grl_operation_options_get_resolution_flags (brc->options) &
-      (GRL_RESOLVE_FULL | GRL_RESOLVE_IDLE_RELAY)) {
-    queue_add_media (brc, media, remaining, error);
+  g_ptr_array_unref (specs);
+  g_ptr_array_unref (batch->specs);
+  g_main_context_unref (batch->context);
+  g_object_unref (batch->source);
+  g_slice_free (ResolveBatch, batch);
+}
+
+static gboolean
+resolve_batch_timeout (gpointer user_data)
+{
+  ResolveBatch *batch = (ResolveBatch *) user_data;
+  GrlSource *source = batch->source;
+
+  G_LOCK (resolve_batches);
+  source->priv->resolve_batches = g_list_remove (source->priv->resolve_batches,
+                                                 batch);
+  G_UNLOCK (resolve_batches);
+
+  resolve_batch_run (batch);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+resolve_batch_push (GrlSource *source,
+                    GrlSourceResolveSpec *rs)
+{
+  ResolveBatch *batch = NULL;
+  GMainContext *context;
+  GList *l;
+
+  context = grl_operation_get_context (rs->operation_id);
+
+  G_LOCK (resolve_batches);
+
+  for (l = source->priv->resolve_batches; l; l = l->next) {
+    if (((ResolveBatch *) l->data)->context == context) {
+      batch = l->data;
+      break;
+    }
+  }
+
+  if (!batch) {
+    batch = g_slice_new (ResolveBatch);
+    batch->source = g_object_ref (source);
+    batch->context = g_main_context_ref (context);
+    batch->specs = g_ptr_array_new ();
+    batch->timeout_source =
+      grl_operation_timeout_add (rs->operation_id,
+                                 source->priv->resolve_batch_latency,
+                                 resolve_batch_timeout,
+                                 batch,
+                                 "[grilo] resolve_batch_timeout");
+    source->priv->resolve_batches =
+      g_list_prepend (source->priv->resolve_batches, batch);
+  }
+
+  g_ptr_array_add (batch->specs, rs);
+
+  if (batch->specs->len >= source->priv->resolve_batch_size) {
+    source->priv->resolve_batches =
+      g_list_remove (source->priv->resolve_batches, batch);
+    g_source_destroy (batch->timeout_source);
   } else {
-    warn_if_no_id (media, source);
-    brc->user_callback (source, operation_id, media, remaining,
-                        brc->user_data, error);
+    batch = NULL;
   }
 
-  if (remaining == 0) {
-  free_resources:
-    browse_relay_spec_free (brc);
-    if (!brc->queue || g_queue_is_empty (brc->queue)) {
-      operation_set_finished (operation_id);
-      browse_relay_free (brc);
-    } else {
-      /* There are elements pending to be processed; let's wait to free it in
-         the queue */
-      operation_set_completed (operation_id);
-    }
+  G_UNLOCK (resolve_batches);
+
+  if (batch) {
+    resolve_batch_run (batch);
   }
+
+  g_main_context_unref (context);
 }
 
+/* Resolutions with a deadline go through this relay. When the deadline
+   expires, the source is skipped as if it could not resolve its keys, but the
+   spec is kept until the source is done with it */
+typedef struct {
+  struct ResolveRelayCb *rrc;
+  GrlSourceResolveSpec *spec;
+  GSource *deadline_source;
+  gboolean timed_out;
+} ResolveDeadline;
+
 static void
-remove_result_relay_cb (GrlSource *source,
-                        GrlMedia *media,
-                        gpointer user_data,
-                        const GError *error)
+resolve_deadline_relay_cb (GrlSource *source,
+                           guint operation_id,
+                           GrlMedia *media,
+                           gpointer user_data,
+                           const GError *error)
 {
-  struct RemoveRelayCb *rrc = (struct RemoveRelayCb *) user_data;
+  ResolveDeadline *rd = (ResolveDeadline *) user_data;
+  struct ResolveRelayCb *rrc = rd->rrc;
 
-  rrc->user_callback (source, media, rrc->user_data, error);
-  remove_relay_free (rrc);
+  if (rd->timed_out) {
+    GRL_DEBUG ("'%s' answered after the deadline, ignoring it",
+               grl_source_get_id (source));
+    resolve_spec_free (rd->spec);
+    g_slice_free (ResolveDeadline, rd);
+    return;
+  }
+
+  g_source_destroy (rd->deadline_source);
+  g_slice_free (ResolveDeadline, rd);
+
+  resolve_result_relay_cb (source, operation_id, media, rrc, error);
+}
+
+static gboolean
+resolve_deadline_cb (gpointer user_data)
+{
+  ResolveDeadline *rd = (ResolveDeadline *) user_data;
+  struct ResolveRelayCb *rrc = rd->rrc;
+  GrlSource *source;
+  GrlMedia *media;
+  guint operation_id;
+  GError *error;
+
+  source = g_object_ref (rd->spec->source);
+  media = g_object_ref (rd->spec->media);
+  operation_id = rd->spec->operation_id;
+
+  GRL_INFO ("'%s' did not resolve '%s' in %u ms, skipping it",
+            grl_source_get_id (source),
+            grl_media_get_id (media),
+            grl_operation_options_get_deadline (rd->spec->options));
+
+  rd->deadline_source = NULL;
+  rd->timed_out = TRUE;
+
+  /* The relay does not own the spec any more */
+  g_hash_table_steal (rrc->resolve_specs, source);
+  g_object_unref (source);
+
+  if (GRL_SOURCE_GET_CLASS (source)->cancel) {
+    GRL_SOURCE_GET_CLASS (source)->cancel (source, operation_id);
+  }
+
+  /* Keys still missing are asked to the next sources able to resolve them */
+  error = g_error_new (GRL_CORE_ERROR,
+                       GRL_CORE_ERROR_OPERATION_TIMED_OUT,
+                       _("Operation timed out"));
+  resolve_result_relay_cb (source, operation_id, media, rrc, error);
+  g_error_free (error);
+
+  g_object_unref (source);
+  g_object_unref (media);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+resolve_spec_set_deadline (struct ResolveRelayCb *rrc,
+                           GrlSourceResolveSpec *rs)
+{
+  ResolveDeadline *rd;
+  guint deadline;
+
+  deadline = grl_operation_options_get_deadline (rs->options);
+  if (deadline == 0) {
+    return;
+  }
+
+  rd = g_slice_new (ResolveDeadline);
+  rd->rrc = rrc;
+  rd->spec = rs;
+  rd->timed_out = FALSE;
+  rd->deadline_source = grl_operation_timeout_add (rs->operation_id,
+                                                   deadline,
+                                                   resolve_deadline_cb,
+                                                   rd,
+                                                   "[grilo] resolve_deadline_cb");
+  rs->callback = resolve_deadline_relay_cb;
+  rs->user_data = rd;
 }
 
 static gboolean
@@ -2426,7 +4242,16 @@ resolve_idle (gpointer user_data)
 
     operation_set_ongoing (rs->source, rs->operation_id);
     operation_set_started (rs->operation_id);
-    GRL_SOURCE_GET_CLASS (rs->source)->resolve (rs->source, rs);
+    resolve_spec_set_deadline (rrc, rs);
+    /* Batches are run from the main context, so a thread-safe source keeps
+       resolving in the workers */
+    if (rs->source->priv->thread_safe) {
+      worker_push (rs->source, GRL_OP_RESOLVE, rs->operation_id, rs);
+    } else if (GRL_SOURCE_GET_CLASS (rs->source)->resolve_batch) {
+      resolve_batch_push (rs->source, rs);
+    } else {
+      GRL_SOURCE_GET_CLASS (rs->source)->resolve (rs->source, rs);
+    }
   }
 
   return run_next;
@@ -2466,7 +4291,11 @@ media_from_uri_idle (gpointer user_data)
                     NULL, mfus->user_data, NULL);
   } else {
     operation_set_started (mfus->operation_id);
-    GRL_SOURCE_GET_CLASS (mfus->source)->media_from_uri (mfus->source, mfus);
+    if (mfus->source->priv->thread_safe) {
+      worker_push (mfus->source, GRL_OP_MEDIA_FROM_URI, mfus->operation_id, mfus);
+    } else {
+      GRL_SOURCE_GET_CLASS (mfus->source)->media_from_uri (mfus->source, mfus);
+    }
   }
 
   return FALSE;
@@ -2484,7 +4313,11 @@ browse_idle (gpointer user_data)
     bs->callback (bs->source, bs->operation_id, NULL, 0, bs->user_data, NULL);
   } else {
     operation_set_started (bs->operation_id);
-    GRL_SOURCE_GET_CLASS (bs->source)->browse (bs->source, bs);
+    if (bs->source->priv->thread_safe) {
+      worker_push (bs->source, GRL_OP_BROWSE, bs->operation_id, bs);
+    } else {
+      GRL_SOURCE_GET_CLASS (bs->source)->browse (bs->source, bs);
+    }
   }
 
   return FALSE;
@@ -2502,7 +4335,11 @@ search_idle (gpointer user_data)
     ss->callback (ss->source, ss->operation_id, NULL, 0, ss->user_data, NULL);
   } else {
     operation_set_started (ss->operation_id);
-    GRL_SOURCE_GET_CLASS (ss->source)->search (ss->source, ss);
+    if (ss->source->priv->thread_safe) {
+      worker_push (ss->source, GRL_OP_SEARCH, ss->operation_id, ss);
+    } else {
+      GRL_SOURCE_GET_CLASS (ss->source)->search (ss->source, ss);
+    }
   }
 
   return FALSE;
@@ -2519,7 +4356,11 @@ query_idle (gpointer user_data)
     qs->callback (qs->source, qs->operation_id, NULL, 0, qs->user_data, NULL);
   } else {
     operation_set_started (qs->operation_id);
-    GRL_SOURCE_GET_CLASS (qs->source)->query (qs->source, qs);
+    if (qs->source->priv->thread_safe) {
+      worker_push (qs->source, GRL_OP_QUERY, qs->operation_id, qs);
+    } else {
+      GRL_SOURCE_GET_CLASS (qs->source)->query (qs->source, qs);
+    }
   }
 
   return FALSE;
@@ -2541,6 +4382,18 @@ remove_idle (gpointer user_data)
   return FALSE;
 }
 
+/* Arguments of a synchronous operation, started by the sync layer */
+typedef struct {
+  GrlSource *source;
+  GrlMedia *media;
+  GrlMedia *parent;
+  const gchar *text;
+  const GList *keys;
+  GrlOperationOptions *options;
+  GrlWriteFlags flags;
+  GrlDataSync *ds;
+} SyncCall;
+
 static void
 resolve_result_async_cb (GrlSource *source,
                          guint operation_id,
@@ -2557,7 +4410,7 @@ resolve_result_async_cb (GrlSource *source,
   }
 
   ds->data = media;
-  ds->complete = TRUE;
+  grl_data_sync_complete (ds);
 }
 
 static void
@@ -2578,75 +4431,336 @@ multiple_result_async_cb (GrlSource *source,
     /* Free previous results */
     g_list_free_full (ds->data, g_object_unref);
 
-    ds->data = NULL;
-    ds->complete = TRUE;
+    ds->data = NULL;
+    grl_data_sync_complete (ds);
+    return;
+  }
+
+  if (media) {
+    ds->data = g_list_prepend (ds->data, media);
+  }
+
+  if (remaining == 0) {
+    ds->data = g_list_reverse (ds->data);
+    grl_data_sync_complete (ds);
+  }
+}
+
+static void
+remove_async_cb (GrlSource *source,
+                 GrlMedia *media,
+                 gpointer user_data,
+                 const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  grl_data_sync_complete (ds);
+}
+
+static void
+store_result_async_cb (GrlSource *source,
+                       GrlMedia *media,
+                       GList *failed_keys,
+                       gpointer user_data,
+                       const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->data = g_list_copy (failed_keys);
+  grl_data_sync_complete (ds);
+}
+
+
+static void
+store_metadata_result_async_cb (GrlSource *source,
+                                GrlMedia *media,
+                                GList *failed_keys,
+                                gpointer user_data,
+                                const GError *error)
+{
+  GrlDataSync *ds = (GrlDataSync *) user_data;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (error) {
+    ds->error = g_error_copy (error);
+  }
+
+  ds->data = g_list_copy (failed_keys);
+  grl_data_sync_complete (ds);
+}
+
+/* State of an operation run through the GTask API */
+typedef struct {
+  guint operation_id;
+  GPtrArray *medias;
+  gulong cancelled_id;
+  gboolean finished;
+  /* first error of a browse, search or query, returned once it ends */
+  GError *error;
+} TaskData;
+
+static void
+task_data_free (TaskData *data)
+{
+  g_clear_error (&data->error);
+  g_ptr_array_unref (data->medias);
+  g_slice_free (TaskData, data);
+}
+
+static GTask *
+task_new (GrlSource *source,
+          GCancellable *cancellable,
+          GAsyncReadyCallback callback,
+          gpointer user_data,
+          gpointer source_tag)
+{
+  GTask *task;
+  TaskData *data;
+
+  task = g_task_new (source, cancellable, callback, user_data);
+  g_task_set_source_tag (task, source_tag);
+
+  data = g_slice_new0 (TaskData);
+  data->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  g_task_set_task_data (task, data, (GDestroyNotify) task_data_free);
+
+  if (g_task_return_error_if_cancelled (task)) {
+    g_object_unref (task);
+    return NULL;
+  }
+
+  return task;
+}
+
+static gboolean
+task_cancel_idle (gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  TaskData *data = g_task_get_task_data (task);
+
+  if (!data->finished) {
+    grl_operation_cancel (data->operation_id);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+task_cancelled_cb (GCancellable *cancellable,
+                   gpointer user_data)
+{
+  GTask *task = G_TASK (user_data);
+  GSource *idle;
+
+  /* This can run in any thread, with the cancellable locked: cancel the
+     operation later, in its own context */
+  idle = g_idle_source_new ();
+  g_source_set_priority (idle, G_PRIORITY_HIGH);
+  g_source_set_callback (idle, task_cancel_idle,
+                         g_object_ref (task), g_object_unref);
+  g_source_set_name (idle, "[grilo] task_cancel_idle");
+  g_source_attach (idle, g_task_get_context (task));
+  g_source_unref (idle);
+}
+
+/* The operation takes the reference of @task, and drops it when finished */
+static void
+task_start (GTask *task,
+            guint operation_id,
+            GrlCoreError error_code)
+{
+  TaskData *data = g_task_get_task_data (task);
+  GCancellable *cancellable;
+
+  if (operation_id == 0) {
+    g_task_return_new_error (task,
+                             GRL_CORE_ERROR,
+                             error_code,
+                             _("Operation could not be started"));
+    g_object_unref (task);
+    return;
+  }
+
+  data->operation_id = operation_id;
+
+  cancellable = g_task_get_cancellable (task);
+  if (cancellable) {
+    data->cancelled_id = g_cancellable_connect (cancellable,
+                                                G_CALLBACK (task_cancelled_cb),
+                                                task, NULL);
+  }
+}
+
+static void
+task_finish (GTask *task)
+{
+  TaskData *data = g_task_get_task_data (task);
+
+  data->finished = TRUE;
+  if (data->cancelled_id) {
+    g_cancellable_disconnect (g_task_get_cancellable (task),
+                              data->cancelled_id);
+    data->cancelled_id = 0;
+  }
+}
+
+static void
+task_resolve_cb (GrlSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 gpointer user_data,
+                 const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task_finish (task);
+
+  if (error) {
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_pointer (task, g_object_ref (media), g_object_unref);
+  }
+
+  g_object_unref (task);
+}
+
+static void
+task_media_from_uri_cb (GrlSource *source,
+                        guint operation_id,
+                        GrlMedia *media,
+                        gpointer user_data,
+                        const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task_finish (task);
+
+  /* Unlike in resolve, the media belongs to the callback */
+  if (error) {
+    g_clear_object (&media);
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_pointer (task, media, g_object_unref);
+  }
+
+  g_object_unref (task);
+}
+
+static void
+task_result_cb (GrlSource *source,
+                guint operation_id,
+                GrlMedia *media,
+                guint remaining,
+                gpointer user_data,
+                const GError *error)
+{
+  GTask *task = G_TASK (user_data);
+  TaskData *data = g_task_get_task_data (task);
+
+  GRL_DEBUG (__FUNCTION__);
+
+  if (media) {
+    g_ptr_array_add (data->medias, media);
+  }
+
+  /* The operation goes on after an error: keep the task until its last
+     result */
+  if (error && !data->error) {
+    data->error = g_error_copy (error);
+  }
+
+  if (remaining > 0) {
     return;
   }
 
-  if (media) {
-    ds->data = g_list_prepend (ds->data, media);
-  }
+  task_finish (task);
 
-  if (remaining == 0) {
-    ds->data = g_list_reverse (ds->data);
-    ds->complete = TRUE;
+  if (data->error) {
+    g_task_return_error (task, g_steal_pointer (&data->error));
+  } else {
+    g_task_return_pointer (task,
+                           g_ptr_array_ref (data->medias),
+                           (GDestroyNotify) g_ptr_array_unref);
   }
+
+  g_object_unref (task);
 }
 
 static void
-remove_async_cb (GrlSource *source,
-                 GrlMedia *media,
-                 gpointer user_data,
-                 const GError *error)
+task_remove_cb (GrlSource *source,
+                GrlMedia *media,
+                gpointer user_data,
+                const GError *error)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  GTask *task = G_TASK (user_data);
 
   GRL_DEBUG (__FUNCTION__);
 
   if (error) {
-    ds->error = g_error_copy (error);
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_boolean (task, TRUE);
   }
 
-  ds->complete = TRUE;
+  g_object_unref (task);
 }
 
 static void
-store_result_async_cb (GrlSource *source,
-                       GrlMedia *media,
-                       GList *failed_keys,
-                       gpointer user_data,
-                       const GError *error)
+task_store_cb (GrlSource *source,
+               GrlMedia *media,
+               GList *failed_keys,
+               gpointer user_data,
+               const GError *error)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  GTask *task = G_TASK (user_data);
 
   GRL_DEBUG (__FUNCTION__);
 
   if (error) {
-    ds->error = g_error_copy (error);
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_boolean (task, TRUE);
   }
 
-  ds->data = g_list_copy (failed_keys);
-  ds->complete = TRUE;
+  g_object_unref (task);
 }
 
-
 static void
-store_metadata_result_async_cb (GrlSource *source,
-                                GrlMedia *media,
-                                GList *failed_keys,
-                                gpointer user_data,
-                                const GError *error)
+task_store_metadata_cb (GrlSource *source,
+                        GrlMedia *media,
+                        GList *failed_keys,
+                        gpointer user_data,
+                        const GError *error)
 {
-  GrlDataSync *ds = (GrlDataSync *) user_data;
+  GTask *task = G_TASK (user_data);
 
   GRL_DEBUG (__FUNCTION__);
 
   if (error) {
-    ds->error = g_error_copy (error);
+    g_task_return_error (task, g_error_copy (error));
+  } else {
+    g_task_return_pointer (task, g_list_copy (failed_keys),
+                           (GDestroyNotify) g_list_free);
   }
 
-  ds->data = g_list_copy (failed_keys);
-  ds->complete = TRUE;
+  g_object_unref (task);
 }
 
 static GHashTable *
@@ -2838,7 +4952,6 @@ run_store_metadata (GrlSource *source,
   GList *failed_keys = NULL;
   GError *error;
   struct StoreMetadataRelayCb *smrc;
-  guint id;
 
   map = map_writable_keys (source, keys, flags, &failed_keys);
 
@@ -2867,8 +4980,12 @@ run_store_metadata (GrlSource *source,
   smrc->user_callback = callback;
   smrc->user_data = user_data;
 
-  id = g_idle_add (store_metadata_idle, smrc);
-  g_source_set_name_by_id (id, "[grilo] store_metadata_idle");
+  grl_operation_idle_add (0,
+                          G_PRIORITY_DEFAULT_IDLE,
+                          store_metadata_idle,
+                          smrc,
+                          NULL,
+                          "[grilo] store_metadata_idle");
 }
 
 static gboolean
@@ -3123,7 +5240,7 @@ grl_source_supported_operations (GrlSource *source)
     return  source_class->supported_operations (source);
   }
 
-  if (source_class->resolve) {
+  if (source_class->resolve || source_class->resolve_batch) {
     ops |= GRL_OP_RESOLVE;
   }
   if (source_class->test_media_from_uri &&
@@ -3206,6 +5323,303 @@ grl_source_set_auto_split_threshold (GrlSource *source,
   g_return_if_fail (GRL_IS_SOURCE (source));
 
   source->priv->auto_split_threshold = threshold;
+  auto_split_tuner_reset (source);
+}
+
+/**
+ * grl_source_get_auto_split_window:
+ * @source: a source
+ *
+ * Gets how many auto-split chunks are requested to the source at the same
+ * time.
+ *
+ * See #grl_source_set_auto_split_window()
+ *
+ * Returns: the assigned window
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_get_auto_split_window (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 1);
+
+  return source->priv->auto_split_window;
+}
+
+/**
+ * grl_source_set_auto_split_window:
+ * @source: a source
+ * @window: the number of chunks to request in parallel
+ *
+ * Sets how many auto-split chunks are requested to the source at the same
+ * time.
+ *
+ * By default, when a request is splitted because of the auto-split threshold,
+ * a chunk is only requested after the source has sent all the elements in the
+ * previous one. With a @window bigger than 1, up to @window chunks are kept in
+ * flight, so sources with a high latency per request (like paginated web
+ * services) don't pay it once per chunk. Elements are still sent to the user in
+ * order, and cancelling the operation cancels all the pending chunks.
+ *
+ * Each chunk is a separate request to the source with its own operation
+ * identifier, so sources must be able to handle several requests at the same
+ * time.
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_auto_split_window (GrlSource *source,
+                                  guint window)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (window > 0);
+
+  source->priv->auto_split_window = window;
+}
+
+/**
+ * grl_source_get_auto_split_target_latency:
+ * @source: a source
+ *
+ * Gets the time the source should take to send the first element of an
+ * auto-split chunk.
+ *
+ * See #grl_source_set_auto_split_target_latency()
+ *
+ * Returns: the target latency in milliseconds, or 0 if chunk size is not tuned
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_get_auto_split_target_latency (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->auto_split_target_latency;
+}
+
+/**
+ * grl_source_set_auto_split_target_latency:
+ * @source: a source
+ * @latency: the target latency in milliseconds, or 0 to disable tuning
+ *
+ * Enables tuning at runtime the number of elements asked in each auto-split
+ * chunk.
+ *
+ * Each time the source finishes a chunk, the time it took to send the first
+ * element and the number of elements per second it sent are measured. Chunks
+ * are made smaller when the time to the first element goes over @latency, and
+ * bigger when the source is fast, never exceeding the auto-split threshold.
+ *
+ * The state of the tuner can be watched through the
+ * #GrlSource:auto-split-tuner-state property.
+ *
+ * See #grl_source_set_auto_split_threshold()
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_auto_split_target_latency (GrlSource *source,
+                                          guint latency)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->auto_split_target_latency = latency;
+  auto_split_tuner_reset (source);
+}
+
+/**
+ * grl_source_get_thread_safe:
+ * @source: a source
+ *
+ * Gets whether the operations of the source run on the thread pool.
+ *
+ * See #grl_source_set_thread_safe()
+ *
+ * Returns: %TRUE if the source is thread-safe
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_source_get_thread_safe (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), FALSE);
+
+  return source->priv->thread_safe;
+}
+
+/**
+ * grl_source_set_thread_safe:
+ * @source: a source
+ * @thread_safe: whether the source can run operations in other threads
+ *
+ * Declares the source as thread-safe. Its browse, search, query, resolve and
+ * media_from_uri functions are then run on a thread pool shared by all the
+ * sources, so CPU-heavy sources do not block the main context of the
+ * application. Results can be sent from any thread: they are delivered to the
+ * user in the main context where the operation was started.
+ *
+ * The source must be able to run several operations at the same time in
+ * different threads, and to have its cancel function called while they run.
+ * Once an operation is cancelled and its function has returned, the core
+ * finishes it without waiting for the last result, so the source must not use
+ * the operation spec any more; further results are dropped.
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_thread_safe (GrlSource *source,
+                            gboolean thread_safe)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  source->priv->thread_safe = thread_safe;
+}
+
+/**
+ * grl_source_get_max_concurrency:
+ * @source: a source
+ *
+ * Gets how many operations of the source can run in the thread pool at the
+ * same time.
+ *
+ * See #grl_source_set_max_concurrency()
+ *
+ * Returns: the maximum number of operations, or 0 if there is no limit
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_get_max_concurrency (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->max_concurrency;
+}
+
+/**
+ * grl_source_set_max_concurrency:
+ * @source: a source
+ * @max_concurrency: maximum number of operations, or 0 for no limit
+ *
+ * Sets how many operations of a thread-safe source can run in the thread pool
+ * at the same time. Further operations wait until one of them returns, so a
+ * single source cannot take all the threads of the pool.
+ *
+ * <note>
+ *  <para>
+ *    This function is intended to be used only by plugins.
+ *  </para>
+ * </note>
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_max_concurrency (GrlSource *source,
+                                guint max_concurrency)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  G_LOCK (workers);
+  source->priv->max_concurrency = max_concurrency;
+  G_UNLOCK (workers);
+}
+
+/**
+ * grl_source_get_resolve_batch_size:
+ * @source: a source
+ *
+ * Gets how many resolutions can be passed at once to the resolve_batch()
+ * function of the source.
+ *
+ * Returns: the maximum number of media resolved at once
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_get_resolve_batch_size (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->resolve_batch_size;
+}
+
+/**
+ * grl_source_set_resolve_batch_size:
+ * @source: a source
+ * @size: maximum number of media resolved at once
+ *
+ * Sets how many resolutions can be passed at once to the resolve_batch()
+ * function of the source. When that many are waiting, they are passed without
+ * waiting for the #GrlSource:resolve-batch-latency.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_resolve_batch_size (GrlSource *source,
+                                   guint size)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+  g_return_if_fail (size > 0);
+
+  G_LOCK (resolve_batches);
+  source->priv->resolve_batch_size = size;
+  G_UNLOCK (resolve_batches);
+}
+
+/**
+ * grl_source_get_resolve_batch_latency:
+ * @source: a source
+ *
+ * Gets how long resolutions wait for others to be passed together to the
+ * resolve_batch() function of the source.
+ *
+ * Returns: the time in milliseconds
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_get_resolve_batch_latency (GrlSource *source)
+{
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+
+  return source->priv->resolve_batch_latency;
+}
+
+/**
+ * grl_source_set_resolve_batch_latency:
+ * @source: a source
+ * @latency: time in milliseconds
+ *
+ * Sets how long resolutions wait for others to be passed together to the
+ * resolve_batch() function of the source. Higher values group more media, for
+ * instance when decorating the results of a browse with %GRL_RESOLVE_FULL, at
+ * the cost of delaying them.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_set_resolve_batch_latency (GrlSource *source,
+                                      guint latency)
+{
+  g_return_if_fail (GRL_IS_SOURCE (source));
+
+  G_LOCK (resolve_batches);
+  source->priv->resolve_batch_latency = latency;
+  G_UNLOCK (resolve_batches);
 }
 
 /**
@@ -3243,6 +5657,7 @@ grl_source_resolve (GrlSource *source,
   GList *sources = NULL;
   GrlResolutionFlags flags;
   GrlOperationOptions *resolve_options;
+  gboolean full;
 
   GRL_DEBUG (__FUNCTION__);
 
@@ -3261,29 +5676,25 @@ grl_source_resolve (GrlSource *source,
     grl_media_set_source (media, grl_source_get_id (source));
   }
 
+  /* Take what is already known from the cache */
+  grl_resolve_cache_fill (media, keys);
+
   /* By default assume we will use the parameters specified by the user */
   _keys = filter_known_keys (media, (GList *) keys);
 
   flags = grl_operation_options_get_resolution_flags (options);
+  full = (flags & GRL_RESOLVE_FULL) != 0;
 
-  if (flags & GRL_RESOLVE_FULL) {
+  /* Consider all resolvers if full metadata is requested, only this source
+     otherwise */
+  sources = resolve_plan_get_sources (source, full);
+
+  if (full) {
     GRL_DEBUG ("requested full metadata");
-    sources = grl_registry_get_sources_by_operations (grl_registry_get_default (),
-                                                      GRL_OP_RESOLVE,
-                                                      TRUE);
-    /* Put current source on top, if it supports resolve() */
-    if (grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
-      sources = g_list_remove (sources, source);
-      sources = g_list_prepend (sources, source);
-    }
     flags &= ~GRL_RESOLVE_FULL;
     resolve_options = grl_operation_options_copy (options);
     grl_operation_options_set_resolution_flags (resolve_options, flags);
   } else {
-    /* Consider only this source, if it supports resolve() */
-    if (grl_source_supported_operations (source) & GRL_OP_RESOLVE) {
-      sources = g_list_prepend (NULL, source);
-    }
     resolve_options = g_object_ref (options);
   }
 
@@ -3309,14 +5720,13 @@ grl_source_resolve (GrlSource *source,
 
   /* If there are no sources able to solve just send the media */
   if (g_list_length (sources) == 0) {
-    guint id;
     g_list_free (_keys);
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_all_done,
-                          rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_all_done");
+    grl_operation_idle_add (operation_id,
+                            flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            resolve_all_done,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_all_done");
     return operation_id;
   }
 
@@ -3326,7 +5736,8 @@ grl_source_resolve (GrlSource *source,
   rrc->map = map_keys_new ();
   rrc->resolve_specs = map_sources_new ();
 
-  map_keys_to_sources (rrc->map, _keys, sources, media, flags & GRL_RESOLVE_FAST_ONLY);
+  map_keys_to_sources (rrc->map, _keys, source, media,
+                       full, flags & GRL_RESOLVE_FAST_ONLY);
   g_list_free (sources);
 
   each_key = rrc->keys;
@@ -3344,26 +5755,37 @@ grl_source_resolve (GrlSource *source,
 
   rrc->specs_to_invoke = g_hash_table_get_values (rrc->resolve_specs);
   if (rrc->specs_to_invoke) {
-    guint id;
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_idle,
-                          rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_idle");
+    grl_operation_idle_add (operation_id,
+                            flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            resolve_idle,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_idle");
   } else {
-    guint id;
-    id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                          G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                          resolve_all_done,
-                          rrc,
-                          NULL);
-    g_source_set_name_by_id (id, "[grilo] resolve_all_done");
+    grl_operation_idle_add (operation_id,
+                            flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                            resolve_all_done,
+                            rrc,
+                            NULL,
+                            "[grilo] resolve_all_done");
   }
 
   return operation_id;
 }
 
+static gboolean
+resolve_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_resolve (call->source,
+                             call->media,
+                             call->keys,
+                             call->options,
+                             resolve_result_async_cb,
+                             call->ds) > 0;
+}
+
 /**
  * grl_source_resolve_sync:
  * @source: a source
@@ -3378,6 +5800,10 @@ grl_source_resolve (GrlSource *source,
  *
  * This method is synchronous.
  *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
  * Returns: (transfer full): a filled #GrlMedia
  *
  * Since: 0.2.0
@@ -3390,16 +5816,20 @@ grl_source_resolve_sync (GrlSource *source,
                          GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_resolve (source,
-                          media,
-                          keys,
-                          options,
-                          resolve_result_async_cb,
-                          ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.media = media;
+  call.keys = keys;
+  call.options = options;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     resolve_sync_start,
+                     &call);
 
   if (ds->error) {
     if (error) {
@@ -3409,9 +5839,86 @@ grl_source_resolve_sync (GrlSource *source,
     }
   }
 
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
+
+  return media;
+}
+
+/**
+ * grl_source_resolve_async:
+ * @source: a source
+ * @media: a data transfer object
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Fetches the requested keys of metadata of @media.
+ *
+ * Cancelling @cancellable cancels the operation, and then
+ * grl_source_resolve_finish() fails with %G_IO_ERROR_CANCELLED.
+ *
+ * This method is asynchronous. Call grl_source_resolve_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_resolve_async (GrlSource *source,
+                          GrlMedia *media,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GCancellable *cancellable,
+                          GAsyncReadyCallback callback,
+                          gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_resolve_async);
+  if (!task) {
+    return;
+  }
+
+  task_start (task,
+              grl_source_resolve (source,
+                                  media,
+                                  keys,
+                                  options,
+                                  task_resolve_cb,
+                                  task),
+              GRL_CORE_ERROR_RESOLVE_FAILED);
+}
+
+/**
+ * grl_source_resolve_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_resolve_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_resolve_async().
+ *
+ * Returns: (transfer full): the filled #GrlMedia, or %NULL on error
+ *
+ * Since: 0.3.13
+ */
+GrlMedia *
+grl_source_resolve_finish (GrlSource *source,
+                           GAsyncResult *result,
+                           GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_resolve_async),
+                        NULL);
 
-  return media;
+  return g_task_propagate_pointer (G_TASK (result), error);
 }
 
 /**
@@ -3459,7 +5966,7 @@ grl_source_may_resolve (GrlSource *source,
 
   /* Default behaviour is to assume that if source implements resolve, then any
      supported key for its own content is resolved */
-  if (klass->resolve) {
+  if (klass->resolve || klass->resolve_batch) {
     GRL_DEBUG ("Using default may_resolve()");
     /* We need to know the media source */
     if (media == NULL ||
@@ -3551,7 +6058,6 @@ grl_source_get_media_from_uri (GrlSource *source,
   struct ResolveRelayCb *rrc;
   guint operation_id;
   GrlResolutionFlags flags;
-  guint id;
 
   GRL_DEBUG (__FUNCTION__);
 
@@ -3609,16 +6115,29 @@ grl_source_get_media_from_uri (GrlSource *source,
 
   operation_set_ongoing (source, operation_id);
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY?
-                        G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        media_from_uri_idle,
-                        mfus,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] media_from_uri_idle");
+  grl_operation_idle_add (operation_id,
+                          flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                          media_from_uri_idle,
+                          mfus,
+                          NULL,
+                          "[grilo] media_from_uri_idle");
 
   return operation_id;
 }
 
+static gboolean
+media_from_uri_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_get_media_from_uri (call->source,
+                                        call->text,
+                                        call->keys,
+                                        call->options,
+                                        resolve_result_async_cb,
+                                        call->ds) > 0;
+}
+
 /**
  * grl_source_get_media_from_uri_sync:
  * @source: a source
@@ -3636,6 +6155,10 @@ grl_source_get_media_from_uri (GrlSource *source,
  *
  * This method is synchronous.
  *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
  * Returns: (transfer full): a filled #GrlMedia
  *
  * Since: 0.2.0
@@ -3648,17 +6171,21 @@ grl_source_get_media_from_uri_sync (GrlSource *source,
                                     GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
   GrlMedia *result;
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_get_media_from_uri (source,
-                                     uri,
-                                     keys,
-                                     options,
-                                     resolve_result_async_cb,
-                                     ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.text = uri;
+  call.keys = keys;
+  call.options = options;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     media_from_uri_sync_start,
+                     &call);
 
   if (ds->error) {
     if (error) {
@@ -3669,11 +6196,89 @@ grl_source_get_media_from_uri_sync (GrlSource *source,
   }
 
   result = (GrlMedia *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
 
   return result;
 }
 
+/**
+ * grl_source_get_media_from_uri_async:
+ * @source: a source
+ * @uri: a URI
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Creates an instance of #GrlMedia representing the media resource
+ * exposed at @uri.
+ *
+ * Cancelling @cancellable cancels the operation, and then
+ * grl_source_get_media_from_uri_finish() fails with %G_IO_ERROR_CANCELLED.
+ *
+ * This method is asynchronous. Call grl_source_get_media_from_uri_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_get_media_from_uri_async (GrlSource *source,
+                                     const gchar *uri,
+                                     const GList *keys,
+                                     GrlOperationOptions *options,
+                                     GCancellable *cancellable,
+                                     GAsyncReadyCallback callback,
+                                     gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_get_media_from_uri_async);
+  if (!task) {
+    return;
+  }
+
+  task_start (task,
+              grl_source_get_media_from_uri (source,
+                                             uri,
+                                             keys,
+                                             options,
+                                             task_media_from_uri_cb,
+                                             task),
+              GRL_CORE_ERROR_MEDIA_FROM_URI_FAILED);
+}
+
+/**
+ * grl_source_get_media_from_uri_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_get_media_from_uri_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_get_media_from_uri_async().
+ *
+ * Returns: (transfer full): a #GrlMedia, or %NULL on error
+ *
+ * Since: 0.3.13
+ */
+GrlMedia *
+grl_source_get_media_from_uri_finish (GrlSource *source,
+                                      GAsyncResult *result,
+                                      GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_get_media_from_uri_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * grl_source_browse:
  * @source: a source
@@ -3705,7 +6310,6 @@ grl_source_browse (GrlSource *source,
   guint operation_id;
   struct BrowseRelayCb *brc;
   GrlResolutionFlags flags;
-  guint id;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
   g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
@@ -3745,6 +6349,8 @@ grl_source_browse (GrlSource *source,
   brc->user_data = user_data;
   brc->queue = NULL;
   brc->dispatcher_running = FALSE;
+  brc->deadline_source = NULL;
+  brc->timed_out = FALSE;
 
   bs = g_new (GrlSourceBrowseSpec, 1);
   bs->source = g_object_ref (source);
@@ -3773,16 +6379,33 @@ grl_source_browse (GrlSource *source,
   brc->auto_split = auto_split_setup (source, bs->options);
 
   operation_set_ongoing (source, operation_id);
+  browse_relay_set_deadline (brc);
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        browse_idle,
-                        bs,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] browse_idle");
+  grl_operation_idle_add (operation_id,
+                          flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                          browse_idle,
+                          bs,
+                          NULL,
+                          "[grilo] browse_idle");
+
+  auto_split_start (brc);
 
   return operation_id;
 }
 
+static gboolean
+browse_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_browse (call->source,
+                            call->media,
+                            call->keys,
+                            call->options,
+                            multiple_result_async_cb,
+                            call->ds) > 0;
+}
+
 /**
  * grl_source_browse_sync:
  * @source: a source
@@ -3797,6 +6420,10 @@ grl_source_browse (GrlSource *source,
  *
  * This method is synchronous.
  *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
  * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
  * elements. After use g_object_unref() every element and g_list_free() the
  * list.
@@ -3811,17 +6438,21 @@ grl_source_browse_sync (GrlSource *source,
                         GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
   GList *result;
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_browse (source,
-                         container,
-                         keys,
-                         options,
-                         multiple_result_async_cb,
-                         ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.media = container;
+  call.keys = keys;
+  call.options = options;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     browse_sync_start,
+                     &call);
 
   if (ds->error) {
     if (error) {
@@ -3832,11 +6463,181 @@ grl_source_browse_sync (GrlSource *source,
   }
 
   result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
 
   return result;
 }
 
+/**
+ * grl_source_browse_async:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Browse media elements through an available list, collecting all of them.
+ *
+ * Cancelling @cancellable cancels the operation, and then
+ * grl_source_browse_finish() fails with %G_IO_ERROR_CANCELLED.
+ *
+ * This method is asynchronous. Call grl_source_browse_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_browse_async (GrlSource *source,
+                         GrlMedia *container,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_browse_async);
+  if (!task) {
+    return;
+  }
+
+  task_start (task,
+              grl_source_browse (source,
+                                 container,
+                                 keys,
+                                 options,
+                                 task_result_cb,
+                                 task),
+              GRL_CORE_ERROR_BROWSE_FAILED);
+}
+
+/**
+ * grl_source_browse_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_browse_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_browse_async().
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * #GrlMedia elements, or %NULL on error. Use g_ptr_array_unref() after use.
+ *
+ * Since: 0.3.13
+ */
+GPtrArray *
+grl_source_browse_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_browse_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_source_browse_stream:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Browse media elements through an available list, getting them from the
+ * returned stream as they are needed.
+ *
+ * Results are requested from @source in chunks, and a new chunk is only
+ * requested when most of the previous one has been taken from the stream,
+ * so a slow consumer does not make results pile up in memory. The skip and
+ * count of @options apply to the whole stream.
+ *
+ * Returns: (transfer full): a #GrlResultStream. Use g_object_unref() after
+ * use.
+ *
+ * Since: 0.3.13
+ */
+GrlResultStream *
+grl_source_browse_stream (GrlSource *source,
+                          GrlMedia *container,
+                          const GList *keys,
+                          GrlOperationOptions *options)
+{
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+  g_return_val_if_fail (check_options (source, GRL_OP_BROWSE, options), NULL);
+
+  return grl_result_stream_new (source, GRL_OP_BROWSE, container, NULL, keys, options,
+                                auto_split_tuner_get_chunk_size (source));
+}
+
+/**
+ * grl_source_browse_batched:
+ * @source: a source
+ * @container: (allow-none): a container of data transfer objects
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Same as grl_source_browse(), but results are handed to @callback in batches
+ * instead of one by one.
+ *
+ * A batch is delivered as soon as it holds as many elements as set with
+ * grl_operation_options_set_batch_size(), or when the time set with
+ * grl_operation_options_set_batch_latency() has elapsed since its first
+ * element was received, whatever happens first. If neither is set, all the
+ * results are delivered in a single batch when the operation finishes.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_browse_batched (GrlSource *source,
+                           GrlMedia *container,
+                           const GList *keys,
+                           GrlOperationOptions *options,
+                           GrlSourceResultBatchCb callback,
+                           gpointer user_data)
+{
+  struct BatchRelayCb *bth;
+  guint operation_id;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (callback != NULL, 0);
+
+  bth = batch_relay_new (source, options, callback, user_data);
+
+  operation_id = grl_source_browse (source,
+                                   container,
+                                   keys,
+                                   options,
+                                   batch_result_relay_cb,
+                                   bth);
+  if (operation_id == 0) {
+    batch_relay_free (bth);
+  }
+
+  return operation_id;
+}
+
 /**
  * grl_source_search:
  * @source: a source
@@ -3873,7 +6674,6 @@ grl_source_search (GrlSource *source,
   guint operation_id;
   struct BrowseRelayCb *brc;
   GrlResolutionFlags flags;
-  guint id;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
   g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
@@ -3913,6 +6713,8 @@ grl_source_search (GrlSource *source,
   brc->user_data = user_data;
   brc->queue = NULL;
   brc->dispatcher_running = FALSE;
+  brc->deadline_source = NULL;
+  brc->timed_out = FALSE;
 
   ss = g_new (GrlSourceSearchSpec, 1);
   ss->source = g_object_ref (source);
@@ -3932,16 +6734,33 @@ grl_source_search (GrlSource *source,
   brc->auto_split = auto_split_setup (source, ss->options);
 
   operation_set_ongoing (source, operation_id);
+  browse_relay_set_deadline (brc);
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        search_idle,
-                        ss,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] search_idle");
+  grl_operation_idle_add (operation_id,
+                          flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                          search_idle,
+                          ss,
+                          NULL,
+                          "[grilo] search_idle");
+
+  auto_split_start (brc);
 
   return operation_id;
 }
 
+static gboolean
+search_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_search (call->source,
+                            call->text,
+                            call->keys,
+                            call->options,
+                            multiple_result_async_cb,
+                            call->ds) > 0;
+}
+
 /**
  * grl_source_search_sync:
  * @source: a source
@@ -3949,55 +6768,234 @@ grl_source_search (GrlSource *source,
  * @keys: (element-type GrlKeyID): the #GList of
  * #GrlKeyID<!-- -->s to request
  * @options: options wanted for that operation
- * @error: a #GError, or @NULL
+ * @error: a #GError, or @NULL
+ *
+ * Search for the @text string in a source for data identified with that string.
+ *
+ * If @text is @NULL then no text filter will be applied, and thus, no media
+ * items from @source will be filtered. If @source does not support NULL-text
+ * search operations it should notiy the client by setting
+ * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in the error parameter.
+ *
+ * This method is synchronous.
+ *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
+ * elements. After use g_object_unref() every element and g_list_free() the
+ * list.
+ *
+ * Since: 0.2.0
+ */
+GList *
+grl_source_search_sync (GrlSource *source,
+                        const gchar *text,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GError **error)
+{
+  GrlDataSync *ds;
+  SyncCall call = { 0, };
+  GList *result;
+
+  ds = grl_data_sync_new ();
+
+  call.source = source;
+  call.text = text;
+  call.keys = keys;
+  call.options = options;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     search_sync_start,
+                     &call);
+
+  if (ds->error) {
+    if (error) {
+      *error = ds->error;
+    } else {
+      g_error_free (ds->error);
+    }
+  }
+
+  result = (GList *) ds->data;
+  grl_data_sync_free (ds);
+
+  return result;
+}
+
+/**
+ * grl_source_search_async:
+ * @source: a source
+ * @text: the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Search for the @text string in a source for data identified with that
+ * string, collecting all the results.
+ *
+ * Cancelling @cancellable cancels the operation, and then
+ * grl_source_search_finish() fails with %G_IO_ERROR_CANCELLED.
+ *
+ * This method is asynchronous. Call grl_source_search_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_search_async (GrlSource *source,
+                         const gchar *text,
+                         const GList *keys,
+                         GrlOperationOptions *options,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_search_async);
+  if (!task) {
+    return;
+  }
+
+  task_start (task,
+              grl_source_search (source,
+                                 text,
+                                 keys,
+                                 options,
+                                 task_result_cb,
+                                 task),
+              GRL_CORE_ERROR_SEARCH_FAILED);
+}
+
+/**
+ * grl_source_search_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_search_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_search_async().
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * #GrlMedia elements, or %NULL on error. Use g_ptr_array_unref() after use.
+ *
+ * Since: 0.3.13
+ */
+GPtrArray *
+grl_source_search_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_search_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_source_search_stream:
+ * @source: a source
+ * @text: the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Search for the @text string in a source for data identified with that
+ * string, getting the results from the returned stream as they are needed.
+ *
+ * Results are requested from @source in chunks, and a new chunk is only
+ * requested when most of the previous one has been taken from the stream,
+ * so a slow consumer does not make results pile up in memory. The skip and
+ * count of @options apply to the whole stream.
+ *
+ * Returns: (transfer full): a #GrlResultStream. Use g_object_unref() after
+ * use.
+ *
+ * Since: 0.3.13
+ */
+GrlResultStream *
+grl_source_search_stream (GrlSource *source,
+                          const gchar *text,
+                          const GList *keys,
+                          GrlOperationOptions *options)
+{
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+  g_return_val_if_fail (check_options (source, GRL_OP_SEARCH, options), NULL);
+
+  return grl_result_stream_new (source, GRL_OP_SEARCH, NULL, text, keys, options,
+                                auto_split_tuner_get_chunk_size (source));
+}
+
+/**
+ * grl_source_search_batched:
+ * @source: a source
+ * @text: the text to search
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
  *
- * Search for the @text string in a source for data identified with that string.
+ * Same as grl_source_search(), but results are handed to @callback in batches
+ * instead of one by one.
  *
- * If @text is @NULL then no text filter will be applied, and thus, no media
- * items from @source will be filtered. If @source does not support NULL-text
- * search operations it should notiy the client by setting
- * @GRL_CORE_ERROR_SEARCH_NULL_UNSUPPORTED in the error parameter.
+ * A batch is delivered as soon as it holds as many elements as set with
+ * grl_operation_options_set_batch_size(), or when the time set with
+ * grl_operation_options_set_batch_latency() has elapsed since its first
+ * element was received, whatever happens first. If neither is set, all the
+ * results are delivered in a single batch when the operation finishes.
  *
- * This method is synchronous.
+ * This method is asynchronous.
  *
- * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
- * elements. After use g_object_unref() every element and g_list_free() the
- * list.
+ * Returns: the operation identifier
  *
- * Since: 0.2.0
+ * Since: 0.3.13
  */
-GList *
-grl_source_search_sync (GrlSource *source,
-                        const gchar *text,
-                        const GList *keys,
-                        GrlOperationOptions *options,
-                        GError **error)
+guint
+grl_source_search_batched (GrlSource *source,
+                           const gchar *text,
+                           const GList *keys,
+                           GrlOperationOptions *options,
+                           GrlSourceResultBatchCb callback,
+                           gpointer user_data)
 {
-  GrlDataSync *ds;
-  GList *result;
+  struct BatchRelayCb *bth;
+  guint operation_id;
 
-  ds = g_slice_new0 (GrlDataSync);
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (callback != NULL, 0);
 
-  if (grl_source_search (source,
-                         text,
-                         keys,
-                         options,
-                         multiple_result_async_cb,
-                         ds))
-    grl_wait_for_async_operation_complete (ds);
+  bth = batch_relay_new (source, options, callback, user_data);
 
-  if (ds->error) {
-    if (error) {
-      *error = ds->error;
-    } else {
-      g_error_free (ds->error);
-    }
+  operation_id = grl_source_search (source,
+                                   text,
+                                   keys,
+                                   options,
+                                   batch_result_relay_cb,
+                                   bth);
+  if (operation_id == 0) {
+    batch_relay_free (bth);
   }
 
-  result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
-
-  return result;
+  return operation_id;
 }
 
 /**
@@ -4035,7 +7033,6 @@ grl_source_query (GrlSource *source,
   guint operation_id;
   struct BrowseRelayCb *brc;
   GrlResolutionFlags flags;
-  guint id;
 
   g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
   g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
@@ -4075,6 +7072,8 @@ grl_source_query (GrlSource *source,
   brc->user_data = user_data;
   brc->queue = NULL;
   brc->dispatcher_running = FALSE;
+  brc->deadline_source = NULL;
+  brc->timed_out = FALSE;
 
   qs = g_new (GrlSourceQuerySpec, 1);
   qs->source = g_object_ref (source);
@@ -4094,16 +7093,33 @@ grl_source_query (GrlSource *source,
   brc->auto_split = auto_split_setup (source, qs->options);
 
   operation_set_ongoing (source, operation_id);
+  browse_relay_set_deadline (brc);
 
-  id = g_idle_add_full (flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
-                        query_idle,
-                        qs,
-                        NULL);
-  g_source_set_name_by_id (id, "[grilo] query_idle");
+  grl_operation_idle_add (operation_id,
+                          flags & GRL_RESOLVE_IDLE_RELAY? G_PRIORITY_DEFAULT_IDLE: G_PRIORITY_HIGH_IDLE,
+                          query_idle,
+                          qs,
+                          NULL,
+                          "[grilo] query_idle");
+
+  auto_split_start (brc);
 
   return operation_id;
 }
 
+static gboolean
+query_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_query (call->source,
+                           call->text,
+                           call->keys,
+                           call->options,
+                           multiple_result_async_cb,
+                           call->ds) > 0;
+}
+
 /**
  * grl_source_query_sync:
  * @source: a source
@@ -4118,6 +7134,10 @@ grl_source_query (GrlSource *source,
  *
  * This method is synchronous.
  *
+ * If @options has %GRL_RESOLVE_PRIVATE_CONTEXT, only a private main context
+ * is iterated until it returns; see that flag for the sources it does not
+ * work with.
+ *
  * Returns: (element-type GrlMedia) (transfer full): a #GList with #GrlMedia
  * elements. After use g_object_unref() every element and g_list_free() the
  * list.
@@ -4132,17 +7152,21 @@ grl_source_query_sync (GrlSource *source,
                        GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
   GList *result;
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_query (source,
-                        query,
-                        keys,
-                        options,
-                        multiple_result_async_cb,
-                        ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.text = query;
+  call.keys = keys;
+  call.options = options;
+  call.ds = ds;
+  grl_data_sync_run (ds,
+                     grl_operation_options_get_resolution_flags (options) &
+                     GRL_RESOLVE_PRIVATE_CONTEXT,
+                     query_sync_start,
+                     &call);
 
   if (ds->error) {
     if (error) {
@@ -4153,11 +7177,183 @@ grl_source_query_sync (GrlSource *source,
   }
 
   result = (GList *) ds->data;
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
 
   return result;
 }
 
+/**
+ * grl_source_query_async:
+ * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Execute a specialized query (specific for each source) on a source,
+ * collecting all the results.
+ *
+ * Cancelling @cancellable cancels the operation, and then
+ * grl_source_query_finish() fails with %G_IO_ERROR_CANCELLED.
+ *
+ * This method is asynchronous. Call grl_source_query_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_query_async (GrlSource *source,
+                        const gchar *query,
+                        const GList *keys,
+                        GrlOperationOptions *options,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_query_async);
+  if (!task) {
+    return;
+  }
+
+  task_start (task,
+              grl_source_query (source,
+                                query,
+                                keys,
+                                options,
+                                task_result_cb,
+                                task),
+              GRL_CORE_ERROR_QUERY_FAILED);
+}
+
+/**
+ * grl_source_query_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_query_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_query_async().
+ *
+ * Returns: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * #GrlMedia elements, or %NULL on error. Use g_ptr_array_unref() after use.
+ *
+ * Since: 0.3.13
+ */
+GPtrArray *
+grl_source_query_finish (GrlSource *source,
+                         GAsyncResult *result,
+                         GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_query_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * grl_source_query_stream:
+ * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ *
+ * Execute a specialized query (specific for each source) on a source,
+ * getting the results from the returned stream as they are needed.
+ *
+ * Results are requested from @source in chunks, and a new chunk is only
+ * requested when most of the previous one has been taken from the stream,
+ * so a slow consumer does not make results pile up in memory. The skip and
+ * count of @options apply to the whole stream.
+ *
+ * Returns: (transfer full): a #GrlResultStream. Use g_object_unref() after
+ * use.
+ *
+ * Since: 0.3.13
+ */
+GrlResultStream *
+grl_source_query_stream (GrlSource *source,
+                         const gchar *query,
+                         const GList *keys,
+                         GrlOperationOptions *options)
+{
+  GRL_DEBUG (__FUNCTION__);
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), NULL);
+  g_return_val_if_fail (query != NULL, NULL);
+  g_return_val_if_fail (check_options (source, GRL_OP_QUERY, options), NULL);
+
+  return grl_result_stream_new (source, GRL_OP_QUERY, NULL, query, keys, options,
+                                auto_split_tuner_get_chunk_size (source));
+}
+
+/**
+ * grl_source_query_batched:
+ * @source: a source
+ * @query: the query to process
+ * @keys: (element-type GrlKeyID): the #GList of
+ * #GrlKeyID<!-- -->s to request
+ * @options: options wanted for that operation
+ * @callback: (scope notified): the user defined callback
+ * @user_data: the user data to pass in the callback
+ *
+ * Same as grl_source_query(), but results are handed to @callback in batches
+ * instead of one by one.
+ *
+ * A batch is delivered as soon as it holds as many elements as set with
+ * grl_operation_options_set_batch_size(), or when the time set with
+ * grl_operation_options_set_batch_latency() has elapsed since its first
+ * element was received, whatever happens first. If neither is set, all the
+ * results are delivered in a single batch when the operation finishes.
+ *
+ * This method is asynchronous.
+ *
+ * Returns: the operation identifier
+ *
+ * Since: 0.3.13
+ */
+guint
+grl_source_query_batched (GrlSource *source,
+                          const gchar *query,
+                          const GList *keys,
+                          GrlOperationOptions *options,
+                          GrlSourceResultBatchCb callback,
+                          gpointer user_data)
+{
+  struct BatchRelayCb *bth;
+  guint operation_id;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), 0);
+  g_return_val_if_fail (GRL_IS_OPERATION_OPTIONS (options), 0);
+  g_return_val_if_fail (callback != NULL, 0);
+
+  bth = batch_relay_new (source, options, callback, user_data);
+
+  operation_id = grl_source_query (source,
+                                  query,
+                                  keys,
+                                  options,
+                                  batch_result_relay_cb,
+                                  bth);
+  if (operation_id == 0) {
+    batch_relay_free (bth);
+  }
+
+  return operation_id;
+}
+
 static gboolean
 grl_source_store_remove_impl (GrlSource *source,
                               GrlMedia *media,
@@ -4167,7 +7363,6 @@ grl_source_store_remove_impl (GrlSource *source,
   const gchar *id;
   struct RemoveRelayCb *rrc;
   GrlSourceRemoveSpec *rs;
-  guint tag_id;
 
   GRL_DEBUG (__FUNCTION__);
 
@@ -4201,8 +7396,12 @@ grl_source_store_remove_impl (GrlSource *source,
     rrc->spec = rs;
   }
 
-  tag_id = g_idle_add (remove_idle, rrc);
-  g_source_set_name_by_id (tag_id, "[grilo] remove_idle");
+  grl_operation_idle_add (0,
+                          G_PRIORITY_DEFAULT_IDLE,
+                          remove_idle,
+                          rrc,
+                          NULL,
+                          "[grilo] remove_idle");
 
   return TRUE;
 }
@@ -4229,6 +7428,17 @@ grl_source_remove (GrlSource *source,
   grl_source_store_remove_impl (source, media, callback, user_data);
 }
 
+static gboolean
+remove_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_store_remove_impl (call->source,
+                                       call->media,
+                                       remove_async_cb,
+                                       call->ds);
+}
+
 /**
  * grl_source_remove_sync:
  * @source: a source
@@ -4247,14 +7457,14 @@ grl_source_remove_sync (GrlSource *source,
                         GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_store_remove_impl (source,
-                                    media,
-                                    remove_async_cb,
-                                    ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.media = media;
+  call.ds = ds;
+  grl_data_sync_run (ds, FALSE, remove_sync_start, &call);
 
   if (ds->error) {
     if (error) {
@@ -4264,7 +7474,72 @@ grl_source_remove_sync (GrlSource *source,
     }
   }
 
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
+}
+
+/**
+ * grl_source_remove_async:
+ * @source: a source
+ * @media: a data transfer object
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Remove a @media from the @source repository.
+ *
+ * @cancellable is only checked before starting, as this operation can not be
+ * cancelled once started.
+ *
+ * This method is asynchronous. Call grl_source_remove_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_remove_async (GrlSource *source,
+                         GrlMedia *media,
+                         GCancellable *cancellable,
+                         GAsyncReadyCallback callback,
+                         gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_remove_async);
+  if (!task) {
+    return;
+  }
+
+  grl_source_remove (source, media, task_remove_cb, task);
+}
+
+/**
+ * grl_source_remove_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_remove_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_remove_async().
+ *
+ * Returns: %TRUE if @media was removed, %FALSE on error
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_source_remove_finish (GrlSource *source,
+                          GAsyncResult *result,
+                          GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), FALSE);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_remove_async),
+                        FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 static gboolean
@@ -4277,7 +7552,6 @@ grl_source_store_impl (GrlSource *source,
 {
   struct StoreRelayCb *src;
   GrlSourceStoreSpec *ss;
-  guint id;
 
   GRL_DEBUG (__FUNCTION__);
 
@@ -4305,8 +7579,12 @@ grl_source_store_impl (GrlSource *source,
 
   src->spec = ss;
 
-  id = g_idle_add (store_idle, ss);
-  g_source_set_name_by_id (id, "[grilo] store_idle");
+  grl_operation_idle_add (0,
+                          G_PRIORITY_DEFAULT_IDLE,
+                          store_idle,
+                          ss,
+                          NULL,
+                          "[grilo] store_idle");
 
   return TRUE;
 }
@@ -4337,6 +7615,19 @@ grl_source_store (GrlSource *source,
   grl_source_store_impl (source, parent, media, flags, callback, user_data);
 }
 
+static gboolean
+store_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_store_impl (call->source,
+                                call->parent,
+                                call->media,
+                                call->flags,
+                                store_result_async_cb,
+                                call->ds);
+}
+
 /**
  * grl_source_store_sync:
  * @source: a source
@@ -4359,16 +7650,16 @@ grl_source_store_sync (GrlSource *source,
                        GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_store_impl (source,
-                             parent,
-                             media,
-                             flags,
-                             store_result_async_cb,
-                             ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.parent = parent;
+  call.media = media;
+  call.flags = flags;
+  call.ds = ds;
+  grl_data_sync_run (ds, FALSE, store_sync_start, &call);
 
   if (ds->error) {
     if (error) {
@@ -4378,7 +7669,76 @@ grl_source_store_sync (GrlSource *source,
     }
   }
 
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
+}
+
+/**
+ * grl_source_store_async:
+ * @source: a source
+ * @parent: (allow-none): a parent to store the data transfer objects
+ * @media: a data transfer object
+ * @flags: flags to configure specific behaviour of the operation
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Store the @media into the @parent container.
+ *
+ * @cancellable is only checked before starting, as this operation can not be
+ * cancelled once started.
+ *
+ * This method is asynchronous. Call grl_source_store_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_store_async (GrlSource *source,
+                        GrlMedia *parent,
+                        GrlMedia *media,
+                        GrlWriteFlags flags,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_store_async);
+  if (!task) {
+    return;
+  }
+
+  grl_source_store (source, parent, media, flags, task_store_cb, task);
+}
+
+/**
+ * grl_source_store_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_store_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_store_async().
+ *
+ * Returns: %TRUE if @media was stored, %FALSE on error
+ *
+ * Since: 0.3.13
+ */
+gboolean
+grl_source_store_finish (GrlSource *source,
+                         GAsyncResult *result,
+                         GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), FALSE);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_store_async),
+                        FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
 }
 
 static gboolean
@@ -4434,6 +7794,19 @@ grl_source_store_metadata (GrlSource *source,
                                   user_data);
 }
 
+static gboolean
+store_metadata_sync_start (gpointer user_data)
+{
+  SyncCall *call = (SyncCall *) user_data;
+
+  return grl_source_store_metadata_impl (call->source,
+                                         call->media,
+                                         (GList *) call->keys,
+                                         call->flags,
+                                         store_metadata_result_async_cb,
+                                         call->ds);
+}
+
 /**
  * grl_source_store_metadata_sync:
  * @source: a source
@@ -4462,17 +7835,17 @@ grl_source_store_metadata_sync (GrlSource *source,
                                 GError **error)
 {
   GrlDataSync *ds;
+  SyncCall call = { 0, };
   GList *failed;
 
-  ds = g_slice_new0 (GrlDataSync);
+  ds = grl_data_sync_new ();
 
-  if (grl_source_store_metadata_impl (source,
-                                      media,
-                                      keys,
-                                      flags,
-                                      store_metadata_result_async_cb,
-                                      ds))
-    grl_wait_for_async_operation_complete (ds);
+  call.source = source;
+  call.media = media;
+  call.keys = keys;
+  call.flags = flags;
+  call.ds = ds;
+  grl_data_sync_run (ds, FALSE, store_metadata_sync_start, &call);
 
   if (ds->error) {
     if (error) {
@@ -4484,11 +7857,87 @@ grl_source_store_metadata_sync (GrlSource *source,
 
   failed = ds->data;
 
-  g_slice_free (GrlDataSync, ds);
+  grl_data_sync_free (ds);
 
   return failed;
 }
 
+/**
+ * grl_source_store_metadata_async:
+ * @source: a source
+ * @media: the #GrlMedia object that we want to operate on
+ * @keys: (element-type GrlKeyID) (allow-none): a list of
+ * #GrlKeyID whose values we want to change
+ * @flags: Flags to configure specific behaviors of the operation.
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @callback: (scope async): the #GAsyncReadyCallback to call when the
+ * operation is finished
+ * @user_data: user data passed to @callback
+ *
+ * Update @keys values from @media in the @source.
+ *
+ * @cancellable is only checked before starting, as this operation can not be
+ * cancelled once started.
+ *
+ * This method is asynchronous. Call grl_source_store_metadata_finish() from
+ * @callback to get the result.
+ *
+ * Since: 0.3.13
+ */
+void
+grl_source_store_metadata_async (GrlSource *source,
+                                 GrlMedia *media,
+                                 GList *keys,
+                                 GrlWriteFlags flags,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data)
+{
+  GTask *task;
+
+  GRL_DEBUG (__FUNCTION__);
+
+  task = task_new (source, cancellable, callback, user_data,
+                   grl_source_store_metadata_async);
+  if (!task) {
+    return;
+  }
+
+  grl_source_store_metadata (source,
+                             media,
+                             keys,
+                             flags,
+                             task_store_metadata_cb,
+                             task);
+}
+
+/**
+ * grl_source_store_metadata_finish:
+ * @source: a source
+ * @result: the #GAsyncResult passed to the callback of
+ * grl_source_store_metadata_async()
+ * @error: a #GError, or @NULL
+ *
+ * Finishes an operation started with grl_source_store_metadata_async().
+ *
+ * Returns: (element-type GrlKeyID) (transfer container): a #GList of keys
+ * that could not be updated, or %NULL. Use g_list_free() after use.
+ *
+ * Since: 0.3.13
+ */
+GList *
+grl_source_store_metadata_finish (GrlSource *source,
+                                  GAsyncResult *result,
+                                  GError **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, source), NULL);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  grl_source_store_metadata_async),
+                        NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
 /**
  * grl_source_notify_change_start:
  * @source: a source
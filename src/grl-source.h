@@ -32,6 +32,7 @@
 #include <grl-definitions.h>
 #include <grl-plugin.h>
 #include <grl-operation-options.h>
+#include <grl-result-stream.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -182,6 +183,30 @@ typedef void (*GrlSourceResultCb) (GrlSource *source,
                                    gpointer user_data,
                                    const GError *error);
 
+/**
+ * GrlSourceResultBatchCb:
+ * @source: a source
+ * @operation_id: operation identifier
+ * @medias: (element-type GrlMedia) (transfer full): a #GPtrArray with the
+ * data transfer objects of this batch; it can be empty
+ * @remaining: the number of remaining #GrlMedia to process, or
+ * GRL_SOURCE_REMAINING_UNKNOWN if it is unknown
+ * @user_data: user data passed to the used method
+ * @error: (nullable): possible #GError generated at processing
+ *
+ * Prototype for the callback passed to grl_source_browse_batched(),
+ * grl_source_search_batched() and grl_source_query_batched(). The callback
+ * owns @medias and must release it with g_ptr_array_unref().
+ *
+ * Since: 0.3.13
+ */
+typedef void (*GrlSourceResultBatchCb) (GrlSource *source,
+                                        guint operation_id,
+                                        GPtrArray *medias,
+                                        guint remaining,
+                                        gpointer user_data,
+                                        const GError *error);
+
 /**
  * GrlSourceRemoveCb:
  * @source: a source
@@ -441,6 +466,10 @@ typedef struct _GrlSourceClass GrlSourceClass;
  * @cancel: cancel the current operation
  * @notify_change_start: start emitting signals about changes in content
  * @notify_change_stop: stop emitting signals about changes in content
+ * @resolve_batch: resolve the metadata of several transfer objects at once.
+ * @specs holds #GrlSourceResolveSpec<!-- -->s, each one completed through its
+ * own callback; the array is only valid during the call. If implemented, it is
+ * used instead of @resolve, unless the source is thread-safe. Since: 0.3.13
  *
  * Grilo Source class. Override the vmethods to implement the
  * element functionality.
@@ -490,8 +519,10 @@ struct _GrlSourceClass {
   gboolean (*notify_change_stop) (GrlSource *source,
                                   GError **error);
 
+  void (*resolve_batch) (GrlSource *source, GPtrArray *specs);
+
   /*< private >*/
-  gpointer _grl_reserved[GRL_PADDING];
+  gpointer _grl_reserved[GRL_PADDING - 1];
 };
 
 G_BEGIN_DECLS
@@ -514,6 +545,36 @@ void grl_source_set_auto_split_threshold (GrlSource *source,
 
 guint grl_source_get_auto_split_threshold (GrlSource *source);
 
+void grl_source_set_auto_split_window (GrlSource *source,
+                                       guint window);
+
+guint grl_source_get_auto_split_window (GrlSource *source);
+
+void grl_source_set_auto_split_target_latency (GrlSource *source,
+                                               guint latency);
+
+guint grl_source_get_auto_split_target_latency (GrlSource *source);
+
+void grl_source_set_thread_safe (GrlSource *source,
+                                 gboolean thread_safe);
+
+gboolean grl_source_get_thread_safe (GrlSource *source);
+
+void grl_source_set_max_concurrency (GrlSource *source,
+                                     guint max_concurrency);
+
+guint grl_source_get_max_concurrency (GrlSource *source);
+
+void grl_source_set_resolve_batch_size (GrlSource *source,
+                                        guint size);
+
+guint grl_source_get_resolve_batch_size (GrlSource *source);
+
+void grl_source_set_resolve_batch_latency (GrlSource *source,
+                                           guint latency);
+
+guint grl_source_get_resolve_batch_latency (GrlSource *source);
+
 
 guint grl_source_resolve (GrlSource *source,
                           GrlMedia *media,
@@ -528,6 +589,18 @@ GrlMedia *grl_source_resolve_sync (GrlSource *source,
                                    GrlOperationOptions *options,
                                    GError **error);
 
+void grl_source_resolve_async (GrlSource *source,
+                               GrlMedia *media,
+                               const GList *keys,
+                               GrlOperationOptions *options,
+                               GCancellable *cancellable,
+                               GAsyncReadyCallback callback,
+                               gpointer user_data);
+
+GrlMedia *grl_source_resolve_finish (GrlSource *source,
+                                     GAsyncResult *result,
+                                     GError **error);
+
 gboolean grl_source_may_resolve (GrlSource *source,
                                  GrlMedia *media,
                                  GrlKeyID key_id,
@@ -549,6 +622,18 @@ GrlMedia *grl_source_get_media_from_uri_sync (GrlSource *source,
                                               GrlOperationOptions *options,
                                               GError **error);
 
+void grl_source_get_media_from_uri_async (GrlSource *source,
+                                          const gchar *uri,
+                                          const GList *keys,
+                                          GrlOperationOptions *options,
+                                          GCancellable *cancellable,
+                                          GAsyncReadyCallback callback,
+                                          gpointer user_data);
+
+GrlMedia *grl_source_get_media_from_uri_finish (GrlSource *source,
+                                                GAsyncResult *result,
+                                                GError **error);
+
 guint grl_source_browse (GrlSource *source,
                          GrlMedia *container,
                          const GList *keys,
@@ -562,6 +647,30 @@ GList *grl_source_browse_sync (GrlSource *source,
                                GrlOperationOptions *options,
                                GError **error);
 
+void grl_source_browse_async (GrlSource *source,
+                              GrlMedia *container,
+                              const GList *keys,
+                              GrlOperationOptions *options,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+GPtrArray *grl_source_browse_finish (GrlSource *source,
+                                     GAsyncResult *result,
+                                     GError **error);
+
+GrlResultStream *grl_source_browse_stream (GrlSource *source,
+                                           GrlMedia *container,
+                                           const GList *keys,
+                                           GrlOperationOptions *options);
+
+guint grl_source_browse_batched (GrlSource *source,
+                                 GrlMedia *container,
+                                 const GList *keys,
+                                 GrlOperationOptions *options,
+                                 GrlSourceResultBatchCb callback,
+                                 gpointer user_data);
+
 guint grl_source_search (GrlSource *source,
                          const gchar *text,
                          const GList *keys,
@@ -575,6 +684,30 @@ GList *grl_source_search_sync (GrlSource *source,
                                GrlOperationOptions *options,
                                GError **error);
 
+void grl_source_search_async (GrlSource *source,
+                              const gchar *text,
+                              const GList *keys,
+                              GrlOperationOptions *options,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+GPtrArray *grl_source_search_finish (GrlSource *source,
+                                     GAsyncResult *result,
+                                     GError **error);
+
+GrlResultStream *grl_source_search_stream (GrlSource *source,
+                                           const gchar *text,
+                                           const GList *keys,
+                                           GrlOperationOptions *options);
+
+guint grl_source_search_batched (GrlSource *source,
+                                 const gchar *text,
+                                 const GList *keys,
+                                 GrlOperationOptions *options,
+                                 GrlSourceResultBatchCb callback,
+                                 gpointer user_data);
+
 guint grl_source_query (GrlSource *source,
                         const gchar *query,
                         const GList *keys,
@@ -588,6 +721,30 @@ GList *grl_source_query_sync (GrlSource *source,
                               GrlOperationOptions *options,
                               GError **error);
 
+void grl_source_query_async (GrlSource *source,
+                             const gchar *query,
+                             const GList *keys,
+                             GrlOperationOptions *options,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data);
+
+GPtrArray *grl_source_query_finish (GrlSource *source,
+                                    GAsyncResult *result,
+                                    GError **error);
+
+GrlResultStream *grl_source_query_stream (GrlSource *source,
+                                          const gchar *query,
+                                          const GList *keys,
+                                          GrlOperationOptions *options);
+
+guint grl_source_query_batched (GrlSource *source,
+                                const gchar *query,
+                                const GList *keys,
+                                GrlOperationOptions *options,
+                                GrlSourceResultBatchCb callback,
+                                gpointer user_data);
+
 void grl_source_remove (GrlSource *source,
                         GrlMedia *media,
                         GrlSourceRemoveCb callback,
@@ -597,6 +754,16 @@ void grl_source_remove_sync (GrlSource *source,
                              GrlMedia *media,
                              GError **error);
 
+void grl_source_remove_async (GrlSource *source,
+                              GrlMedia *media,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+
+gboolean grl_source_remove_finish (GrlSource *source,
+                                   GAsyncResult *result,
+                                   GError **error);
+
 void grl_source_store (GrlSource *source,
                        GrlMedia *parent,
                        GrlMedia *media,
@@ -610,6 +777,18 @@ void grl_source_store_sync (GrlSource *source,
                             GrlWriteFlags flags,
                             GError **error);
 
+void grl_source_store_async (GrlSource *source,
+                             GrlMedia *parent,
+                             GrlMedia *media,
+                             GrlWriteFlags flags,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data);
+
+gboolean grl_source_store_finish (GrlSource *source,
+                                  GAsyncResult *result,
+                                  GError **error);
+
 void grl_source_store_metadata (GrlSource *source,
                                 GrlMedia *media,
                                 GList *keys,
@@ -623,6 +802,18 @@ GList *grl_source_store_metadata_sync (GrlSource *source,
                                        GrlWriteFlags flags,
                                        GError **error);
 
+void grl_source_store_metadata_async (GrlSource *source,
+                                      GrlMedia *media,
+                                      GList *keys,
+                                      GrlWriteFlags flags,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data);
+
+GList *grl_source_store_metadata_finish (GrlSource *source,
+                                         GAsyncResult *result,
+                                         GError **error);
+
 gboolean grl_source_notify_change_start (GrlSource *source,
                                          GError **error);
 
@@ -29,9 +29,25 @@ typedef struct {
   gboolean complete;
   gpointer data;
   GError *error;
+  /*< private >*/
+  GMutex lock;
+  GCond cond;
+  gboolean started;
 } GrlDataSync;
 
-void
-grl_wait_for_async_operation_complete (GrlDataSync *ds);
+/* Starts the asynchronous operation, returning FALSE if it could not be
+   started and the result callback will not be called */
+typedef gboolean (*GrlDataSyncStartFunc) (gpointer user_data);
+
+GrlDataSync *grl_data_sync_new (void);
+
+void grl_data_sync_free (GrlDataSync *ds);
+
+void grl_data_sync_run (GrlDataSync *ds,
+                        gboolean private_context,
+                        GrlDataSyncStartFunc start,
+                        gpointer user_data);
+
+void grl_data_sync_complete (GrlDataSync *ds);
 
 #endif /* _GRL_SYNC_PRIV_H_ */
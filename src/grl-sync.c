@@ -23,19 +23,150 @@
 
 #include "grl-sync-priv.h"
 
+/*
+ * Synchronous operations wait for the asynchronous ones in one of three ways:
+ *
+ *  - If the operation was asked to run in a private context, a new main
+ *    context is pushed as thread-default while it runs, and only that context
+ *    is iterated, so no unrelated source is dispatched.
+ *  - If the thread-default main context of the caller is being run by another
+ *    thread, typically when called from a worker thread, the operation is
+ *    started in that context and the caller blocks until it completes.
+ *  - Otherwise the caller iterates its thread-default main context until the
+ *    operation completes.
+ */
+
+typedef struct {
+  GrlDataSync *ds;
+  GrlDataSyncStartFunc start;
+  gpointer user_data;
+  GMainContext *context;
+} SyncStart;
+
+GrlDataSync *
+grl_data_sync_new (void)
+{
+  GrlDataSync *ds = g_slice_new0 (GrlDataSync);
+
+  g_mutex_init (&ds->lock);
+  g_cond_init (&ds->cond);
+
+  return ds;
+}
+
 void
-grl_wait_for_async_operation_complete (GrlDataSync *ds)
+grl_data_sync_free (GrlDataSync *ds)
+{
+  g_mutex_clear (&ds->lock);
+  g_cond_clear (&ds->cond);
+  g_slice_free (GrlDataSync, ds);
+}
+
+/*
+ * grl_data_sync_complete:
+ * @ds: a #GrlDataSync
+ *
+ * Marks the operation as complete, waking up the caller if it is waiting in
+ * another thread. Results must be set in @ds before calling it.
+ */
+void
+grl_data_sync_complete (GrlDataSync *ds)
+{
+  g_mutex_lock (&ds->lock);
+  ds->complete = TRUE;
+  g_cond_signal (&ds->cond);
+  g_mutex_unlock (&ds->lock);
+}
+
+static gboolean
+sync_start_in_context (gpointer user_data)
 {
-  GMainLoop *ml;
-  GMainContext *mc;
+  SyncStart *sync_start = (SyncStart *) user_data;
+  GrlDataSync *ds = sync_start->ds;
+  gboolean started;
 
-  ml = g_main_loop_new (g_main_context_get_thread_default (), TRUE);
-  mc = g_main_loop_get_context (ml);
+  /* Make the operation belong to this context */
+  g_main_context_push_thread_default (sync_start->context);
+  started = sync_start->start (sync_start->user_data);
+  g_main_context_pop_thread_default (sync_start->context);
 
- while (!ds->complete) {
-    g_main_context_iteration (mc, TRUE);
+  /* The caller can return, freeing everything, as soon as this is set */
+  g_mutex_lock (&ds->lock);
+  ds->started = TRUE;
+  if (!started) {
+    ds->complete = TRUE;
   }
+  g_cond_signal (&ds->cond);
+  g_mutex_unlock (&ds->lock);
 
-  g_main_loop_unref (ml);
+  return G_SOURCE_REMOVE;
 }
 
+static void
+sync_iterate (GrlDataSync *ds,
+              GMainContext *context)
+{
+  while (!ds->complete) {
+    g_main_context_iteration (context, TRUE);
+  }
+}
+
+/*
+ * grl_data_sync_run:
+ * @ds: a #GrlDataSync
+ * @private_context: whether to run the operation in a private main context
+ * @start: function starting the asynchronous operation
+ * @user_data: data to pass to @start
+ *
+ * Runs the asynchronous operation started by @start, and waits until its
+ * result callback calls grl_data_sync_complete(). @private_context is usually
+ * set from %GRL_RESOLVE_PRIVATE_CONTEXT.
+ */
+void
+grl_data_sync_run (GrlDataSync *ds,
+                   gboolean private_context,
+                   GrlDataSyncStartFunc start,
+                   gpointer user_data)
+{
+  GMainContext *context;
+  SyncStart sync_start;
+
+  if (private_context) {
+    context = g_main_context_new ();
+    g_main_context_push_thread_default (context);
+    if (start (user_data)) {
+      sync_iterate (ds, context);
+    }
+    g_main_context_pop_thread_default (context);
+    g_main_context_unref (context);
+    return;
+  }
+
+  context = g_main_context_ref_thread_default ();
+
+  /* Succeeds if this thread already owns it */
+  if (g_main_context_acquire (context)) {
+    if (start (user_data)) {
+      sync_iterate (ds, context);
+    }
+    g_main_context_release (context);
+    g_main_context_unref (context);
+    return;
+  }
+
+  /* Another thread runs the context: let it run the operation too */
+  sync_start.ds = ds;
+  sync_start.start = start;
+  sync_start.user_data = user_data;
+  sync_start.context = context;
+
+  g_main_context_invoke (context, sync_start_in_context, &sync_start);
+
+  g_mutex_lock (&ds->lock);
+  while (!ds->started || !ds->complete) {
+    g_cond_wait (&ds->cond, &ds->lock);
+  }
+  g_mutex_unlock (&ds->lock);
+
+  g_main_context_unref (context);
+}
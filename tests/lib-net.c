@@ -31,6 +31,7 @@ typedef struct {
   guint timeout;
   guint num_operations;
   gboolean timeout_is_expected;
+  const gchar *expected_body;
 } Fixture;
 
 typedef struct {
@@ -48,6 +49,12 @@ typedef struct {
 
 #define NUM_STRESS_TEST 100
 
+#define MS_DELAY     200    /* milliseconds */
+#define MS_THRESHOLD 50     /* milliseconds */
+#define NUM_MS_TEST  5
+
+#define CACHE_WRITE_DELAY 200  /* milliseconds */
+
 static void
 fixture_setup (Fixture *fixture, gconstpointer data)
 {
@@ -266,11 +273,590 @@ test_net_wc_no_throttling_stress (Fixture *f,
   g_main_loop_run (f->loop);
 }
 
+static void
+test_net_wc_ms_throttling (Fixture *f,
+                           gconstpointer data)
+{
+  GSList *uris;
+  gchar *request;
+  GrlNetWc *wc;
+  gint i;
+  GError *error = NULL;
+
+  soup_server_add_handler (f->server, NULL, soup_server_throttling_cb, NULL, NULL);
+  soup_server_listen_local (f->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_assert_no_error (error);
+
+  uris = soup_server_get_uris (f->server);
+  g_assert_nonnull (uris);
+  request = soup_uri_to_string (uris->data, FALSE);
+  g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+  g_assert_nonnull (request);
+
+  wc = grl_net_wc_new ();
+  grl_net_wc_set_throttling_ms (wc, MS_DELAY);
+  g_assert_cmpuint (grl_net_wc_get_current_delay (wc), ==, 0);
+
+  /* Requests are evenly spaced, the first one being sent right away */
+  for (i = 0; i < NUM_MS_TEST; i++) {
+    ThrottlingOperation *op;
+
+    op = throttling_operation_new (f, NO_DELAY);
+    op->expected_time = op->request_time + (i * MS_DELAY - MS_THRESHOLD) * 1000;
+    grl_net_wc_request_async (wc, request, f->cancellable, test_net_wc_throttling_cb, op);
+  }
+  g_assert_cmpuint (grl_net_wc_get_queue_depth (wc), ==, NUM_MS_TEST);
+  g_assert_cmpuint (grl_net_wc_get_current_delay (wc), >, 0);
+
+  g_object_unref (wc);
+  g_free (request);
+
+  f->timeout = g_timeout_add_seconds (5, timeout, f);
+  g_main_loop_run (f->loop);
+}
+
+typedef struct {
+  Fixture *f;
+  guint expected_order;
+} PriorityOperation;
+
+static void
+soup_server_order_cb (SoupServer *server,
+                      SoupMessage *message,
+                      const char *path,
+                      GHashTable *query,
+                      SoupClientContext *client,
+                      gpointer user_data)
+{
+  guint *served = user_data;
+  gchar *response = g_strdup_printf ("%u", (*served)++);
+
+  soup_message_set_response (message, "text/plain", SOUP_MEMORY_TAKE, response, strlen(response));
+  soup_message_set_status (message, SOUP_STATUS_OK);
+}
+
+static void
+test_net_wc_priority_cb (GObject *source_object,
+                         GAsyncResult *res,
+                         gpointer user_data)
+{
+  gchar *data;
+  gsize len;
+  gboolean ret;
+  GError *err = NULL;
+  PriorityOperation *op = user_data;
+  Fixture *f = op->f;
+
+  ret = grl_net_wc_request_finish (GRL_NET_WC (source_object), res, &data, &len, &err);
+  g_assert_no_error (err);
+  g_assert_true (ret);
+  g_assert_cmpuint (g_ascii_strtoull (data, NULL, 0), ==, op->expected_order);
+
+  g_free (op);
+  f->num_operations--;
+
+  if (f->num_operations == 0) {
+    if (f->timeout > 0)
+        g_source_remove(f->timeout);
+    g_main_loop_quit (f->loop);
+  }
+}
+
+static void
+test_net_wc_priority (Fixture *f,
+                      gconstpointer data)
+{
+  GSList *uris;
+  gchar *request;
+  GrlNetWc *wc;
+  guint served = 0;
+  gint priorities[] = { G_PRIORITY_LOW, G_PRIORITY_DEFAULT, G_PRIORITY_HIGH };
+  guint expected_order[] = { 2, 1, 0 };
+  guint i;
+  GError *error = NULL;
+
+  soup_server_add_handler (f->server, NULL, soup_server_order_cb, &served, NULL);
+  soup_server_listen_local (f->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_assert_no_error (error);
+
+  uris = soup_server_get_uris (f->server);
+  g_assert_nonnull (uris);
+  request = soup_uri_to_string (uris->data, FALSE);
+  g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+  g_assert_nonnull (request);
+
+  /* With one request per host at a time, the queued requests must be sent
+   * in priority order rather than in the order they were done */
+  wc = grl_net_wc_new ();
+  grl_net_wc_set_max_requests_per_host (wc, 1);
+  for (i = 0; i < G_N_ELEMENTS (priorities); i++) {
+    PriorityOperation *op = g_new (PriorityOperation, 1);
+
+    op->f = f;
+    op->expected_order = expected_order[i];
+    f->num_operations++;
+    grl_net_wc_request_with_priority_async (wc, request, NULL, priorities[i],
+                                            f->cancellable,
+                                            test_net_wc_priority_cb, op);
+  }
+  g_object_unref (wc);
+  g_free (request);
+
+  f->timeout = g_timeout_add_seconds (5, timeout, f);
+  g_main_loop_run (f->loop);
+  g_assert_cmpuint (served, ==, G_N_ELEMENTS (priorities));
+}
+
+static void
+soup_server_path_cb (SoupServer *server,
+                     SoupMessage *message,
+                     const char *path,
+                     GHashTable *query,
+                     SoupClientContext *client,
+                     gpointer user_data)
+{
+  soup_message_set_response (message, "text/plain", SOUP_MEMORY_COPY, path, strlen(path));
+  soup_message_set_status (message, SOUP_STATUS_OK);
+}
+
+static void
+test_net_wc_bytes_cb (GObject *source_object,
+                      GAsyncResult *res,
+                      gpointer user_data)
+{
+  GPtrArray *results = user_data;
+  GError *err = NULL;
+  GBytes *bytes;
+
+  bytes = grl_net_wc_request_bytes_finish (GRL_NET_WC (source_object), res, &err);
+  g_assert_no_error (err);
+  g_assert_nonnull (bytes);
+  g_ptr_array_add (results, bytes);
+}
+
+static void
+test_net_wc_bytes (Fixture *f,
+                   gconstpointer data)
+{
+  GSList *uris;
+  SoupURI *base;
+  gchar *first, *second;
+  GrlNetWc *wc;
+  GPtrArray *results;
+  GError *error = NULL;
+
+  soup_server_add_handler (f->server, NULL, soup_server_path_cb, NULL, NULL);
+  soup_server_listen_local (f->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_assert_no_error (error);
+
+  uris = soup_server_get_uris (f->server);
+  g_assert_nonnull (uris);
+  base = uris->data;
+  soup_uri_set_path (base, "/first");
+  first = soup_uri_to_string (base, FALSE);
+  soup_uri_set_path (base, "/second");
+  second = soup_uri_to_string (base, FALSE);
+  g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+  results = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+  wc = grl_net_wc_new ();
+  grl_net_wc_set_max_requests_per_host (wc, 1);
+  grl_net_wc_request_async (wc, first, NULL, test_net_wc_bytes_cb, results);
+  grl_net_wc_request_async (wc, second, NULL, test_net_wc_bytes_cb, results);
+
+  while (results->len < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* The first contents must survive the second request */
+  g_assert_cmpuint (g_bytes_get_size (results->pdata[0]), ==, strlen ("/first"));
+  g_assert_cmpstr (g_bytes_get_data (results->pdata[0], NULL), ==, "/first");
+  g_assert_cmpuint (g_bytes_get_size (results->pdata[1]), ==, strlen ("/second"));
+  g_assert_cmpstr (g_bytes_get_data (results->pdata[1], NULL), ==, "/second");
+
+  g_ptr_array_unref (results);
+  g_object_unref (wc);
+  g_free (first);
+  g_free (second);
+}
+
+static void
+test_net_wc_stream_splice_cb (GObject *source_object,
+                              GAsyncResult *res,
+                              gpointer user_data)
+{
+  Fixture *f = user_data;
+  GError *err = NULL;
+  gssize size;
+
+  size = g_output_stream_splice_finish (G_OUTPUT_STREAM (source_object), res, &err);
+  g_assert_no_error (err);
+  g_assert_cmpint (size, ==, strlen ("/stream"));
+  g_assert_cmpint (memcmp (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (source_object)),
+                           "/stream", size), ==, 0);
+
+  g_main_loop_quit (f->loop);
+}
+
+static void
+test_net_wc_stream_cb (GObject *source_object,
+                       GAsyncResult *res,
+                       gpointer user_data)
+{
+  Fixture *f = user_data;
+  GError *err = NULL;
+  GInputStream *in;
+  GOutputStream *out;
+
+  in = grl_net_wc_request_stream_finish (GRL_NET_WC (source_object), res, &err);
+  g_assert_no_error (err);
+  g_assert_nonnull (in);
+
+  out = g_memory_output_stream_new_resizable ();
+
+  g_output_stream_splice_async (out, in,
+                                G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE,
+                                G_PRIORITY_DEFAULT, NULL,
+                                test_net_wc_stream_splice_cb, f);
+  g_object_unref (out);
+  g_object_unref (in);
+}
+
+static void
+test_net_wc_stream (Fixture *f,
+                    gconstpointer data)
+{
+  GSList *uris;
+  gchar *request;
+  GrlNetWc *wc;
+  GError *error = NULL;
+
+  soup_server_add_handler (f->server, NULL, soup_server_path_cb, NULL, NULL);
+  soup_server_listen_local (f->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_assert_no_error (error);
+
+  uris = soup_server_get_uris (f->server);
+  g_assert_nonnull (uris);
+  soup_uri_set_path (uris->data, "/stream");
+  request = soup_uri_to_string (uris->data, FALSE);
+  g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+  wc = grl_net_wc_new ();
+  grl_net_wc_request_stream_async (wc, request, NULL, f->cancellable,
+                                   test_net_wc_stream_cb, f);
+  g_object_unref (wc);
+  g_free (request);
+
+  f->timeout = g_timeout_add_seconds (5, timeout, f);
+  g_main_loop_run (f->loop);
+  g_source_remove (f->timeout);
+}
+
+static void
+soup_server_cacheable_cb (SoupServer *server,
+                          SoupMessage *message,
+                          const char *path,
+                          GHashTable *query,
+                          SoupClientContext *client,
+                          gpointer user_data)
+{
+  guint *served = user_data;
+  gchar *response = g_strdup_printf ("%u", (*served)++);
+
+  soup_message_headers_append (message->response_headers,
+                               "Cache-Control", "max-age=3600");
+  soup_message_set_response (message, "text/plain", SOUP_MEMORY_TAKE, response, strlen(response));
+  soup_message_set_status (message, SOUP_STATUS_OK);
+}
+
+static void
+soup_server_short_lived_cb (SoupServer *server,
+                            SoupMessage *message,
+                            const char *path,
+                            GHashTable *query,
+                            SoupClientContext *client,
+                            gpointer user_data)
+{
+  guint *served = user_data;
+  gchar *response = g_strdup_printf ("%u", (*served)++);
+  SoupDate *date = soup_date_new_from_now (0);
+  gchar *date_string = soup_date_to_string (date, SOUP_DATE_HTTP);
+
+  soup_message_headers_replace (message->response_headers, "Date", date_string);
+  soup_message_headers_append (message->response_headers,
+                               "Cache-Control", "max-age=1");
+  soup_message_set_response (message, "text/plain", SOUP_MEMORY_TAKE, response, strlen(response));
+  soup_message_set_status (message, SOUP_STATUS_OK);
+
+  g_free (date_string);
+  soup_date_free (date);
+}
+
+static gchar *
+cache_server_start (Fixture *f,
+                    SoupServerCallback callback,
+                    guint *served)
+{
+  GSList *uris;
+  gchar *request;
+  GError *error = NULL;
+
+  soup_server_add_handler (f->server, NULL, callback, served, NULL);
+  soup_server_listen_local (f->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_assert_no_error (error);
+
+  uris = soup_server_get_uris (f->server);
+  g_assert_nonnull (uris);
+  request = soup_uri_to_string (uris->data, FALSE);
+  g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+  return request;
+}
+
+static void
+test_net_wc_cache_cb (GObject *source_object,
+                      GAsyncResult *res,
+                      gpointer user_data)
+{
+  Fixture *f = user_data;
+  GError *err = NULL;
+  GBytes *bytes;
+
+  bytes = grl_net_wc_request_bytes_finish (GRL_NET_WC (source_object), res, &err);
+  g_assert_no_error (err);
+  g_assert_cmpstr (g_bytes_get_data (bytes, NULL), ==, f->expected_body);
+  g_bytes_unref (bytes);
+
+  g_main_loop_quit (f->loop);
+}
+
+static void
+cache_request (Fixture *f,
+               GrlNetWc *wc,
+               const gchar *request,
+               const gchar *expected_body)
+{
+  f->expected_body = expected_body;
+  grl_net_wc_request_async (wc, request, NULL, test_net_wc_cache_cb, f);
+
+  f->timeout = g_timeout_add_seconds (5, timeout, f);
+  g_main_loop_run (f->loop);
+  g_source_remove (f->timeout);
+}
+
+static gboolean
+quit_loop_cb (gpointer user_data)
+{
+  g_main_loop_quit (user_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Lets the pending work, like writing the responses to the cache, run */
+static void
+wait_ms (Fixture *f,
+         guint ms)
+{
+  g_timeout_add (ms, quit_loop_cb, f->loop);
+  g_main_loop_run (f->loop);
+}
+
+static void
+test_net_wc_persistent_cache (Fixture *f,
+                              gconstpointer data)
+{
+  gchar *request;
+  GrlNetWc *wc;
+  guint served = 0;
+  gint i;
+
+  request = cache_server_start (f, soup_server_cacheable_cb, &served);
+
+  /* The second instance must find the response cached by the first one,
+   * after it was saved and the cache closed */
+  for (i = 0; i < 2; i++) {
+    wc = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-test", NULL);
+    cache_request (f, wc, request, "0");
+    wait_ms (f, CACHE_WRITE_DELAY);
+    g_object_unref (wc);
+  }
+
+  g_assert_cmpuint (served, ==, 1);
+  g_free (request);
+}
+
+static void
+test_net_wc_shared_cache_name (Fixture *f,
+                               gconstpointer data)
+{
+  gchar *request;
+  GrlNetWc *first, *second, *wc;
+  guint served = 0;
+
+  request = cache_server_start (f, soup_server_cacheable_cb, &served);
+
+  /* Instances alive at the same time share the cache */
+  first = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-shared", NULL);
+  second = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-shared", NULL);
+
+  cache_request (f, first, request, "0");
+  wait_ms (f, CACHE_WRITE_DELAY);
+  cache_request (f, second, request, "0");
+  g_assert_cmpuint (served, ==, 1);
+
+  /* and it outlives the instance that filled it */
+  g_object_unref (first);
+  cache_request (f, second, request, "0");
+  g_object_unref (second);
+
+  wc = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-shared", NULL);
+  cache_request (f, wc, request, "0");
+  g_object_unref (wc);
+
+  g_assert_cmpuint (served, ==, 1);
+  g_free (request);
+}
+
+/* Run in a subprocess: caches a response from a server of its own, and
+   leaves its url next to the caches */
+static void
+merge_subprocess (Fixture *f)
+{
+  gchar *request, *url_path;
+  GrlNetWc *wc;
+  guint served = 0;
+  GError *error = NULL;
+
+  request = cache_server_start (f, soup_server_cacheable_cb, &served);
+
+  wc = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-merge", NULL);
+  cache_request (f, wc, request, "0");
+  wait_ms (f, CACHE_WRITE_DELAY);
+  g_object_unref (wc);
+
+  url_path = g_build_filename (g_get_user_cache_dir (), "merge-url", NULL);
+  g_file_set_contents (url_path, request, -1, &error);
+  g_assert_no_error (error);
+
+  g_free (url_path);
+  g_free (request);
+}
+
+static void
+test_net_wc_merge_cache_index (Fixture *f,
+                               gconstpointer data)
+{
+  gchar *request, *other_request, *url_path;
+  GrlNetWc *wc;
+  guint served = 0;
+  GError *error = NULL;
+
+  if (g_test_subprocess ()) {
+    merge_subprocess (f);
+    return;
+  }
+
+  request = cache_server_start (f, soup_server_cacheable_cb, &served);
+
+  wc = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-merge", NULL);
+  cache_request (f, wc, request, "0");
+  wait_ms (f, CACHE_WRITE_DELAY);
+
+  /* Another process saves its index while this one uses the cache */
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+
+  url_path = g_build_filename (g_get_user_cache_dir (), "merge-url", NULL);
+  g_file_get_contents (url_path, &other_request, NULL, &error);
+  g_assert_no_error (error);
+
+  g_object_unref (wc);
+
+  /* Both responses are kept; the server of the other process is gone, so
+     its response can only come from the cache */
+  wc = g_object_new (GRL_TYPE_NET_WC, "cache-name", "lib-net-merge", NULL);
+  cache_request (f, wc, request, "0");
+  cache_request (f, wc, other_request, "0");
+  g_object_unref (wc);
+
+  g_assert_cmpuint (served, ==, 1);
+  g_free (other_request);
+  g_free (url_path);
+  g_free (request);
+}
+
+static void
+test_net_wc_stale_while_revalidate (Fixture *f,
+                                    gconstpointer data)
+{
+  gchar *request;
+  GrlNetWc *wc;
+  guint served = 0;
+
+  request = cache_server_start (f, soup_server_short_lived_cb, &served);
+
+  wc = g_object_new (GRL_TYPE_NET_WC, "stale-while-revalidate", 60, NULL);
+
+  /* Just received: not refreshed */
+  cache_request (f, wc, request, "0");
+  wait_ms (f, CACHE_WRITE_DELAY);
+  g_assert_cmpuint (served, ==, 1);
+
+  /* Once expired, the cached response is still used, and refreshed once */
+  wait_ms (f, 2500);
+  cache_request (f, wc, request, "0");
+  wait_ms (f, CACHE_WRITE_DELAY);
+  g_assert_cmpuint (served, ==, 2);
+
+  /* The refreshed response is used from then on */
+  cache_request (f, wc, request, "1");
+  wait_ms (f, CACHE_WRITE_DELAY);
+  g_assert_cmpuint (served, ==, 2);
+
+  g_object_unref (wc);
+  g_free (request);
+}
+
+static void
+remove_dir (GFile *dir)
+{
+  GFileEnumerator *children;
+  GFileInfo *info;
+
+  children = g_file_enumerate_children (dir, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                        G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                        NULL, NULL);
+  while (children &&
+         (info = g_file_enumerator_next_file (children, NULL, NULL))) {
+    GFile *child = g_file_get_child (dir, g_file_info_get_name (info));
+
+    remove_dir (child);
+    g_object_unref (child);
+    g_object_unref (info);
+  }
+  g_clear_object (&children);
+
+  g_file_delete (dir, NULL, NULL);
+}
+
 int
 main (int argc, char **argv)
 {
+  gchar *cache_dir;
+  GFile *cache_dir_file;
+  gint ret;
+
   g_test_init (&argc, &argv, NULL);
 
+  /* Keep the persistent caches out of the user's cache directory.
+     Subprocesses use the one of their parent */
+  if (g_test_subprocess ()) {
+    cache_dir = NULL;
+  } else {
+    cache_dir = g_dir_make_tmp ("grilo-test-net-XXXXXX", NULL);
+    g_assert_nonnull (cache_dir);
+    g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+  }
+
   g_test_bug_base ("http://bugs.gnome.org/%s");
 
   grl_init (&argc, &argv);
@@ -293,5 +879,62 @@ main (int argc, char **argv)
               test_net_wc_no_throttling_stress,
               fixture_teardown);
 
-  return g_test_run ();
+  g_test_add ("/net/throttling/milliseconds",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_ms_throttling,
+              fixture_teardown);
+
+  g_test_add ("/net/priority/per-host-limit",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_priority,
+              fixture_teardown);
+
+  g_test_add ("/net/request/bytes",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_bytes,
+              fixture_teardown);
+
+  g_test_add ("/net/request/stream",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_stream,
+              fixture_teardown);
+
+  g_test_add ("/net/cache/persistent",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_persistent_cache,
+              fixture_teardown);
+
+  g_test_add ("/net/cache/shared-name",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_shared_cache_name,
+              fixture_teardown);
+
+  g_test_add ("/net/cache/merge-index",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_merge_cache_index,
+              fixture_teardown);
+
+  g_test_add ("/net/cache/stale-while-revalidate",
+              Fixture, NULL,
+              fixture_setup,
+              test_net_wc_stale_while_revalidate,
+              fixture_teardown);
+
+  ret = g_test_run ();
+
+  if (cache_dir) {
+    cache_dir_file = g_file_new_for_path (cache_dir);
+    remove_dir (cache_dir_file);
+    g_object_unref (cache_dir_file);
+    g_free (cache_dir);
+  }
+
+  return ret;
 }
@@ -25,10 +25,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <locale.h>
+#include <math.h>
 #include <glib.h>
+#ifdef G_OS_UNIX
+#include <unistd.h>
+#endif
 
 #include <grilo.h>
 
+#define NUM_MEDIAS       10000
+#define NUM_MEDIAS_PERF  500000
+
 typedef struct {
   GrlRegistry *registry;
 } Fixture;
@@ -222,6 +229,276 @@ test_set_for_id_different_key_type (Fixture *fixture, gconstpointer data)
 #undef TEST_OTHER_GTYPE
 }
 
+static void
+test_related_keys_storage (Fixture *fixture, gconstpointer data)
+{
+  GrlMedia *media;
+  GrlMedia *dup;
+  GrlRelatedKeys *relkeys;
+  GList *keys;
+  GList *dup_keys;
+  const gchar *title;
+  const GValue *value;
+
+  media = grl_media_audio_new ();
+  grl_media_set_title (media, "title");
+  grl_media_add_artist (media, "artist 1");
+  grl_media_add_artist (media, "artist 2");
+
+  /* Values already handed out survive handing out their related keys */
+  title = grl_media_get_title (media);
+  value = grl_data_get (GRL_DATA (media), GRL_METADATA_KEY_TITLE);
+  relkeys = grl_data_get_related_keys (GRL_DATA (media),
+                                       GRL_METADATA_KEY_TITLE, 0);
+  g_assert_cmpstr (title, ==, "title");
+  g_assert_cmpstr (g_value_get_string (value), ==, "title");
+  g_assert_true (grl_media_get_title (media) == title);
+
+  /* Changes in the related keys handed out are kept */
+  g_assert_nonnull (relkeys);
+  grl_related_keys_set_string (relkeys, GRL_METADATA_KEY_TITLE, "new title");
+  g_assert_cmpstr (grl_media_get_title (media), ==, "new title");
+  grl_media_set_title (media, "title");
+  g_assert_cmpstr (grl_related_keys_get_string (relkeys,
+                                                GRL_METADATA_KEY_TITLE),
+                   ==, "title");
+
+  /* Setting a key related to a value already set keeps them together */
+  grl_media_set_url (media, "http://example.com/song");
+  grl_media_set_mime (media, "audio/ogg");
+  g_assert_cmpuint (grl_data_length (GRL_DATA (media), GRL_METADATA_KEY_MIME),
+                    ==, 1);
+  relkeys = grl_data_get_related_keys (GRL_DATA (media),
+                                       GRL_METADATA_KEY_URL, 0);
+  g_assert_cmpstr (grl_related_keys_get_string (relkeys, GRL_METADATA_KEY_MIME),
+                   ==, "audio/ogg");
+
+  /* Order of values is kept */
+  grl_media_add_artist (media, "artist 3");
+  grl_data_remove_nth (GRL_DATA (media), GRL_METADATA_KEY_ARTIST, 1);
+  g_assert_cmpuint (grl_data_length (GRL_DATA (media), GRL_METADATA_KEY_ARTIST),
+                    ==, 2);
+  g_assert_cmpstr (grl_media_get_artist_nth (media, 0), ==, "artist 1");
+  g_assert_cmpstr (grl_media_get_artist_nth (media, 1), ==, "artist 3");
+
+  /* Related keys added by the caller are kept as they are */
+  relkeys = grl_related_keys_new_with_keys (GRL_METADATA_KEY_GENRE, "rock",
+                                            NULL);
+  grl_data_add_related_keys (GRL_DATA (media), relkeys);
+  g_assert_true (grl_data_get_related_keys (GRL_DATA (media),
+                                            GRL_METADATA_KEY_GENRE, 0) == relkeys);
+
+  dup = GRL_MEDIA (grl_data_dup (GRL_DATA (media)));
+  g_assert_cmpstr (grl_media_get_title (dup), ==, "title");
+  g_assert_cmpstr (grl_media_get_mime (dup), ==, "audio/ogg");
+  g_assert_cmpstr (grl_media_get_artist_nth (dup, 1), ==, "artist 3");
+  keys = grl_data_get_keys (GRL_DATA (media));
+  dup_keys = grl_data_get_keys (GRL_DATA (dup));
+  g_assert_cmpuint (g_list_length (dup_keys), ==, g_list_length (keys));
+  g_list_free (dup_keys);
+  g_list_free (keys);
+
+  g_object_unref (dup);
+  g_object_unref (media);
+}
+
+static void
+test_string_pool (Fixture *fixture, gconstpointer data)
+{
+  GrlMedia *media1;
+  GrlMedia *media2;
+  guint strings, references;
+  guint strings_before, references_before;
+  gsize saved, saved_before;
+
+  grl_data_set_interned_key (GRL_METADATA_KEY_GENRE, TRUE);
+  g_assert_true (grl_data_get_interned_key (GRL_METADATA_KEY_GENRE));
+  g_assert_false (grl_data_get_interned_key (GRL_METADATA_KEY_SOURCE));
+
+  grl_data_get_string_pool_stats (&strings_before, &references_before,
+                                  &saved_before);
+
+  media1 = grl_media_audio_new ();
+  media2 = grl_media_audio_new ();
+  grl_media_set_genre (media1, "Rock");
+  grl_media_set_genre (media2, "Rock");
+
+  /* Both media share the same string */
+  g_assert_true (grl_media_get_genre (media1) == grl_media_get_genre (media2));
+
+  grl_data_get_string_pool_stats (&strings, &references, &saved);
+  g_assert_cmpuint (strings, ==, strings_before + 1);
+  g_assert_cmpuint (references, ==, references_before + 2);
+  g_assert_cmpuint (saved, ==, saved_before + strlen ("Rock") + 1);
+
+  /* Copies and replaced values keep the accounting right */
+  g_object_unref (grl_data_dup (GRL_DATA (media1)));
+  grl_media_set_genre (media2, "Jazz");
+  grl_data_get_string_pool_stats (&strings, &references, &saved);
+  g_assert_cmpuint (strings, ==, strings_before + 2);
+  g_assert_cmpuint (references, ==, references_before + 2);
+  g_assert_cmpuint (saved, ==, saved_before);
+
+  /* Strings are freed when no longer used */
+  g_object_unref (media1);
+  g_object_unref (media2);
+  grl_data_get_string_pool_stats (&strings, &references, &saved);
+  g_assert_cmpuint (strings, ==, strings_before);
+  g_assert_cmpuint (references, ==, references_before);
+
+  grl_data_set_interned_key (GRL_METADATA_KEY_GENRE, FALSE);
+  g_assert_false (grl_data_get_interned_key (GRL_METADATA_KEY_GENRE));
+}
+
+static void
+test_typed_setters (Fixture *fixture, gconstpointer data)
+{
+  GrlData *grl_data;
+  GrlKeyID float_key;
+
+  grl_data = grl_data_new ();
+
+  /* Same type as the key */
+  grl_data_set_int (grl_data, GRL_METADATA_KEY_DURATION, 10);
+  grl_data_set_int (grl_data, GRL_METADATA_KEY_DURATION, 20);
+  g_assert_cmpint (grl_data_get_int (grl_data, GRL_METADATA_KEY_DURATION), ==, 20);
+  g_assert_cmpuint (grl_data_length (grl_data, GRL_METADATA_KEY_DURATION), ==, 1);
+
+  grl_data_set_string (grl_data, GRL_METADATA_KEY_TITLE, "title");
+  grl_data_set_string (grl_data, GRL_METADATA_KEY_TITLE, "new title");
+  g_assert_cmpstr (grl_data_get_string (grl_data, GRL_METADATA_KEY_TITLE), ==,
+                   "new title");
+
+  grl_data_set_boolean (grl_data, GRL_METADATA_KEY_FAVOURITE, TRUE);
+  g_assert_true (grl_data_get_boolean (grl_data, GRL_METADATA_KEY_FAVOURITE));
+
+  grl_data_set_int64 (grl_data, GRL_METADATA_KEY_SIZE, G_GINT64_CONSTANT (1) << 40);
+  g_assert_cmpint (grl_data_get_int64 (grl_data, GRL_METADATA_KEY_SIZE), ==,
+                   G_GINT64_CONSTANT (1) << 40);
+
+  /* Different type than the key: the value is transformed */
+  grl_data_set_int (grl_data, GRL_METADATA_KEY_RATING, 3);
+  g_assert_cmpfloat (grl_data_get_float (grl_data, GRL_METADATA_KEY_RATING), ==, 3.0);
+
+  /* Infinite values are clamped, even without an explicit range */
+  float_key = grl_registry_register_metadata_key (fixture->registry,
+                                                  g_param_spec_float ("test-typed-float",
+                                                                      "Float",
+                                                                      "Float with the default range",
+                                                                      -G_MAXFLOAT, G_MAXFLOAT,
+                                                                      0,
+                                                                      G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE),
+                                                  GRL_METADATA_KEY_INVALID,
+                                                  NULL);
+  g_assert_true (float_key != GRL_METADATA_KEY_INVALID);
+  g_test_expect_message ("Grilo", G_LOG_LEVEL_WARNING, "*value invalid, adjusting*");
+  grl_data_set_float (grl_data, float_key, INFINITY);
+  g_test_assert_expected_messages ();
+  g_assert_cmpfloat (grl_data_get_float (grl_data, float_key), ==, G_MAXFLOAT);
+
+  /* Values of related keys are kept together */
+  grl_data_set_string (grl_data, GRL_METADATA_KEY_URL, "http://example.com");
+  grl_data_set_string (grl_data, GRL_METADATA_KEY_MIME, "audio/ogg");
+  grl_data_set_int (grl_data, GRL_METADATA_KEY_BITRATE, 128);
+  g_assert_cmpuint (grl_data_length (grl_data, GRL_METADATA_KEY_URL), ==, 1);
+  g_assert_cmpstr (grl_data_get_string (grl_data, GRL_METADATA_KEY_MIME), ==,
+                   "audio/ogg");
+  g_assert_cmpint (grl_data_get_int (grl_data, GRL_METADATA_KEY_BITRATE), ==, 128);
+
+  g_object_unref (grl_data);
+}
+
+static gsize
+get_resident_memory (void)
+{
+  gsize resident = 0;
+#ifdef G_OS_UNIX
+  gchar *contents;
+  gchar **fields;
+
+  if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+    fields = g_strsplit (contents, " ", -1);
+    if (fields[0] && fields[1]) {
+      resident = g_ascii_strtoull (fields[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+    }
+    g_strfreev (fields);
+    g_free (contents);
+  }
+#endif
+
+  return resident;
+}
+
+/* Builds a catalogue of medias with a typical set of keys */
+static void
+test_storage_benchmark (Fixture *fixture, gconstpointer data)
+{
+  GrlMedia **medias;
+  guint total;
+  guint i;
+  guint64 sum = 0;
+  gsize resident;
+  gdouble elapsed;
+
+  total = g_test_perf () ? NUM_MEDIAS_PERF : NUM_MEDIAS;
+  medias = g_new (GrlMedia *, total);
+
+  resident = get_resident_memory ();
+  g_test_timer_start ();
+
+  for (i = 0; i < total; i++) {
+    gchar *id = g_strdup_printf ("%u", i);
+    GrlMedia *media = grl_media_audio_new ();
+
+    grl_media_set_id (media, id);
+    grl_media_set_source (media, "grl-test-source");
+    grl_media_set_title (media, "A song title");
+    grl_media_set_artist (media, "An artist");
+    grl_media_set_album (media, "An album");
+    grl_media_set_genre (media, "Rock");
+    grl_media_set_author (media, "An author");
+    grl_media_set_description (media, "A description of the song");
+    grl_media_set_url_data (media, "http://example.com/song.ogg", "audio/ogg",
+                            128, -1, -1, -1);
+    grl_media_set_duration (media, 180);
+    grl_media_set_track_number (media, i % 20);
+    grl_media_set_play_count (media, i);
+    grl_media_set_last_position (media, 60);
+    grl_media_set_size (media, 1 << 22);
+    grl_media_set_rating (media, 3, 5);
+    medias[i] = media;
+    g_free (id);
+  }
+
+  elapsed = g_test_timer_elapsed ();
+  resident = get_resident_memory () - resident;
+
+  g_test_minimized_result (elapsed, "created %u medias in %6.3f seconds",
+                           total, elapsed);
+  if (resident > 0) {
+    g_test_minimized_result (resident / total,
+                             "%" G_GSIZE_FORMAT " bytes per media",
+                             resident / total);
+  }
+
+  g_test_timer_start ();
+  for (i = 0; i < total; i++) {
+    sum += grl_media_get_play_count (medias[i]);
+    sum += strlen (grl_media_get_title (medias[i]));
+    sum += strlen (grl_media_get_mime (medias[i]));
+  }
+  elapsed = g_test_timer_elapsed ();
+  g_assert_cmpuint (sum, >, 0);
+
+  g_test_minimized_result (elapsed, "read %u medias in %6.3f seconds",
+                           total, elapsed);
+
+  for (i = 0; i < total; i++) {
+    g_object_unref (medias[i]);
+  }
+  g_free (medias);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -267,5 +544,29 @@ main (int argc, char **argv)
               test_set_for_id_different_key_type,
               fixture_teardown);
 
+  g_test_add ("/data/related-keys/storage",
+              Fixture, NULL,
+              fixture_setup,
+              test_related_keys_storage,
+              fixture_teardown);
+
+  g_test_add ("/data/typed-setters",
+              Fixture, NULL,
+              fixture_setup,
+              test_typed_setters,
+              fixture_teardown);
+
+  g_test_add ("/data/string-pool",
+              Fixture, NULL,
+              fixture_setup,
+              test_string_pool,
+              fixture_teardown);
+
+  g_test_add ("/data/storage/benchmark",
+              Fixture, NULL,
+              fixture_setup,
+              test_storage_benchmark,
+              fixture_teardown);
+
   return g_test_run ();
 }
@@ -0,0 +1,2042 @@
+/*
+ * Copyright (C) 2026 Grilo Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <grilo.h>
+
+#define NUM_ITEMS       10000
+#define NUM_ITEMS_PERF  100000
+
+/* ================ Mock source ================ */
+
+#define TEST_TYPE_SOURCE (test_source_get_type ())
+#define TEST_SOURCE(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_SOURCE, TestSource))
+
+typedef struct {
+  GrlSource parent;
+  guint total;
+  guint delay;
+  gboolean dead;
+  /* Only answers, with an error, when cancelled */
+  gboolean late;
+  guint late_operation_id;
+  GrlSourceResultCb late_callback;
+  gpointer late_user_data;
+  gboolean late_answered;
+  /* Position, from 1, of a result sent as an error instead, or 0 */
+  guint fail_at;
+  guint resolve_calls;
+  gint running;
+  gint max_running;
+  gint main_context_calls;
+} TestSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestSourceClass;
+
+GType test_source_get_type (void);
+
+G_DEFINE_TYPE (TestSource, test_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys) {
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+  }
+
+  return keys;
+}
+
+/* Emits synthetic items synchronously, honouring skip and count, after
+ * waiting for delay milliseconds */
+static void
+test_source_emit (GrlSource *source,
+                  guint operation_id,
+                  GrlOperationOptions *options,
+                  GrlSourceResultCb callback,
+                  gpointer user_data)
+{
+  TestSource *self = TEST_SOURCE (source);
+  guint skip = grl_operation_options_get_skip (options);
+  gint count = grl_operation_options_get_count (options);
+  guint last;
+  guint i;
+  gint running;
+  gint max_running;
+
+  /* Never answers */
+  if (self->dead)
+    return;
+
+  if (self->late) {
+    self->late_operation_id = operation_id;
+    self->late_callback = callback;
+    self->late_user_data = user_data;
+    return;
+  }
+
+  if (g_main_context_is_owner (g_main_context_default ()))
+    g_atomic_int_inc (&self->main_context_calls);
+
+  running = g_atomic_int_add (&self->running, 1) + 1;
+  do {
+    max_running = g_atomic_int_get (&self->max_running);
+  } while (running > max_running &&
+           !g_atomic_int_compare_and_exchange (&self->max_running,
+                                               max_running, running));
+
+  if (self->delay > 0)
+    g_usleep (self->delay * 1000);
+
+  if (skip >= self->total) {
+    g_atomic_int_add (&self->running, -1);
+    callback (source, operation_id, NULL, 0, user_data, NULL);
+    return;
+  }
+
+  last = (count == GRL_COUNT_INFINITY) ? self->total : MIN (self->total, skip + count);
+
+  for (i = skip; i < last; i++) {
+    GrlMedia *media;
+    gchar *id;
+
+    if (i + 1 == self->fail_at) {
+      GError *error = g_error_new (GRL_CORE_ERROR,
+                                   GRL_CORE_ERROR_BROWSE_FAILED,
+                                   "Result %u failed", i);
+
+      if (i == last - 1)
+        g_atomic_int_add (&self->running, -1);
+      callback (source, operation_id, NULL, last - i - 1, user_data, error);
+      g_error_free (error);
+      continue;
+    }
+
+    media = grl_media_new ();
+    id = g_strdup_printf ("%u", i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    g_free (id);
+
+    if (i == last - 1)
+      g_atomic_int_add (&self->running, -1);
+    callback (source, operation_id, media, last - i - 1, user_data, NULL);
+  }
+}
+
+static void
+test_source_browse (GrlSource *source,
+                    GrlSourceBrowseSpec *bs)
+{
+  test_source_emit (source, bs->operation_id, bs->options,
+                    bs->callback, bs->user_data);
+}
+
+static void
+test_source_search (GrlSource *source,
+                    GrlSourceSearchSpec *ss)
+{
+  test_source_emit (source, ss->operation_id, ss->options,
+                    ss->callback, ss->user_data);
+}
+
+static void
+test_source_query (GrlSource *source,
+                   GrlSourceQuerySpec *qs)
+{
+  test_source_emit (source, qs->operation_id, qs->options,
+                    qs->callback, qs->user_data);
+}
+
+/* Sets the title from the id */
+static void
+test_source_resolve (GrlSource *source,
+                     GrlSourceResolveSpec *rs)
+{
+  TEST_SOURCE (source)->resolve_calls++;
+
+  /* Never answers */
+  if (TEST_SOURCE (source)->dead)
+    return;
+
+  grl_media_set_title (rs->media, grl_media_get_id (rs->media));
+  rs->callback (source, rs->operation_id, rs->media, rs->user_data, NULL);
+}
+
+static gboolean
+test_source_late_answer (gpointer user_data)
+{
+  TestSource *self = TEST_SOURCE (user_data);
+  GError *error;
+
+  error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED,
+                       "Cancelled");
+  self->late_callback (GRL_SOURCE (self), self->late_operation_id, NULL, 0,
+                       self->late_user_data, error);
+  g_error_free (error);
+  self->late_answered = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* A late source confirms the cancellation some time afterwards */
+static void
+test_source_cancel (GrlSource *source,
+                    guint operation_id)
+{
+  TestSource *self = TEST_SOURCE (source);
+
+  if (self->late && self->late_operation_id == operation_id) {
+    g_timeout_add_full (G_PRIORITY_DEFAULT, 20, test_source_late_answer,
+                        g_object_ref (self), g_object_unref);
+  }
+}
+
+static void
+test_source_class_init (TestSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_source_supported_keys;
+  source_class->browse = test_source_browse;
+  source_class->search = test_source_search;
+  source_class->query = test_source_query;
+  source_class->resolve = test_source_resolve;
+  source_class->cancel = test_source_cancel;
+}
+
+static void
+test_source_init (TestSource *self)
+{
+}
+
+static GrlSource *
+test_source_new (guint total)
+{
+  TestSource *source;
+
+  source = g_object_new (TEST_TYPE_SOURCE,
+                         "source-id", "test-source",
+                         "source-name", "Test source",
+                         NULL);
+  source->total = total;
+
+  return GRL_SOURCE (source);
+}
+
+/* Same source, resolving media in batches */
+
+#define TEST_TYPE_BATCH_SOURCE (test_batch_source_get_type ())
+#define TEST_BATCH_SOURCE(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj), TEST_TYPE_BATCH_SOURCE, TestBatchSource))
+
+typedef struct {
+  TestSource parent;
+  guint batch_calls;
+  guint max_batch;
+} TestBatchSource;
+
+typedef struct {
+  TestSourceClass parent_class;
+} TestBatchSourceClass;
+
+GType test_batch_source_get_type (void);
+
+G_DEFINE_TYPE (TestBatchSource, test_batch_source, TEST_TYPE_SOURCE)
+
+static void
+test_batch_source_resolve_batch (GrlSource *source,
+                                 GPtrArray *specs)
+{
+  TestBatchSource *self = TEST_BATCH_SOURCE (source);
+  guint i;
+
+  self->batch_calls++;
+  self->max_batch = MAX (self->max_batch, specs->len);
+
+  for (i = 0; i < specs->len; i++) {
+    GrlSourceResolveSpec *rs = g_ptr_array_index (specs, i);
+
+    grl_media_set_title (rs->media, grl_media_get_id (rs->media));
+    rs->callback (source, rs->operation_id, rs->media, rs->user_data, NULL);
+  }
+}
+
+static void
+test_batch_source_class_init (TestBatchSourceClass *klass)
+{
+  GRL_SOURCE_CLASS (klass)->resolve_batch = test_batch_source_resolve_batch;
+}
+
+static void
+test_batch_source_init (TestBatchSource *self)
+{
+}
+
+/* Another source, resolving the artist of any media with an id */
+
+#define TEST_TYPE_ARTIST_SOURCE (test_artist_source_get_type ())
+
+typedef struct {
+  GrlSource parent;
+} TestArtistSource;
+
+typedef struct {
+  GrlSourceClass parent_class;
+} TestArtistSourceClass;
+
+GType test_artist_source_get_type (void);
+
+G_DEFINE_TYPE (TestArtistSource, test_artist_source, GRL_TYPE_SOURCE)
+
+static const GList *
+test_artist_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys)
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ARTIST, NULL);
+
+  return keys;
+}
+
+static gboolean
+test_artist_source_may_resolve (GrlSource *source,
+                                GrlMedia *media,
+                                GrlKeyID key_id,
+                                GList **missing_keys)
+{
+  if (key_id != GRL_METADATA_KEY_ARTIST)
+    return FALSE;
+
+  if (media && grl_media_get_id (media))
+    return TRUE;
+
+  if (missing_keys)
+    *missing_keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID, NULL);
+
+  return FALSE;
+}
+
+static void
+test_artist_source_resolve (GrlSource *source,
+                            GrlSourceResolveSpec *rs)
+{
+  grl_media_set_artist (rs->media, grl_media_get_id (rs->media));
+  rs->callback (source, rs->operation_id, rs->media, rs->user_data, NULL);
+}
+
+static void
+test_artist_source_class_init (TestArtistSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = test_artist_source_supported_keys;
+  source_class->may_resolve = test_artist_source_may_resolve;
+  source_class->resolve = test_artist_source_resolve;
+}
+
+static void
+test_artist_source_init (TestArtistSource *self)
+{
+}
+
+/* ================ Tests ================ */
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  gboolean in_order;
+} BrowseData;
+
+static void
+browse_cb (GrlSource *source,
+           guint operation_id,
+           GrlMedia *media,
+           guint remaining,
+           gpointer user_data,
+           const GError *error)
+{
+  BrowseData *data = user_data;
+
+  g_assert_no_error (error);
+
+  if (media) {
+    if (strtoul (grl_media_get_id (media), NULL, 10) != data->received)
+      data->in_order = FALSE;
+    data->received++;
+    g_object_unref (media);
+  }
+
+  if (remaining == 0)
+    g_main_loop_quit (data->loop);
+}
+
+/* Browses a large container with GRL_RESOLVE_FULL and a key the source can't
+ * provide, so every result goes through the relay queue and
+ * media_decorate() */
+static void
+test_source_browse_resolve_full (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  BrowseData data = { 0, };
+  guint total;
+  gdouble elapsed;
+
+  total = g_test_perf () ? NUM_ITEMS_PERF : NUM_ITEMS;
+
+  source = test_source_new (total);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.in_order = TRUE;
+
+  g_test_timer_start ();
+  grl_source_browse (source, NULL, keys, options, browse_cb, &data);
+  g_main_loop_run (data.loop);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (data.received, ==, total);
+  g_assert_true (data.in_order);
+
+  g_test_minimized_result (elapsed, "browsed %u items in %6.3f seconds",
+                           total, elapsed);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  guint received;
+  guint batches;
+  guint batch_size;
+} BatchData;
+
+static void
+browse_batched_cb (GrlSource *source,
+                   guint operation_id,
+                   GPtrArray *medias,
+                   guint remaining,
+                   gpointer user_data,
+                   const GError *error)
+{
+  BatchData *data = user_data;
+
+  g_assert_no_error (error);
+  g_assert_cmpuint (medias->len, <=, data->batch_size);
+
+  data->received += medias->len;
+  data->batches++;
+  g_ptr_array_unref (medias);
+
+  if (remaining == 0)
+    g_main_loop_quit (data->loop);
+}
+
+static void
+test_source_browse_batched (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  BatchData data = { 0, };
+
+  source = test_source_new (NUM_ITEMS);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_IDLE_RELAY);
+  grl_operation_options_set_batch_size (options, 100);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.batch_size = 100;
+
+  grl_source_browse_batched (source, NULL, keys, options, browse_batched_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpuint (data.received, ==, NUM_ITEMS);
+  g_assert_cmpuint (data.batches, ==, NUM_ITEMS / 100);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static guint
+browse_auto_split (guint total,
+                   guint count,
+                   gboolean *in_order)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  BrowseData data = { 0, };
+
+  source = test_source_new (total);
+  grl_source_set_auto_split_threshold (source, 100);
+  grl_source_set_auto_split_window (source, 4);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, count);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.in_order = TRUE;
+
+  grl_source_browse (source, NULL, keys, options, browse_cb, &data);
+  g_main_loop_run (data.loop);
+
+  *in_order = data.in_order;
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+
+  return data.received;
+}
+
+static void
+test_source_browse_auto_split_window (void)
+{
+  gboolean in_order;
+
+  /* All chunks are full */
+  g_assert_cmpuint (browse_auto_split (1000, 1000, &in_order), ==, 1000);
+  g_assert_true (in_order);
+
+  /* Source runs out of elements while chunks are still in flight */
+  g_assert_cmpuint (browse_auto_split (550, 1000, &in_order), ==, 550);
+  g_assert_true (in_order);
+}
+
+static void
+test_source_browse_auto_split_tuner (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GVariant *state;
+  guint chunk_size;
+  guint samples;
+  BrowseData data = { 0, };
+
+  source = test_source_new (300);
+  TEST_SOURCE (source)->delay = 20;
+  grl_source_set_auto_split_threshold (source, 100);
+  grl_source_set_auto_split_target_latency (source, 10);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 300);
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.in_order = TRUE;
+
+  grl_source_browse (source, NULL, keys, options, browse_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpuint (data.received, ==, 300);
+  g_assert_true (data.in_order);
+
+  /* The source is slower than the target, so chunks must have shrunk */
+  g_object_get (source, "auto-split-tuner-state", &state, NULL);
+  g_assert_true (g_variant_lookup (state, "chunk-size", "u", &chunk_size));
+  g_assert_true (g_variant_lookup (state, "samples", "u", &samples));
+  g_assert_cmpuint (chunk_size, <, 100);
+  g_assert_cmpuint (samples, >, 1);
+  g_variant_unref (state);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static GrlMedia *
+resolve_title (GrlSource *source,
+               GrlOperationOptions *options)
+{
+  GrlMedia *media;
+  GList *keys;
+  GError *error = NULL;
+
+  media = grl_media_new ();
+  grl_media_set_id (media, "42");
+  grl_media_set_source (media, grl_source_get_id (source));
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  media = grl_source_resolve_sync (source, media, keys, options, &error);
+  g_assert_no_error (error);
+  g_list_free (keys);
+
+  return media;
+}
+
+static void
+test_source_resolve_cache (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  guint64 hits;
+  guint64 misses;
+  gsize size;
+
+  source = test_source_new (0);
+  options = grl_operation_options_new (NULL);
+
+  grl_resolve_cache_set_max_size (1024 * 1024);
+
+  /* First time it is asked to the source */
+  media = resolve_title (source, options);
+  g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 1);
+  g_object_unref (media);
+
+  /* Second time it comes from the cache */
+  media = resolve_title (source, options);
+  g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 1);
+  g_object_unref (media);
+
+  grl_resolve_cache_get_stats (&hits, &misses, &size);
+  g_assert_cmpuint (hits, ==, 1);
+  g_assert_cmpuint (misses, ==, 1);
+  g_assert_cmpuint (size, >, 0);
+
+  /* A change in the source drops its entries */
+  grl_source_notify_change (source, NULL, GRL_CONTENT_CHANGED, TRUE);
+  grl_resolve_cache_get_stats (NULL, NULL, &size);
+  g_assert_cmpuint (size, ==, 0);
+
+  media = resolve_title (source, options);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 2);
+  g_object_unref (media);
+
+  /* Entries not fitting in the cache are not kept */
+  grl_resolve_cache_set_max_size (1);
+  grl_resolve_cache_get_stats (NULL, NULL, &size);
+  g_assert_cmpuint (size, ==, 0);
+
+  media = resolve_title (source, options);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 3);
+  g_object_unref (media);
+
+  grl_resolve_cache_set_max_size (0);
+  grl_resolve_cache_clear ();
+
+  g_object_unref (options);
+  g_object_unref (source);
+}
+
+static void
+test_source_resolve_persistent_cache (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  GError *error = NULL;
+  gchar *dir;
+  gchar *filename;
+  gchar *lock_filename;
+  FILE *file;
+
+  source = test_source_new (0);
+  options = grl_operation_options_new (NULL);
+
+  dir = g_dir_make_tmp ("grilo-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  filename = g_build_filename (dir, "cache", NULL);
+
+  /* Only the file is used, without a memory cache */
+  g_assert_true (grl_resolve_cache_set_file (filename, &error));
+  g_assert_no_error (error);
+
+  media = resolve_title (source, options);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 1);
+  g_object_unref (media);
+
+  /* Entries survive reopening the file */
+  g_assert_true (grl_resolve_cache_set_file (filename, &error));
+  g_assert_no_error (error);
+
+  media = resolve_title (source, options);
+  g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 1);
+  g_object_unref (media);
+
+  /* An incomplete record, as left by a crash, is discarded */
+  grl_resolve_cache_set_file (NULL, NULL);
+  file = fopen (filename, "ab");
+  g_assert_nonnull (file);
+  fwrite ("GRLR\x10", 1, 5, file);
+  fclose (file);
+
+  g_assert_true (grl_resolve_cache_set_file (filename, &error));
+  g_assert_no_error (error);
+
+  media = resolve_title (source, options);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 1);
+  g_object_unref (media);
+
+  /* A change in the source drops its entries from the file too */
+  grl_source_notify_change (source, NULL, GRL_CONTENT_CHANGED, TRUE);
+  g_assert_true (grl_resolve_cache_compact (&error));
+  g_assert_no_error (error);
+  g_assert_true (grl_resolve_cache_set_file (filename, &error));
+  g_assert_no_error (error);
+
+  media = resolve_title (source, options);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 2);
+  g_object_unref (media);
+
+  grl_resolve_cache_set_file (NULL, NULL);
+  grl_resolve_cache_clear ();
+  g_unlink (filename);
+  lock_filename = g_strconcat (filename, ".lock", NULL);
+  g_unlink (lock_filename);
+  g_rmdir (dir);
+  g_free (lock_filename);
+  g_free (filename);
+  g_free (dir);
+
+  g_object_unref (options);
+  g_object_unref (source);
+}
+
+typedef struct {
+  GMainContext *context;
+  guint received;
+  gboolean cancelled;
+  gboolean in_context;
+} CancelData;
+
+static void
+browse_cancel_cb (GrlSource *source,
+                  guint operation_id,
+                  GrlMedia *media,
+                  guint remaining,
+                  gpointer user_data,
+                  const GError *error)
+{
+  CancelData *data = user_data;
+
+  data->in_context = g_main_context_is_owner (data->context);
+
+  if (media) {
+    data->received++;
+    g_object_unref (media);
+  }
+
+  if (remaining == 0) {
+    g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED);
+    data->cancelled = TRUE;
+  }
+}
+
+static gpointer
+cancel_thread (gpointer user_data)
+{
+  grl_operation_cancel (GPOINTER_TO_UINT (user_data));
+
+  return NULL;
+}
+
+/* Starts a browse in a private main context and cancels it from another
+ * thread. The cancellation must wait for the context to be iterated, and
+ * then happen before any result is delivered in it */
+static void
+test_source_browse_cancel_from_thread (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GThread *thread;
+  CancelData data = { 0, };
+  guint operation_id;
+
+  source = test_source_new (NUM_ITEMS);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  data.context = g_main_context_new ();
+  g_main_context_push_thread_default (data.context);
+
+  operation_id = grl_source_browse (source, NULL, keys, options,
+                                    browse_cancel_cb, &data);
+
+  thread = g_thread_new ("cancel", cancel_thread,
+                         GUINT_TO_POINTER (operation_id));
+  g_thread_join (thread);
+
+  /* Nothing runs in the default context */
+  while (g_main_context_iteration (NULL, FALSE));
+  g_assert_false (data.cancelled);
+
+  while (!data.cancelled)
+    g_main_context_iteration (data.context, TRUE);
+
+  g_assert_cmpuint (data.received, ==, 0);
+  g_assert_true (data.in_context);
+
+  g_main_context_pop_thread_default (data.context);
+  g_main_context_unref (data.context);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+typedef struct {
+  guint operation_id;
+  guint received;
+  gboolean cancel_returned;
+  gboolean finished;
+  gboolean in_main_context;
+} CancelRunningData;
+
+static void
+browse_cancel_running_cb (GrlSource *source,
+                          guint operation_id,
+                          GrlMedia *media,
+                          guint remaining,
+                          gpointer user_data,
+                          const GError *error)
+{
+  CancelRunningData *data = user_data;
+  GThread *thread;
+
+  if (!g_main_context_is_owner (g_main_context_default ()))
+    data->in_main_context = FALSE;
+
+  if (media) {
+    data->received++;
+    g_object_unref (media);
+  }
+
+  if (!data->cancel_returned) {
+    thread = g_thread_new ("cancel", cancel_thread,
+                           GUINT_TO_POINTER (data->operation_id));
+    g_thread_join (thread);
+    /* The context is busy with this callback, so the cancellation has only
+       been queued */
+    data->cancel_returned = TRUE;
+  }
+
+  if (remaining == 0) {
+    if (error)
+      g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED);
+    data->finished = TRUE;
+  }
+}
+
+/* Cancels a browse from another thread while its context is delivering
+ * results: grl_operation_cancel() returns before the cancellation happens,
+ * and the operation still ends in its own context */
+static void
+test_source_browse_cancel_from_thread_running (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  CancelRunningData data = { 0, };
+
+  source = test_source_new (100);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  data.in_main_context = TRUE;
+
+  data.operation_id = grl_source_browse (source, NULL, keys, options,
+                                         browse_cancel_running_cb, &data);
+
+  while (!data.finished)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (data.cancel_returned);
+  g_assert_cmpuint (data.received, >=, 1);
+  g_assert_true (data.in_main_context);
+
+  /* Nothing is left behind for the cancelled operation */
+  while (g_main_context_iteration (NULL, FALSE));
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+#define NUM_THREADED_BROWSES 6
+
+typedef struct {
+  guint pending;
+  guint received[NUM_THREADED_BROWSES];
+  guint operation_ids[NUM_THREADED_BROWSES];
+  gboolean in_order;
+  gboolean in_main_context;
+} ThreadedData;
+
+static void
+browse_threaded_cb (GrlSource *source,
+                    guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    gpointer user_data,
+                    const GError *error)
+{
+  ThreadedData *data = user_data;
+  guint i;
+
+  g_assert_no_error (error);
+
+  if (!g_main_context_is_owner (g_main_context_default ()))
+    data->in_main_context = FALSE;
+
+  for (i = 0; data->operation_ids[i] != operation_id; i++)
+    g_assert_cmpuint (i, <, NUM_THREADED_BROWSES - 1);
+
+  if (media) {
+    if (strtoul (grl_media_get_id (media), NULL, 10) != data->received[i])
+      data->in_order = FALSE;
+    data->received[i]++;
+    g_object_unref (media);
+  }
+
+  if (remaining == 0)
+    data->pending--;
+}
+
+/* Runs several browses on a thread-safe source limited to two operations at
+ * the same time: the source must only be called from the pool, and results
+ * must come back in order to the main context */
+static void
+test_source_browse_threaded (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  ThreadedData data = { 0, };
+  guint i;
+
+  source = test_source_new (100);
+  TEST_SOURCE (source)->delay = 20;
+  g_object_set (source,
+                "thread-safe", TRUE,
+                "max-concurrency", 2,
+                NULL);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  data.in_order = TRUE;
+  data.in_main_context = TRUE;
+  data.pending = NUM_THREADED_BROWSES;
+
+  for (i = 0; i < NUM_THREADED_BROWSES; i++) {
+    data.operation_ids[i] = grl_source_browse (source, NULL, keys, options,
+                                               browse_threaded_cb, &data);
+  }
+
+  while (data.pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  for (i = 0; i < NUM_THREADED_BROWSES; i++)
+    g_assert_cmpuint (data.received[i], ==, 100);
+  g_assert_true (data.in_order);
+  g_assert_true (data.in_main_context);
+  g_assert_cmpint (TEST_SOURCE (source)->main_context_calls, ==, 0);
+  g_assert_cmpint (TEST_SOURCE (source)->max_running, >=, 1);
+  g_assert_cmpint (TEST_SOURCE (source)->max_running, <=, 2);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static void
+browse_cancelled_cb (GrlSource *source,
+                     guint operation_id,
+                     GrlMedia *media,
+                     guint remaining,
+                     gpointer user_data,
+                     const GError *error)
+{
+  guint *pending = user_data;
+
+  g_assert_null (media);
+  g_assert_cmpuint (remaining, ==, 0);
+  g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_CANCELLED);
+  (*pending)--;
+}
+
+/* Cancelled operations of a thread-safe source that never answers, both the
+ * running one and the one waiting for a slot, must still finish */
+static void
+test_source_browse_threaded_cancel_dead (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  guint pending = 2;
+  guint running_id;
+  guint queued_id;
+
+  source = test_source_new (100);
+  TEST_SOURCE (source)->dead = TRUE;
+  g_object_set (source,
+                "thread-safe", TRUE,
+                "max-concurrency", 1,
+                NULL);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  running_id = grl_source_browse (source, NULL, keys, options,
+                                  browse_cancelled_cb, &pending);
+  queued_id = grl_source_browse (source, NULL, keys, options,
+                                 browse_cancelled_cb, &pending);
+
+  /* Let both operations reach the workers */
+  while (g_main_context_iteration (NULL, FALSE));
+
+  grl_operation_cancel (queued_id);
+  grl_operation_cancel (running_id);
+
+  while (pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static gboolean
+set_flag_idle (gpointer user_data)
+{
+  *((gboolean *) user_data) = TRUE;
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* A sync browse in a private context must not dispatch unrelated sources */
+static void
+test_source_browse_sync_private_context (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GList *medias;
+  GError *error = NULL;
+  gboolean dispatched = FALSE;
+  guint id;
+
+  source = test_source_new (100);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_resolution_flags (options,
+                                              GRL_RESOLVE_PRIVATE_CONTEXT);
+
+  id = g_idle_add (set_flag_idle, &dispatched);
+
+  medias = grl_source_browse_sync (source, NULL, keys, options, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_list_length (medias), ==, 100);
+  g_assert_false (dispatched);
+
+  g_source_remove (id);
+  g_list_free_full (medias, g_object_unref);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+typedef struct {
+  GrlSource *source;
+  GMainLoop *loop;
+  guint received;
+} SyncThreadData;
+
+static gpointer
+browse_sync_thread (gpointer user_data)
+{
+  SyncThreadData *data = user_data;
+  GrlOperationOptions *options;
+  GList *keys;
+  GList *medias;
+  GError *error = NULL;
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  medias = grl_source_browse_sync (data->source, NULL, keys, options, &error);
+  g_assert_no_error (error);
+  data->received = g_list_length (medias);
+
+  g_list_free_full (medias, g_object_unref);
+  g_object_unref (options);
+  g_list_free (keys);
+
+  g_main_loop_quit (data->loop);
+
+  return NULL;
+}
+
+/* A sync browse from a worker thread must run the source in the main context,
+ * that is being run by the main thread */
+static void
+test_source_browse_sync_from_thread (void)
+{
+  SyncThreadData data = { 0, };
+  GThread *thread;
+
+  data.source = test_source_new (100);
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  /* Own the context from the start, so the thread cannot run it */
+  g_assert_true (g_main_context_acquire (NULL));
+  thread = g_thread_new ("sync", browse_sync_thread, &data);
+  g_main_loop_run (data.loop);
+  g_thread_join (thread);
+  g_main_context_release (NULL);
+
+  g_assert_cmpuint (data.received, ==, 100);
+  g_assert_cmpint (TEST_SOURCE (data.source)->main_context_calls, ==, 1);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (data.source);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GPtrArray *medias;
+  GError *error;
+} AsyncData;
+
+static void
+browse_async_cb (GObject *object,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+  AsyncData *data = user_data;
+
+  data->medias = grl_source_browse_finish (GRL_SOURCE (object), result,
+                                           &data->error);
+  g_main_loop_quit (data->loop);
+}
+
+/* Collects the results of a browse with the GTask API, then cancels another
+ * one through its GCancellable */
+static void
+test_source_browse_async (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GCancellable *cancellable;
+  AsyncData data = { 0, };
+  guint i;
+
+  source = test_source_new (100);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  grl_source_browse_async (source, NULL, keys, options, NULL,
+                           browse_async_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_no_error (data.error);
+  g_assert_cmpuint (data.medias->len, ==, 100);
+  for (i = 0; i < data.medias->len; i++) {
+    GrlMedia *media = g_ptr_array_index (data.medias, i);
+    g_assert_cmpuint (strtoul (grl_media_get_id (media), NULL, 10), ==, i);
+  }
+  g_clear_pointer (&data.medias, g_ptr_array_unref);
+
+  cancellable = g_cancellable_new ();
+  grl_source_browse_async (source, NULL, keys, options, cancellable,
+                           browse_async_cb, &data);
+  g_cancellable_cancel (cancellable);
+  g_main_loop_run (data.loop);
+
+  g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (data.medias);
+  g_clear_error (&data.error);
+
+  /* Already cancelled: fails without starting the operation */
+  grl_source_browse_async (source, NULL, keys, options, cancellable,
+                           browse_async_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_clear_error (&data.error);
+
+  g_object_unref (cancellable);
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+/* A source failing in the middle of a browse still sends its other
+ * results: the task only ends with the last one */
+static void
+test_source_browse_async_error (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  AsyncData data = { 0, };
+
+  source = test_source_new (100);
+  TEST_SOURCE (source)->fail_at = 10;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  grl_source_browse_async (source, NULL, keys, options, NULL,
+                           browse_async_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_error (data.error, GRL_CORE_ERROR, GRL_CORE_ERROR_BROWSE_FAILED);
+  g_assert_null (data.medias);
+  g_clear_error (&data.error);
+
+  g_main_loop_unref (data.loop);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static void
+stream_async_cb (GObject *object,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+  *((GAsyncResult **) user_data) = g_object_ref (result);
+}
+
+static GAsyncResult *
+wait_for_result (GAsyncResult **result)
+{
+  while (!*result)
+    g_main_context_iteration (NULL, TRUE);
+
+  return *result;
+}
+
+/* Pulls the results of a browse one by one and in batches: the source must
+ * not be asked for more than about two chunks ahead of the consumer */
+static void
+test_source_browse_stream (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlResultStream *stream;
+  GAsyncResult *result;
+  GrlMedia *media;
+  GPtrArray *medias;
+  GError *error = NULL;
+  guint received = 0;
+  guint len;
+
+  source = test_source_new (1000);
+  grl_source_set_auto_split_threshold (source, 50);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  stream = grl_source_browse_stream (source, NULL, keys, options);
+  do {
+    result = NULL;
+    grl_result_stream_next_async (stream, NULL, stream_async_cb, &result);
+    media = grl_result_stream_next_finish (stream, wait_for_result (&result),
+                                           &error);
+    g_assert_no_error (error);
+    g_assert_cmpuint (grl_result_stream_get_n_buffered (stream), <=, 100);
+    if (media) {
+      g_assert_cmpuint (strtoul (grl_media_get_id (media), NULL, 10), ==,
+                        received);
+      received++;
+      g_object_unref (media);
+    }
+    g_object_unref (result);
+  } while (media);
+  g_assert_cmpuint (received, ==, 1000);
+  g_object_unref (stream);
+
+  /* Skip and count apply to the whole stream */
+  grl_operation_options_set_skip (options, 10);
+  grl_operation_options_set_count (options, 120);
+  stream = grl_source_browse_stream (source, NULL, keys, options);
+  received = 0;
+  do {
+    result = NULL;
+    grl_result_stream_next_batch_async (stream, 30, NULL,
+                                        stream_async_cb, &result);
+    medias = grl_result_stream_next_batch_finish (stream,
+                                                  wait_for_result (&result),
+                                                  &error);
+    g_assert_no_error (error);
+    len = medias->len;
+    g_assert_cmpuint (len, <=, 30);
+    if (len > 0) {
+      media = g_ptr_array_index (medias, 0);
+      g_assert_cmpuint (strtoul (grl_media_get_id (media), NULL, 10), ==,
+                        received + 10);
+    }
+    received += len;
+    g_ptr_array_unref (medias);
+    g_object_unref (result);
+  } while (len > 0);
+  g_assert_cmpuint (received, ==, 120);
+
+  grl_result_stream_close (stream);
+  result = NULL;
+  grl_result_stream_next_async (stream, NULL, stream_async_cb, &result);
+  media = grl_result_stream_next_finish (stream, wait_for_result (&result),
+                                         &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CLOSED);
+  g_assert_null (media);
+  g_clear_error (&error);
+  g_object_unref (result);
+  g_object_unref (stream);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+/* The results a source sends after an error are still delivered, then the
+ * error, and no more chunks are requested */
+static void
+test_source_browse_stream_error (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlResultStream *stream;
+  GAsyncResult *result;
+  GrlMedia *media;
+  GError *error = NULL;
+  guint received = 0;
+
+  source = test_source_new (1000);
+  TEST_SOURCE (source)->fail_at = 10;
+  grl_source_set_auto_split_threshold (source, 50);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  stream = grl_source_browse_stream (source, NULL, keys, options);
+  do {
+    result = NULL;
+    grl_result_stream_next_async (stream, NULL, stream_async_cb, &result);
+    media = grl_result_stream_next_finish (stream, wait_for_result (&result),
+                                           &error);
+    if (media) {
+      received++;
+      g_object_unref (media);
+    }
+    g_object_unref (result);
+  } while (media);
+
+  g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_BROWSE_FAILED);
+  g_clear_error (&error);
+  g_assert_cmpuint (received, ==, 49);
+
+  /* Then the stream is over */
+  result = NULL;
+  grl_result_stream_next_async (stream, NULL, stream_async_cb, &result);
+  media = grl_result_stream_next_finish (stream, wait_for_result (&result),
+                                         &error);
+  g_assert_no_error (error);
+  g_assert_null (media);
+  g_object_unref (result);
+  g_object_unref (stream);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+typedef struct {
+  guint received;
+  gboolean done;
+  GError *error;
+} StreamChainData;
+
+/* Asks for the next result from inside the callback of the previous one */
+static void
+stream_chain_cb (GObject *object,
+                 GAsyncResult *result,
+                 gpointer user_data)
+{
+  GrlResultStream *stream = GRL_RESULT_STREAM (object);
+  StreamChainData *data = user_data;
+  GrlMedia *media;
+
+  media = grl_result_stream_next_finish (stream, result, &data->error);
+  if (!media) {
+    data->done = TRUE;
+    return;
+  }
+
+  g_assert_cmpuint (strtoul (grl_media_get_id (media), NULL, 10), ==,
+                    data->received);
+  data->received++;
+  g_object_unref (media);
+
+  grl_result_stream_next_async (stream, NULL, stream_chain_cb, data);
+}
+
+static void
+test_source_browse_stream_chained (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlResultStream *stream;
+  StreamChainData data = { 0, };
+
+  source = test_source_new (300);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  stream = grl_source_browse_stream (source, NULL, keys, options);
+  grl_result_stream_next_async (stream, NULL, stream_chain_cb, &data);
+  while (!data.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_no_error (data.error);
+  g_assert_cmpuint (data.received, ==, 300);
+
+  g_object_unref (stream);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+typedef struct {
+  guint pending;
+  gboolean resolved;
+} ResolveBatchData;
+
+static void
+resolve_batch_cb (GrlSource *source,
+                  guint operation_id,
+                  GrlMedia *media,
+                  gpointer user_data,
+                  const GError *error)
+{
+  ResolveBatchData *data = user_data;
+
+  g_assert_no_error (error);
+
+  if (g_strcmp0 (grl_media_get_title (media), grl_media_get_id (media)) != 0)
+    data->resolved = FALSE;
+
+  data->pending--;
+}
+
+/* Resolutions of a source implementing resolve_batch() are grouped up to the
+ * batch size, and the rest are sent once the latency expires */
+static void
+test_source_resolve_batch (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GList *keys;
+  ResolveBatchData data = { 0, };
+  guint i;
+
+  source = g_object_new (TEST_TYPE_BATCH_SOURCE,
+                         "source-id", "test-batch-source",
+                         "source-name", "Test batch source",
+                         "resolve-batch-size", 50,
+                         "resolve-batch-latency", 200,
+                         NULL);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE, NULL);
+  options = grl_operation_options_new (NULL);
+
+  data.resolved = TRUE;
+  data.pending = 120;
+
+  for (i = 0; i < 120; i++) {
+    GrlMedia *media = grl_media_new ();
+    gchar *id = g_strdup_printf ("%u", i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_source (media, grl_source_get_id (source));
+    g_free (id);
+
+    grl_source_resolve (source, media, keys, options, resolve_batch_cb, &data);
+    g_object_unref (media);
+  }
+
+  while (data.pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (data.resolved);
+  g_assert_cmpuint (TEST_BATCH_SOURCE (source)->batch_calls, ==, 3);
+  g_assert_cmpuint (TEST_BATCH_SOURCE (source)->max_batch, ==, 50);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 0);
+
+  /* Thread-safe sources keep resolving one by one in the workers */
+  g_object_set (source,
+                "thread-safe", TRUE,
+                "max-concurrency", 1,
+                NULL);
+  data.pending = 20;
+
+  for (i = 0; i < 20; i++) {
+    GrlMedia *media = grl_media_new ();
+    gchar *id = g_strdup_printf ("%u", i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_source (media, grl_source_get_id (source));
+    g_free (id);
+
+    grl_source_resolve (source, media, keys, options, resolve_batch_cb, &data);
+    g_object_unref (media);
+  }
+
+  while (data.pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (data.resolved);
+  g_assert_cmpuint (TEST_BATCH_SOURCE (source)->batch_calls, ==, 3);
+  g_assert_cmpuint (TEST_SOURCE (source)->resolve_calls, ==, 20);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+static GrlMedia *
+resolve_title_and_artist (GrlSource *source,
+                          GrlOperationOptions *options)
+{
+  GrlMedia *media;
+  GList *keys;
+  GError *error = NULL;
+
+  media = grl_media_new ();
+  grl_media_set_id (media, "42");
+  grl_media_set_source (media, grl_source_get_id (source));
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_ARTIST,
+                                    NULL);
+  media = grl_source_resolve_sync (source, media, keys, options, &error);
+  g_assert_no_error (error);
+  g_list_free (keys);
+
+  return media;
+}
+
+/* Resolution plans are reused across operations, but must follow the sources
+ * coming and going in the registry */
+static void
+test_source_resolve_plans (void)
+{
+  GrlRegistry *registry;
+  GrlPlugin *plugin;
+  GrlSource *source;
+  GrlSource *artist_source;
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  GError *error = NULL;
+  guint i;
+
+  registry = grl_registry_get_default ();
+  plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+  source = test_source_new (0);
+  artist_source = g_object_new (TEST_TYPE_ARTIST_SOURCE,
+                                "source-id", "test-artist-source",
+                                "source-name", "Test artist source",
+                                NULL);
+
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_FULL);
+
+  /* Nobody can resolve the artist yet */
+  for (i = 0; i < 2; i++) {
+    media = resolve_title_and_artist (source, options);
+    g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+    g_assert_null (grl_media_get_artist (media));
+    g_object_unref (media);
+  }
+
+  /* A new source is taken into account */
+  g_assert_true (grl_registry_register_source (registry, plugin,
+                                               g_object_ref (artist_source),
+                                               &error));
+  g_assert_no_error (error);
+
+  for (i = 0; i < 2; i++) {
+    media = resolve_title_and_artist (source, options);
+    g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+    g_assert_cmpstr (grl_media_get_artist (media), ==, "42");
+    g_object_unref (media);
+  }
+
+  /* And forgotten once it goes away */
+  g_assert_true (grl_registry_unregister_source (registry, artist_source,
+                                                 &error));
+  g_assert_no_error (error);
+
+  media = resolve_title_and_artist (source, options);
+  g_assert_cmpstr (grl_media_get_title (media), ==, "42");
+  g_assert_null (grl_media_get_artist (media));
+  g_object_unref (media);
+
+  g_object_unref (options);
+  g_object_unref (artist_source);
+  g_object_unref (source);
+  g_object_unref (plugin);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GrlSource *short_source;
+  guint short_received;
+  guint long_received;
+  guint last_remaining;
+  GHashTable *ids;
+} MultipleSearchData;
+
+static void
+multiple_search_cb (GrlSource *source,
+                    guint operation_id,
+                    GrlMedia *media,
+                    guint remaining,
+                    gpointer user_data,
+                    const GError *error)
+{
+  MultipleSearchData *data = user_data;
+
+  g_assert_no_error (error);
+
+  data->last_remaining = remaining;
+
+  if (media) {
+    if (source == data->short_source) {
+      data->short_received++;
+    } else {
+      data->long_received++;
+      /* Refills continue where the previous request stopped */
+      g_assert_false (g_hash_table_contains (data->ids,
+                                             grl_media_get_id (media)));
+      g_hash_table_add (data->ids, g_strdup (grl_media_get_id (media)));
+    }
+    g_object_unref (media);
+  }
+
+  if (remaining == 0)
+    g_main_loop_quit (data->loop);
+}
+
+/* A source running out of results has its share taken over by the others */
+static void
+test_source_multiple_search_refill (void)
+{
+  MultipleSearchData data = { 0, };
+  GrlOperationOptions *options;
+  GList *sources;
+  GList *keys;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  data.short_source = test_source_new (3);
+  data.last_remaining = G_MAXUINT;
+
+  sources = g_list_append (NULL, data.short_source);
+  sources = g_list_append (sources, test_source_new (100));
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 20);
+
+  grl_multiple_search (sources, "test", keys, options,
+                       multiple_search_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpuint (data.short_received, ==, 3);
+  g_assert_cmpuint (data.long_received, ==, 17);
+  g_assert_cmpuint (data.last_remaining, ==, 0);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_list_free_full (sources, g_object_unref);
+  g_hash_table_unref (data.ids);
+  g_main_loop_unref (data.loop);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GrlSource *slow_source;
+  gboolean slow_started;
+  guint after_slow;
+  guint received;
+} RefillOrderData;
+
+static void
+refill_order_cb (GrlSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 guint remaining,
+                 gpointer user_data,
+                 const GError *error)
+{
+  RefillOrderData *data = user_data;
+
+  g_assert_no_error (error);
+
+  if (media) {
+    if (source == data->slow_source)
+      data->slow_started = TRUE;
+    else if (data->slow_started)
+      data->after_slow++;
+    data->received++;
+    g_object_unref (media);
+  }
+
+  if (remaining == 0)
+    g_main_loop_quit (data->loop);
+}
+
+/* Returns how many results of the other sources came after the first one of
+ * @slow_source, when the share of a short source has to be taken over */
+static guint
+refill_order_search (GList *sources,
+                     GrlSource *slow_source,
+                     gboolean continuous)
+{
+  RefillOrderData data = { 0, };
+  GrlOperationOptions *options;
+  GList *keys;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.slow_source = slow_source;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID, NULL);
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 21);
+  grl_operation_options_set_continuous_refill (options, continuous);
+
+  grl_multiple_search (sources, "test", keys, options,
+                       refill_order_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpuint (data.received, ==, 21);
+
+  g_object_unref (options);
+  g_list_free (keys);
+  g_main_loop_unref (data.loop);
+
+  return data.after_slow;
+}
+
+/* By default the missing results are asked for once every source finished;
+ * with continuous refill, without waiting for the slow one */
+static void
+test_source_multiple_search_continuous_refill (void)
+{
+  GrlSource *slow_source;
+  GList *sources;
+
+  slow_source = test_source_new (100);
+  TEST_SOURCE (slow_source)->delay = 200;
+  g_object_set (slow_source, "thread-safe", TRUE, NULL);
+
+  sources = g_list_append (NULL, test_source_new (3));
+  sources = g_list_append (sources, test_source_new (100));
+  sources = g_list_append (sources, slow_source);
+
+  g_assert_cmpuint (refill_order_search (sources, slow_source, FALSE), >, 0);
+  g_assert_cmpuint (refill_order_search (sources, slow_source, TRUE), ==, 0);
+
+  g_list_free_full (sources, g_object_unref);
+}
+
+typedef struct {
+  GMainLoop *loop;
+  GString *ids;
+} MergeData;
+
+static void
+merge_search_cb (GrlSource *source,
+                 guint operation_id,
+                 GrlMedia *media,
+                 guint remaining,
+                 gpointer user_data,
+                 const GError *error)
+{
+  MergeData *data = user_data;
+
+  g_assert_no_error (error);
+
+  if (media) {
+    g_string_append (data->ids, grl_media_get_id (media));
+    g_object_unref (media);
+  }
+
+  if (remaining == 0)
+    g_main_loop_quit (data->loop);
+}
+
+static gchar *
+merge_search (guint total_a,
+              guint total_b,
+              GrlOperationOptions *options)
+{
+  MergeData data;
+  GList *sources;
+  GList *keys;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.ids = g_string_new (NULL);
+
+  sources = g_list_append (NULL, test_source_new (total_a));
+  sources = g_list_append (sources, test_source_new (total_b));
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    NULL);
+
+  grl_multiple_search (sources, "test", keys, options,
+                       merge_search_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_list_free (keys);
+  g_list_free_full (sources, g_object_unref);
+  g_main_loop_unref (data.loop);
+
+  return g_string_free (data.ids, FALSE);
+}
+
+/* Results of several sources can be interleaved, sorted and deduplicated */
+static void
+test_source_multiple_search_merge (void)
+{
+  GrlOperationOptions *options;
+  gchar *ids;
+
+  /* Both sources return the same media */
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 10);
+  grl_operation_options_set_merge_order (options, GRL_MERGE_RANK,
+                                         GRL_METADATA_KEY_INVALID);
+  grl_operation_options_set_dedup_key (options, GRL_METADATA_KEY_ID);
+
+  ids = merge_search (5, 5, options);
+  g_assert_cmpstr (ids, ==, "01234");
+  g_free (ids);
+  g_object_unref (options);
+
+  /* Sorted by title, keeping duplicates */
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 6);
+  g_assert_false (grl_operation_options_set_merge_order (options,
+                                                         GRL_MERGE_ASCENDING,
+                                                         GRL_METADATA_KEY_INVALID));
+  g_assert_true (grl_operation_options_set_merge_order (options,
+                                                        GRL_MERGE_ASCENDING,
+                                                        GRL_METADATA_KEY_TITLE));
+
+  ids = merge_search (3, 100, options);
+  g_assert_cmpstr (ids, ==, "001122");
+  g_free (ids);
+  g_object_unref (options);
+}
+
+/* Browsing several sources does not wait forever for a dead one, and
+ * querying several sources returns the results of all of them */
+static void
+test_source_multiple_browse_timeout (void)
+{
+  MergeData data;
+  GrlOperationOptions *options;
+  GList *sources;
+  GList *keys;
+  GList *medias;
+  GError *error = NULL;
+
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.ids = g_string_new (NULL);
+
+  sources = g_list_append (NULL, test_source_new (5));
+  sources = g_list_append (sources, test_source_new (5));
+  TEST_SOURCE (sources->next->data)->dead = TRUE;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID, NULL);
+
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_count (options, 10);
+  grl_operation_options_set_source_timeout (options, 50);
+
+  grl_multiple_browse (sources, NULL, keys, options,
+                       merge_search_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpstr (data.ids->str, ==, "01234");
+
+  /* A source confirming the cancellation after the timeout is ignored */
+  TEST_SOURCE (sources->next->data)->dead = FALSE;
+  TEST_SOURCE (sources->next->data)->late = TRUE;
+  g_string_truncate (data.ids, 0);
+
+  grl_multiple_browse (sources, NULL, keys, options,
+                       merge_search_cb, &data);
+  g_main_loop_run (data.loop);
+
+  g_assert_cmpstr (data.ids->str, ==, "01234");
+  while (!TEST_SOURCE (sources->next->data)->late_answered)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (options);
+
+  TEST_SOURCE (sources->next->data)->late = FALSE;
+  options = grl_operation_options_new (NULL);
+  medias = grl_multiple_query_sync (sources, "query", keys, options, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_list_length (medias), ==, 10);
+
+  g_list_free_full (medias, g_object_unref);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_list_free_full (sources, g_object_unref);
+  g_string_free (data.ids, TRUE);
+  g_main_loop_unref (data.loop);
+}
+
+/* Operations on a source that never answers complete when their deadline
+ * expires */
+static void
+test_source_deadline (void)
+{
+  GrlSource *source;
+  GrlOperationOptions *options;
+  GrlMedia *media;
+  GList *keys;
+  GList *medias;
+  GError *error = NULL;
+
+  source = test_source_new (5);
+  TEST_SOURCE (source)->dead = TRUE;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    NULL);
+
+  options = grl_operation_options_new (NULL);
+  grl_operation_options_set_deadline (options, 50);
+  g_assert_cmpuint (grl_operation_options_get_deadline (options), ==, 50);
+
+  medias = grl_source_browse_sync (source, NULL, keys, options, &error);
+  g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_TIMED_OUT);
+  g_assert_null (medias);
+  g_clear_error (&error);
+
+  media = grl_media_new ();
+  grl_media_set_id (media, "1");
+  media = grl_source_resolve_sync (source, media, keys, options, &error);
+  g_assert_error (error, GRL_CORE_ERROR, GRL_CORE_ERROR_OPERATION_TIMED_OUT);
+  g_assert_nonnull (media);
+  g_assert_null (grl_media_get_title (media));
+  g_clear_error (&error);
+
+  /* Sources answering in time are not affected */
+  TEST_SOURCE (source)->dead = FALSE;
+  medias = grl_source_browse_sync (source, NULL, keys, options, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_list_length (medias), ==, 5);
+
+  g_list_free_full (medias, g_object_unref);
+  g_object_unref (media);
+  g_object_unref (options);
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+int
+main (int argc, char **argv)
+{
+  setlocale (LC_ALL, "");
+
+  g_test_init (&argc, &argv, NULL);
+
+  grl_init (&argc, &argv);
+
+  g_test_add_func ("/source/browse/resolve-full", test_source_browse_resolve_full);
+  g_test_add_func ("/source/browse/batched", test_source_browse_batched);
+  g_test_add_func ("/source/browse/auto-split-window", test_source_browse_auto_split_window);
+  g_test_add_func ("/source/browse/auto-split-tuner", test_source_browse_auto_split_tuner);
+  g_test_add_func ("/source/resolve/cache", test_source_resolve_cache);
+  g_test_add_func ("/source/resolve/batch", test_source_resolve_batch);
+  g_test_add_func ("/source/resolve/plans", test_source_resolve_plans);
+  g_test_add_func ("/source/resolve/persistent-cache",
+                   test_source_resolve_persistent_cache);
+  g_test_add_func ("/source/browse/cancel-from-thread-running",
+                   test_source_browse_cancel_from_thread_running);
+  g_test_add_func ("/source/browse/cancel-from-thread",
+                   test_source_browse_cancel_from_thread);
+  g_test_add_func ("/source/browse/threaded", test_source_browse_threaded);
+  g_test_add_func ("/source/browse/threaded-cancel-dead",
+                   test_source_browse_threaded_cancel_dead);
+  g_test_add_func ("/source/browse/sync-private-context",
+                   test_source_browse_sync_private_context);
+  g_test_add_func ("/source/browse/sync-from-thread",
+                   test_source_browse_sync_from_thread);
+  g_test_add_func ("/source/browse/async", test_source_browse_async);
+  g_test_add_func ("/source/browse/async-error",
+                   test_source_browse_async_error);
+  g_test_add_func ("/source/browse/stream", test_source_browse_stream);
+  g_test_add_func ("/source/browse/stream-error",
+                   test_source_browse_stream_error);
+  g_test_add_func ("/source/browse/stream-chained",
+                   test_source_browse_stream_chained);
+  g_test_add_func ("/source/multiple-search/refill",
+                   test_source_multiple_search_refill);
+  g_test_add_func ("/source/multiple-search/continuous-refill",
+                   test_source_multiple_search_continuous_refill);
+  g_test_add_func ("/source/multiple-search/merge",
+                   test_source_multiple_search_merge);
+  g_test_add_func ("/source/multiple-browse/timeout",
+                   test_source_multiple_browse_timeout);
+  g_test_add_func ("/source/deadline", test_source_deadline);
+
+  return g_test_run ();
+}